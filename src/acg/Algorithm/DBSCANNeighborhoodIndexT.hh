@@ -0,0 +1,398 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#ifndef DBSCANNEIGHBORHOODINDEXT_HH_
+#define DBSCANNEIGHBORHOODINDEXT_HH_
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cassert>
+
+namespace ACG {
+namespace Algorithm {
+
+/*
+ * Neighborhood index policies for DBSCAN.
+ *
+ * A neighborhood index has to provide
+ *
+ *     template<typename INPUT_ITERATOR>
+ *     void build(INPUT_ITERATOR first, INPUT_ITERATOR last, double epsilon);
+ *
+ *     template<typename OUTPUT_ITERATOR>
+ *     void query(size_t idx, OUTPUT_ITERATOR result) const;
+ *
+ * build() is called once before clustering. query() outputs the indices of candidate
+ * neighbors of the element with index idx, in any order. The candidates have to be a
+ * superset of all elements within epsilon of that element according to the distance
+ * function passed to DBSCAN. They may contain idx itself. DBSCAN checks every candidate
+ * with the distance function, so the cluster assignment does not depend on the index.
+ *
+ * The indices below are conservative for the Euclidean distance of the coordinates
+ * returned by POSITION_FUNC. POSITION_FUNC is a unary function taking an element and
+ * returning its position, which has to support operator[] for 0 <= i < DIM.
+ */
+
+namespace _DBSCAN_PRIVATE {
+
+/*
+ * Query radius of the indices, slightly enlarged so that rounding errors of the
+ * distance function never drop a neighbor.
+ */
+inline double conservative_radius(const double epsilon) {
+    return epsilon * (1.0 + 1e-6);
+}
+
+} /* namespace _DBSCAN_PRIVATE */
+
+/**
+ * Reports all elements as candidates. Supports arbitrary distance functions, but
+ * clustering stays quadratic in the number of elements.
+ */
+class BruteForceNeighborhoodIndex {
+    public:
+        BruteForceNeighborhoodIndex() : size_(0) {}
+
+        template<typename INPUT_ITERATOR>
+        void build(INPUT_ITERATOR first, const INPUT_ITERATOR last, const double /* epsilon */) {
+            size_ = std::distance(first, last);
+        }
+
+        template<typename OUTPUT_ITERATOR>
+        void query(const size_t /* idx */, OUTPUT_ITERATOR result) const {
+            for (size_t i = 0; i < size_; ++i)
+                *result++ = i;
+        }
+
+    private:
+        size_t size_;
+};
+
+/**
+ * Uniform grid with cells of edge length epsilon. The neighbors of an element are
+ * located in the 3^DIM cells around its own cell.
+ *
+ * Only occupied cells are stored, so memory is linear in the number of elements
+ * regardless of the extent of the input. Best for evenly dense data.
+ *
+ * Falls back to reporting all elements like BruteForceNeighborhoodIndex if epsilon
+ * is not positive or a position has no valid cell (non-finite or huge coordinates).
+ */
+template<typename POSITION_FUNC, int DIM = 3>
+class GridNeighborhoodIndex {
+    public:
+        explicit GridNeighborhoodIndex(POSITION_FUNC position_func = POSITION_FUNC()) :
+            position_func_(position_func), cell_size_(1.0), brute_force_(false) {}
+
+        template<typename INPUT_ITERATOR>
+        void build(INPUT_ITERATOR first, const INPUT_ITERATOR last, const double epsilon) {
+            cell_size_ = _DBSCAN_PRIVATE::conservative_radius(epsilon);
+
+            const size_t input_size = std::distance(first, last);
+            coords_.resize(input_size * DIM);
+            elements_.resize(input_size);
+            cells_.clear();
+
+            brute_force_ = !(cell_size_ > 0);
+            for (size_t idx = 0; first != last && !brute_force_; ++first, ++idx) {
+                brute_force_ = !cell_of(position_func_(*first), &coords_[idx * DIM]);
+                elements_[idx] = idx;
+            }
+
+            if (brute_force_) {
+                std::vector<long long>().swap(coords_);
+                for (size_t i = 0; i < input_size; ++i) elements_[i] = i;
+                return;
+            }
+
+            // Sort the elements by cell, the x-neighbors of a cell are consecutive.
+            std::sort(elements_.begin(), elements_.end(), cell_less(coords_));
+
+            for (size_t i = 0; i < input_size; ++i) {
+                if (i == 0 || cell_less(coords_)(elements_[i-1], elements_[i]))
+                    cells_.push_back(i);
+            }
+            cells_.push_back(input_size);
+        }
+
+        template<typename OUTPUT_ITERATOR>
+        void query(const size_t idx, OUTPUT_ITERATOR result) const {
+            if (brute_force_) {
+                for (size_t i = 0; i < elements_.size(); ++i)
+                    *result++ = i;
+                return;
+            }
+
+            const long long *center = &coords_[idx * DIM];
+
+            // Iterate over the 3^(DIM-1) neighboring rows of cells along x.
+            long long row[DIM];
+            int offset[DIM] = { 0 };
+            for (int d = 1; d < DIM; ++d) offset[d] = -1;
+
+            for (;;) {
+                row[0] = center[0] - 1;
+                for (int d = 1; d < DIM; ++d) row[d] = center[d] + offset[d];
+
+                // First cell of the row with x >= center[0] - 1.
+                size_t cell = std::lower_bound(cells_.begin(), cells_.end() - 1, row, cell_key_less(coords_, elements_)) - cells_.begin();
+
+                for (; cell + 1 < cells_.size(); ++cell) {
+                    const long long *c = &coords_[elements_[cells_[cell]] * DIM];
+                    if (!same_row(c, row) || c[0] > center[0] + 1) break;
+
+                    for (size_t i = cells_[cell]; i < cells_[cell + 1]; ++i)
+                        *result++ = elements_[i];
+                }
+
+                int d = 1;
+                for (; d < DIM && offset[d] == 1; ++d) offset[d] = -1;
+                if (d == DIM) break;
+                ++offset[d];
+            }
+        }
+
+    private:
+        // Returns false if a coordinate is not finite or too large for a cell index.
+        template<typename POSITION>
+        bool cell_of(const POSITION &position, long long *cell) const {
+            for (int d = 0; d < DIM; ++d) {
+                const double c = std::floor(static_cast<double>(position[d]) / cell_size_);
+                // The neighbor rows at c +- 1 have to be representable as well.
+                if (!(std::fabs(c) < 4611686018427387904.0)) return false;
+                cell[d] = static_cast<long long>(c);
+            }
+            return true;
+        }
+
+        static bool same_row(const long long *a, const long long *b) {
+            for (int d = 1; d < DIM; ++d)
+                if (a[d] != b[d]) return false;
+            return true;
+        }
+
+        // Lexicographic order of cells, x varies fastest.
+        static bool less_cell(const long long *a, const long long *b) {
+            for (int d = DIM - 1; d >= 0; --d) {
+                if (a[d] != b[d]) return a[d] < b[d];
+            }
+            return false;
+        }
+
+        class cell_less {
+            public:
+                explicit cell_less(const std::vector<long long> &coords) : coords_(coords) {}
+                bool operator()(size_t a, size_t b) const {
+                    return less_cell(&coords_[a * DIM], &coords_[b * DIM]);
+                }
+            private:
+                const std::vector<long long> &coords_;
+        };
+
+        class cell_key_less {
+            public:
+                cell_key_less(const std::vector<long long> &coords, const std::vector<size_t> &elements) :
+                    coords_(coords), elements_(elements) {}
+                bool operator()(size_t cell_begin, const long long *key) const {
+                    return less_cell(&coords_[elements_[cell_begin] * DIM], key);
+                }
+            private:
+                const std::vector<long long> &coords_;
+                const std::vector<size_t> &elements_;
+        };
+
+        POSITION_FUNC position_func_;
+        double cell_size_;
+        bool brute_force_;                // Report all elements, see class description.
+
+        std::vector<long long> coords_;   // Cell coordinates of each element.
+        std::vector<size_t> elements_;    // Element indices sorted by cell.
+        std::vector<size_t> cells_;       // Start of each cell in elements_, followed by elements_.size().
+};
+
+/**
+ * Balanced kd-tree over the element positions. Adapts to varying density and
+ * clustered data better than GridNeighborhoodIndex.
+ */
+template<typename POSITION_FUNC, int DIM = 3>
+class KdTreeNeighborhoodIndex {
+    public:
+        explicit KdTreeNeighborhoodIndex(POSITION_FUNC position_func = POSITION_FUNC()) :
+            position_func_(position_func), radius_(1.0) {}
+
+        template<typename INPUT_ITERATOR>
+        void build(INPUT_ITERATOR first, const INPUT_ITERATOR last, const double epsilon) {
+            radius_ = _DBSCAN_PRIVATE::conservative_radius(epsilon);
+
+            const size_t input_size = std::distance(first, last);
+            positions_.resize(input_size * DIM);
+            elements_.resize(input_size);
+
+            for (size_t idx = 0; first != last; ++first, ++idx) {
+                for (int d = 0; d < DIM; ++d)
+                    positions_[idx * DIM + d] = static_cast<double>(position_func_(*first)[d]);
+                elements_[idx] = idx;
+            }
+
+            nodes_.clear();
+            if (input_size > 0) {
+                nodes_.reserve(4 * (input_size / LEAF_SIZE) + 1);
+                nodes_.resize(1);
+                build_node(0, 0, input_size, 0);
+            }
+        }
+
+        template<typename OUTPUT_ITERATOR>
+        void query(const size_t idx, OUTPUT_ITERATOR result) const {
+            if (nodes_.empty()) return;
+
+            const double *center = &positions_[idx * DIM];
+            const double sqr_radius = radius_ * radius_;
+
+            // Explicit stack, holds at most one node per level, see build_node().
+            size_t stack[MAX_DEPTH + 1];
+            int stack_size = 0;
+            stack[stack_size++] = 0;
+
+            while (stack_size > 0) {
+                const Node &node = nodes_[stack[--stack_size]];
+
+                if (node.axis < 0) {
+                    for (size_t i = node.begin; i < node.end; ++i) {
+                        const double *p = &positions_[elements_[i] * DIM];
+                        double sqr_dist = 0;
+                        for (int d = 0; d < DIM; ++d)
+                            sqr_dist += (p[d] - center[d]) * (p[d] - center[d]);
+                        if (sqr_dist <= sqr_radius)
+                            *result++ = elements_[i];
+                    }
+                    continue;
+                }
+
+                if (center[node.axis] - radius_ <= node.split)
+                    stack[stack_size++] = node.left;
+                if (center[node.axis] + radius_ >= node.split)
+                    stack[stack_size++] = node.left + 1;
+            }
+        }
+
+    private:
+        static const size_t LEAF_SIZE = 16;
+
+        // Median splits halve the elements on each level, so the depth stays below 64 for any input size.
+        static const int MAX_DEPTH = 64;
+
+        struct Node {
+            int axis;               // Split axis, -1 for leaves.
+            double split;           // Split coordinate, left children are <= split, right children >= split.
+            size_t left;            // Index of the left child, the right child follows it.
+            size_t begin, end;      // Range of elements_ of a leaf.
+        };
+
+        class axis_less {
+            public:
+                axis_less(const std::vector<double> &positions, int axis) : positions_(positions), axis_(axis) {}
+                bool operator()(size_t a, size_t b) const {
+                    return positions_[a * DIM + axis_] < positions_[b * DIM + axis_];
+                }
+            private:
+                const std::vector<double> &positions_;
+                int axis_;
+        };
+
+        void build_node(const size_t node_idx, const size_t begin, const size_t end, const int depth) {
+            assert(depth < MAX_DEPTH);
+
+            nodes_[node_idx].axis = -1;
+            nodes_[node_idx].split = 0;
+            nodes_[node_idx].left = 0;
+            nodes_[node_idx].begin = begin;
+            nodes_[node_idx].end = end;
+
+            if (end - begin <= LEAF_SIZE) return;
+
+            // Split the axis of largest extent at the median.
+            double extent_max = -1;
+            int axis = 0;
+            for (int d = 0; d < DIM; ++d) {
+                double lo = positions_[elements_[begin] * DIM + d], hi = lo;
+                for (size_t i = begin + 1; i < end; ++i) {
+                    const double x = positions_[elements_[i] * DIM + d];
+                    lo = std::min(lo, x);
+                    hi = std::max(hi, x);
+                }
+                if (hi - lo > extent_max) {
+                    extent_max = hi - lo;
+                    axis = d;
+                }
+            }
+
+            const size_t mid = begin + (end - begin) / 2;
+            std::nth_element(elements_.begin() + begin, elements_.begin() + mid, elements_.begin() + end, axis_less(positions_, axis));
+
+            // Both children are stored next to each other.
+            const size_t left = nodes_.size();
+            nodes_.resize(left + 2);
+
+            nodes_[node_idx].axis = axis;
+            nodes_[node_idx].split = positions_[elements_[mid] * DIM + axis];
+            nodes_[node_idx].left = left;
+
+            build_node(left, begin, mid, depth + 1);
+            build_node(left + 1, mid, end, depth + 1);
+        }
+
+        POSITION_FUNC position_func_;
+        double radius_;
+
+        std::vector<double> positions_;   // Coordinates of each element.
+        std::vector<size_t> elements_;    // Element indices, leaves reference ranges.
+        std::vector<Node> nodes_;         // Root is nodes_[0].
+};
+
+} /* namespace Algorithm */
+} /* namespace ACG */
+
+#endif /* DBSCANNEIGHBORHOODINDEXT_HH_ */
@@ -46,6 +46,12 @@
 #include <iterator>
 #include <algorithm>
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "DBSCANNeighborhoodIndexT.hh"
+
 /*
  * Private functions.
  */
@@ -89,34 +95,72 @@ template<typename INPUT_ITERATOR, typename DISTANCE_FUNC, typename OUTPUT_ITERAT
 int DBSCAN(const INPUT_ITERATOR first, const INPUT_ITERATOR last, DISTANCE_FUNC distance_func,
            OUTPUT_ITERATOR result, const double epsilon, const double n_min, WEIGHT_FUNC weight_func) {
 
-    const size_t input_size = std::distance(first, last);
-
-    std::vector<int> id_cache(input_size, -1);
+    _DBSCAN_PRIVATE::brute_force_region_query<INPUT_ITERATOR, DISTANCE_FUNC> region_query(first, last, distance_func, epsilon);
+    return _DBSCAN_PRIVATE::dbscan(first, last, region_query, result, n_min, weight_func);
+}
 
-    int idx = 0;
-    int current_cluster_id = 0;
+/**
+ * Version of DBSCAN that finds the neighborhoods with a spatial index instead of
+ * scanning the whole input for every element. The result is the same as without
+ * the index, the distance function still decides which elements are neighbors.
+ *
+ * Example:
+ *
+ *     ACG::Algorithm::DBSCAN(points.begin(), points.end(), DistanceFunc(),
+ *                            std::back_inserter(clusters), 0.1, 5, WeightFunc(),
+ *                            ACG::Algorithm::GridNeighborhoodIndex<PositionFunc, 3>())
+ *
+ * @param neighborhood_index Neighborhood index policy, see DBSCANNeighborhoodIndexT.hh.
+ *   GridNeighborhoodIndex and KdTreeNeighborhoodIndex support the Euclidean distance.
+ *   build() is called on it before clustering.
+ */
+template<typename INPUT_ITERATOR, typename DISTANCE_FUNC, typename OUTPUT_ITERATOR, typename WEIGHT_FUNC, typename NEIGHBORHOOD_INDEX>
+int DBSCAN(const INPUT_ITERATOR first, const INPUT_ITERATOR last, DISTANCE_FUNC distance_func,
+           OUTPUT_ITERATOR result, const double epsilon, const double n_min, WEIGHT_FUNC weight_func,
+           NEIGHBORHOOD_INDEX neighborhood_index) {
 
-    for (INPUT_ITERATOR it = first; it != last; ++it, ++idx) {
+    neighborhood_index.build(first, last, epsilon);
 
-        // Visit every element only once.
-        if (id_cache[idx] >= 0) continue;
+    const std::vector<INPUT_ITERATOR> elements = _DBSCAN_PRIVATE::element_table(first, last);
+    _DBSCAN_PRIVATE::indexed_region_query<INPUT_ITERATOR, DISTANCE_FUNC, NEIGHBORHOOD_INDEX>
+        region_query(elements, distance_func, epsilon, neighborhood_index);
+    return _DBSCAN_PRIVATE::dbscan(first, last, region_query, result, n_min, weight_func);
+}
 
-        // Gather neighborhood.
-        std::vector<INPUT_ITERATOR> neighborhood; neighborhood.reserve(input_size);
-        _DBSCAN_PRIVATE::region_query(first, last, it, distance_func, std::back_inserter(neighborhood), epsilon);
+/**
+ * Multi-threaded version of DBSCAN with a neighborhood index.
+ *
+ * Core elements are determined in parallel and merged with a lock-free union-find instead
+ * of a breadth-first search. Clusters are numbered and border elements are assigned
+ * exactly like the sequential DBSCAN does, so the result is identical to it and does not
+ * depend on the number of threads.
+ *
+ * Every element is queried once, like in the sequential DBSCAN. The neighborhoods of core
+ * elements are kept for merging and border assignment, which needs memory for one int per
+ * neighbor of each core element.
+ *
+ * distance_func, weight_func and the query() of neighborhood_index are called concurrently.
+ * distance_func has to be symmetric.
+ *
+ * @param neighborhood_index Neighborhood index policy, see DBSCANNeighborhoodIndexT.hh.
+ *   BruteForceNeighborhoodIndex supports arbitrary distance functions.
+ * @param num_threads Number of threads, 0 uses all available OpenMP threads.
+ */
+template<typename INPUT_ITERATOR, typename DISTANCE_FUNC, typename OUTPUT_ITERATOR, typename WEIGHT_FUNC, typename NEIGHBORHOOD_INDEX>
+int DBSCANParallel(const INPUT_ITERATOR first, const INPUT_ITERATOR last, DISTANCE_FUNC distance_func,
+                   OUTPUT_ITERATOR result, const double epsilon, const double n_min, WEIGHT_FUNC weight_func,
+                   NEIGHBORHOOD_INDEX neighborhood_index, int num_threads = 0) {
 
-        if (_DBSCAN_PRIVATE::neighborhoodWeight(neighborhood.begin(), neighborhood.end(), weight_func) < n_min) {
-            // It's noise.
-            id_cache[idx] = 0;
-        } else {
-            // It's the seed of a cluster.
-            _DBSCAN_PRIVATE::expand_cluster(first, last, it, distance_func, epsilon, n_min, id_cache, ++current_cluster_id, weight_func);
-        }
-    }
+#ifdef USE_OPENMP
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+#else
+    num_threads = 1;
+#endif
 
-    std::copy(id_cache.begin(), id_cache.end(), result);
+    neighborhood_index.build(first, last, epsilon);
 
-    return current_cluster_id;
+    return _DBSCAN_PRIVATE::dbscan_parallel(first, last, distance_func, neighborhood_index, result,
+                                            epsilon, n_min, weight_func, num_threads);
 }
 
 /**
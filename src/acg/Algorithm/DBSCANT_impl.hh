@@ -40,6 +40,11 @@
 \*===========================================================================*/
 
 #include <queue>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <atomic>
 
 namespace ACG {
 namespace Algorithm {
@@ -79,23 +84,84 @@ void region_query(INPUT_ITERATOR first, const INPUT_ITERATOR last, const INPUT_I
 }
 
 
-template<typename INPUT_ITERATOR, typename DISTANCE_FUNC, typename WEIGHT_FUNC>
-inline
-void expand_cluster(INPUT_ITERATOR first, const INPUT_ITERATOR last, const INPUT_ITERATOR center,
-                    DISTANCE_FUNC &distance_func, const double epsilon, const double n_min,
-                    std::vector<int> &id_cache, const int current_cluster_id, WEIGHT_FUNC &weight_func) {
+/*
+ * Region query over the whole input range, O(n) per query.
+ */
+template<typename INPUT_ITERATOR, typename DISTANCE_FUNC>
+class brute_force_region_query {
+    public:
+        brute_force_region_query(const INPUT_ITERATOR first, const INPUT_ITERATOR last, DISTANCE_FUNC &distance_func, const double epsilon) :
+            first_(first), last_(last), distance_func_(distance_func), epsilon_(epsilon) {}
 
+        template<typename OUTPUT_ITERATOR>
+        void operator()(const INPUT_ITERATOR center, const size_t /* center_idx */, OUTPUT_ITERATOR result) {
+            region_query(first_, last_, center, distance_func_, result, epsilon_);
+        }
 
-    std::queue<INPUT_ITERATOR> bfq;
-    bfq.push(center);
+    private:
+        const INPUT_ITERATOR first_, last_;
+        DISTANCE_FUNC &distance_func_;
+        const double epsilon_;
+};
 
-    id_cache[std::distance(first, center)] = current_cluster_id;
+/*
+ * Region query on the candidates of a neighborhood index.
+ *
+ * Candidates are checked with the distance function and reported in input order,
+ * so the neighborhood is exactly the one of brute_force_region_query.
+ */
+template<typename INPUT_ITERATOR, typename DISTANCE_FUNC, typename NEIGHBORHOOD_INDEX>
+class indexed_region_query {
+    public:
+        /*
+         * elements holds an iterator to each element of the input. It is shared,
+         * so every thread can use its own region query.
+         */
+        indexed_region_query(const std::vector<INPUT_ITERATOR> &elements, DISTANCE_FUNC &distance_func, const double epsilon,
+                             const NEIGHBORHOOD_INDEX &neighborhood_index) :
+            elements_(elements), distance_func_(distance_func), epsilon_(epsilon), neighborhood_index_(neighborhood_index) {}
 
-    std::vector<INPUT_ITERATOR> neighborhood; neighborhood.reserve(std::distance(first, last));
+        template<typename OUTPUT_ITERATOR>
+        void operator()(const INPUT_ITERATOR center, const size_t center_idx, OUTPUT_ITERATOR result) {
+            candidates_.clear();
+            neighborhood_index_.query(center_idx, std::back_inserter(candidates_));
+            if (!std::is_sorted(candidates_.begin(), candidates_.end()))
+                std::sort(candidates_.begin(), candidates_.end());
+            candidates_.erase(std::unique(candidates_.begin(), candidates_.end()), candidates_.end());
+
+            for (std::vector<size_t>::const_iterator it = candidates_.begin(), it_end = candidates_.end(); it != it_end; ++it) {
+                if (*it == center_idx) continue;
+                if (distance_func_(*center, *elements_[*it]) <= epsilon_) {
+                    *result++ = elements_[*it];
+                }
+            }
+        }
+
+    private:
+        const std::vector<INPUT_ITERATOR> &elements_;
+        DISTANCE_FUNC &distance_func_;
+        const double epsilon_;
+        const NEIGHBORHOOD_INDEX &neighborhood_index_;
+        std::vector<size_t> candidates_;
+};
+
+
+template<typename INPUT_ITERATOR, typename REGION_QUERY, typename WEIGHT_FUNC>
+inline
+void expand_cluster(INPUT_ITERATOR first, const INPUT_ITERATOR center, const size_t center_idx,
+                    REGION_QUERY &region_query, const double n_min,
+                    std::vector<int> &id_cache, const int current_cluster_id, WEIGHT_FUNC &weight_func,
+                    std::vector<INPUT_ITERATOR> &neighborhood) {
+
+
+    std::queue<std::pair<INPUT_ITERATOR, size_t> > bfq;
+    bfq.push(std::make_pair(center, center_idx));
+
+    id_cache[center_idx] = current_cluster_id;
 
     while (!bfq.empty()) {
 
-        INPUT_ITERATOR current_element = bfq.front();
+        const std::pair<INPUT_ITERATOR, size_t> current_element = bfq.front();
         bfq.pop();
 
         /*
@@ -103,7 +169,7 @@ void expand_cluster(INPUT_ITERATOR first, const INPUT_ITERATOR last, const INPUT
          */
 
         neighborhood.clear();
-        region_query(first, last, current_element, distance_func, std::back_inserter(neighborhood), epsilon);
+        region_query(current_element.first, current_element.second, std::back_inserter(neighborhood));
 
         /*
          * If the current element is not inside a dense area,
@@ -126,10 +192,263 @@ void expand_cluster(INPUT_ITERATOR first, const INPUT_ITERATOR last, const INPUT
                  * Classify it and use it as a seed.
                  */
                 id_cache[neighbor_idx] = current_cluster_id;
-                bfq.push(*it);
+                bfq.push(std::make_pair(*it, neighbor_idx));
+            }
+        }
+    }
+}
+
+/*
+ * DBSCAN on an arbitrary region query.
+ */
+template<typename INPUT_ITERATOR, typename REGION_QUERY, typename OUTPUT_ITERATOR, typename WEIGHT_FUNC>
+int dbscan(const INPUT_ITERATOR first, const INPUT_ITERATOR last, REGION_QUERY &region_query,
+           OUTPUT_ITERATOR result, const double n_min, WEIGHT_FUNC &weight_func) {
+
+    const size_t input_size = std::distance(first, last);
+
+    std::vector<int> id_cache(input_size, -1);
+
+    int idx = 0;
+    int current_cluster_id = 0;
+
+    std::vector<INPUT_ITERATOR> neighborhood;
+
+    for (INPUT_ITERATOR it = first; it != last; ++it, ++idx) {
+
+        // Visit every element only once.
+        if (id_cache[idx] >= 0) continue;
+
+        // Gather neighborhood.
+        neighborhood.clear();
+        region_query(it, idx, std::back_inserter(neighborhood));
+
+        if (neighborhoodWeight(neighborhood.begin(), neighborhood.end(), weight_func) < n_min) {
+            // It's noise.
+            id_cache[idx] = 0;
+        } else {
+            // It's the seed of a cluster.
+            expand_cluster(first, it, idx, region_query, n_min, id_cache, ++current_cluster_id, weight_func, neighborhood);
+        }
+    }
+
+    std::copy(id_cache.begin(), id_cache.end(), result);
+
+    return current_cluster_id;
+}
+
+/*
+ * Iterators to all elements of [first, last), for random access by index.
+ */
+template<typename INPUT_ITERATOR>
+std::vector<INPUT_ITERATOR> element_table(INPUT_ITERATOR first, const INPUT_ITERATOR last) {
+    std::vector<INPUT_ITERATOR> elements;
+    elements.reserve(std::distance(first, last));
+    for (; first != last; ++first)
+        elements.push_back(first);
+    return elements;
+}
+
+/*
+ * Lock-free union-find. Roots are always linked below the root with the smaller
+ * index, so the root of a set is its smallest element, independent of the order
+ * of the unions.
+ */
+class concurrent_union_find {
+    public:
+        explicit concurrent_union_find(const int size) : parent_(size) {
+            for (int i = 0; i < size; ++i)
+                parent_[i].store(i, std::memory_order_relaxed);
+        }
+
+        int find(int i) {
+            for (;;) {
+                int parent = parent_[i].load(std::memory_order_acquire);
+                if (parent == i) return i;
+
+                // Path halving, fails harmlessly if another thread changed the parent.
+                const int grandparent = parent_[parent].load(std::memory_order_acquire);
+                if (grandparent != parent)
+                    parent_[i].compare_exchange_weak(parent, grandparent, std::memory_order_acq_rel);
+                i = grandparent;
+            }
+        }
+
+        void unite(int a, int b) {
+            for (;;) {
+                a = find(a);
+                b = find(b);
+                if (a == b) return;
+                if (a > b) std::swap(a, b);
+
+                // Link root b below a, retry if b is no root anymore.
+                int expected = b;
+                if (parent_[b].compare_exchange_strong(expected, a, std::memory_order_acq_rel))
+                    return;
+            }
+        }
+
+    private:
+        std::vector<std::atomic<int> > parent_;
+};
+
+/*
+ * Parallel DBSCAN on a neighborhood index, produces the same result as dbscan().
+ *
+ * 1. Core elements, whose neighborhood weight reaches n_min, are determined in parallel.
+ *    This is the only pass that queries the index, the neighborhoods of core elements are kept.
+ * 2. Core elements within epsilon of each other are merged in a lock-free union-find.
+ * 3. Clusters are numbered by their smallest core element, which is the order in which
+ *    dbscan() finds their seeds.
+ * 4. Border elements join the cluster with the smallest index among their core
+ *    neighbors, which is the first cluster that reaches them in dbscan(). As the distance
+ *    is symmetric, the core neighbors of a border element are the core elements that have
+ *    it in their neighborhood.
+ */
+template<typename INPUT_ITERATOR, typename DISTANCE_FUNC, typename NEIGHBORHOOD_INDEX, typename OUTPUT_ITERATOR, typename WEIGHT_FUNC>
+int dbscan_parallel(const INPUT_ITERATOR first, const INPUT_ITERATOR last, DISTANCE_FUNC &distance_func,
+                    const NEIGHBORHOOD_INDEX &neighborhood_index, OUTPUT_ITERATOR result,
+                    const double epsilon, const double n_min, WEIGHT_FUNC &weight_func, const int num_threads) {
+
+    typedef indexed_region_query<INPUT_ITERATOR, DISTANCE_FUNC, NEIGHBORHOOD_INDEX> REGION_QUERY;
+
+    const std::vector<INPUT_ITERATOR> elements = element_table(first, last);
+    const int input_size = static_cast<int>(elements.size());
+
+    std::vector<unsigned char> is_core(input_size, 0);
+    concurrent_union_find components(input_size);
+
+    // Neighbor indices of core elements, sorted by index. Each thread appends to its own
+    // buffer, the neighborhood of core element i is neighbors[list_thread[i]][list_begin[i], list_end[i]).
+    std::vector<std::vector<int> > neighbors(num_threads);
+    std::vector<int> list_thread(input_size, 0), list_begin(input_size, 0), list_end(input_size, 0);
+
+    // Elements claimed by a thread, each element is queried exactly once.
+    std::vector<std::atomic<unsigned char> > claimed(input_size);
+    for (int i = 0; i < input_size; ++i)
+        claimed[i].store(0, std::memory_order_relaxed);
+    std::atomic<int> next_seed(0);
+
+    // Core elements.
+    // Like the breadth-first search of dbscan(), each thread continues with the neighbors
+    // of the elements it has just queried, so that consecutive queries touch the same part
+    // of the index instead of jumping through the input. A walk stops growing after
+    // walk_size elements, so that a large cluster is shared among the threads.
+    const size_t walk_size = 64;
+
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(num_threads) if (num_threads > 1 && input_size > 1024)
+#endif
+    {
+#ifdef USE_OPENMP
+        const int thread = omp_get_thread_num();
+#else
+        const int thread = 0;
+#endif
+        std::vector<int>& thread_neighbors = neighbors[thread];
+
+        REGION_QUERY region_query(elements, distance_func, epsilon, neighborhood_index);
+        std::vector<INPUT_ITERATOR> neighborhood;
+        std::vector<int> walk;
+
+        for (;;) {
+            const int seed = next_seed.fetch_add(1, std::memory_order_relaxed);
+            if (seed >= input_size) break;
+            if (claimed[seed].exchange(1, std::memory_order_relaxed)) continue;
+
+            walk.clear();
+            walk.push_back(seed);
+
+            for (size_t w = 0; w < walk.size(); ++w) {
+                const int i = walk[w];
+
+                neighborhood.clear();
+                region_query(elements[i], i, std::back_inserter(neighborhood));
+                is_core[i] = neighborhoodWeight(neighborhood.begin(), neighborhood.end(), weight_func) >= n_min;
+
+                if (is_core[i]) {
+                    list_thread[i] = thread;
+                    list_begin[i] = static_cast<int>(thread_neighbors.size());
+                }
+
+                for (typename std::vector<INPUT_ITERATOR>::const_iterator it = neighborhood.begin(), it_end = neighborhood.end();
+                        it != it_end; ++it) {
+                    const int neighbor_idx = static_cast<int>(std::distance(first, *it));
+                    if (is_core[i])
+                        thread_neighbors.push_back(neighbor_idx);
+
+                    // Claimed elements stay in the walk until it is done, even if it stops growing.
+                    if (walk.size() < walk_size && !claimed[neighbor_idx].load(std::memory_order_relaxed) &&
+                            !claimed[neighbor_idx].exchange(1, std::memory_order_relaxed))
+                        walk.push_back(neighbor_idx);
+                }
+
+                if (is_core[i])
+                    list_end[i] = static_cast<int>(thread_neighbors.size());
             }
         }
     }
+
+    // Merge core elements within epsilon.
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads) if (num_threads > 1 && input_size > 1024)
+#endif
+    for (int i = 0; i < input_size; ++i) {
+        if (!is_core[i]) continue;
+
+        // Neighborhoods are sorted by index, each edge is merged from its larger end.
+        const std::vector<int>& list = neighbors[list_thread[i]];
+        for (int k = list_begin[i]; k < list_end[i]; ++k) {
+            const int neighbor_idx = list[k];
+            if (neighbor_idx > i) break;
+            if (is_core[neighbor_idx])
+                components.unite(i, neighbor_idx);
+        }
+    }
+
+    // Number the clusters in order of their smallest core element.
+    std::vector<int> id_cache(input_size, 0);
+    int current_cluster_id = 0;
+
+    for (int i = 0; i < input_size; ++i) {
+        if (!is_core[i]) continue;
+
+        const int root = components.find(i);
+        id_cache[i] = (root == i) ? ++current_cluster_id : id_cache[root];
+    }
+
+    // Assign border elements: each core element offers its cluster to its non-core neighbors,
+    // the smallest id wins.
+    std::vector<std::atomic<int> > border_id(input_size);
+    for (int i = 0; i < input_size; ++i)
+        border_id[i].store(0, std::memory_order_relaxed);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads) if (num_threads > 1 && input_size > 1024)
+#endif
+    for (int i = 0; i < input_size; ++i) {
+        if (!is_core[i]) continue;
+
+        const int cluster_id = id_cache[i];
+        const std::vector<int>& list = neighbors[list_thread[i]];
+        for (int k = list_begin[i]; k < list_end[i]; ++k) {
+            const int neighbor_idx = list[k];
+            if (is_core[neighbor_idx]) continue;
+
+            int current = border_id[neighbor_idx].load(std::memory_order_relaxed);
+            while ((current == 0 || cluster_id < current) &&
+                   !border_id[neighbor_idx].compare_exchange_weak(current, cluster_id, std::memory_order_relaxed)) {}
+        }
+    }
+
+    for (int i = 0; i < input_size; ++i) {
+        if (!is_core[i])
+            id_cache[i] = border_id[i].load(std::memory_order_relaxed);
+    }
+
+    std::copy(id_cache.begin(), id_cache.end(), result);
+
+    return current_cluster_id;
 }
 
 } /* namespace _DBSCAN_PRIVATE */
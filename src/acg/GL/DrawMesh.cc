@@ -151,6 +151,13 @@ void DrawMeshBase::fillVertexBuffer() {
       glBufferData(GL_ARRAY_BUFFER_ARB, numVerts_ * vertexDecl_->getVertexStride(), &vertices_[0], GL_STATIC_DRAW_ARB);
 }
 
+void DrawMeshBase::fillVertexBufferRange(size_t _first, size_t _count) {
+    if (!vertices_.empty() && _count) {
+      const size_t stride = vertexDecl_->getVertexStride();
+      glBufferSubData(GL_ARRAY_BUFFER_ARB, _first * stride, _count * stride, &vertices_[_first * stride]);
+    }
+}
+
 void DrawMeshBase::fillInvVertexMap(size_t n_vertices, void *data) {
     glBufferData(GL_ELEMENT_ARRAY_BUFFER_ARB, sizeof(int) * n_vertices, data, GL_STATIC_DRAW);
 }
@@ -94,6 +94,7 @@ class ACGDLLEXPORT DrawMeshBase {
         void fillLineBuffer(size_t n_edges, void *data);
         void fillHEVBO(size_t numberOfElements_, size_t sizeOfElements_, void* data_);
         void fillVertexBuffer();
+        void fillVertexBufferRange(size_t _first, size_t _count);
         void fillInvVertexMap(size_t n_vertices, void *data);
 
     public:
@@ -179,7 +180,7 @@ private:
     unsigned long numTris;
   };
 
-  enum REBUILD_TYPE {REBUILD_NONE = 0, REBUILD_FULL = 1, REBUILD_GEOMETRY = 2, REBUILD_TOPOLOGY = 4, REBUILD_TEXTURES = 8};
+  enum REBUILD_TYPE {REBUILD_NONE = 0, REBUILD_FULL = 1, REBUILD_GEOMETRY = 2, REBUILD_TOPOLOGY = 4, REBUILD_TEXTURES = 8, REBUILD_GEOMETRY_PARTIAL = 16};
 
 
 public:
@@ -253,6 +254,51 @@ public:
   */
   void addTriRenderObjects(IRenderer* _renderer, const RenderObject* _baseObj, std::map< int, GLuint>* _textureMap, bool _nonindexed = false);
 
+  /** \brief Enable culling of meshlets on the cpu
+  *
+  *   The mesh is partitioned into meshlets (see MeshCompiler::buildMeshlets()), which are attached to the indexed
+  *   render objects of addTriRenderObjects(). The renderer then skips meshlets outside of the view frustum
+  *   or facing away from the viewer, see RenderObject::meshlets.
+  *
+  *   @param _enable enable or disable meshlet culling
+  */
+  void setMeshletCulling(bool _enable);
+
+  /** \brief meshlet culling enabled?
+  */
+  bool getMeshletCulling() const {return meshletCulling_;}
+
+  /** \brief get texture buffer with the meshlet table for gpu culling
+  *
+  *   Format GL_RGBA32F with 4 texels per meshlet, see MeshCompiler::getMeshletTable().
+  *   The meshlets are in the same order as the draw index buffer.
+  *
+  *   @return texture buffer, 0 if meshlet culling is disabled
+  */
+  TextureBuffer* getMeshletTableTBO();
+
+private:
+
+  /// rebuild meshlets after the draw buffers changed
+  void updateMeshlets();
+
+  /** \brief refit bounds of existing meshlets after vertex positions changed, keeps the partition
+   *
+   * @param _ranges modified draw vertex ranges, 0 to refit all meshlets
+  */
+  void refitMeshlets(const std::vector< std::pair<int, int> >* _ranges);
+
+  /// meshlet culling enabled
+  bool meshletCulling_;
+
+  /// meshlet table has to be uploaded to meshletTableTBO_
+  bool updateMeshletTable_;
+
+  /// meshlet table on the gpu
+  TextureBuffer meshletTableTBO_;
+
+public:
+
   /** \brief render the mesh in wireframe mode
   */
   void drawLines();
@@ -288,6 +334,17 @@ public:
    */
   void updateGeometry() {rebuild_ |= REBUILD_GEOMETRY;}
 
+  /** \brief request an update for some modified mesh vertices
+   *
+   * Only the positions and normals of the given vertices are rewritten and uploaded to the vbo,
+   * which is much faster than updateGeometry() for local deformations.
+   * The mesh topology, texcoords and colors must not have changed since the last rebuild.
+   * Falls back to updateGeometry() if a partial update is not possible, e.g. in flat shading mode.
+   *
+   * @param _vertices indices of modified vertices of the mesh
+   */
+  void updateGeometry(const std::vector<unsigned int>& _vertices);
+
   /** \brief request an update for the textures
      */
   void updateTextures() {rebuild_ |= REBUILD_TEXTURES;}
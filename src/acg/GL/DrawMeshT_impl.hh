@@ -98,6 +98,9 @@ DrawMeshT<Mesh>::DrawMeshT(Mesh& _mesh)
   pickFaceShader_ = 0;
   pickEdgeShader_ = 0;
 
+  meshletCulling_ = false;
+  updateMeshletTable_ = false;
+
   createVertexDeclaration();
 
   vertexDeclEdgeNew_.addElement(GL_FLOAT, 3, VERTEX_USAGE_POSITION);
@@ -402,6 +405,24 @@ private:
 
 
 
+template <class Mesh>
+void
+DrawMeshT<Mesh>::updateGeometry(const std::vector<unsigned int>& _vertices)
+{
+  if (!meshComp_)
+  {
+    // nothing compiled yet
+    rebuild_ |= REBUILD_GEOMETRY;
+    return;
+  }
+
+  for (size_t i = 0; i < _vertices.size(); ++i)
+    meshComp_->setInputVertexDirty(static_cast<int>(_vertices[i]));
+
+  rebuild_ |= REBUILD_GEOMETRY_PARTIAL;
+}
+
+
 template <class Mesh>
 void
 DrawMeshT<Mesh>::rebuild()
@@ -503,6 +524,61 @@ DrawMeshT<Mesh>::rebuild()
     prevNumVerts_ = mesh_.n_vertices();
   }
 
+  // partial update: rewrite positions and normals of modified vertices only
+  if (!bTriangleRebuild && !bVertexRebuild && rebuild_ == REBUILD_GEOMETRY_PARTIAL && meshComp_ &&
+      !flatMode_ && !bVBOinFlatMode_ && !vertices_.empty())
+  {
+    // merge close ranges to reduce the number of uploads
+    std::vector< std::pair<int, int> > dirtyRanges;
+    meshComp_->getDirtyVertexRanges(dirtyRanges, 64);
+    meshComp_->clearDirtyInputVertices();
+
+    bindVbo();
+
+    for (size_t r = 0; r < dirtyRanges.size(); ++r)
+    {
+      for (int i = dirtyRanges[r].first; i < dirtyRanges[r].second; ++i)
+      {
+        const typename Mesh::HalfedgeHandle hh = mapToHalfedgeHandle(i);
+        typename Mesh::VertexHandle vh(-1);
+
+        if (hh.is_valid())
+          vh = mesh_.to_vertex_handle(hh);
+        else
+        {
+          // isolated vertex
+          int f_id, c_id;
+          vh = mesh_.vertex_handle(meshComp_->mapToOriginalVertexID(i, f_id, c_id));
+        }
+
+        ACG::Vec3d n(0.0, 0.0, 1.0);
+        if (halfedgeNormalMode_ == 0 && mesh_.has_vertex_normals())
+          n = mesh_.normal(vh);
+        else if (halfedgeNormalMode_ && mesh_.has_halfedge_normals() && hh.is_valid())
+          n = mesh_.normal(hh);
+
+        writePosition(i, mesh_.point(vh));
+        writeNormal(i, n);
+      }
+
+      fillVertexBufferRange(dirtyRanges[r].first, dirtyRanges[r].second - dirtyRanges[r].first);
+    }
+
+    ACG::GLState::bindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+    refitMeshlets(&dirtyRanges);
+
+    rebuild_ = REBUILD_NONE;
+    return;
+  }
+
+  // partial update not possible, update all vertices instead
+  if (rebuild_ & REBUILD_GEOMETRY_PARTIAL)
+    rebuild_ = (rebuild_ & ~REBUILD_GEOMETRY_PARTIAL) | REBUILD_GEOMETRY;
+
+  if (meshComp_)
+    meshComp_->clearDirtyInputVertices();
+
   // support faster update by only updating vertices (do a complete update if the textures have to be rebuild)
   if (!bTriangleRebuild && !bVertexRebuild && (rebuild_ & REBUILD_GEOMETRY) && !(rebuild_ & REBUILD_TEXTURES))
   {
@@ -537,6 +613,8 @@ DrawMeshT<Mesh>::rebuild()
 
     createVBO();
 
+    refitMeshlets(0);
+
     rebuild_ = REBUILD_NONE;
     return;
   }
@@ -643,6 +721,8 @@ DrawMeshT<Mesh>::rebuild()
   // compile draw buffers
   meshComp_->build(true, true, true, true);
 
+  updateMeshlets();
+
 
   // create inverse vertex map
   for (int i = 0; i < (int)mesh_.n_faces(); ++i)
@@ -1461,8 +1541,19 @@ void ACG::DrawMeshT<Mesh>::addTriRenderObjects(IRenderer* _renderer, const Rende
         
 
         if (!_nonindexed)
+        {
           ro.glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(sub->numTris * 3), indexType_,
             (GLvoid*)((size_t)sub->startIndex * (indexType_ == GL_UNSIGNED_INT ? 4 : 2))); // offset in bytes
+
+          if (meshletCulling_ && meshComp_->getNumMeshlets())
+          {
+            int firstMeshlet = 0, numMeshlets = 0;
+            meshComp_->getSubsetMeshlets(i, firstMeshlet, numMeshlets);
+
+            ro.meshlets = numMeshlets ? meshComp_->getMeshlet(firstMeshlet) : 0;
+            ro.numMeshlets = numMeshlets;
+          }
+        }
         else
           ro.glDrawArrays(GL_TRIANGLES, sub->startIndex, static_cast<GLsizei>(sub->numTris * 3) );
         
@@ -1472,7 +1563,15 @@ void ACG::DrawMeshT<Mesh>::addTriRenderObjects(IRenderer* _renderer, const Rende
     else
     {
       if (!_nonindexed)
+      {
         ro.glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(numTris_ * 3), indexType_, 0);
+
+        if (meshletCulling_ && meshComp_->getNumMeshlets())
+        {
+          ro.meshlets = meshComp_->getMeshlet(0);
+          ro.numMeshlets = meshComp_->getNumMeshlets();
+        }
+      }
       else
         ro.glDrawArrays(GL_TRIANGLES,0,  static_cast<GLsizei>(numTris_ * 3));
       _renderer->addRenderObject(&ro);
@@ -1748,6 +1847,71 @@ void ACG::DrawMeshT<Mesh>::drawPickingVertices_opt( const GLMatrixf& _mvp, size_
 
 
 
+template <class Mesh>
+void DrawMeshT<Mesh>::setMeshletCulling(bool _enable)
+{
+  if (meshletCulling_ == _enable)
+    return;
+
+  meshletCulling_ = _enable;
+
+  if (meshComp_ && numTris_)
+    updateMeshlets();
+}
+
+
+template <class Mesh>
+void DrawMeshT<Mesh>::updateMeshlets()
+{
+  if (!meshletCulling_ || !meshComp_)
+    return;
+
+  meshComp_->buildMeshlets();
+  updateMeshletTable_ = true;
+}
+
+
+template <class Mesh>
+void DrawMeshT<Mesh>::refitMeshlets(const std::vector< std::pair<int, int> >* _ranges)
+{
+  if (!meshletCulling_ || !meshComp_)
+    return;
+
+  // topology is unchanged on partial updates, only bounds and cones have to follow the vertices
+  if (!meshComp_->getNumMeshlets())
+    meshComp_->buildMeshlets();
+  else if (_ranges)
+    meshComp_->refitMeshlets(*_ranges);
+  else
+    meshComp_->refitMeshlets();
+
+  updateMeshletTable_ = true;
+}
+
+
+template <class Mesh>
+TextureBuffer* DrawMeshT<Mesh>::getMeshletTableTBO()
+{
+  if (!meshletCulling_)
+    return 0;
+
+  // make sure the meshlets are up to date
+  updateGPUBuffers();
+
+  if (updateMeshletTable_ && meshComp_ && meshComp_->getNumMeshlets())
+  {
+    std::vector<char> table(meshComp_->getNumMeshlets() * MeshCompiler::MESHLET_TABLE_STRIDE);
+    meshComp_->getMeshletTable(&table[0]);
+
+    meshletTableTBO_.setBufferData(table.size(), &table[0], GL_RGBA32F, GL_STATIC_DRAW);
+
+    updateMeshletTable_ = false;
+  }
+
+  return meshletTableTBO_.is_valid() ? &meshletTableTBO_ : 0;
+}
+
+
 template <class Mesh>
 void DrawMeshT<Mesh>::updatePerEdgeBuffers()
 {
@@ -44,6 +44,7 @@
 #include <ACG/GL/acg_glew.hh>
 #include <cstdio>
 #include <cstring>
+#include <cmath>
 #include <iostream>
 #include <algorithm>
 #include <QFile>
@@ -54,6 +55,7 @@
 #include <ACG/GL/IRenderer.hh>
 
 #include <ACG/GL/VertexDeclaration.hh>
+#include <ACG/GL/MeshCompiler.hh>
 #include <ACG/GL/GLError.hh>
 
 #include <ACG/GL/ShaderCache.hh>
@@ -80,6 +82,7 @@ prevVAO_(0),
 depthCopyShader_(0),
 errorDetectionLevel_(1),
 coreProfile_(false),
+asyncShaderCompilation_(false),
 enableLineThicknessGL42_(false)
 {
   prevViewport_[0] = 0;
@@ -326,9 +329,19 @@ void IRenderer::addRenderObject(ACG::RenderObject* _renderObject)
 
     p->internalFlags_ = 0;
 
+    // the description is final now, modifiers and light setup above may have changed it
+    p->invalidateShaderDescFingerprint();
+
     // precompile shader
 #ifdef GL_VERSION_3_2
-    GLSL::Program* shaderProg = ACG::ShaderCache::getInstance()->getProgram(&p->shaderDesc);
+    GLSL::Program* shaderProg = 0;
+    const std::vector<unsigned int> noModifiers;
+
+    // the intensive error check below needs the linked program right away
+    if (asyncShaderCompilation_ && errorDetectionLevel_ <= 1)
+      ACG::ShaderCache::getInstance()->getProgramAsync(&p->shaderDesc, noModifiers, p->getShaderDescFingerprint());
+    else
+      shaderProg = ACG::ShaderCache::getInstance()->getProgram(&p->shaderDesc, noModifiers, p->getShaderDescFingerprint());
 #endif
 
 
@@ -538,6 +551,10 @@ void IRenderer::prepareRenderingPipeline(ACG::GLState* _glState, ACG::SceneGraph
 
   coreProfile_ = !_glState->compatibilityProfile();
 
+  // collect programs that have been compiled in the background
+  if (asyncShaderCompilation_)
+    ShaderCache::getInstance()->updateAsyncPrograms();
+
   // grab view transform from glstate
   viewMatrix_ = _glState->modelview();
   camPosWS_ = Vec3f( viewMatrix_(0,3), viewMatrix_(1,3), viewMatrix_(2,3) );
@@ -601,6 +618,7 @@ void IRenderer::prepareRenderingPipeline(ACG::GLState* _glState, ACG::SceneGraph
     {
       renderObjects_[i].shaderDesc.geometryTemplateFile = "Wireframe/gl42/geometry.tpl";
       renderObjects_[i].shaderDesc.fragmentTemplateFile = "Wireframe/gl42/fragment.tpl";
+      renderObjects_[i].invalidateShaderDescFingerprint();
 
       // disable color write to fbo, but allow RenderObject to control depth write
       renderObjects_[i].glColorMask(0,0,0,0);
@@ -1127,7 +1145,17 @@ void IRenderer::drawObject(ACG::RenderObject* _obj)
       default: indexSize = 1; break;
       }
 
-      if (_obj->numInstances <= 0)
+      const bool meshletCulling = _obj->meshlets && _obj->numMeshlets && _obj->numInstances <= 0 &&
+        _obj->primitiveMode == GL_TRIANGLES && (_obj->indexBuffer || _obj->vertexArrayObject);
+
+      if (meshletCulling)
+      {
+        const int numRanges = cullMeshlets(_obj, indexSize);
+
+        if (numRanges)
+          glMultiDrawElements(GL_TRIANGLES, &meshletDrawCounts_[0], _obj->indexType, (const GLvoid**)&meshletDrawOffsets_[0], numRanges);
+      }
+      else if (_obj->numInstances <= 0)
         glDrawElements(_obj->primitiveMode, _obj->numIndices, _obj->indexType,
           ((const char*)_obj->sysmemIndexBuffer) + _obj->indexOffset * indexSize);
       else
@@ -1137,13 +1165,120 @@ void IRenderer::drawObject(ACG::RenderObject* _obj)
   }
 }
 
+int IRenderer::cullMeshlets(const ACG::RenderObject* _obj, int _indexSize)
+{
+  meshletDrawCounts_.clear();
+  meshletDrawOffsets_.clear();
+
+  // frustum planes in object space, extracted from the rows of the model-view-projection matrix
+  const GLMatrixd mvp = _obj->proj * _obj->modelview;
+
+  double planes[6][4];
+
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int k = 0; k < 4; ++k)
+    {
+      planes[i * 2][k]     = mvp(3, k) + mvp(i, k);
+      planes[i * 2 + 1][k] = mvp(3, k) - mvp(i, k);
+    }
+  }
+
+  for (int i = 0; i < 6; ++i)
+  {
+    const double len = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+
+    if (len > 0.0)
+      for (int k = 0; k < 4; ++k)
+        planes[i][k] /= len;
+  }
+
+  // eye position (perspective) or view direction (orthographic) in object space for the backface test
+  //  mirroring transforms swap front and back faces, the test is skipped for them
+  const GLMatrixd& mv = _obj->modelview;
+  const double det = mv(0, 0) * (mv(1, 1) * mv(2, 2) - mv(1, 2) * mv(2, 1))
+                   - mv(0, 1) * (mv(1, 0) * mv(2, 2) - mv(1, 2) * mv(2, 0))
+                   + mv(0, 2) * (mv(1, 0) * mv(2, 1) - mv(1, 1) * mv(2, 0));
+
+  GLMatrixd invModelview = _obj->modelview;
+  const bool backfaceTest = _obj->culling && det > 0.0 && invModelview.invert();
+  const bool perspective = _obj->proj(3, 3) == 0.0;
+
+  Vec3d eye = invModelview.transform_point(Vec3d(0.0, 0.0, 0.0));
+  Vec3d viewDir = invModelview.transform_vector(Vec3d(0.0, 0.0, -1.0));
+
+  if (viewDir.norm() > 0.0)
+    viewDir.normalize();
+
+  const MeshCompilerMeshlet* meshlets = _obj->meshlets;
+
+  for (unsigned int m = 0; m < _obj->numMeshlets; ++m)
+  {
+    const MeshCompilerMeshlet& ml = meshlets[m];
+
+    bool visible = true;
+
+    for (int i = 0; i < 6 && visible; ++i)
+    {
+      const double dist = planes[i][0] * ml.center[0] + planes[i][1] * ml.center[1] + planes[i][2] * ml.center[2] + planes[i][3];
+      visible = dist >= -ml.radius;
+    }
+
+    if (visible && backfaceTest && ml.coneCutoff <= 1.0f)
+    {
+      Vec3d dir = viewDir;
+
+      if (perspective)
+      {
+        dir = Vec3d(ml.coneApex[0], ml.coneApex[1], ml.coneApex[2]) - eye;
+        const double len = dir.norm();
+        dir = len > 0.0 ? dir / len : Vec3d(0.0, 0.0, 0.0);
+      }
+
+      visible = (dir | Vec3d(ml.coneAxis[0], ml.coneAxis[1], ml.coneAxis[2])) < ml.coneCutoff;
+    }
+
+    if (!visible)
+      continue;
+
+    // offset in bytes
+    const size_t offset = (size_t)ml.indexOffset * _indexSize;
+
+    // merge with previous range
+    if (!meshletDrawCounts_.empty() &&
+        (size_t)meshletDrawOffsets_.back() + (size_t)meshletDrawCounts_.back() * _indexSize == offset)
+      meshletDrawCounts_.back() += GLsizei(ml.numTriangles * 3);
+    else
+    {
+      meshletDrawCounts_.push_back(GLsizei(ml.numTriangles * 3));
+      meshletDrawOffsets_.push_back((const GLvoid*)offset);
+    }
+  }
+
+  return int(meshletDrawCounts_.size());
+}
+
 void IRenderer::renderObject(ACG::RenderObject* _obj, 
                                       GLSL::Program* _prog,
                                       bool _constRenderStates,
                                       const std::vector<unsigned int>* _shaderModifiers)
 {
   // select shader from cache
-  GLSL::Program* prog = _prog ? _prog : ACG::ShaderCache::getInstance()->getProgram(&_obj->shaderDesc, _shaderModifiers);
+  GLSL::Program* prog = _prog;
+
+  if (!prog)
+  {
+    static const std::vector<unsigned int> noModifiers;
+
+    if (asyncShaderCompilation_ && (!_shaderModifiers || _shaderModifiers->empty()))
+    {
+      prog = ACG::ShaderCache::getInstance()->getProgramAsync(&_obj->shaderDesc, noModifiers, _obj->getShaderDescFingerprint());
+      if (!prog)
+        prog = ACG::ShaderCache::getInstance()->getFallbackProgram(&_obj->shaderDesc);
+    }
+    else
+      prog = ACG::ShaderCache::getInstance()->getProgram(&_obj->shaderDesc, _shaderModifiers ? *_shaderModifiers : noModifiers, _obj->getShaderDescFingerprint());
+  }
 
 
   bindObjectVBO(_obj, prog);
@@ -1481,7 +1616,7 @@ void IRenderer::renderDepthMap(int _viewerID, int _width, int _height)
     if (obj->inZPrePass)
     {
       // apply depth map modifier to get the depth pass shader
-      GLSL::Program* depthPassShader = ShaderCache::getInstance()->getProgram(&obj->shaderDesc, DepthMapPass::instance);
+      GLSL::Program* depthPassShader = ShaderCache::getInstance()->getProgram(&obj->shaderDesc, DepthMapPass::instance, obj->getShaderDescFingerprint());
 
       // temporarily prevent read/write access to the same texture (the depth map)
       const char* depthMapUniformName = obj->depthMapUniformName;
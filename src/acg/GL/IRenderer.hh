@@ -276,6 +276,18 @@ protected:
    */
   virtual void drawObject(ACG::RenderObject* _obj);
 
+  /** \brief Culls the meshlets of an object on the cpu (part of drawObject())
+   *
+   * Rejects meshlets outside of the view frustum and, if culling is enabled for the object,
+   * meshlets with a completely backfacing normal cone. Index ranges of consecutive visible meshlets are merged.
+   * The resulting draw ranges are stored in meshletDrawCounts_ and meshletDrawOffsets_ for glMultiDrawElements().
+   *
+   * @param _obj render object with meshlets, see RenderObject::meshlets
+   * @param _indexSize size in bytes of one index
+   * @return number of draw ranges
+   */
+  virtual int cullMeshlets(const ACG::RenderObject* _obj, int _indexSize);
+
 
   //=========================================================================
   // Restore OpenGL State
@@ -412,6 +424,22 @@ public:
   /// Get error detection level
   int getErrorDetectionLevel() const;
 
+  /** \brief Compile shaders of render objects in the background
+   *
+   * If enabled, renderObject() does not stall on programs that are not compiled yet.
+   * Their objects are rendered with ShaderCache::getFallbackProgram() until the actual
+   * program is ready, see ShaderCache::getProgramAsync(). Passes with shader modifiers
+   * and objects with tessellation always wait for their programs.
+   *
+   * Disabled by default.
+   *
+   * @param _enable  enable/disable
+   */
+  void setAsyncShaderCompilation(bool _enable) {asyncShaderCompilation_ = _enable;}
+
+  /// Are shaders compiled in the background?
+  bool getAsyncShaderCompilation() const {return asyncShaderCompilation_;}
+
   //=========================================================================
   // Variables
   //=========================================================================
@@ -575,10 +603,17 @@ protected:
   /// core profile mode
   bool coreProfile_;
 
+  /// render with fallback programs while shaders are compiled in the background
+  bool asyncShaderCompilation_;
+
 
   /// max number of clip distance outputs in a vertex shader
   static int maxClipDistances_;
 
+  /// draw ranges of visible meshlets, see cullMeshlets()
+  std::vector<GLsizei> meshletDrawCounts_;
+  std::vector<const GLvoid*> meshletDrawOffsets_;
+
   RenderObjectRange current_subtree_objects_;
 private:
 
@@ -46,8 +46,12 @@
 
 #include <iostream>
 #include <sstream>
+#include <cmath>
+#include <cfloat>
+#include <limits>
 
 #ifdef USE_OPENMP
+#include <omp.h>
 #endif
 
 #ifdef ACG_MC_USE_STL_HASH
@@ -555,6 +559,165 @@ void MeshCompiler::weldVertices()
   delete [] vtxCompBuf;
 }
 
+int MeshCompiler::getWeldKeySize() const
+{
+  // key layout: position id, element data
+  //  float and double components are stored as 8 byte values (canonical double or grid cell index as double)
+  int keySize = sizeof(int);
+
+  for (int i = 0; i < numAttributes_; ++i)
+  {
+    const VertexElement* el = decl_.getElement(i);
+
+    if (el->type_ == GL_FLOAT || el->type_ == GL_DOUBLE)
+      keySize += int(el->numElements_) * 8;
+    else
+      keySize += int(VertexDeclaration::getElementSize(el));
+  }
+
+  return keySize;
+}
+
+void MeshCompiler::getWeldKey( const int _face, const int _corner, char* _vtxBuf, char* _key ) const
+{
+  getInputFaceVertexData(_face, _corner, _vtxBuf);
+
+  // only corners referencing the same input position get welded (same as in weldVertices())
+  const int posID = getInputIndex(_face, _corner, inputIDPos_);
+  memcpy(_key, &posID, sizeof(int));
+
+  char* dst = _key + sizeof(int);
+
+  const bool quantize = weldMethod_ == WELD_HASH_QUANTIZED && weldQuantizationEps_ > 0.0;
+
+  for (int i = 0; i < numAttributes_; ++i)
+  {
+    const VertexElement* el = decl_.getElement(i);
+    const char* src = _vtxBuf + (size_t)el->pointer_;
+
+    if (el->type_ == GL_FLOAT || el->type_ == GL_DOUBLE)
+    {
+      for (int k = 0; k < (int)el->numElements_; ++k)
+      {
+        double v = (el->type_ == GL_FLOAT) ? double(reinterpret_cast<const float*>(src)[k]) : reinterpret_cast<const double*>(src)[k];
+
+        if (quantize)
+        {
+          // the grid cell is stored as a double to keep huge and non-finite values well-defined:
+          //  beyond 2^52 the double spacing exceeds the grid size, so these values are used unquantized,
+          //  infinities stay as they are and all NaNs share one cell
+          double q = v / weldQuantizationEps_;
+          if (std::fabs(q) < 4503599627370496.0)
+            q = std::floor(q + 0.5);
+          else if (q != q)
+            q = std::numeric_limits<double>::quiet_NaN();
+
+          q += 0.0;
+          memcpy(dst, &q, 8);
+        }
+        else
+        {
+          // -0 and +0 have different bit patterns, but should be welded
+          v += 0.0;
+          memcpy(dst, &v, 8);
+        }
+
+        dst += 8;
+      }
+    }
+    else
+    {
+      const size_t elementSize = VertexDeclaration::getElementSize(el);
+      memcpy(dst, src, elementSize);
+      dst += elementSize;
+    }
+  }
+}
+
+// FNV-1a hash of a byte sequence
+static size_t MeshCompiler_HashBytes(const char* _data, const int _size)
+{
+  unsigned long long h = 14695981039346656037ULL;
+
+  for (int i = 0; i < _size; ++i)
+  {
+    h ^= (unsigned char)_data[i];
+    h *= 1099511628211ULL;
+  }
+
+  return size_t(h ^ (h >> 32));
+}
+
+void MeshCompiler::weldVertices_Hash()
+{
+  // each face corner is welded to the first corner (in face order) with the same key
+  //  the hash table is an open addressing table with linear probing, that stores the ids of unique vertices
+
+  vertexWeldMapFace_.resize(numIndices_, -1);
+  vertexWeldMapCorner_.resize(numIndices_, -1);
+
+  const int keySize = getWeldKeySize();
+
+  size_t tableSize = 1;
+  while (tableSize < size_t(numIndices_) * 2)
+    tableSize <<= 1;
+
+  const size_t tableMask = tableSize - 1;
+  std::vector<int> table(tableSize, -1);
+
+  // unique vertices: key data, hash value and reference corner
+  std::vector<char>   uniqueKeys;
+  std::vector<size_t> uniqueHash;
+  std::vector<int>    uniqueFace;
+  std::vector<int>    uniqueCorner;
+
+  std::vector<char> vtxBuf(decl_.getVertexStride());
+  std::vector<char> key(keySize);
+
+  for (int i = 0; i < numFaces_; ++i)
+  {
+    const int fsize = getFaceSize(i);
+    for (int k = 0; k < fsize; ++k)
+    {
+      getWeldKey(i, k, &vtxBuf[0], &key[0]);
+
+      const size_t hash = MeshCompiler_HashBytes(&key[0], keySize);
+
+      size_t slot = hash & tableMask;
+      int match = -1;
+
+      while (table[slot] >= 0)
+      {
+        const int u = table[slot];
+
+        if (uniqueHash[u] == hash && !memcmp(&uniqueKeys[size_t(u) * keySize], &key[0], keySize))
+        {
+          match = u;
+          break;
+        }
+
+        slot = (slot + 1) & tableMask;
+      }
+
+      if (match < 0)
+      {
+        // first occurrence
+        match = int(uniqueFace.size());
+        table[slot] = match;
+
+        uniqueKeys.insert(uniqueKeys.end(), key.begin(), key.end());
+        uniqueHash.push_back(hash);
+        uniqueFace.push_back(i);
+        uniqueCorner.push_back(k);
+      }
+
+      const int weldMapOffset = getInputFaceOffset(i) + k;
+      vertexWeldMapFace_[weldMapOffset] = uniqueFace[match];
+      vertexWeldMapCorner_[weldMapOffset] = uniqueCorner[match];
+    }
+  }
+}
+
 void MeshCompiler::fixWeldMap()
 {
   for (int i = 0; i < numFaces_; ++i)
@@ -780,6 +943,182 @@ void MeshCompiler::splitVertices()
 }
 
 
+void MeshCompiler::splitVertices_MT()
+{
+  /* algorithm overview
+
+  computes the same vertex ids as splitVertices() with the serial VertexSplitter:
+   - the first attribute combination of a position (in face order) keeps the position id
+   - every other combination gets a new id, new ids are given in order of first occurrence
+
+  1. read attribute indices of all face corners (parallel over faces)
+  2. bucket face corners by position id, corners of a bucket are in face order (counting sort)
+  3. find unique attribute combinations in each bucket (parallel over positions)
+  4. give new ids to the split combinations in order of first occurrence
+  5. write vertex ids of face corners (parallel over positions)
+  */
+
+  const int numPositions = input_[inputIDPos_].count;
+  const int numThreads = getNumWorkerThreads();
+
+  faceBufSplit_.resize(numIndices_, -1);
+
+  // 1. attribute indices of each face corner after welding, indexed by getInputIndexOffset()
+  std::vector<int> cornerAttribs(size_t(numIndices_) * numAttributes_, -1);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThreads)
+#endif
+  for (int i = 0; i < numFaces_; ++i)
+  {
+    const int fsize = getFaceSize(i);
+    for (int k = 0; k < fsize; ++k)
+      getInputFaceVertex_Welded(i, k, &cornerAttribs[size_t(getInputIndexOffset(i, k)) * numAttributes_]);
+  }
+
+  // 2. bucket corners by position
+
+  std::vector<int> bucketStart(numPositions + 1, 0);
+
+  for (int i = 0; i < numFaces_; ++i)
+  {
+    const int fsize = getFaceSize(i);
+    for (int k = 0; k < fsize; ++k)
+      ++bucketStart[cornerAttribs[size_t(getInputIndexOffset(i, k)) * numAttributes_] + 1];
+  }
+
+  for (int i = 0; i < numPositions; ++i)
+    bucketStart[i + 1] += bucketStart[i];
+
+  const int numCorners = bucketStart[numPositions];
+
+  std::vector<int> bucketCorners(numCorners);
+
+  {
+    std::vector<int> bucketFill(bucketStart.begin(), bucketStart.end() - 1);
+
+    for (int i = 0; i < numFaces_; ++i)
+    {
+      const int fsize = getFaceSize(i);
+      for (int k = 0; k < fsize; ++k)
+      {
+        const int offset = getInputIndexOffset(i, k);
+        bucketCorners[bucketFill[cornerAttribs[size_t(offset) * numAttributes_]]++] = offset;
+      }
+    }
+  }
+
+  // 3. unique combinations per position
+  //  bucketUnique[bucketStart[pos] + j] = first corner of the j-th combination of a position
+  //  faceBufSplit_ temporarily stores the local combination id j of each corner
+  //  splitID[corner] marks first corners of split combinations, which need a new id
+
+  std::vector<int> bucketUnique(numCorners, -1);
+  std::vector<int> splitID(numIndices_, -1);
+  const int splitMarker = -2;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThreads)
+#endif
+  for (int pos = 0; pos < numPositions; ++pos)
+  {
+    const int start = bucketStart[pos];
+    const int end = bucketStart[pos + 1];
+
+    int numUnique = 0;
+
+    for (int c = start; c < end; ++c)
+    {
+      const int corner = bucketCorners[c];
+      const int* vertex = &cornerAttribs[size_t(corner) * numAttributes_];
+
+      // search vertex in combinations found so far
+      int localID = 0;
+      while (localID < numUnique &&
+        memcmp(vertex, &cornerAttribs[size_t(bucketUnique[start + localID]) * numAttributes_], numAttributes_ * sizeof(int)))
+        ++localID;
+
+      if (localID == numUnique)
+      {
+        // combination not found -> add new vertex
+        bucketUnique[start + numUnique++] = corner;
+
+        if (localID)
+          splitID[corner] = splitMarker;
+      }
+
+      faceBufSplit_[corner] = localID;
+    }
+  }
+
+  // 4. new ids for split combinations in face order
+
+  int numVerts = numPositions;
+
+  for (int i = 0; i < numFaces_; ++i)
+  {
+    const int fsize = getFaceSize(i);
+    for (int k = 0; k < fsize; ++k)
+    {
+      const int offset = getInputIndexOffset(i, k);
+
+      if (splitID[offset] == splitMarker)
+        splitID[offset] = numVerts++;
+    }
+  }
+
+  // isolated vertices are positions without any reference
+  //  IsoFix[] array contains offsets <= 0 for each split vertex id, see splitVertices()
+
+  numIsolatedVerts_ = 0;
+  isolatedVertices_.clear();
+
+  std::vector<int> IsoFix;
+
+  for (int i = 0; i < numPositions; ++i)
+  {
+    if (bucketStart[i] == bucketStart[i + 1])
+    {
+      if (IsoFix.empty())
+        IsoFix.resize(numPositions, 0);
+
+      isolatedVertices_.push_back(i);
+      ++numIsolatedVerts_;
+    }
+
+    if (!IsoFix.empty())
+      IsoFix[i] = -int(numIsolatedVerts_);
+  }
+
+  // 5. final vertex ids
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThreads)
+#endif
+  for (int pos = 0; pos < numPositions; ++pos)
+  {
+    const int start = bucketStart[pos];
+    const int end = bucketStart[pos + 1];
+
+    for (int c = start; c < end; ++c)
+    {
+      const int corner = bucketCorners[c];
+      const int localID = faceBufSplit_[corner];
+
+      int idx = localID ? splitID[bucketUnique[start + localID]] : pos;
+
+      // split vertices are located after all positions, so they are shifted by the total number of isolated vertices
+      if (!IsoFix.empty())
+        idx += idx < numPositions ? IsoFix[idx] : -int(numIsolatedVerts_);
+
+      faceBufSplit_[corner] = idx;
+    }
+  }
+
+  numDrawVerts_ = numVerts - numIsolatedVerts_;
+}
+
+
 bool MeshCompiler_forceUnsharedFaceVertex_InnerValenceSorter( const std::pair<int, int>& a, const std::pair<int, int>& b )
 {
   return a.second > b.second;
@@ -1127,6 +1466,14 @@ MeshCompiler::MeshCompiler(const VertexDeclaration& _decl)
   provokingVertex_ = -1;
   provokingVertexSetByUser_ = false;
 
+  numThreads_ = 1;
+  clusteredVCacheOpt_ = false;
+
+  weldMethod_ = WELD_ADJACENCY;
+  weldQuantizationEps_ = 1e-4;
+
+  compactIndexBufferSize_ = 0;
+
   // search for convenient attribute indices
   numAttributes_ = decl_.getNumElements();
   inputIDNorm_ = inputIDPos_ = inputIDTexC_ = -1;
@@ -1400,12 +1747,21 @@ MeshCompiler::VertexElementInput::~VertexElementInput()
 
 void MeshCompiler::triangulate()
 {
-  // count no. of triangles
+  // count no. of triangles and compute the offset of the first triangle of each sorted face
+  //  a n-poly is always split into n-2 triangles, which allows to triangulate all faces independently
+
+  std::vector<int> sortFaceTriOffset(numFaces_ + 1, 0);
 
   int numTris = 0;
 
-  for (int i = 0; i < numFaces_; ++i)
-    numTris += getFaceSize(i) - 2;
+  for (int sortFaceID = 0; sortFaceID < numFaces_; ++sortFaceID)
+  {
+    const int faceID = faceSortMap_.empty() ? sortFaceID : faceSortMap_[sortFaceID];
+
+    sortFaceTriOffset[sortFaceID] = numTris;
+    numTris += getFaceSize(faceID) - 2;
+  }
+  sortFaceTriOffset[numFaces_] = numTris;
 
   numTris_ = numTris;
 
@@ -1420,9 +1776,11 @@ void MeshCompiler::triangulate()
   //  this change is necessary to implement the forceUnsharedVertices() function for complex polygons
   //  the negative values are resolved later in the function resolveTriangulation()
 
-  int triCounter = 0;
-  int indexCounter = 0;
+  const int numThreads = getNumWorkerThreads();
 
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(numThreads) if (numThreads > 1)
+#endif
   for (int sortFaceID = 0; sortFaceID < numFaces_; ++sortFaceID)
   {
     // get original face id
@@ -1430,6 +1788,9 @@ void MeshCompiler::triangulate()
 
     const int faceSize = getFaceSize(faceID);
 
+    int triCounter = sortFaceTriOffset[sortFaceID];
+    int indexCounter = triCounter * 3;
+
     if (faceSize < 4)
     {
       // save face index mapping
@@ -1480,6 +1841,8 @@ void MeshCompiler::triangulate()
         // concave polygon
         // enforcing an unshared vertex gets ugly now
 
+        assert(int(tris.numTriangles()) == faceSize - 2);
+
         for (size_t i = 0; i < tris.numTriangles(); ++i)
         {
           triToSortFaceMap_[triCounter++] = sortFaceID;
@@ -1496,33 +1859,20 @@ void MeshCompiler::triangulate()
  
   // ---------------
   // fill out missing subset info:
+  //  faces of a subset are stored in the range [startFace, startFace + numFaces) after sorting,
+  //  so the triangles of a subset are found in the triangle range of these faces
 
   for (int i = 0; i < numSubsets_; ++i)
   {
-    subsets_[i].startIndex = 0xffffffff;
-    subsets_[i].numTris = 0;
-  }
-
-  // triangle count per subset
-
-  for (int i = 0; i < numTris; ++i)
-  {
-    const int faceID = mapTriToInputFace(i);
-
-    const int faceGroup = getFaceGroup(faceID);
-    Subset* sub = &subsets_[findGroupSubset(faceGroup)];
-
-    ++sub->numTris;
-  }
+    Subset* sub = &subsets_[i];
 
-  // start index
+    sub->numTris = sortFaceTriOffset[sub->startFace + sub->numFaces] - sortFaceTriOffset[sub->startFace];
 
-  for (int i = 0; i < numSubsets_; ++i)
-  {
+    // start index
     if (i > 0)
-      subsets_[i].startIndex = subsets_[i-1].startIndex + subsets_[i-1].numTris * 3;
+      sub->startIndex = subsets_[i-1].startIndex + subsets_[i-1].numTris * 3;
     else
-      subsets_[i].startIndex = 0;
+      sub->startIndex = 0;
   }
 
 }
@@ -1532,8 +1882,13 @@ void MeshCompiler::resolveTriangulation()
 {
   // rotate tris such that the unshared face vertex is at the wanted provoking position of each triangle
 
+  const int numThreads = getNumWorkerThreads();
+
   if (provokingVertex_ >= 0)
   {
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+#endif
     for (int i  = 0; i < numTris_; ++i)
     {
       for (int k = 0; k < 3 - provokingVertex_; ++k)
@@ -1547,6 +1902,9 @@ void MeshCompiler::resolveTriangulation()
   }
 
   // resolve triangulation to indices
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+#endif
   for (int drawTriID = 0; drawTriID < numTris_; ++drawTriID)
   {
     if (triIndexBuffer_[drawTriID * 3] < 0)
@@ -1573,38 +1931,71 @@ void MeshCompiler::sortFacesByGroup()
   // sort faces based on their group id
   // faces within the same group can be rendered in one batch
 
+  // group ids are 16 bit values, so a counting sort with one bucket per possible group id can be used
+  //  the input faces are split into one contiguous range per thread,
+  //  each thread counts the group ids in its range and then places its faces in the sorted order.
+  //  faces of the same group keep their input order, subsets are sorted by increasing group id
+
+  const int groupIDOffset = 32768;
+  const int numGroupIDs = 65536;
+
   numSubsets_ = 0;
 
-  std::map<int, unsigned int> GroupIDs; // map[groupID] = first face
+  const int numThreads = getNumWorkerThreads();
+  const int numChunks = std::max(1, std::min(numThreads, numFaces_ / 4096));
+  const int chunkSize = (numFaces_ + numChunks - 1) / numChunks;
+
+  // groupCount[chunk * numGroupIDs + groupID + groupIDOffset] = # faces of a group in a chunk
+  std::vector<int> groupCount(numChunks * numGroupIDs, 0);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(numChunks) if (numChunks > 1)
+#endif
+  for (int chunk = 0; chunk < numChunks; ++chunk)
+  {
+    int* chunkCount = &groupCount[chunk * numGroupIDs];
+
+    const int faceEnd = std::min(numFaces_, (chunk + 1) * chunkSize);
+    for (int face = chunk * chunkSize; face < faceEnd; ++face)
+      ++chunkCount[getFaceGroup(face) + groupIDOffset];
+  }
+
+  // find the used group ids and count faces per group
+  std::vector<int> groupSubset(numGroupIDs, -1); // map[groupID + offset] = subset id
 
-  // initialize GroupIDs map
-  for (int face = 0; face < numFaces_; ++face)
+  for (int g = 0; g < numGroupIDs; ++g)
   {
-    const int texID = getFaceGroup(face);
+    int numFaces = 0;
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+      numFaces += groupCount[chunk * numGroupIDs + g];
 
-    if (GroupIDs.find(texID) == GroupIDs.end())
-      GroupIDs[texID] = face;
+    if (numFaces)
+      groupSubset[g] = numSubsets_++;
   }
 
   // alloc subset array
-  numSubsets_ = int(GroupIDs.size());
   subsets_.resize(numSubsets_);
+  subsetIDMap_.clear();
 
   if (numSubsets_ > 1)
     faceSortMap_.resize(numFaces_, -1);
 
-  // initialize subsets and face sorting map
+  // initialize subsets and compute the first sorted face of each group in each chunk
 
-  std::map<int, unsigned int>::const_iterator it = GroupIDs.begin();
   unsigned int numSortedFaces = 0;
 
-  for (unsigned int i = 0; it != GroupIDs.end(); ++i, ++it)
+  for (int g = 0; g < numGroupIDs; ++g)
   {
+    const int i = groupSubset[g];
+
+    if (i < 0)
+      continue;
+
     // subset id = group id
-    subsets_[i].id = it->first;
+    subsets_[i].id = g - groupIDOffset;
 
     // store id mapping (optimization)
-    subsetIDMap_[it->first] = i;
+    subsetIDMap_[subsets_[i].id] = i;
 
     // rearrange by subset chunks, face offset = # processed faces
     subsets_[i].numFaces = 0;
@@ -1614,89 +2005,297 @@ void MeshCompiler::sortFacesByGroup()
     subsets_[i].startIndex = 0;
     subsets_[i].numTris = 0;
 
-    if (numSubsets_ == 1)
+    // replace face count by the offset of the chunk into the face sorting map
+    for (int chunk = 0; chunk < numChunks; ++chunk)
     {
-      subsets_[i].numFaces = numFaces_;
+      int* count = &groupCount[chunk * numGroupIDs + g];
+      const int chunkFaces = *count;
+
+      *count = numSortedFaces;
+
+      subsets_[i].numFaces += chunkFaces;
+      numSortedFaces += chunkFaces;
     }
-    else
-    {
-      // - find # faces in this subset
-      // - create face sorting map:  map[sortFaceID] = faceID
-      for (int k = it->second; k < numFaces_; ++k)
-      {
-        const int texID = getFaceGroup(k);
+  }
 
-        if (texID == subsets_[i].id)
-        {
-          subsets_[i].numFaces++;
+  // create face sorting map:  map[sortFaceID] = faceID
+  if (numSubsets_ > 1)
+  {
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(numChunks) if (numChunks > 1)
+#endif
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {
+      int* chunkOffset = &groupCount[chunk * numGroupIDs];
 
-          faceSortMap_[numSortedFaces++] = k;
-        }
-      }
+      const int faceEnd = std::min(numFaces_, (chunk + 1) * chunkSize);
+      for (int face = chunk * chunkSize; face < faceEnd; ++face)
+        faceSortMap_[chunkOffset[getFaceGroup(face) + groupIDOffset]++] = face;
     }
   }
 
 }
 
 
-void MeshCompiler::optimize()
+// interleave lower 10 bits of x, y, z to a 30 bit morton code
+static unsigned int MeshCompiler_MortonCode(unsigned int x, unsigned int y, unsigned int z)
 {
-  indices_.resize(numTris_ * 3);
-  triOptMap_.resize(numTris_, -1);
+  unsigned int code = 0;
 
-  for (int i = 0; i < numSubsets_; ++i)
+  for (int i = 0; i < 10; ++i)
   {
-    Subset* pSubset = &subsets_[i];
+    code |= ((x >> i) & 1) << (3 * i);
+    code |= ((y >> i) & 1) << (3 * i + 1);
+    code |= ((z >> i) & 1) << (3 * i + 2);
+  }
 
-    const int vcacheSize = 24;
-    GPUCacheOptimizerTipsify copt(vcacheSize, pSubset->numTris, numDrawVerts_, 4, &triIndexBuffer_[0] + pSubset->startIndex);
-    copt.WriteIndexBuffer(4, &indices_[pSubset->startIndex]);
+  return code;
+}
 
+// morton code of point _p in a 1024^3 grid over the box [_bbMin, _bbMax]
+static unsigned int MeshCompiler_MortonKey(const float* _p, const float* _bbMin, const float* _bbMax)
+{
+  unsigned int cell[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    const float ext = _bbMax[k] - _bbMin[k];
+    float t = ext > 0.0f ? (_p[k] - _bbMin[k]) / ext : 0.0f;
 
-    // apply changes to trimap
-    const unsigned int StartTri = pSubset->startIndex/3;
-    for (unsigned int k = 0; k < pSubset->numTris; ++k)
-    {
-      const unsigned int SrcTri = copt.GetTriangleMap()[k];
-      triOptMap_[k + StartTri] = SrcTri + StartTri;
-    }
+    // points with NaN or infinite coordinates go to the first cell
+    if (!std::isfinite(t))
+      t = 0.0f;
 
+    cell[k] = std::min(1023u, static_cast<unsigned int>(std::min(std::max(t, 0.0f), 1.0f) * 1023.0f));
   }
 
-  // call to GPUCacheOptimizer::OptimizeVertices!
-
-  unsigned int* vertexOptMap = new unsigned int[numDrawVerts_];
-
-  GPUCacheOptimizer::OptimizeVertices(numTris_, numDrawVerts_, 4, indices_.data(), vertexOptMap);
+  return MeshCompiler_MortonCode(cell[0], cell[1], cell[2]);
+}
 
-  // apply vertexOptMap to index buffer
+// number of triangles per cluster for multi-threaded vcache optimization of huge subsets
+static const unsigned int MeshCompiler_TipsifyClusterSize = 65536;
 
-  for (int i = 0; i < numTris_ * 3; ++i)
-    indices_[i] = vertexOptMap[indices_[i]];
+void MeshCompiler::optimize(bool _overdraw)
+{
+  indices_.resize(numTris_ * 3);
+  triOptMap_.resize(numTris_, -1);
 
+  const int numThreads = getNumWorkerThreads();
 
-  // apply opt-map to current vertex-map
+  // overdraw optimization needs the positions of the split vertices
+  std::vector<float> splitPositions;
 
-  for (int i = 0; i < numFaces_; ++i)
+  if (_overdraw && inputIDPos_ >= 0)
   {
-    const int fsize = getFaceSize(i);
+    VertexElement posElement;
+    posElement.type_ = GL_FLOAT;
+    posElement.numElements_ = 3;
+    posElement.usage_ = VERTEX_USAGE_POSITION;
+    posElement.pointer_ = 0;
+    posElement.shaderInputName_ = 0;
+    posElement.divisor_ = 0;
+    posElement.vbo_ = 0;
 
-    for (int k = 0;  k < fsize; ++k)
-    {
+    splitPositions.resize(numDrawVerts_ * 3, 0.0f);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+#endif
+    for (int i = 0; i < numFaces_; ++i)
+    {
+      const int fsize = getFaceSize(i);
+
+      for (int k = 0; k < fsize; ++k)
+        input_[inputIDPos_].getElementData(getInputIndex(i, k, inputIDPos_), &splitPositions[getInputIndexSplit(i, k) * 3], &posElement);
+    }
+  }
+
+  // if enabled, huge subsets are split into clusters, which are optimized in parallel one subset at a time
+  //  the remaining subsets are optimized in parallel per subset
+  std::vector<int> clusteredSubsets, serialSubsets;
+
+  for (int i = 0; i < numSubsets_; ++i)
+  {
+    if (clusteredVCacheOpt_ && splitPositions.empty() && numThreads > 1 && subsets_[i].numTris >= 2 * MeshCompiler_TipsifyClusterSize)
+      clusteredSubsets.push_back(i);
+    else
+      serialSubsets.push_back(i);
+  }
+
+  for (size_t i = 0; i < clusteredSubsets.size(); ++i)
+    optimizeSubset(clusteredSubsets[i], 0, numThreads);
+
+  // subsets are optimized independently and write to disjoint ranges of the index buffer
+  const int numSerialSubsets = int(serialSubsets.size());
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads) if (numThreads > 1)
+#endif
+  for (int i = 0; i < numSerialSubsets; ++i)
+    optimizeSubset(serialSubsets[i], splitPositions.empty() ? 0 : &splitPositions[0], 1);
+}
+
+
+void MeshCompiler::optimizeSubset(int _subset, const float* _splitPositions, int _numThreads)
+{
+  const Subset* pSubset = &subsets_[_subset];
+
+  const int vcacheSize = 24;
+
+  GPUCacheOptimizer* copt = 0;
+
+  // clustered optimization: sorted triangle -> subset triangle and the sorted index buffer,
+  //  which is read by the optimizer until WriteIndexBuffer()
+  std::vector<int> clusterTriOrder, sortedTris;
+
+  if (_splitPositions)
+    copt = new GPUCacheOptimizerOverdraw(vcacheSize, pSubset->numTris, numDrawVerts_, 4, &triIndexBuffer_[0] + pSubset->startIndex,
+                                         _splitPositions);
+  else if (_numThreads > 1)
+  {
+    // clusters are runs of consecutive triangles, so they have to be spatially coherent
+    //  regardless of the input face order
+    const int* subsetTris = &triIndexBuffer_[0] + pSubset->startIndex;
+
+    if (inputIDPos_ >= 0)
+    {
+      getSubsetMortonOrder(_subset, _numThreads, clusterTriOrder);
+
+      sortedTris.resize(pSubset->numTris * 3);
+      for (unsigned int k = 0; k < pSubset->numTris; ++k)
+      {
+        for (int c = 0; c < 3; ++c)
+          sortedTris[k * 3 + c] = subsetTris[clusterTriOrder[k] * 3 + c];
+      }
+
+      subsetTris = &sortedTris[0];
+    }
+
+    copt = new GPUCacheOptimizerTipsifyParallel(vcacheSize, pSubset->numTris, numDrawVerts_, 4, subsetTris,
+                                                MeshCompiler_TipsifyClusterSize, _numThreads);
+  }
+  else
+    copt = new GPUCacheOptimizerTipsify(vcacheSize, pSubset->numTris, numDrawVerts_, 4, &triIndexBuffer_[0] + pSubset->startIndex);
+
+  copt->WriteIndexBuffer(4, &indices_[pSubset->startIndex]);
+
+
+  // apply changes to trimap
+  const unsigned int StartTri = pSubset->startIndex/3;
+  for (unsigned int k = 0; k < pSubset->numTris; ++k)
+  {
+    unsigned int SrcTri = copt->GetTriangleMap()[k];
+    if (!clusterTriOrder.empty())
+      SrcTri = clusterTriOrder[SrcTri];
+    triOptMap_[k + StartTri] = SrcTri + StartTri;
+  }
+
+  delete copt;
+}
+
+
+void MeshCompiler::getSubsetMortonOrder(int _subset, int _numThreads, std::vector<int>& _triOrder) const
+{
+  const Subset* pSubset = &subsets_[_subset];
+  const int numTris = int(pSubset->numTris);
+  const int startTri = int(pSubset->startIndex / 3);
+
+  // triangles of a face share the centroid of the face
+  std::vector<float> centroids(numTris * 3);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(_numThreads) if (_numThreads > 1)
+#endif
+  for (int i = 0; i < numTris; ++i)
+    getInputFaceCentroid(mapTriToInputFace(startTri + i), &centroids[i * 3]);
+
+  float bbMin[3] = { FLT_MAX,  FLT_MAX,  FLT_MAX};
+  float bbMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  for (int i = 0; i < numTris; ++i)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      bbMin[k] = std::min(bbMin[k], centroids[i * 3 + k]);
+      bbMax[k] = std::max(bbMax[k], centroids[i * 3 + k]);
+    }
+  }
+
+  // (morton code, triangle id), sorting by id keeps the input order within a cell
+  std::vector< std::pair<unsigned int, int> > sortedTris(numTris);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(_numThreads) if (_numThreads > 1)
+#endif
+  for (int i = 0; i < numTris; ++i)
+    sortedTris[i] = std::pair<unsigned int, int>(MeshCompiler_MortonKey(&centroids[i * 3], bbMin, bbMax), i);
+
+  std::sort(sortedTris.begin(), sortedTris.end());
+
+  _triOrder.resize(numTris);
+  for (int i = 0; i < numTris; ++i)
+    _triOrder[i] = sortedTris[i].second;
+}
+
+
+void MeshCompiler::optimizeVertexFetch()
+{
+  if (indices_.empty() || !numDrawVerts_)
+    return;
+
+  const int numThreads = getNumWorkerThreads();
+
+  // renumber draw vertices in order of first use in the final index buffer
+  std::vector<unsigned int> vertexOptMap(numDrawVerts_);
+
+  GPUCacheOptimizer::OptimizeVertices(numTris_, numDrawVerts_, 4, indices_.data(), vertexOptMap.data());
+
+  // split vertices of faces without triangles (ie. lines or points) are not referenced by the index buffer,
+  //  append them in their current order to keep the map a permutation
+  {
+    unsigned int numReferenced = 0;
+    for (size_t i = 0; i < numDrawVerts_; ++i)
+      numReferenced += vertexOptMap[i] != 0xFFFFFFFF ? 1 : 0;
+
+    for (size_t i = 0; i < numDrawVerts_; ++i)
+      if (vertexOptMap[i] == 0xFFFFFFFF)
+        vertexOptMap[i] = numReferenced++;
+  }
+
+  // apply vertexOptMap to index buffer
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+#endif
+  for (int i = 0; i < numTris_ * 3; ++i)
+    indices_[i] = vertexOptMap[indices_[i]];
+
+
+  // apply opt-map to current vertex-map
+  //  the number of vertices does not change here, so faceBufSplit_ can be written directly
+  //  vertex and face maps are created afterwards from faceBufSplit_ and indices_,
+  //  so mapToOriginalVertexID(), mapToDrawVertexID() and the picking maps of DrawMeshT follow automatically
+
+#ifdef USE_OPENMP
+#pragma omp parallel for num_threads(numThreads) if (numThreads > 1)
+#endif
+  for (int i = 0; i < numFaces_; ++i)
+  {
+    const int fsize = getFaceSize(i);
+
+    for (int k = 0;  k < fsize; ++k)
+    {
       int oldVertex = getInputIndexSplit(i, k);
 
       int newVertex = vertexOptMap[oldVertex];
 
-      setInputIndexSplit(i, k, newVertex);
+      faceBufSplit_[getInputIndexOffset(i, k)] = newVertex;
     }
   }
-
-  delete [] vertexOptMap;
 }
 
 
 
-void MeshCompiler::build(bool _weldVertices, bool _optimizeVCache, bool _needPerFaceAttribute, bool _keepIsolatedVertices)
+void MeshCompiler::build(bool _weldVertices, bool _optimizeVCache, bool _needPerFaceAttribute, bool _keepIsolatedVertices, bool _optimizeOverdraw)
 {
   // track memory report for profiling/debugging
   const bool dbg_MemProfiling = false;
@@ -1722,7 +2321,15 @@ void MeshCompiler::build(bool _weldVertices, bool _optimizeVCache, bool _needPer
   use get/setInputIndexSplit for the mapping between interleaved indices and face vertices.
   */
 
-  if (_weldVertices)
+  if (_weldVertices && weldMethod_ != WELD_ADJACENCY)
+  {
+    if (dbg_MemProfiling)
+      std::cout << "vertex welding (hash).., memusage = " << (getMemoryUsage() /(1024 * 1024)) << std::endl;
+
+    // no adjacency information needed
+    weldVertices_Hash();
+  }
+  else if (_weldVertices)
   {
     if (dbg_MemProfiling)
       std::cout << "computing adjacency.., memusage = " << (getMemoryUsage() /(1024 * 1024)) << std::endl;
@@ -1741,7 +2348,10 @@ void MeshCompiler::build(bool _weldVertices, bool _optimizeVCache, bool _needPer
   if (dbg_MemProfiling)
     std::cout << "vertex splitting.., memusage = " << (getMemoryUsage() /(1024 * 1024)) << std::endl;
 
-  splitVertices();
+  if (getNumWorkerThreads() > 1)
+    splitVertices_MT();
+  else
+    splitVertices();
 
   if (dbg_MemProfiling)
     std::cout << "splitting done.., memusage = " << (getMemoryUsage() /(1024 * 1024)) << std::endl;
@@ -1835,8 +2445,6 @@ void MeshCompiler::build(bool _weldVertices, bool _optimizeVCache, bool _needPer
   which means only complete triangles are reordered and
   will not be rotated afterwards.
 
-  Additionally reorders vertex indices in increasing order.
-
   output:
    triIndexBuffer_  (updated)
    triOptMap
@@ -1846,11 +2454,22 @@ void MeshCompiler::build(bool _weldVertices, bool _optimizeVCache, bool _needPer
     if (dbg_MemProfiling)
       std::cout << "optimizing.., memusage = " << (getMemoryUsage() /(1024 * 1024)) << std::endl;
 
-    optimize();
+    optimize(_optimizeOverdraw);
   }
   else if (!triIndexBuffer_.empty())
     triIndexBuffer_.swap(indices_);
 
+  /*
+  Vertex fetch optimization:
+  Renumber draw vertices in order of first use in the final index buffer,
+  so that the gpu reads the vertex buffer mostly sequentially.
+
+  output:
+   indices_  (updated)
+   faceBufSplit_  (updated)
+  */
+  optimizeVertexFetch();
+
   if (dbg_MemProfiling)
     std::cout << "creating maps.., memusage = " << (getMemoryUsage() /(1024 * 1024)) << std::endl;
 
@@ -3217,182 +3836,1072 @@ void MeshCompiler::getVertexBuffer( void* _dst, const int _offset /*= 0*/, const
 
   char* bdst = (char*)_dst;
 
+  const int numThreads = getNumWorkerThreads();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 4096) num_threads(numThreads) if (numThreads > 1 && batchSize > 4096)
+#endif
   for (int i = 0; i < batchSize; ++i)
   {
     getVertex(i + _offset, bdst + decl_.getVertexStride() * i);
   }
 }
 
-struct MeshCompiler_EdgeTriMapKey
+void MeshCompiler::getInputFaceCentroid( const int _face, float* _out ) const
 {
-  // ordered vertex ids of the edge:  e0 < e1
-  int e0, e1;
+  VertexElement posElement;
+  posElement.type_ = GL_FLOAT;
+  posElement.numElements_ = 3;
+  posElement.usage_ = VERTEX_USAGE_POSITION;
+  posElement.pointer_ = 0;
+  posElement.shaderInputName_ = 0;
+  posElement.divisor_ = 0;
+  posElement.vbo_ = 0;
 
-  MeshCompiler_EdgeTriMapKey(int a, int b)
-    : e0(std::min(a,b)), e1(std::max(a,b)) {}
+  _out[0] = _out[1] = _out[2] = 0.0f;
 
-  bool operator ==(const MeshCompiler_EdgeTriMapKey& k) const
-  {
-    return e0 == k.e0 && e1 == k.e1;
-  }
+  const int faceSize = faceInput_->getFaceSize(_face);
 
-  bool operator <(const MeshCompiler_EdgeTriMapKey& k) const
+  for (int k = 0; k < faceSize; ++k)
   {
-    if (e0 < k.e0)
-      return true;
-
-    if (e0 > k.e0)
-      return false;
+    float pos[3];
+    input_[inputIDPos_].getElementData(getInputIndex(_face, k, inputIDPos_), pos, &posElement);
 
-    return e1 < k.e1;
+    for (int i = 0; i < 3; ++i)
+      _out[i] += pos[i];
   }
-};
 
+  for (int i = 0; i < 3; ++i)
+    _out[i] /= float(std::max(faceSize, 1));
+}
 
-#ifdef ACG_MC_USE_STL_HASH
-// requires c++0x
-struct MeshCompiler_EdgeTriMapKey_Hash
-{
-  std::size_t operator()(const MeshCompiler_EdgeTriMapKey& k) const
-  {
-    return ((std::hash<int>()(k.e0) << 1) ^ std::hash<int>()(k.e1)) >> 1;
-  }
-};
-#else
-uint qHash(const MeshCompiler_EdgeTriMapKey& k)
+int MeshCompiler::buildChunked( MeshCompilerChunkCallback* _callback, int _maxFacesPerChunk /*= 65536*/,
+  bool _weldVertices /*= false*/, bool _optimizeVCache /*= true*/, bool _needPerFaceAttribute /*= false*/ )
 {
-  return ((::qHash(k.e0) << 1) ^ ::qHash(k.e1)) >> 1;
-}
-#endif // ACG_MC_USE_STL_HASH
+  if (!faceInput_ || inputIDPos_ < 0)
+    return 0;
 
+  _maxFacesPerChunk = std::max(_maxFacesPerChunk, 1);
 
-void MeshCompiler::getIndexAdjBuffer(void* _dst, const int _borderIndex /* = -1 */)
-{
-  int* idst = (int*)_dst;
+  const int numFaces = faceInput_->getNumFaces();
 
-  for (int i = 0; i < numTris_; ++i)
-  {
-    // initialize all triangles
-    idst[i*6] = getIndex(i*3);
-    idst[i*6+2] = getIndex(i*3+1);
-    idst[i*6+4] = getIndex(i*3+2);
-    
-    idst[i*6+1] = _borderIndex;
-    idst[i*6+3] = _borderIndex;
-    idst[i*6+5] = _borderIndex;
-  }
+  // update size of each attribute, as in prepareData()
+  for (int i = 0; i < numAttributes_; ++i)
+    input_[i].attrSize = (int)VertexDeclaration::getElementSize(decl_.getElement(i));
 
-  // map from edge -> adjacent tris
-  QHash<MeshCompiler_EdgeTriMapKey, std::pair<int, int> > EdgeAdjMap;
+  // 1. spatial sort of faces along a morton curve of the face centroids
 
-  for (int i = 0; i < numTris_; ++i)
+  float bbMin[3] = { FLT_MAX,  FLT_MAX,  FLT_MAX};
+  float bbMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+  int maxFaceSize = 0;
+
+  for (int i = 0; i < numFaces; ++i)
   {
-    // get input positions of triangle
-    int PosIdx[3];
+    const int faceSize = faceInput_->getFaceSize(i);
+    maxFaceSize = std::max(maxFaceSize, faceSize);
+
+    // skip empty faces
+    if (faceSize < 3)
+      continue;
+
+    float c[3];
+    getInputFaceCentroid(i, c);
 
     for (int k = 0; k < 3; ++k)
     {
-      int faceId, cornerId;
-      PosIdx[k] = mapToOriginalVertexID(getIndex(i*3+k), faceId, cornerId);
+      bbMin[k] = std::min(bbMin[k], c[k]);
+      bbMax[k] = std::max(bbMax[k], c[k]);
     }
+  }
 
-    // build edge->triangle adjacency map
-    for (int e = 0; e < 3; ++e)
-    {
-      MeshCompiler_EdgeTriMapKey edge( PosIdx[e], PosIdx[(e+1)%3] );
-
-      QHash< MeshCompiler_EdgeTriMapKey, std::pair<int, int> >::iterator itKey;
+  // (morton code, face id)
+  std::vector< std::pair<unsigned int, int> > sortedFaces;
+  sortedFaces.reserve(numFaces);
 
-      itKey = EdgeAdjMap.find(edge);
+  for (int i = 0; i < numFaces; ++i)
+  {
+    if (faceInput_->getFaceSize(i) < 3)
+      continue;
 
-      if (itKey == EdgeAdjMap.end())
-        EdgeAdjMap[edge] = std::pair<int, int>(i, -1);
-      else
-        itKey.value().second = i;
-    }
+    float c[3];
+    getInputFaceCentroid(i, c);
 
+    sortedFaces.push_back(std::pair<unsigned int, int>(MeshCompiler_MortonKey(c, bbMin, bbMax), i));
   }
 
-  // use edge->triangle adjacency map to build index buffer with adjacency
-  for (QHash< MeshCompiler_EdgeTriMapKey, std::pair<int, int> >::iterator it = EdgeAdjMap.begin(); it != EdgeAdjMap.end(); ++it)
-  {
-    // two adjacent tris of current edge
-    int Tris[2] = {it.value().first, it.value().second};
+  std::sort(sortedFaces.begin(), sortedFaces.end());
 
-    // get input positions of triangles
-    int PosIdx[6];
 
-    for (int k = 0; k < 3; ++k)
-    {
-      int faceId, cornerId;
+  // 2. compile chunks one by one
 
-      PosIdx[k] = mapToOriginalVertexID(getIndex(Tris[0]*3+k), faceId, cornerId);
+  const int stride = decl_.getVertexStride();
+  const int numInputFaces = int(sortedFaces.size());
 
-      if (Tris[1] >= 0)
-        PosIdx[3+k] = mapToOriginalVertexID(getIndex(Tris[1]*3+k), faceId, cornerId);
-    }
+  int vertexOffset = 0;
+  int indexOffset = 0;
+  int chunkID = 0;
 
+  // chunk buffers, reused for all chunks
+  std::vector<int> localIDs;
+  std::vector<int> faceBuf(std::max(maxFaceSize, 3));
+  std::vector< std::vector<char> > localAttribs(numAttributes_);
+  std::vector<char> chunkVertices;
+  std::vector<int> chunkIndices;
+  std::vector<int> chunkFaceIDs;
 
-    // find edge and opposite corner wrt. to adjacent tris
+  for (int chunkStart = 0; chunkStart < numInputFaces; chunkStart += _maxFacesPerChunk, ++chunkID)
+  {
+    const int numChunkFaces = std::min(_maxFacesPerChunk, numInputFaces - chunkStart);
 
-    int TriEdges[2] = {-1,-1};
-    int TriOppositeVerts[2] = {-1,-1};
+    int numChunkIndices = 0;
+    for (int i = 0; i < numChunkFaces; ++i)
+      numChunkIndices += faceInput_->getFaceSize(sortedFaces[chunkStart + i].second);
 
-    for (int e = 0; e < 3; ++e)
-    {
-      MeshCompiler_EdgeTriMapKey edge0( PosIdx[e], PosIdx[(e+1)%3] );
+    MeshCompiler chunk(decl_);
 
-      if (edge0 == it.key())
-      {
-        TriEdges[0] = e;
-        TriOppositeVerts[1] = (e+2)%3;
-      }
-    }
+    chunk.setNumFaces(numChunkFaces, numChunkIndices);
+    chunk.setNumThreads(numThreads_);
+    chunk.setClusteredVCacheOptimization(clusteredVCacheOpt_);
+    chunk.setWeldMethod(weldMethod_, weldQuantizationEps_);
+    chunk.vertexCompare_ = vertexCompare_;
 
-    if (Tris[1] >= 0)
+    if (provokingVertexSetByUser_)
+      chunk.setProvokingVertex(provokingVertex_);
+
+    for (int attr = 0; attr < numAttributes_; ++attr)
     {
-      for (int e = 0; e < 3; ++e)
+      // find referenced attribute entries
+      localIDs.clear();
+
+      for (int i = 0; i < numChunkFaces; ++i)
       {
-        MeshCompiler_EdgeTriMapKey edge1( PosIdx[3 + e], PosIdx[3 + ((e+1)%3)] );
+        const int faceID = sortedFaces[chunkStart + i].second;
+        const int faceSize = faceInput_->getFaceSize(faceID);
 
-        if (edge1 == it.key())
+        for (int k = 0; k < faceSize; ++k)
         {
-          TriEdges[1] = e;
-          TriOppositeVerts[0] = (e+2)%3;
+          const int id = getInputIndex(faceID, k, attr);
+          if (id >= 0)
+            localIDs.push_back(id);
         }
       }
-    }
 
-    // store adjacency in buffer
+      std::sort(localIDs.begin(), localIDs.end());
+      localIDs.erase(std::unique(localIDs.begin(), localIDs.end()), localIDs.end());
 
-    for (int i = 0; i < 2; ++i)
-    {
-      if (Tris[i] >= 0)
-      {
-        int e = TriEdges[i];
+      // local copy of the referenced data, already converted to the vertex declaration format
+      const int attrSize = input_[attr].attrSize;
+      std::vector<char>& localData = localAttribs[attr];
+      localData.resize(localIDs.size() * attrSize);
 
-        // opposite vertex
-        int ov = _borderIndex;
+      for (size_t i = 0; i < localIDs.size(); ++i)
+        input_[attr].getElementData(localIDs[i], &localData[i * attrSize], decl_.getElement(attr));
 
-        if (TriOppositeVerts[i] >= 0 && Tris[(i+1)%2] >= 0)
-          ov = getIndex(Tris[(i+1)%2]*3 + TriOppositeVerts[i]);
+      chunk.setAttribVec(attr, localIDs.size(), localData.empty() ? 0 : &localData[0], attrSize);
 
-        idst[Tris[i] * 6 + e*2 + 1] = ov;
+      // remap face indices to the local copy
+      for (int i = 0; i < numChunkFaces; ++i)
+      {
+        const int faceID = sortedFaces[chunkStart + i].second;
+        const int faceSize = faceInput_->getFaceSize(faceID);
+
+        for (int k = 0; k < faceSize; ++k)
+        {
+          const int id = getInputIndex(faceID, k, attr);
+          faceBuf[k] = id >= 0 ? int(std::lower_bound(localIDs.begin(), localIDs.end(), id) - localIDs.begin()) : -1;
+        }
+
+        chunk.setFaceAttrib(i, faceSize, &faceBuf[0], attr);
       }
     }
 
-  }
+    if (!faceGroupIDs_.empty())
+    {
+      for (int i = 0; i < numChunkFaces; ++i)
+        chunk.setFaceGroup(i, faceGroupIDs_[sortedFaces[chunkStart + i].second]);
+    }
 
-  return;
+    chunk.build(_weldVertices, _optimizeVCache, _needPerFaceAttribute, false);
 
-  /*
 
-  // alternative algorithm without hashing with multi threading
-  // in case hashing method is too slow, the following unfinished implementation can be completed
+    // output
+    const int numChunkVerts = chunk.getNumVertices();
+    const int numChunkTris = chunk.getNumTriangles();
 
-  // requires vertex-face adjacency
+    chunkVertices.resize(std::max(numChunkVerts * stride, 1));
+    chunk.getVertexBuffer(&chunkVertices[0]);
 
-  computeAdjacency();
+    chunkIndices.resize(std::max(numChunkTris * 3, 1));
+    for (int i = 0; i < numChunkTris * 3; ++i)
+      chunkIndices[i] = chunk.getIndex(i) + vertexOffset;
+
+    chunkFaceIDs.resize(std::max(numChunkTris, 1));
+    for (int i = 0; i < numChunkTris; ++i)
+      chunkFaceIDs[i] = sortedFaces[chunkStart + chunk.mapToOriginalFaceID(i)].second;
+
+    MeshCompilerChunk out;
+    out.id = chunkID;
+    out.compiler = &chunk;
+    out.numVertices = numChunkVerts;
+    out.vertices = &chunkVertices[0];
+    out.numTriangles = numChunkTris;
+    out.indices = &chunkIndices[0];
+    out.faceIDs = &chunkFaceIDs[0];
+    out.vertexOffset = vertexOffset;
+    out.indexOffset = indexOffset;
+
+    if (_callback)
+      _callback->processChunk(out);
+
+    vertexOffset += numChunkVerts;
+    indexOffset += numChunkTris * 3;
+  }
+
+  return vertexOffset;
+}
+
+void MeshCompiler::createInputVertexMap()
+{
+  // inverse of mapToOriginalVertexID in compressed row format
+  const int numPositions = input_[inputIDPos_].count;
+
+  inputVertexMapOffset_.clear();
+  inputVertexMapOffset_.resize(numPositions + 1, 0);
+  inputVertexMap_.resize(numDrawVerts_);
+
+  std::vector<int> posIDs(numDrawVerts_);
+
+  for (int i = 0; i < (int)numDrawVerts_; ++i)
+  {
+    int f, c;
+    posIDs[i] = mapToOriginalVertexID(i, f, c);
+    ++inputVertexMapOffset_[posIDs[i] + 1];
+  }
+
+  for (int i = 0; i < numPositions; ++i)
+    inputVertexMapOffset_[i + 1] += inputVertexMapOffset_[i];
+
+  std::vector<int> writePos(inputVertexMapOffset_.begin(), inputVertexMapOffset_.end() - 1);
+
+  for (int i = 0; i < (int)numDrawVerts_; ++i)
+    inputVertexMap_[writePos[posIDs[i]]++] = i;
+}
+
+void MeshCompiler::setInputVertexDirty( const int _posID )
+{
+  const int numPositions = input_[inputIDPos_].count;
+
+  if (_posID < 0 || _posID >= numPositions)
+    return;
+
+  if ((int)dirtyInputVertexFlags_.size() < numPositions)
+    dirtyInputVertexFlags_.resize(numPositions, 0);
+
+  if (!dirtyInputVertexFlags_[_posID])
+  {
+    dirtyInputVertexFlags_[_posID] = 1;
+    dirtyInputVertices_.push_back(_posID);
+  }
+}
+
+void MeshCompiler::clearDirtyInputVertices()
+{
+  for (size_t i = 0; i < dirtyInputVertices_.size(); ++i)
+    dirtyInputVertexFlags_[dirtyInputVertices_[i]] = 0;
+
+  dirtyInputVertices_.clear();
+}
+
+void MeshCompiler::getDirtyVertexRanges( std::vector< std::pair<int, int> >& _ranges, const int _maxGap /*= 0*/ )
+{
+  _ranges.clear();
+
+  if (dirtyInputVertices_.empty() || !numDrawVerts_)
+    return;
+
+  if (inputVertexMapOffset_.empty())
+    createInputVertexMap();
+
+  // collect affected draw vertices
+  std::vector<int> drawVerts;
+  drawVerts.reserve(dirtyInputVertices_.size() * 2);
+
+  for (size_t i = 0; i < dirtyInputVertices_.size(); ++i)
+  {
+    const int posID = dirtyInputVertices_[i];
+
+    if (posID + 1 >= (int)inputVertexMapOffset_.size())
+      continue;
+
+    for (int k = inputVertexMapOffset_[posID]; k < inputVertexMapOffset_[posID + 1]; ++k)
+      drawVerts.push_back(inputVertexMap_[k]);
+  }
+
+  std::sort(drawVerts.begin(), drawVerts.end());
+
+  // merge into ranges
+  for (size_t i = 0; i < drawVerts.size(); ++i)
+  {
+    const int v = drawVerts[i];
+
+    if (_ranges.empty() || v > _ranges.back().second + _maxGap)
+      _ranges.push_back(std::pair<int, int>(v, v + 1));
+    else
+      _ranges.back().second = std::max(_ranges.back().second, v + 1);
+  }
+}
+
+int MeshCompiler::refillVertexBuffer( void* _dst, std::vector< std::pair<int, int> >* _ranges /*= 0*/, const int _maxGap /*= 0*/ )
+{
+  std::vector< std::pair<int, int> > ranges;
+  getDirtyVertexRanges(ranges, _maxGap);
+
+  const int stride = decl_.getVertexStride();
+  int numWritten = 0;
+
+  for (size_t i = 0; i < ranges.size(); ++i)
+  {
+    const int count = ranges[i].second - ranges[i].first;
+    getVertexBuffer((char*)_dst + (size_t)stride * ranges[i].first, ranges[i].first, count);
+    numWritten += count;
+  }
+
+  clearDirtyInputVertices();
+
+  if (_ranges)
+    _ranges->swap(ranges);
+
+  return numWritten;
+}
+
+// read a float or double component of a vertex element
+static float MeshCompiler_ReadComponent(const char* _src, GLuint _type, int _i)
+{
+  return _type == GL_DOUBLE ? float(reinterpret_cast<const double*>(_src)[_i]) : reinterpret_cast<const float*>(_src)[_i];
+}
+
+// map [-1, 1] to signed normalized integer with _bits bits
+static int MeshCompiler_QuantizeSNorm(float _v, int _bits)
+{
+  const float maxVal = float((1 << (_bits - 1)) - 1);
+  _v = std::max(-1.0f, std::min(1.0f, _v));
+  return int(std::floor(_v * maxVal + 0.5f));
+}
+
+static bool MeshCompiler_IsFloatType(GLuint _type)
+{
+  return _type == GL_FLOAT || _type == GL_DOUBLE;
+}
+
+void MeshCompiler::buildCompactOutput( int _flags /*= COMPACT_ALL*/ )
+{
+  // compact vertex layout
+
+  compactDecl_.clear();
+
+  for (unsigned int i = 0; i < decl_.getNumElements(); ++i)
+  {
+    VertexElement el = *decl_.getElement(i);
+    el.pointer_ = 0;
+
+    if ((_flags & COMPACT_POSITIONS) && el.usage_ == VERTEX_USAGE_POSITION && el.numElements_ >= 3 && MeshCompiler_IsFloatType(el.type_))
+    {
+      el.type_ = GL_SHORT;
+      el.numElements_ = 4;
+    }
+
+    if ((_flags & COMPACT_NORMALS) && el.usage_ == VERTEX_USAGE_NORMAL && el.numElements_ == 3 && MeshCompiler_IsFloatType(el.type_))
+    {
+      el.type_ = GL_INT_2_10_10_10_REV;
+      el.numElements_ = 4;
+    }
+
+    compactDecl_.addElement(&el);
+  }
+
+  // subset-local vertex blocks, vertices are numbered in order of first use in the index buffer
+
+  compactSubsets_.resize(subsets_.size());
+  compactVertexMap_.clear();
+  compactVertexMap_.reserve(numDrawVerts_);
+
+  std::vector<int> localID(numDrawVerts_, -1);
+  unsigned int indexBytes = 0;
+
+  VertexElement posElement;
+  posElement.type_ = GL_FLOAT;
+  posElement.numElements_ = 3;
+  posElement.usage_ = VERTEX_USAGE_POSITION;
+  posElement.pointer_ = 0;
+  posElement.shaderInputName_ = 0;
+  posElement.divisor_ = 0;
+  posElement.vbo_ = 0;
+
+  for (size_t s = 0; s < subsets_.size(); ++s)
+  {
+    const Subset& sub = subsets_[s];
+    CompactSubset& cs = compactSubsets_[s];
+
+    cs.subset = int(s);
+    cs.baseVertex = (unsigned int)compactVertexMap_.size();
+    cs.numIndices = sub.numTris * 3;
+
+    for (unsigned int i = 0; i < cs.numIndices; ++i)
+    {
+      const int v = indices_[sub.startIndex + i];
+
+      if (localID[v] < 0)
+      {
+        localID[v] = int(compactVertexMap_.size() - cs.baseVertex);
+        compactVertexMap_.push_back(v);
+      }
+    }
+
+    cs.numVertices = (unsigned int)compactVertexMap_.size() - cs.baseVertex;
+
+    // reset for next subset
+    for (unsigned int i = cs.baseVertex; i < cs.baseVertex + cs.numVertices; ++i)
+      localID[compactVertexMap_[i]] = -1;
+
+    // index layout: 32 bit indices have to be 4 byte aligned
+    cs.indexType = ((_flags & COMPACT_INDICES) && cs.numVertices < 65536) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    if (cs.indexType == GL_UNSIGNED_INT)
+      indexBytes = (indexBytes + 3) & ~3u;
+
+    cs.indexByteOffset = indexBytes;
+    indexBytes += cs.numIndices * (cs.indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+
+    // subset bounding box for position dequantization
+    float bbMin[3] = { FLT_MAX,  FLT_MAX,  FLT_MAX};
+    float bbMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    for (unsigned int i = cs.baseVertex; i < cs.baseVertex + cs.numVertices && inputIDPos_ >= 0; ++i)
+    {
+      int f, c;
+      float pos[3];
+      input_[inputIDPos_].getElementData(mapToOriginalVertexID(compactVertexMap_[i], f, c), pos, &posElement);
+
+      for (int k = 0; k < 3; ++k)
+      {
+        bbMin[k] = std::min(bbMin[k], pos[k]);
+        bbMax[k] = std::max(bbMax[k], pos[k]);
+      }
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+      cs.posScale[k] = cs.numVertices ? (bbMax[k] - bbMin[k]) * 0.5f : 0.0f;
+      cs.posOffset[k] = cs.numVertices ? (bbMax[k] + bbMin[k]) * 0.5f : 0.0f;
+    }
+  }
+
+  compactIndexBufferSize_ = indexBytes;
+}
+
+void MeshCompiler::getCompactVertexBuffer( void* _dst ) const
+{
+  const int stride = decl_.getVertexStride();
+  const int compactStride = compactDecl_.getVertexStride();
+  const int numElements = int(decl_.getNumElements());
+
+  char* bdst = static_cast<char*>(_dst);
+
+  const int numThreads = getNumWorkerThreads();
+
+  for (size_t s = 0; s < compactSubsets_.size(); ++s)
+  {
+    const CompactSubset& cs = compactSubsets_[s];
+    const int numVerts = int(cs.numVertices);
+
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(numThreads) if (numThreads > 1 && numVerts > 4096)
+#endif
+    {
+      std::vector<char> vtx(stride);
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(static, 4096)
+#endif
+      for (int i = 0; i < numVerts; ++i)
+      {
+        getVertex(compactVertexMap_[cs.baseVertex + i], &vtx[0]);
+
+        char* dst = bdst + (size_t)compactStride * (cs.baseVertex + i);
+
+        for (int e = 0; e < numElements; ++e)
+        {
+          const VertexElement* el = decl_.getElement(e);
+          const VertexElement* cel = compactDecl_.getElement(e);
+
+          const char* src = &vtx[0] + el->getByteOffset();
+          char* celDst = dst + cel->getByteOffset();
+
+          if (cel->type_ == el->type_)
+            memcpy(celDst, src, VertexDeclaration::getElementSize(el));
+          else if (cel->type_ == GL_SHORT)
+          {
+            // quantized position relative to subset bounding box
+            short q[4] = {0, 0, 0, 32767};
+
+            for (int k = 0; k < 3; ++k)
+            {
+              const float v = MeshCompiler_ReadComponent(src, el->type_, k);
+              if (cs.posScale[k] > 0.0f)
+                q[k] = short(MeshCompiler_QuantizeSNorm((v - cs.posOffset[k]) / cs.posScale[k], 16));
+            }
+
+            memcpy(celDst, q, 8);
+          }
+          else
+          {
+            // packed normal
+            unsigned int packed = 0;
+
+            for (int k = 0; k < 3; ++k)
+              packed |= (unsigned int)(MeshCompiler_QuantizeSNorm(MeshCompiler_ReadComponent(src, el->type_, k), 10) & 1023) << (10 * k);
+
+            memcpy(celDst, &packed, 4);
+          }
+        }
+      }
+    }
+  }
+}
+
+void MeshCompiler::getCompactIndexBuffer( void* _dst ) const
+{
+  char* bdst = static_cast<char*>(_dst);
+
+  std::vector<int> localID(numDrawVerts_, -1);
+
+  for (size_t s = 0; s < compactSubsets_.size(); ++s)
+  {
+    const CompactSubset& cs = compactSubsets_[s];
+    const Subset& sub = subsets_[s];
+
+    for (unsigned int i = 0; i < cs.numVertices; ++i)
+      localID[compactVertexMap_[cs.baseVertex + i]] = int(i);
+
+    if (cs.indexType == GL_UNSIGNED_SHORT)
+    {
+      unsigned short* dst = reinterpret_cast<unsigned short*>(bdst + cs.indexByteOffset);
+      for (unsigned int i = 0; i < cs.numIndices; ++i)
+        dst[i] = (unsigned short)localID[indices_[sub.startIndex + i]];
+    }
+    else
+    {
+      unsigned int* dst = reinterpret_cast<unsigned int*>(bdst + cs.indexByteOffset);
+      for (unsigned int i = 0; i < cs.numIndices; ++i)
+        dst[i] = (unsigned int)localID[indices_[sub.startIndex + i]];
+    }
+  }
+}
+
+int MeshCompiler::buildMeshlets( int _maxVertices /*= 64*/, int _maxTriangles /*= 124*/ )
+{
+  meshlets_.clear();
+  subsetMeshletOffset_.assign(subsets_.size() + 1, 0);
+  vertexMeshletOffset_.clear();
+  vertexMeshlets_.clear();
+
+  if (_maxVertices < 3 || _maxTriangles < 1)
+    return 0;
+
+  // 1. greedy partition of the index buffer, vertex stamps track the vertices of the current meshlet
+
+  std::vector<int> vertexStamp(numDrawVerts_, -1);
+
+  for (size_t s = 0; s < subsets_.size(); ++s)
+  {
+    const Subset& sub = subsets_[s];
+
+    subsetMeshletOffset_[s] = int(meshlets_.size());
+
+    MeshCompilerMeshlet cur;
+    memset(&cur, 0, sizeof(cur));
+    cur.subset = int(s);
+    cur.indexOffset = sub.startIndex;
+
+    for (unsigned int t = 0; t < sub.numTris; ++t)
+    {
+      const int* tri = &indices_[sub.startIndex + t * 3];
+      const int stamp = int(meshlets_.size());
+
+      int numNewVerts = 0;
+      for (int k = 0; k < 3; ++k)
+      {
+        if (vertexStamp[tri[k]] != stamp && (k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+          ++numNewVerts;
+      }
+
+      // close current meshlet
+      if (cur.numTriangles && (int(cur.numVertices) + numNewVerts > _maxVertices || int(cur.numTriangles) >= _maxTriangles))
+      {
+        meshlets_.push_back(cur);
+
+        cur.indexOffset += cur.numTriangles * 3;
+        cur.numTriangles = 0;
+        cur.numVertices = 0;
+
+        --t;
+        continue;
+      }
+
+      for (int k = 0; k < 3; ++k)
+      {
+        if (vertexStamp[tri[k]] != stamp)
+        {
+          vertexStamp[tri[k]] = stamp;
+          ++cur.numVertices;
+        }
+      }
+
+      ++cur.numTriangles;
+    }
+
+    if (cur.numTriangles)
+      meshlets_.push_back(cur);
+  }
+
+  subsetMeshletOffset_[subsets_.size()] = int(meshlets_.size());
+
+
+  // 2. bounding sphere and normal cone of each meshlet
+
+  fitMeshlets(0);
+
+  return int(meshlets_.size());
+}
+
+int MeshCompiler::refitMeshlets()
+{
+  fitMeshlets(0);
+
+  return int(meshlets_.size());
+}
+
+int MeshCompiler::refitMeshlets( const std::vector< std::pair<int, int> >& _ranges )
+{
+  if (meshlets_.empty())
+    return 0;
+
+  if (vertexMeshletOffset_.empty())
+    createVertexMeshletMap();
+
+  // meshlets referencing a vertex in the ranges, each once
+  std::vector<int> ids;
+
+  for (size_t r = 0; r < _ranges.size(); ++r)
+  {
+    const int first = std::max(_ranges[r].first, 0);
+    const int last = std::min(_ranges[r].second, int(numDrawVerts_));
+
+    for (int v = first; v < last; ++v)
+    {
+      for (int k = vertexMeshletOffset_[v]; k < vertexMeshletOffset_[v + 1]; ++k)
+        ids.push_back(vertexMeshlets_[k]);
+    }
+  }
+
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+  fitMeshlets(&ids);
+
+  return int(ids.size());
+}
+
+void MeshCompiler::createVertexMeshletMap()
+{
+  vertexMeshletOffset_.assign(numDrawVerts_ + 1, 0);
+  vertexMeshlets_.clear();
+
+  // count meshlets per vertex, a vertex is counted once per meshlet
+  std::vector<int> vertexStamp(numDrawVerts_, -1);
+
+  for (int m = 0; m < int(meshlets_.size()); ++m)
+  {
+    const MeshCompilerMeshlet& ml = meshlets_[m];
+
+    for (unsigned int i = 0; i < ml.numTriangles * 3; ++i)
+    {
+      const int v = indices_[ml.indexOffset + i];
+      if (vertexStamp[v] != m)
+      {
+        vertexStamp[v] = m;
+        ++vertexMeshletOffset_[v + 1];
+      }
+    }
+  }
+
+  for (unsigned int v = 0; v < numDrawVerts_; ++v)
+    vertexMeshletOffset_[v + 1] += vertexMeshletOffset_[v];
+
+  vertexMeshlets_.resize(vertexMeshletOffset_[numDrawVerts_]);
+
+  std::vector<int> writePos(vertexMeshletOffset_.begin(), vertexMeshletOffset_.end() - 1);
+  vertexStamp.assign(numDrawVerts_, -1);
+
+  for (int m = 0; m < int(meshlets_.size()); ++m)
+  {
+    const MeshCompilerMeshlet& ml = meshlets_[m];
+
+    for (unsigned int i = 0; i < ml.numTriangles * 3; ++i)
+    {
+      const int v = indices_[ml.indexOffset + i];
+      if (vertexStamp[v] != m)
+      {
+        vertexStamp[v] = m;
+        vertexMeshlets_[writePos[v]++] = m;
+      }
+    }
+  }
+}
+
+void MeshCompiler::fitMeshlets( const std::vector<int>* _ids )
+{
+  const int numMeshlets = _ids ? int(_ids->size()) : int(meshlets_.size());
+  const int numThreads = getNumWorkerThreads();
+
+  VertexElement posElement;
+  posElement.type_ = GL_FLOAT;
+  posElement.numElements_ = 3;
+  posElement.usage_ = VERTEX_USAGE_POSITION;
+  posElement.pointer_ = 0;
+  posElement.shaderInputName_ = 0;
+  posElement.divisor_ = 0;
+  posElement.vbo_ = 0;
+
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(numThreads) if (numThreads > 1 && numMeshlets > 256)
+#endif
+  {
+    std::vector<float> triPos;
+    std::vector<float> triNormal;
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(static, 64)
+#endif
+    for (int m = 0; m < numMeshlets; ++m)
+    {
+      MeshCompilerMeshlet& ml = meshlets_[_ids ? (*_ids)[m] : m];
+
+      triPos.assign(ml.numTriangles * 9, 0.0f);
+      triNormal.assign(ml.numTriangles * 3, 0.0f);
+
+      for (unsigned int i = 0; i < ml.numTriangles * 3 && inputIDPos_ >= 0; ++i)
+      {
+        int f, c;
+        input_[inputIDPos_].getElementData(mapToOriginalVertexID(indices_[ml.indexOffset + i], f, c), &triPos[i * 3], &posElement);
+      }
+
+      // bounding sphere: center of bounding box
+      float bbMin[3] = { FLT_MAX,  FLT_MAX,  FLT_MAX};
+      float bbMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+      for (unsigned int i = 0; i < ml.numTriangles * 3; ++i)
+      {
+        for (int k = 0; k < 3; ++k)
+        {
+          bbMin[k] = std::min(bbMin[k], triPos[i * 3 + k]);
+          bbMax[k] = std::max(bbMax[k], triPos[i * 3 + k]);
+        }
+      }
+
+      float radiusSq = 0.0f;
+
+      for (int k = 0; k < 3; ++k)
+        ml.center[k] = (bbMin[k] + bbMax[k]) * 0.5f;
+
+      for (unsigned int i = 0; i < ml.numTriangles * 3; ++i)
+      {
+        float d[3];
+        for (int k = 0; k < 3; ++k)
+          d[k] = triPos[i * 3 + k] - ml.center[k];
+        radiusSq = std::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+      }
+
+      ml.radius = std::sqrt(radiusSq);
+
+      // normal cone: axis is the average triangle normal
+      float axis[3] = {0.0f, 0.0f, 0.0f};
+
+      for (unsigned int t = 0; t < ml.numTriangles; ++t)
+      {
+        const float* p = &triPos[t * 9];
+        float* n = &triNormal[t * 3];
+
+        const float e0[3] = {p[3] - p[0], p[4] - p[1], p[5] - p[2]};
+        const float e1[3] = {p[6] - p[0], p[7] - p[1], p[8] - p[2]};
+
+        n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+        n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+        n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+        const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        // degenerate triangles are never visible
+        if (len > 0.0f)
+        {
+          for (int k = 0; k < 3; ++k)
+          {
+            n[k] /= len;
+            axis[k] += n[k];
+          }
+        }
+      }
+
+      const float axisLen = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+      float minDot = axisLen > 0.0f ? 1.0f : -1.0f;
+
+      for (int k = 0; k < 3; ++k)
+      {
+        ml.coneAxis[k] = axisLen > 0.0f ? axis[k] / axisLen : 0.0f;
+        ml.coneApex[k] = ml.center[k];
+      }
+
+      for (unsigned int t = 0; t < ml.numTriangles && minDot > 0.0f; ++t)
+      {
+        const float* n = &triNormal[t * 3];
+        if (n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f)
+          minDot = std::min(minDot, n[0] * ml.coneAxis[0] + n[1] * ml.coneAxis[1] + n[2] * ml.coneAxis[2]);
+      }
+
+      // cones wider than ~84 degrees are rarely backfacing and numerically unstable
+      if (minDot <= 0.1f)
+        ml.coneCutoff = 2.0f;
+      else
+      {
+        ml.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+
+        // move apex along the negative axis behind all triangle planes
+        float maxT = 0.0f;
+
+        for (unsigned int t = 0; t < ml.numTriangles; ++t)
+        {
+          const float* p = &triPos[t * 9];
+          const float* n = &triNormal[t * 3];
+
+          const float dn = n[0] * ml.coneAxis[0] + n[1] * ml.coneAxis[1] + n[2] * ml.coneAxis[2];
+
+          if (dn > 0.0f)
+          {
+            const float dc = (ml.center[0] - p[0]) * n[0] + (ml.center[1] - p[1]) * n[1] + (ml.center[2] - p[2]) * n[2];
+            maxT = std::max(maxT, dc / dn);
+          }
+        }
+
+        for (int k = 0; k < 3; ++k)
+          ml.coneApex[k] = ml.center[k] - ml.coneAxis[k] * maxT;
+      }
+    }
+  }
+}
+
+void MeshCompiler::getSubsetMeshlets( int _subset, int& _first, int& _count ) const
+{
+  if (subsetMeshletOffset_.empty())
+  {
+    _first = _count = 0;
+    return;
+  }
+
+  _first = subsetMeshletOffset_[_subset];
+  _count = subsetMeshletOffset_[_subset + 1] - _first;
+}
+
+void MeshCompiler::getMeshletTable( void* _dst ) const
+{
+  char* bdst = static_cast<char*>(_dst);
+
+  for (size_t m = 0; m < meshlets_.size(); ++m)
+  {
+    const MeshCompilerMeshlet& ml = meshlets_[m];
+
+    float* fdst = reinterpret_cast<float*>(bdst + m * MESHLET_TABLE_STRIDE);
+
+    fdst[0] = ml.center[0]; fdst[1] = ml.center[1]; fdst[2] = ml.center[2]; fdst[3] = ml.radius;
+    fdst[4] = ml.coneAxis[0]; fdst[5] = ml.coneAxis[1]; fdst[6] = ml.coneAxis[2]; fdst[7] = ml.coneCutoff;
+    fdst[8] = ml.coneApex[0]; fdst[9] = ml.coneApex[1]; fdst[10] = ml.coneApex[2]; fdst[11] = 0.0f;
+
+    const unsigned int range[4] = {ml.indexOffset, ml.numTriangles, ml.numVertices, (unsigned int)ml.subset};
+    memcpy(fdst + 12, range, sizeof(range));
+  }
+}
+
+struct MeshCompiler_EdgeTriMapKey
+{
+  // ordered vertex ids of the edge:  e0 < e1
+  int e0, e1;
+
+  MeshCompiler_EdgeTriMapKey(int a, int b)
+    : e0(std::min(a,b)), e1(std::max(a,b)) {}
+
+  bool operator ==(const MeshCompiler_EdgeTriMapKey& k) const
+  {
+    return e0 == k.e0 && e1 == k.e1;
+  }
+
+  bool operator <(const MeshCompiler_EdgeTriMapKey& k) const
+  {
+    if (e0 < k.e0)
+      return true;
+
+    if (e0 > k.e0)
+      return false;
+
+    return e1 < k.e1;
+  }
+};
+
+
+#ifdef ACG_MC_USE_STL_HASH
+// requires c++0x
+struct MeshCompiler_EdgeTriMapKey_Hash
+{
+  std::size_t operator()(const MeshCompiler_EdgeTriMapKey& k) const
+  {
+    return ((std::hash<int>()(k.e0) << 1) ^ std::hash<int>()(k.e1)) >> 1;
+  }
+};
+#else
+uint qHash(const MeshCompiler_EdgeTriMapKey& k)
+{
+  return ((::qHash(k.e0) << 1) ^ ::qHash(k.e1)) >> 1;
+}
+#endif // ACG_MC_USE_STL_HASH
+
+
+void MeshCompiler::getIndexAdjBuffer(void* _dst, const int _borderIndex /* = -1 */)
+{
+  int* idst = (int*)_dst;
+
+  for (int i = 0; i < numTris_; ++i)
+  {
+    // initialize all triangles
+    idst[i*6] = getIndex(i*3);
+    idst[i*6+2] = getIndex(i*3+1);
+    idst[i*6+4] = getIndex(i*3+2);
+    
+    idst[i*6+1] = _borderIndex;
+    idst[i*6+3] = _borderIndex;
+    idst[i*6+5] = _borderIndex;
+  }
+
+  // map from edge -> adjacent tris
+  QHash<MeshCompiler_EdgeTriMapKey, std::pair<int, int> > EdgeAdjMap;
+
+  for (int i = 0; i < numTris_; ++i)
+  {
+    // get input positions of triangle
+    int PosIdx[3];
+
+    for (int k = 0; k < 3; ++k)
+    {
+      int faceId, cornerId;
+      PosIdx[k] = mapToOriginalVertexID(getIndex(i*3+k), faceId, cornerId);
+    }
+
+    // build edge->triangle adjacency map
+    for (int e = 0; e < 3; ++e)
+    {
+      MeshCompiler_EdgeTriMapKey edge( PosIdx[e], PosIdx[(e+1)%3] );
+
+      QHash< MeshCompiler_EdgeTriMapKey, std::pair<int, int> >::iterator itKey;
+
+      itKey = EdgeAdjMap.find(edge);
+
+      if (itKey == EdgeAdjMap.end())
+        EdgeAdjMap[edge] = std::pair<int, int>(i, -1);
+      else
+        itKey.value().second = i;
+    }
+
+  }
+
+  // use edge->triangle adjacency map to build index buffer with adjacency
+  for (QHash< MeshCompiler_EdgeTriMapKey, std::pair<int, int> >::iterator it = EdgeAdjMap.begin(); it != EdgeAdjMap.end(); ++it)
+  {
+    // two adjacent tris of current edge
+    int Tris[2] = {it.value().first, it.value().second};
+
+    // get input positions of triangles
+    int PosIdx[6];
+
+    for (int k = 0; k < 3; ++k)
+    {
+      int faceId, cornerId;
+
+      PosIdx[k] = mapToOriginalVertexID(getIndex(Tris[0]*3+k), faceId, cornerId);
+
+      if (Tris[1] >= 0)
+        PosIdx[3+k] = mapToOriginalVertexID(getIndex(Tris[1]*3+k), faceId, cornerId);
+    }
+
+
+    // find edge and opposite corner wrt. to adjacent tris
+
+    int TriEdges[2] = {-1,-1};
+    int TriOppositeVerts[2] = {-1,-1};
+
+    for (int e = 0; e < 3; ++e)
+    {
+      MeshCompiler_EdgeTriMapKey edge0( PosIdx[e], PosIdx[(e+1)%3] );
+
+      if (edge0 == it.key())
+      {
+        TriEdges[0] = e;
+        TriOppositeVerts[1] = (e+2)%3;
+      }
+    }
+
+    if (Tris[1] >= 0)
+    {
+      for (int e = 0; e < 3; ++e)
+      {
+        MeshCompiler_EdgeTriMapKey edge1( PosIdx[3 + e], PosIdx[3 + ((e+1)%3)] );
+
+        if (edge1 == it.key())
+        {
+          TriEdges[1] = e;
+          TriOppositeVerts[0] = (e+2)%3;
+        }
+      }
+    }
+
+    // store adjacency in buffer
+
+    for (int i = 0; i < 2; ++i)
+    {
+      if (Tris[i] >= 0)
+      {
+        int e = TriEdges[i];
+
+        // opposite vertex
+        int ov = _borderIndex;
+
+        if (TriOppositeVerts[i] >= 0 && Tris[(i+1)%2] >= 0)
+          ov = getIndex(Tris[(i+1)%2]*3 + TriOppositeVerts[i]);
+
+        idst[Tris[i] * 6 + e*2 + 1] = ov;
+      }
+    }
+
+  }
+
+  return;
+
+  /*
+
+  // alternative algorithm without hashing with multi threading
+  // in case hashing method is too slow, the following unfinished implementation can be completed
+
+  // requires vertex-face adjacency
+
+  computeAdjacency();
 
 #ifdef  USE_OPENMP
 #pragma omp parallel for
@@ -3885,6 +5394,18 @@ std::string MeshCompiler::checkInputData() const
 
 void MeshCompiler::prepareData()
 {
+  // id mappings of a previous build are invalid now
+  inputVertexMapOffset_.clear();
+  inputVertexMap_.clear();
+  clearDirtyInputVertices();
+  compactSubsets_.clear();
+  compactVertexMap_.clear();
+  compactIndexBufferSize_ = 0;
+  meshlets_.clear();
+  subsetMeshletOffset_.clear();
+  vertexMeshletOffset_.clear();
+  vertexMeshlets_.clear();
+
   // update face count, in case not provided by user
   numFaces_ = faceInput_->getNumFaces();
   numIndices_ = faceInput_->getNumIndices();
@@ -4018,6 +5539,26 @@ int MeshCompiler::getNumFaces() const
   return numFaces_;
 }
 
+void MeshCompiler::setWeldMethod( WeldMethod _method, double _quantizationEps )
+{
+  weldMethod_ = _method;
+  weldQuantizationEps_ = _quantizationEps;
+}
+
+void MeshCompiler::setNumThreads( int _numThreads )
+{
+  numThreads_ = std::max(_numThreads, 0);
+}
+
+int MeshCompiler::getNumWorkerThreads() const
+{
+#ifdef USE_OPENMP
+  return numThreads_ > 0 ? numThreads_ : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
 void MeshCompiler::setProvokingVertex( int _v )
 {
   provokingVertex_ = _v;
@@ -237,6 +237,87 @@ public:
   const float f_eps_;
 };
 
+class MeshCompiler;
+
+/** \brief Compiled part of a mesh, see MeshCompiler::buildChunked()
+ *
+ * Buffers are only valid during MeshCompilerChunkCallback::processChunk().
+*/
+struct ACGDLLEXPORT MeshCompilerChunk
+{
+  /// chunk index
+  int id;
+
+  /// compiled chunk, ids and subsets are local to the chunk
+  const MeshCompiler* compiler;
+
+  /// interleaved vertex buffer of the chunk
+  int numVertices;
+  const char* vertices;
+
+  /// 32bit index buffer of the chunk, indices are already offset by vertexOffset
+  int numTriangles;
+  const int* indices;
+
+  /// draw triangle id of the chunk -> input face id
+  const int* faceIDs;
+
+  /// position of the chunk in the combined vertex buffer (in vertices)
+  int vertexOffset;
+
+  /// position of the chunk in the combined index buffer (in indices)
+  int indexOffset;
+};
+
+class ACGDLLEXPORT MeshCompilerChunkCallback
+{
+  // output interface of MeshCompiler::buildChunked()
+
+public:
+  MeshCompilerChunkCallback(){}
+  virtual ~MeshCompilerChunkCallback(){}
+
+  /** Called once for each compiled chunk in order of the combined buffers.
+   *
+   * Example: upload to preallocated buffers via
+   *  glBufferSubData(GL_ARRAY_BUFFER, _chunk.vertexOffset * stride, _chunk.numVertices * stride, _chunk.vertices) and
+   *  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, _chunk.indexOffset * 4, _chunk.numTriangles * 12, _chunk.indices)
+   * @param _chunk compiled chunk
+  */
+  virtual void processChunk(const MeshCompilerChunk& _chunk) = 0;
+};
+
+/** \brief Cluster of consecutive triangles of a subset, see MeshCompiler::buildMeshlets()
+ *
+ * Bounds are given in the space of the input positions.
+*/
+struct ACGDLLEXPORT MeshCompilerMeshlet
+{
+  /// subset id, see MeshCompiler::getSubset()
+  int subset;
+
+  /// first index of the meshlet in the draw index buffer
+  unsigned int indexOffset;
+
+  /// number of triangles, the meshlet covers numTriangles * 3 indices starting at indexOffset
+  unsigned int numTriangles;
+
+  /// number of unique draw vertices referenced by the meshlet
+  unsigned int numVertices;
+
+  /// bounding sphere
+  float center[3];
+  float radius;
+
+  /** normal cone: all triangles of the meshlet are backfacing as seen from eye position e
+   *  if dot(normalize(coneApex - e), coneAxis) >= coneCutoff
+   *  coneCutoff > 1 disables the backface test
+   */
+  float coneApex[3];
+  float coneAxis[3];
+  float coneCutoff;
+};
+
 class ACGDLLEXPORT MeshCompiler
 {
 public:
@@ -500,12 +581,100 @@ public:
 
   /** \brief Build vertex + index buffer.
    * 
+   * Draw vertices are always numbered in order of their first use in the final index buffer
+   * for sequential vertex fetches (see GPUCacheOptimizer::ComputeFetchEfficiency).
+   * Vertices not referenced by any triangle are stored at the end of the vertex buffer.
+   *
    * @param _weldVertices Compare vertices and attempt to eliminate duplicates. High computation cost
    * @param _optimizeVCache Reorder faces for optimized vcache usage. High computation cost
    * @param _needPerFaceAttribute User wants to set per-face attributes in draw vertex buffer. Per-face data can be stored in the provoking vertex of each face. Low computation cost
    * @param _keepIsolatedVertices Isolated vertices should not be discarded in the output vertex buffer
+   * @param _optimizeOverdraw Reorder clusters of faces within each subset to reduce overdraw, see GPUCacheOptimizerOverdraw. Requires _optimizeVCache. Low computation cost
+  */
+  void build(bool _weldVertices = false, bool _optimizeVCache = true, bool _needPerFaceAttribute = false, bool _keepIsolatedVertices = false, bool _optimizeOverdraw = false);
+
+  /** \brief Build vertex + index buffer in chunks with bounded memory usage.
+   *
+   * Input faces are sorted along a space filling curve of their centroids and split into spatially coherent chunks.
+   * Each chunk is compiled by a temporary MeshCompiler on a local copy of its vertex data and passed to the callback.
+   * Peak memory usage is proportional to the chunk size plus 12 bytes per input face for the spatial sort.
+   * Vertices are neither shared nor welded across chunk boundaries, isolated vertices are discarded.
+   *
+   * The combined index buffer has the same size as the one from build(),
+   * the combined vertex buffer never contains more vertices than the number of input face corners.
+   * This compiler keeps its input and does not provide any build output afterwards.
+   *
+   * @param _callback receives the compiled chunks
+   * @param _maxFacesPerChunk max number of input faces per chunk
+   * @param _weldVertices see build()
+   * @param _optimizeVCache see build(), applied per chunk
+   * @param _needPerFaceAttribute see build()
+   * @return total number of vertices in the combined vertex buffer
+  */
+  int buildChunked(MeshCompilerChunkCallback* _callback, int _maxFacesPerChunk = 65536,
+    bool _weldVertices = false, bool _optimizeVCache = true, bool _needPerFaceAttribute = false);
+
+  /// vertex welding methods, see setWeldMethod()
+  enum WeldMethod
+  {
+    WELD_ADJACENCY,      ///< compare corners of the vertex-face adjacency with MeshCompilerVertexCompare (default)
+    WELD_HASH,           ///< hash table lookup of the interleaved vertex data, bitwise equal vertices are welded
+    WELD_HASH_QUANTIZED  ///< like WELD_HASH, but float and double attributes are snapped to a grid of size _quantizationEps first
+  };
+
+  /** \brief Choose the vertex welding method used in build()
+   *
+   * Welding merges face corners that reference the same input position and have equal vertex data.
+   * WELD_ADJACENCY compares each corner with all other corners of the adjacent faces of a vertex,
+   * which is quadratic in the vertex valence and requires the vertex-face adjacency list.
+   * The hash methods compute a key from the position id and the interleaved vertex data of each corner
+   * and look it up in a hash table, which runs in linear time and does not need any adjacency information.
+   * WELD_HASH_QUANTIZED approximates the epsilon comparison of MeshCompilerVertexCompare:
+   * values in the same grid cell are welded, but close values on different sides of a cell boundary are not.
+   *
+   * @param _method welding method
+   * @param _quantizationEps grid size for WELD_HASH_QUANTIZED
+   */
+  void setWeldMethod(WeldMethod _method, double _quantizationEps = 1e-4);
+
+  /** Get vertex welding method, see setWeldMethod()
   */
-  void build(bool _weldVertices = false, bool _optimizeVCache = true, bool _needPerFaceAttribute = false, bool _keepIsolatedVertices = false);
+  WeldMethod getWeldMethod() const {return weldMethod_;}
+
+  /** \brief Enable multithreaded mesh compilation
+   *
+   * build() distributes triangulation, vertex splitting, face sorting and vcache optimization of subsets over several threads.
+   * getVertexBuffer() writes the vertex buffer in parallel as well.
+   * The result is identical to a single-threaded build, unless setClusteredVCacheOptimization() is enabled.
+   * Multithreading requires ACG to be compiled with OpenMP (USE_OPENMP), otherwise this setting has no effect.
+   *
+   * In this mode the face input interface and the vertex input buffers are read concurrently by multiple threads,
+   * so a custom MeshCompilerFaceInput must be safe for concurrent read access.
+   * Vertex splitting needs an additional temporary buffer of size numIndices * numAttributes * 4 bytes.
+   *
+   * @param _numThreads number of threads, 0 uses all available cores, 1 disables multithreading (default)
+   */
+  void setNumThreads(int _numThreads);
+
+  /** Get number of threads used in build(), see setNumThreads()
+  */
+  int getNumThreads() const {return numThreads_;}
+
+  /** \brief Enable clustered vcache optimization of large subsets
+   *
+   * Subsets with many triangles are sorted along a morton curve of the face centroids and split into clusters
+   * of consecutive triangles in this order, which are optimized with Tipsify concurrently, see GPUCacheOptimizerTipsifyParallel.
+   * This only takes effect if multithreading is enabled with setNumThreads() and overdraw optimization is disabled.
+   * The resulting index buffer differs from a single-threaded build and its ACMR is slightly higher
+   * due to cache misses at the cluster borders, independent of the input face order.
+   *
+   * @param _enable enable clustered optimization (default: false, plain Tipsify on each subset)
+   */
+  void setClusteredVCacheOptimization(bool _enable) {clusteredVCacheOpt_ = _enable;}
+
+  /** Check whether clustered vcache optimization is enabled, see setClusteredVCacheOptimization()
+  */
+  bool getClusteredVCacheOptimization() const {return clusteredVCacheOpt_;}
 
   /** Get number of vertices in final buffer.
   */
@@ -666,6 +835,211 @@ public:
 /** @} */  
 
 
+//===========================================================================
+/** @name Incremental Update
+* @{ */
+//===========================================================================  
+
+  /** \brief Mark an input position as modified
+   *
+   * The vertex split map, triangulation, optimized triangle order and all id mappings of the last build()
+   * remain valid as long as the face connectivity does not change.
+   * If only the vertex data of some input positions is modified, it is sufficient to mark these positions as dirty
+   * and refill the affected ranges of the vertex buffer with refillVertexBuffer() instead of calling build() again.
+   *
+   * Note that welding and triangulation of concave polygons were computed with the old vertex data and are not updated.
+   * The input buffer has to be modified by the user before calling refillVertexBuffer().
+   *
+   * @param _posID Position ID in input buffer
+  */
+  void setInputVertexDirty(const int _posID);
+
+  /** Get number of dirty input positions since the last refill.
+  */
+  int getNumDirtyInputVertices() const {return int(dirtyInputVertices_.size());}
+
+  /** Reset the list of dirty input positions.
+  */
+  void clearDirtyInputVertices();
+
+  /** \brief Get ranges of the draw vertex buffer affected by dirty input positions
+   *
+   * Ranges are sorted and disjoint. Neighboring ranges with a gap of at most _maxGap clean vertices are merged,
+   * which reduces the number of buffer uploads at the cost of rewriting some unchanged vertices.
+   *
+   * @param _ranges [out] list of half-open ranges [first, last) in the draw vertex buffer
+   * @param _maxGap max number of clean vertices in between two merged ranges
+  */
+  void getDirtyVertexRanges(std::vector< std::pair<int, int> >& _ranges, const int _maxGap = 0);
+
+  /** \brief Rewrite dirty vertices in a vertex buffer
+   *
+   * Updates all draw vertices of dirty input positions in a previously filled vertex buffer and clears the dirty list.
+   * The buffer _dst must contain the full vertex buffer as returned by getVertexBuffer().
+   *
+   * @param _dst [in/out] Pointer to vertex buffer of size getNumVertices() * getVertexDeclaration()->getVertexStride()
+   * @param _ranges [out] optional, ranges of the buffer that have been written, see getDirtyVertexRanges()
+   * @param _maxGap max number of clean vertices in between two merged ranges
+   * @return number of vertices written
+  */
+  int refillVertexBuffer(void* _dst, std::vector< std::pair<int, int> >* _ranges = 0, const int _maxGap = 0);
+
+/** @} */  
+
+
+//===========================================================================
+/** @name Compact Output
+* @{ */
+//===========================================================================  
+
+  /// compaction options, see buildCompactOutput()
+  enum CompactFlags
+  {
+    COMPACT_INDICES   = 1, ///< 16 bit indices for subsets with less than 65536 vertices
+    COMPACT_NORMALS   = 2, ///< float3 normals are packed to GL_INT_2_10_10_10_REV
+    COMPACT_POSITIONS = 4, ///< float3 positions are quantized to 16 bit relative to the subset bounding box
+    COMPACT_ALL       = 7
+  };
+
+  /// draw information of a subset in the compact buffers
+  struct CompactSubset
+  {
+    int subset;                   ///< subset id, see getSubset()
+    GLenum indexType;             ///< GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    unsigned int indexByteOffset; ///< offset in bytes into the compact index buffer
+    unsigned int numIndices;      ///< number of indices of the subset
+    unsigned int baseVertex;      ///< first vertex of the subset in the compact vertex buffer, indices are relative to it
+    unsigned int numVertices;     ///< number of vertices of the subset
+    float posScale[3];            ///< dequantization of positions: pos = snorm16 * posScale + posOffset
+    float posOffset[3];
+  };
+
+  /** \brief Prepare compact vertex and index buffers after build()
+   *
+   * Each subset gets its own block of vertices in the compact vertex buffer, such that indices are local to the subset
+   * and positions can be quantized relative to its bounding box.
+   * Vertices shared by several subsets are duplicated, isolated vertices are discarded.
+   * Only float and double attributes are compacted, other attributes keep their format.
+   *
+   * Quantized positions are stored as normalized GL_SHORT x4 and have to be dequantized in the vertex shader,
+   * see ShaderGenDesc::quantizedPositions. The subset has to be drawn with baseVertex added to its indices,
+   * for instance with glDrawElementsBaseVertex().
+   *
+   * @param _flags combination of CompactFlags
+  */
+  void buildCompactOutput(int _flags = COMPACT_ALL);
+
+  /** Get vertex declaration of the compact vertex buffer.
+  */
+  const VertexDeclaration* getCompactVertexDeclaration() const {return &compactDecl_;}
+
+  /** Get number of vertices in compact vertex buffer.
+  */
+  int getNumCompactVertices() const {return int(compactVertexMap_.size());}
+
+  /** Get size in bytes of the compact index buffer.
+  */
+  unsigned int getCompactIndexBufferSize() const {return compactIndexBufferSize_;}
+
+  /** Get draw information of a subset in the compact buffers.
+   *
+   * @param _i subset index in range [0, getNumSubsets() - 1]
+  */
+  const CompactSubset* getCompactSubset(int _i) const {return &compactSubsets_[_i];}
+
+  /** \brief Get compact vertex buffer
+   *
+   * @param _dst [out] Pointer to memory of size getNumCompactVertices() * getCompactVertexDeclaration()->getVertexStride()
+  */
+  void getCompactVertexBuffer(void* _dst) const;
+
+  /** \brief Get compact index buffer with mixed 16 and 32 bit indices
+   *
+   * @param _dst [out] Pointer to memory of size getCompactIndexBufferSize()
+  */
+  void getCompactIndexBuffer(void* _dst) const;
+
+  /** Mapping from compact vertex id -> draw vertex id
+   *
+   * @param _i Vertex ID in compact vertex buffer
+   * @return Vertex ID in draw vertex buffer
+  */
+  int mapCompactToDrawVertexID(const int _i) const {return compactVertexMap_[_i];}
+
+/** @} */  
+
+
+//===========================================================================
+/** @name Meshlets
+* @{ */
+//===========================================================================  
+
+  /// size in bytes of one meshlet in the table of getMeshletTable()
+  static const int MESHLET_TABLE_STRIDE = 64;
+
+  /** \brief Partition each subset into meshlets after build()
+   *
+   * Triangles are assigned to meshlets in the order of the draw index buffer,
+   * so each meshlet covers a contiguous range of the index buffer and can be drawn directly from it.
+   * A meshlet is closed as soon as the next triangle would exceed one of the limits.
+   * Meshlets are stored in subset order.
+   *
+   * @param _maxVertices max number of unique vertices per meshlet
+   * @param _maxTriangles max number of triangles per meshlet
+   * @return number of meshlets
+  */
+  int buildMeshlets(int _maxVertices = 64, int _maxTriangles = 124);
+
+  /** \brief Update bounding spheres and normal cones of the meshlets after positions changed
+   *
+   * Keeps the partition of buildMeshlets() and only refits meshlets that reference a draw vertex
+   * in one of the ranges, so that a deformation costs O(modified vertices) instead of a full rebuild.
+   * Positions are read from the vertex input as in buildMeshlets().
+   *
+   * @param _ranges draw vertex ranges [first, last), e.g. from getDirtyVertexRanges()
+   * @return number of refitted meshlets
+  */
+  int refitMeshlets(const std::vector< std::pair<int, int> >& _ranges);
+
+  /** \brief Update bounding spheres and normal cones of all meshlets, keeps the partition
+   *
+   * @return number of meshlets
+  */
+  int refitMeshlets();
+
+  /** Get number of meshlets created by buildMeshlets().
+  */
+  int getNumMeshlets() const {return int(meshlets_.size());}
+
+  /** Get a meshlet.
+   *
+   * @param _i meshlet index in range [0, getNumMeshlets() - 1]
+  */
+  const MeshCompilerMeshlet* getMeshlet(int _i) const {return &meshlets_[_i];}
+
+  /** Get the meshlets of a subset.
+   *
+   * @param _subset subset index in range [0, getNumSubsets() - 1]
+   * @param _first [out] index of the first meshlet of the subset
+   * @param _count [out] number of meshlets of the subset
+  */
+  void getSubsetMeshlets(int _subset, int& _first, int& _count) const;
+
+  /** \brief Get the meshlet table for gpu buffers (SSBO or texture buffer)
+   *
+   * Each meshlet is stored as four vec4 (MESHLET_TABLE_STRIDE bytes):
+   *  - center.xyz, radius
+   *  - coneAxis.xyz, coneCutoff
+   *  - coneApex.xyz, 0
+   *  - indexOffset, numTriangles, numVertices, subset as 32 bit unsigned integers (use floatBitsToUint() in a float buffer)
+   *
+   * @param _dst [out] Pointer to memory of size getNumMeshlets() * MESHLET_TABLE_STRIDE
+  */
+  void getMeshletTable(void* _dst) const;
+
+/** @} */  
+
+
 //===========================================================================
 /** @name Triangulation properties
 * @{ */
@@ -698,6 +1072,27 @@ private:
   // convert per-face vertices to unique ids
   void splitVertices();
 
+  // multithreaded version of splitVertices(), computes the same vertex ids
+  void splitVertices_MT();
+
+  // number of threads to use in parallel sections, 1 if not compiled with OpenMP
+  int getNumWorkerThreads() const;
+
+  // create inverse vertex map: input position id -> draw vertex ids
+  void createInputVertexMap();
+
+  // create map: draw vertex id -> meshlets referencing the vertex
+  void createVertexMeshletMap();
+
+  // bounding sphere and normal cone of meshlets, _ids: meshlet ids or 0 for all meshlets
+  void fitMeshlets(const std::vector<int>* _ids);
+
+  // centroid of an input face, _out: float3
+  void getInputFaceCentroid(const int _face, float* _out) const;
+
+  // triangles of a subset sorted along a morton curve of their face centroids, _triOrder: sorted id -> triangle id within the subset
+  void getSubsetMortonOrder(int _subset, int _numThreads, std::vector<int>& _triOrder) const;
+
 private:
 
   // small helper functions
@@ -810,6 +1205,9 @@ private:
   int   numTris_;
   std::vector<int>  triIndexBuffer_; // triangulated index buffer with interleaved vertices
 
+  int   numThreads_; // user setting for multithreaded build, see setNumThreads()
+  bool  clusteredVCacheOpt_; // user setting for clustered vcache optimization, see setClusteredVCacheOptimization()
+
   // IDs of isolated vertices: index into input position buffer
   std::vector<int>  isolatedVertices_;
 
@@ -880,6 +1278,9 @@ private:
   static MeshCompilerVertexCompare defaultVertexCompare;
   MeshCompilerVertexCompare* vertexCompare_;
 
+  WeldMethod weldMethod_;
+  double     weldQuantizationEps_;
+
   // mapping from <faceId, faceCornerId> -> <weldFaceId, weldFaceCorner>
 //  std::vector< std::pair<int, unsigned char> > vertexWeldMap_;   // std::pair<int, unsigned char> gets padded to 8 bytes
   std::vector<int> vertexWeldMapFace_;
@@ -960,6 +1361,28 @@ private:
   /// output tri index -> input face index
   std::vector<int> triToFaceMap_;
 
+  /// input position id -> draw vertex ids, offsets into inputVertexMap_ (size: numPositions + 1), created on demand
+  std::vector<int> inputVertexMapOffset_;
+  std::vector<int> inputVertexMap_;
+
+  /// input positions modified since the last refill, see setInputVertexDirty()
+  std::vector<int>  dirtyInputVertices_;
+  std::vector<char> dirtyInputVertexFlags_;
+
+  /// compact output, see buildCompactOutput()
+  VertexDeclaration compactDecl_;
+  std::vector<CompactSubset> compactSubsets_;
+  std::vector<int> compactVertexMap_; // compact vertex id -> draw vertex id
+  unsigned int compactIndexBufferSize_;
+
+  /// meshlets in subset order, see buildMeshlets()
+  std::vector<MeshCompilerMeshlet> meshlets_;
+  std::vector<int> subsetMeshletOffset_; // first meshlet of each subset (size: numSubsets + 1)
+
+  /// draw vertex id -> meshlet ids, see createVertexMeshletMap()
+  std::vector<int> vertexMeshletOffset_; // (size: numDrawVerts + 1)
+  std::vector<int> vertexMeshlets_;
+
   // =====================================================
 
   // final buffers used for drawing
@@ -1002,6 +1425,15 @@ private:
   // eliminate duplicate attribute entries
   void weldVertices();
 
+  // eliminate duplicate attribute entries with a hash table, see setWeldMethod()
+  void weldVertices_Hash();
+
+  // size in bytes of the hash key of a face corner for weldVertices_Hash()
+  int getWeldKeySize() const;
+
+  // compute hash key of a face corner, _vtxBuf is a work buffer of size getVertexStride()
+  void getWeldKey(const int _face, const int _corner, char* _vtxBuf, char* _key) const;
+
   // fix incomplete welding map if mesh contains isolated vertices
   void fixWeldMap();
 
@@ -1014,8 +1446,14 @@ private:
   // sort input faces by group ids
   void sortFacesByGroup();
 
-  // v-cache optimization + vertex reorder
-  void optimize();
+  // v-cache optimization
+  void optimize(bool _overdraw);
+
+  // v-cache optimization of one subset, _splitPositions enables overdraw optimization
+  void optimizeSubset(int _subset, const float* _splitPositions, int _numThreads);
+
+  // reorder draw vertices in first-use order of the index buffer
+  void optimizeVertexFetch();
 
   // create vertex mapping: input id <-> final buffer id
   void createVertexMap(bool _keepIsolatedVerts);
@@ -204,6 +204,7 @@ RenderObject::RenderObject()
   primitiveMode(GL_TRIANGLES), patchVertices(0), numIndices(0), indexOffset(0), indexType(GL_UNSIGNED_INT),
   numInstances(0),
   vertexDecl(0),
+  meshlets(0), numMeshlets(0),
   culling(true), blending(false), alphaTest(false),
   depthTest(true), depthWrite(true),
   fillMode(GL_FILL), depthFunc(GL_LESS),
@@ -227,7 +228,9 @@ RenderObject::RenderObject()
   depthMapUniformName(0),
 
   debugID(0),
-  internalFlags_(0)
+  internalFlags_(0),
+  shaderDescFingerprint_(0),
+  shaderDescFingerprintValid_(false)
 {
   colorWriteMask[0] = colorWriteMask[1] = colorWriteMask[2] = colorWriteMask[3] = 1;
 }
@@ -236,6 +239,16 @@ RenderObject::~RenderObject() {
   uniformPool_.clear();
 }
 
+quint64 RenderObject::getShaderDescFingerprint()
+{
+  if (!shaderDescFingerprintValid_)
+  {
+    shaderDescFingerprint_ = shaderDesc.fingerprint();
+    shaderDescFingerprintValid_ = true;
+  }
+  return shaderDescFingerprint_;
+}
+
 QString RenderObject::toString() const
 {
   // several mappings: (int)GLEnum -> string
@@ -309,6 +322,9 @@ QString RenderObject::toString() const
              << "\nibo-id: " << indexBuffer
              << "\nsysmemIndexBuffer: " << sysmemIndexBuffer;
 
+  if (meshlets)
+    resultStrm << "\nnumMeshlets: " << numMeshlets;
+
 
 
   resultStrm << "\n" << shaderDesc.toString();
@@ -61,6 +61,7 @@ namespace ACG
 // forward declaration
 class VertexDeclaration;
 class GLState;
+struct MeshCompilerMeshlet;
 
 namespace SceneGraph {
   namespace DrawModes {
@@ -207,6 +208,19 @@ struct ACGDLLEXPORT RenderObject
   /// Defines the vertex buffer layout,  ignored if VAO is provided
   const VertexDeclaration* vertexDecl;
 
+  /** \brief Meshlets for culling on the cpu (optional)
+   *
+   * Table of meshlets covering the index range of this object, see MeshCompiler::buildMeshlets().
+   * The renderer rejects whole meshlets outside of the view frustum and, if culling is enabled,
+   * meshlets whose normal cone is completely backfacing. Only the index ranges of the remaining meshlets are drawn.
+   * Meshlet index offsets are absolute positions in the index buffer object,
+   * so this is only supported for indexed GL_TRIANGLES from an IBO or VAO without instancing and ignored otherwise.
+   *
+   * default: 0
+   */
+  const MeshCompilerMeshlet* meshlets;
+  unsigned int numMeshlets;
+
   /** @} */
 
 
@@ -224,6 +238,16 @@ struct ACGDLLEXPORT RenderObject
    */
   ShaderGenDesc shaderDesc;
 
+  /** \brief ShaderGenDesc::fingerprint() of shaderDesc
+   *
+   * Computed once and reused by all render passes to look up the program in the ShaderCache.
+   * Call invalidateShaderDescFingerprint() after changing shaderDesc of an object that may have been rendered.
+   */
+  quint64 getShaderDescFingerprint();
+
+  /// Recompute the fingerprint of shaderDesc on the next getShaderDescFingerprint()
+  void invalidateShaderDescFingerprint() {shaderDescFingerprintValid_ = false;}
+
   // opengl states
   //  queried from glState in initFromState()
   bool culling;
@@ -363,6 +387,12 @@ public:
   /// may be used internally by the renderer
   unsigned int internalFlags_;
 
+private:
+  /// cached ShaderGenDesc::fingerprint() of shaderDesc
+  quint64 shaderDescFingerprint_;
+  bool shaderDescFingerprintValid_;
+public:
+
 
   // opengl style helper function interface: 
   // provided for easier setup of RenderObjects,
@@ -44,7 +44,9 @@
 
 #include "ShaderCache.hh"
 
+#include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 
@@ -52,19 +54,206 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
+#include <QRunnable>
+#include <QSaveFile>
 #include <QTextStream>
+#include <QThreadPool>
+
+#include <atomic>
 
 #include <ACG/GL/GLError.hh>
 #include <ACG/ShaderUtils/GLSLShader.hh>
+#include <ACG/Utils/StopWatch.hh>
 
 
 namespace ACG
 {
 
+namespace {
+
+const quint64 fnvOffsetBasis = 14695981039346656037ull;
+
+/// continue a FNV-1a hash with _size bytes of _data
+quint64 hashBytes(quint64 _hash, const void* _data, size_t _size)
+{
+  const quint64 fnv_prime = 1099511628211ull;
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+  for (size_t i = 0; i < _size; ++i)
+  {
+    _hash ^= bytes[i];
+    _hash *= fnv_prime;
+  }
+  return _hash;
+}
+
+/// continue a FNV-1a hash with the source of shader stage _stage
+quint64 hashSource(quint64 _hash, GLenum _stage, const QStringList& _src)
+{
+  _hash = hashBytes(_hash, &_stage, sizeof(_stage));
+  for (QStringList::const_iterator it = _src.constBegin(); it != _src.constEnd(); ++it)
+  {
+    const int length = it->size();
+    _hash = hashBytes(_hash, &length, sizeof(length));
+    _hash = hashBytes(_hash, it->constData(), length * sizeof(QChar));
+  }
+  return _hash;
+}
+
+quint64 hashSource(quint64 _hash, GLenum _stage, const GLSL::StringList& _src)
+{
+  _hash = hashBytes(_hash, &_stage, sizeof(_stage));
+  for (GLSL::StringList::const_iterator it = _src.begin(); it != _src.end(); ++it)
+  {
+    const int length = static_cast<int>(it->size());
+    _hash = hashBytes(_hash, &length, sizeof(length));
+    _hash = hashBytes(_hash, it->data(), length);
+  }
+  return _hash;
+}
+
+/// header of a file in the program binary cache, followed by the binary
+struct ProgramBinaryHeader
+{
+  char magic[8];       // "ACGPRGB"
+  quint32 version;     // file format version
+  quint32 format;      // binary format as returned by glGetProgramBinary
+  quint64 sourceKey;   // hash of the shader sources
+  quint64 driverKey;   // hash of vendor, renderer and version of the driver
+  quint32 size;        // size of the binary in bytes
+  float compileTime;   // time in ms it took to compile the program from source, negative if unknown
+};
+
+const char programBinaryMagic[8] = "ACGPRGB";
+const quint32 programBinaryVersion = 2;
+
+/// hash of the generated sources, key in the binary cache
+quint64 getSourceKey(ShaderProgGenerator& _progGen)
+{
+  quint64 key = hashSource(fnvOffsetBasis, GL_VERTEX_SHADER, _progGen.getVertexShaderCode());
+  if (_progGen.hasTessControlShader())
+    key = hashSource(key, GL_TESS_CONTROL_SHADER, _progGen.getTessControlShaderCode());
+  if (_progGen.hasTessEvaluationShader())
+    key = hashSource(key, GL_TESS_EVALUATION_SHADER, _progGen.getTessEvaluationShaderCode());
+  if (_progGen.hasGeometryShader())
+    key = hashSource(key, GL_GEOMETRY_SHADER, _progGen.getGeometryShaderCode());
+  return hashSource(key, GL_FRAGMENT_SHADER, _progGen.getFragmentShaderCode());
+}
+
+/// stages of a program loaded from files: vertex, tess-control, tess-eval, geometry and fragment
+const int numFileStages = 5;
+
+/** compile and link a program from sources already loaded with GLSL::loadShader()
+ *
+ * Same as GLSL::loadProgram(), but without reading the files again.
+ * Stages without file name are skipped.
+ */
+GLSL::Program* linkProgramSources(const GLSL::StringList* _sources, const char* const* _files, bool _binaryHint, bool _verbose)
+{
+  GLSL::Shader* shaders[numFileStages] = {0};
+  bool valid = true;
+
+  for (int i = 0; i < numFileStages && valid; ++i)
+  {
+    if (!_files[i] || !_files[i][0])
+      continue;
+
+    if (!_sources[i].empty())
+    {
+      if (i == 0)
+        shaders[i] = new GLSL::VertexShader();
+#ifdef GL_ARB_tessellation_shader
+      else if (i == 1)
+        shaders[i] = new GLSL::TessControlShader();
+      else if (i == 2)
+        shaders[i] = new GLSL::TessEvaluationShader();
+#endif // GL_ARB_tessellation_shader
+      else if (i == 3)
+        shaders[i] = new GLSL::GeometryShader();
+      else
+        shaders[i] = new GLSL::FragmentShader();
+    }
+
+    if (shaders[i])
+    {
+      shaders[i]->setSource(_sources[i]);
+      valid = shaders[i]->compile(_verbose);
+    }
+    else
+      valid = false;
+
+    if (!valid && _verbose)
+      std::cerr << _files[i] << " could not be loaded and compiled" << std::endl;
+  }
+
+  GLSL::Program* prog = 0;
+
+  if (valid)
+  {
+    prog = new GLSL::Program();
+
+    for (int i = 0; i < numFileStages; ++i)
+    {
+      if (shaders[i])
+        prog->attach(shaders[i]);
+    }
+
+    if (_binaryHint)
+      prog->setBinaryRetrievableHint();
+
+    prog->link();
+  }
+
+  for (int i = 0; i < numFileStages; ++i)
+    delete shaders[i];
+
+  return prog;
+}
+
+} // anonymous namespace
+
+
+struct ShaderCache::AsyncProgram
+{
+  AsyncProgram() : progGen(0), generated(false), prog(0), sourceKey(0) {}
+  ~AsyncProgram() {delete progGen; delete prog;}
+
+  CacheEntry entry;
+
+  /// generator, created by the worker thread
+  ShaderProgGenerator* progGen;
+
+  /// set by the worker thread once progGen is complete
+  std::atomic<bool> generated;
+
+  /// program submitted to the driver, owned until it is inserted into the cache
+  GLSL::Program* prog;
+
+  quint64 sourceKey;
+};
+
+/// generates the shader sources of an AsyncProgram
+class ShaderCache::GenerateTask : public QRunnable
+{
+public:
+  explicit GenerateTask(const std::shared_ptr<AsyncProgram>& _job) : job_(_job) {}
+
+  void run() override
+  {
+    job_->progGen = new ShaderProgGenerator(&job_->entry.desc, job_->entry.mods);
+    job_->generated.store(true, std::memory_order_release);
+  }
+
+private:
+  std::shared_ptr<AsyncProgram> job_;
+};
+
 ShaderCache::ShaderCache():
     cache_(),
+    cacheIndex_(),
     cacheStatic_(),
-    timeCheck_(false)
+    timeCheck_(false),
+    driverKey_(0)
 {
 }
 
@@ -94,60 +283,54 @@ GLSL::Program* ACG::ShaderCache::getProgram( const ShaderGenDesc* _desc )
   return getProgram(_desc, dummy);
 }
 
+quint64 ACG::ShaderCache::getProgramKey( const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods )
+{
+  return getProgramKey(_desc->fingerprint(), _mods);
+}
+
+quint64 ACG::ShaderCache::getProgramKey( quint64 _descFingerprint, const std::vector<unsigned int>& _mods )
+{
+  // continue the FNV-1a hash of the description with the modifier ids
+  quint64 key = _descFingerprint;
+
+  const unsigned int numMods = static_cast<unsigned int>(_mods.size());
+  key = hashBytes(key, &numMods, sizeof(numMods));
+
+  if (numMods)
+    key = hashBytes(key, &_mods[0], numMods * sizeof(unsigned int));
+
+  return key;
+}
+
 //***********************************************************************
-// TODO implement binary search eventually (if cache access is getting too slow)
-// - modify compareShaderGenDescs s.t. it defines an order
-// or generate a hash key from ShaderGenDesc
 
 GLSL::Program* ACG::ShaderCache::getProgram( const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods )
 {
-  CacheEntry newEntry;
-  newEntry.desc = *_desc;
-  newEntry.mods = _mods;
+  return getProgram(_desc, _mods, _desc->fingerprint());
+}
 
-  if (!_desc->fragmentTemplateFile.isEmpty())
-  {
-    newEntry.strFragmentTemplate = _desc->fragmentTemplateFile;
-    newEntry.fragmentFileLastMod = QFileInfo(newEntry.strFragmentTemplate).lastModified();
-  }
+GLSL::Program* ACG::ShaderCache::getProgram( const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods, quint64 _descFingerprint )
+{
+  assert(_descFingerprint == _desc->fingerprint());
 
-  if (!_desc->tessControlTemplateFile.isEmpty())
-  {
-    newEntry.strTessControlTemplate = _desc->tessControlTemplateFile;
-    newEntry.tessControlFileLastMod = QFileInfo(newEntry.strTessControlTemplate).lastModified();
-  }
+  const quint64 key = getProgramKey(_descFingerprint, _mods);
 
-  if (!_desc->tessEvaluationTemplateFile.isEmpty())
-  {
-    newEntry.strTessEvaluationTemplate = _desc->tessEvaluationTemplateFile;
-    newEntry.tessEvaluationFileLastMod = QFileInfo(newEntry.strTessEvaluationTemplate).lastModified();
-  }
+  CacheList::iterator cached = findProgram(key, _desc, _mods);
 
-  if (!_desc->geometryTemplateFile.isEmpty())
-  {
-      newEntry.strGeometryTemplate = _desc->geometryTemplateFile;
-      newEntry.geometryFileLastMod = QFileInfo(newEntry.strGeometryTemplate).lastModified();
-  }
+  // file timestamps are only read if the cache needs them
+  if (cached != cache_.end() && !timeCheck_)
+    return cached->second;
 
-  if (!_desc->vertexTemplateFile.isEmpty())
-  {
-    newEntry.strVertexTemplate = _desc->vertexTemplateFile;
-    newEntry.vertexFileLastMod = QFileInfo(newEntry.strVertexTemplate).lastModified();
-  }
+  CacheEntry newEntry;
+  initDynamicEntry(&newEntry, key, _desc, _mods);
 
-  CacheList::iterator oldCache = cache_.end();
+  if (cached != cache_.end() && compareTimeStamp(&cached->first, &newEntry))
+    return cached->second;
 
-  for (CacheList::iterator it = cache_.begin(); it != cache_.end();  ++it)
-  {
-    // If the shaders are equal, we return the cached entry
-    if (!compareShaderGenDescs(&it->first, &newEntry))
-    {
-      if ( timeCheck_ && !compareTimeStamp(&it->first, &newEntry))
-        oldCache = it;
-      else
-        return it->second;
-    }
-  }
+  // compiled right now, a background request for the same program is obsolete
+  AsyncList::iterator pending = pending_.find(key);
+  if (pending != pending_.end() && matchesDesc(pending.value()->entry, _desc, _mods))
+    pending_.erase(pending);
 
   // glsl program not in cache, generate shaders
   ShaderProgGenerator progGen(_desc, _mods);
@@ -211,71 +394,315 @@ GLSL::Program* ACG::ShaderCache::getProgram( const ShaderGenDesc* _desc, const s
     }
   }
 
-  GLSL::FragmentShader* fragShader = new GLSL::FragmentShader();
-  GLSL::VertexShader* vertShader   = new GLSL::VertexShader();
+  // try the persistent binary cache before compiling
+  GLSL::Program* prog = 0;
+  quint64 sourceKey = 0;
 
-  vertShader->setSource(progGen.getVertexShaderCode());
-  fragShader->setSource(progGen.getFragmentShaderCode());
+  const bool useBinaryCache = !binaryCacheDir_.isEmpty() && GLSL::Program::binarySupported();
 
-  vertShader->compile();
-  fragShader->compile();
+  if (useBinaryCache)
+  {
+    sourceKey = getSourceKey(progGen);
+    prog = loadProgramBinary(sourceKey);
+  }
 
-  GLSL::Program* prog = new GLSL::Program();
-  prog->attach(vertShader);
-  prog->attach(fragShader);
+  if (!prog)
+  {
+    StopWatch compileTimer;
+    compileTimer.start();
+
+    prog = compileProgram(progGen, useBinaryCache, false);
+    glCheckErrors();
+
+    if (useBinaryCache)
+      storeProgramBinary(sourceKey, prog, compileTimer.stop());
+  }
+
+  return insertProgram(newEntry, prog);
+}
+
+void ACG::ShaderCache::initDynamicEntry( CacheEntry* _entry, quint64 _key, const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods )
+{
+  _entry->key = _key;
+  _entry->desc = *_desc;
+  _entry->mods = _mods;
+
+  if (!_desc->fragmentTemplateFile.isEmpty())
+  {
+    _entry->strFragmentTemplate = _desc->fragmentTemplateFile;
+    _entry->fragmentFileLastMod = QFileInfo(_entry->strFragmentTemplate).lastModified();
+  }
+
+  if (!_desc->tessControlTemplateFile.isEmpty())
+  {
+    _entry->strTessControlTemplate = _desc->tessControlTemplateFile;
+    _entry->tessControlFileLastMod = QFileInfo(_entry->strTessControlTemplate).lastModified();
+  }
+
+  if (!_desc->tessEvaluationTemplateFile.isEmpty())
+  {
+    _entry->strTessEvaluationTemplate = _desc->tessEvaluationTemplateFile;
+    _entry->tessEvaluationFileLastMod = QFileInfo(_entry->strTessEvaluationTemplate).lastModified();
+  }
+
+  if (!_desc->geometryTemplateFile.isEmpty())
+  {
+      _entry->strGeometryTemplate = _desc->geometryTemplateFile;
+      _entry->geometryFileLastMod = QFileInfo(_entry->strGeometryTemplate).lastModified();
+  }
+
+  if (!_desc->vertexTemplateFile.isEmpty())
+  {
+    _entry->strVertexTemplate = _desc->vertexTemplateFile;
+    _entry->vertexFileLastMod = QFileInfo(_entry->strVertexTemplate).lastModified();
+  }
+}
+
+GLSL::Program* ACG::ShaderCache::compileProgram( ShaderProgGenerator& _progGen, bool _binaryHint, bool _async )
+{
+  std::vector<GLSL::Shader*> shaders;
+
+  GLSL::VertexShader* vertShader   = new GLSL::VertexShader();
+  vertShader->setSource(_progGen.getVertexShaderCode());
+  shaders.push_back(vertShader);
+
+  GLSL::FragmentShader* fragShader = new GLSL::FragmentShader();
+  fragShader->setSource(_progGen.getFragmentShaderCode());
+  shaders.push_back(fragShader);
 
   // Check if we have a geometry shader and if we have support for it, enable it here
-  if ( progGen.hasGeometryShader() ) {
+  if ( _progGen.hasGeometryShader() ) {
     GLSL::GeometryShader* geomShader = new GLSL::GeometryShader();
-    geomShader->setSource(progGen.getGeometryShaderCode());
-    geomShader->compile();
-    prog->attach(geomShader);
+    geomShader->setSource(_progGen.getGeometryShaderCode());
+    shaders.push_back(geomShader);
   }
 
   // Check if we have tessellation shaders and if we have support for it, enable it here
-  if ( progGen.hasTessControlShader() || progGen.hasTessEvaluationShader() ) {
-    GLSL::Shader* tessControlShader = 0, *tessEvalShader = 0;
-
 #ifdef GL_ARB_tessellation_shader
-    tessControlShader = new GLSL::TessControlShader();
-    tessEvalShader = new GLSL::TessEvaluationShader();
+  if (_progGen.hasTessControlShader())
+  {
+    GLSL::Shader* tessControlShader = new GLSL::TessControlShader();
+    tessControlShader->setSource(_progGen.getTessControlShaderCode());
+    shaders.push_back(tessControlShader);
+  }
+
+  if (_progGen.hasTessEvaluationShader())
+  {
+    GLSL::Shader* tessEvalShader = new GLSL::TessEvaluationShader();
+    tessEvalShader->setSource(_progGen.getTessEvaluationShaderCode());
+    shaders.push_back(tessEvalShader);
+  }
 #endif // GL_ARB_tessellation_shader
 
-    if (tessControlShader && progGen.hasTessControlShader())
+  GLSL::Program* prog = new GLSL::Program();
+
+  for (size_t i = 0; i < shaders.size(); ++i)
+  {
+    // compile all stages first, so that the driver can work on them in parallel
+    if (_async)
+      shaders[i]->compileAsync();
+    else
+      shaders[i]->compile();
+
+    prog->attach(shaders[i]);
+  }
+
+  if (_binaryHint)
+    prog->setBinaryRetrievableHint();
+
+  if (_async)
+    prog->linkAsync();
+  else
+    prog->link();
+
+  return prog;
+}
+
+GLSL::Program* ACG::ShaderCache::insertProgram( const CacheEntry& _entry, GLSL::Program* _prog )
+{
+  CacheList::iterator cached = findProgram(_entry.key, &_entry.desc, _entry.mods);
+
+  if (cached != cache_.end())
+  {
+    // keep the outdated program if the new one does not work
+    if (!_prog->isLinked())
     {
-      tessControlShader->setSource(progGen.getTessControlShaderCode());
-      tessControlShader->compile();
-      prog->attach(tessControlShader);
+      delete _prog;
+      return cached->second;
     }
-
-    if (tessEvalShader && progGen.hasTessEvaluationShader())
+    else
     {
-      tessEvalShader->setSource(progGen.getTessEvaluationShaderCode());
-      tessEvalShader->compile();
-      prog->attach(tessEvalShader);
+      cacheIndex_.remove(_entry.key, cached);
+      cache_.erase(cached);
     }
-    
   }
 
-  prog->link();
-  glCheckErrors();
+  // other programs with the same key belong to different descriptions and stay in the cache
+  cache_.push_back(std::pair<CacheEntry, GLSL::Program*>(_entry, _prog));
+  cacheIndex_.insert(_entry.key, --cache_.end());
 
-  if (oldCache != cache_.end())
+  return _prog;
+}
+
+ACG::ShaderCache::CacheList::iterator ACG::ShaderCache::findProgram( quint64 _key, const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods )
+{
+  // usually a single entry, more only if the keys of different descriptions collide
+  for (CacheIndex::iterator it = cacheIndex_.find(_key); it != cacheIndex_.end() && it.key() == _key; ++it)
   {
-    if (!prog->isLinked())
+    if (matchesDesc(it.value()->first, _desc, _mods))
+      return it.value();
+  }
+
+  return cache_.end();
+}
+
+bool ACG::ShaderCache::matchesDesc( const CacheEntry& _entry, const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods )
+{
+  // same as compareShaderGenDescs(), the template file names are part of the description
+  return _entry.mods == _mods && _entry.desc == *_desc;
+}
+
+//***********************************************************************
+
+void ACG::ShaderCache::prewarmPrograms( const std::vector<ProgramRequest>& _requests )
+{
+  if (_requests.empty())
+    return;
+
+  // query the gl state used by the generator before leaving the gl thread
+  ShaderProgGenerator::initThreadedGeneration();
+
+  for (size_t i = 0; i < _requests.size(); ++i)
+  {
+    const quint64 key = getProgramKey(&_requests[i].desc, _requests[i].mods);
+
+    // a pending program with a colliding key is compiled on request instead
+    if (pending_.contains(key) || findProgram(key, &_requests[i].desc, _requests[i].mods) != cache_.end())
+      continue;
+
+    std::shared_ptr<AsyncProgram> job(new AsyncProgram());
+    initDynamicEntry(&job->entry, key, &_requests[i].desc, _requests[i].mods);
+
+    pending_.insert(key, job);
+    QThreadPool::globalInstance()->start(new GenerateTask(job));
+  }
+}
+
+GLSL::Program* ACG::ShaderCache::getProgramAsync( const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods )
+{
+  return getProgramAsync(_desc, _mods, _desc->fingerprint());
+}
+
+GLSL::Program* ACG::ShaderCache::getProgramAsync( const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods, quint64 _descFingerprint )
+{
+  assert(_descFingerprint == _desc->fingerprint());
+
+  const quint64 key = getProgramKey(_descFingerprint, _mods);
+
+  CacheList::iterator cached = findProgram(key, _desc, _mods);
+
+  if (cached != cache_.end() && !timeCheck_)
+    return cached->second;
+
+  AsyncList::const_iterator pending = pending_.constFind(key);
+
+  if (pending == pending_.constEnd())
+  {
+    std::shared_ptr<AsyncProgram> job(new AsyncProgram());
+    initDynamicEntry(&job->entry, key, _desc, _mods);
+
+    if (cached != cache_.end() && compareTimeStamp(&cached->first, &job->entry))
+      return cached->second;
+
+    ShaderProgGenerator::initThreadedGeneration();
+
+    pending_.insert(key, job);
+    QThreadPool::globalInstance()->start(new GenerateTask(job));
+  }
+  else if (!matchesDesc(pending.value()->entry, _desc, _mods))
+  {
+    // the key collides with a different program in flight, compile this one right away
+    return getProgram(_desc, _mods, _descFingerprint);
+  }
+
+  // outdated program is still usable until the new one is ready
+  return cached != cache_.end() ? cached->second : 0;
+}
+
+GLSL::Program* ACG::ShaderCache::getFallbackProgram( const ShaderGenDesc* _desc )
+{
+  // objects with tessellation are drawn as patches, which is invalid without the tessellation stages
+  if (!_desc->tessControlTemplateFile.isEmpty() || !_desc->tessEvaluationTemplateFile.isEmpty())
+    return getProgram(_desc);
+
+  ShaderGenDesc fallback;
+
+  fallback.version = _desc->version;
+  fallback.numLights = _desc->numLights;
+  for (int i = 0; i < SG_MAX_SHADER_LIGHTS; ++i)
+    fallback.lightTypes[i] = _desc->lightTypes[i];
+  fallback.twoSidedLighting = _desc->twoSidedLighting;
+  fallback.shadeMode = _desc->shadeMode;
+  fallback.vertexColors = _desc->vertexColors;
+  fallback.colorMaterialMode = _desc->colorMaterialMode;
+  fallback.quantizedPositions = _desc->quantizedPositions;
+
+  return getProgram(&fallback);
+}
+
+int ACG::ShaderCache::updateAsyncPrograms()
+{
+  const bool useBinaryCache = !binaryCacheDir_.isEmpty() && GLSL::Program::binarySupported();
+
+  for (AsyncList::iterator it = pending_.begin(); it != pending_.end(); )
+  {
+    AsyncProgram* job = it.value().get();
+
+    if (!job->generated.load(std::memory_order_acquire))
     {
-      delete prog;
-      return oldCache->second;
+      ++it;
+      continue;
+    }
+
+    if (!job->prog)
+    {
+      if (useBinaryCache)
+      {
+        job->sourceKey = getSourceKey(*job->progGen);
+        job->prog = loadProgramBinary(job->sourceKey);
+      }
+
+      if (!job->prog)
+      {
+        // check for completion in the next update, the driver compiles in the meantime
+        job->prog = compileProgram(*job->progGen, useBinaryCache, true);
+        glCheckErrors();
+        ++it;
+        continue;
+      }
     }
     else
     {
-      cache_.erase(oldCache);
+      if (!job->prog->isLinkCompleted())
+      {
+        ++it;
+        continue;
+      }
+
+      job->prog->finishLink();
+
+      // the compile time is unknown, the driver compiled in parallel to whole frames
+      if (useBinaryCache)
+        storeProgramBinary(job->sourceKey, job->prog, -1.0);
     }
-  }
 
-  cache_.push_back(std::pair<CacheEntry, GLSL::Program*>(newEntry, prog));
+    insertProgram(job->entry, job->prog);
+    job->prog = 0;
 
-  return prog;
+    it = pending_.erase(it);
+  }
+
+  return pending_.size();
 }
 
 GLSL::Program* ACG::ShaderCache::getProgram( const char* _vertexShaderFile, 
@@ -411,8 +838,51 @@ GLSL::Program* ACG::ShaderCache::getProgram( const char* _vertexShaderFile,
   }
 
 
-  GLSL::Program* prog = GLSL::loadProgram(_vertexShaderFile, _tessControlShaderFile, _tessEvalShaderFile, _geometryShaderFile, _fragmentShaderFile, &glslMacros, _verbose);
-  glCheckErrors();
+  // try the persistent binary cache before compiling
+  GLSL::Program* prog = 0;
+
+  const bool useBinaryCache = !binaryCacheDir_.isEmpty() && GLSL::Program::binarySupported();
+
+  if (useBinaryCache)
+  {
+    const char* const stageFiles[numFileStages] = {_vertexShaderFile, _tessControlShaderFile, _tessEvalShaderFile, _geometryShaderFile, _fragmentShaderFile};
+    const QString* const stagePaths[numFileStages] = {&newEntry.strVertexTemplate, &newEntry.strTessControlTemplate, &newEntry.strTessEvaluationTemplate,
+                                                      &newEntry.strGeometryTemplate, &newEntry.strFragmentTemplate};
+    const GLenum stageTypes[numFileStages] = {GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+
+    // the binary is keyed by the complete source including macros and includes,
+    //  the same sources are compiled on a miss, so each file is read only once
+    GLSL::StringList sources[numFileStages];
+    quint64 sourceKey = fnvOffsetBasis;
+
+    for (int i = 0; i < numFileStages; ++i)
+    {
+      if (stageFiles[i] && stageFiles[i][0])
+      {
+        sources[i] = GLSL::loadShader(stagePaths[i]->toUtf8(), &glslMacros);
+        sourceKey = hashSource(sourceKey, stageTypes[i], sources[i]);
+      }
+    }
+
+    prog = loadProgramBinary(sourceKey);
+
+    if (!prog)
+    {
+      StopWatch compileTimer;
+      compileTimer.start();
+
+      prog = linkProgramSources(sources, stageFiles, true, _verbose);
+      glCheckErrors();
+
+      if (prog)
+        storeProgramBinary(sourceKey, prog, compileTimer.stop());
+    }
+  }
+  else
+  {
+    prog = GLSL::loadProgram(_vertexShaderFile, _tessControlShaderFile, _tessEvalShaderFile, _geometryShaderFile, _fragmentShaderFile, &glslMacros, _verbose);
+    glCheckErrors();
+  }
 
   if (oldCache != cacheStatic_.end())
   {
@@ -595,8 +1065,13 @@ int ACG::ShaderCache::compareShaderGenDescs( const CacheEntry* _a, const CacheEn
 void ACG::ShaderCache::clearCache()
 {
   cache_.clear();
+  cacheIndex_.clear();
+  pending_.clear();
   cacheStatic_.clear();
   cacheComputeShaders_.clear();
+
+  // templates are read again on the next request
+  ShaderProgGenerator::clearFileCache();
 }
 
 void ACG::ShaderCache::setDebugOutputDir(const char* _outputDir)
@@ -604,6 +1079,128 @@ void ACG::ShaderCache::setDebugOutputDir(const char* _outputDir)
   dbgOutputDir_ = _outputDir;
 }
 
+void ACG::ShaderCache::setBinaryCacheDir(const QString& _dir)
+{
+  binaryCacheDir_ = _dir;
+
+  if (!binaryCacheDir_.isEmpty() && !QDir().mkpath(binaryCacheDir_))
+  {
+    std::cerr << "ShaderCache: could not create binary cache directory " << binaryCacheDir_.toStdString() << std::endl;
+    binaryCacheDir_.clear();
+  }
+}
+
+quint64 ACG::ShaderCache::getDriverKey()
+{
+  if (!driverKey_)
+  {
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+
+    quint64 key = fnvOffsetBasis;
+    for (int i = 0; i < 3; ++i)
+    {
+      const char* str = reinterpret_cast<const char*>(glGetString(names[i]));
+      if (str)
+        key = hashBytes(key, str, strlen(str) + 1);
+    }
+    driverKey_ = key;
+  }
+  return driverKey_;
+}
+
+GLSL::Program* ACG::ShaderCache::loadProgramBinary(quint64 _sourceKey)
+{
+  const QString fileName = binaryCacheDir_ + QDir::separator() + QString("%1.glprog").arg(_sourceKey, 16, 16, QLatin1Char('0'));
+
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly))
+  {
+    ++binaryStats_.misses;
+    return 0;
+  }
+
+  StopWatch loadTimer;
+  loadTimer.start();
+
+  const QByteArray data = file.readAll();
+  file.close();
+
+  // outdated binaries of another driver or a hash collision are simply compiled again
+  ProgramBinaryHeader header;
+  if (data.size() < int(sizeof(header)))
+  {
+    ++binaryStats_.misses;
+    return 0;
+  }
+
+  memcpy(&header, data.constData(), sizeof(header));
+
+  if (memcmp(header.magic, programBinaryMagic, sizeof(header.magic)) ||
+      header.version != programBinaryVersion ||
+      header.sourceKey != _sourceKey ||
+      header.driverKey != getDriverKey() ||
+      data.size() != int(sizeof(header) + header.size))
+  {
+    ++binaryStats_.misses;
+    return 0;
+  }
+
+  GLSL::Program* prog = new GLSL::Program();
+
+  if (!prog->loadBinary(header.format, data.constData() + sizeof(header), header.size))
+  {
+    delete prog;
+    ++binaryStats_.rejected;
+    ++binaryStats_.misses;
+    return 0;
+  }
+
+  const double loadTime = loadTimer.stop();
+
+  ++binaryStats_.hits;
+  binaryStats_.loadTime += loadTime;
+
+  if (header.compileTime >= 0.0f)
+    binaryStats_.savedTime += header.compileTime - loadTime;
+
+  return prog;
+}
+
+void ACG::ShaderCache::storeProgramBinary(quint64 _sourceKey, GLSL::Program* _prog, double _compileTime)
+{
+  if (_compileTime >= 0.0)
+    binaryStats_.compileTime += _compileTime;
+
+  if (!_prog->isLinked())
+    return;
+
+  GLenum format = 0;
+  std::vector<char> binary;
+
+  if (!_prog->getBinary(format, binary) || binary.empty())
+    return;
+
+  ProgramBinaryHeader header;
+  memcpy(header.magic, programBinaryMagic, sizeof(header.magic));
+  header.version = programBinaryVersion;
+  header.format = format;
+  header.sourceKey = _sourceKey;
+  header.driverKey = getDriverKey();
+  header.size = static_cast<quint32>(binary.size());
+  header.compileTime = static_cast<float>(_compileTime);
+
+  // write to a temporary file first, so that concurrent sessions never see partial binaries
+  const QString fileName = binaryCacheDir_ + QDir::separator() + QString("%1.glprog").arg(_sourceKey, 16, 16, QLatin1Char('0'));
+
+  QSaveFile file(fileName);
+  if (file.open(QFile::WriteOnly))
+  {
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(&binary[0], binary.size());
+    file.commit();
+  }
+}
+
 //=============================================================================
 } // namespace ACG
 //=============================================================================
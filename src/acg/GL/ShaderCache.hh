@@ -45,7 +45,9 @@
 
 
 #include <list>
+#include <memory>
 #include <QDateTime>
+#include <QHash>
 #include <ACG/Config/ACGDefines.hh>
 #include <ACG/GL/ShaderGenerator.hh>
 
@@ -92,6 +94,18 @@ public:
    */
   GLSL::Program* getProgram(const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods);
 
+  /** \brief Query a dynamically generated program from cache
+   *
+   * Same as getProgram(_desc, _mods), but with the fingerprint of the description computed by the caller,
+   * e.g. RenderObject::getShaderDescFingerprint().
+   *
+   * @param _desc            Shader description
+   * @param _mods            Combination of active shader modifier ids
+   * @param _descFingerprint _desc->fingerprint()
+   * @return The program (Either from cache or newly compiled and linked)
+   */
+  GLSL::Program* getProgram(const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods, quint64 _descFingerprint);
+
     /** \brief Query a dynamically generated program from cache
    *
    * @param _desc  Shader description
@@ -111,6 +125,80 @@ public:
    */
   GLSL::Program* getProgram(const ShaderGenDesc* _desc);
 
+  /** \brief Key of a dynamically generated program in the cache
+   *
+   * 64 bit fingerprint of the shader description and the modifier ids.
+   * Equal descriptions with equal modifiers always map to the same key, different ones may collide.
+   * The cache therefore compares the description of the program found by the key once.
+   *
+   * @param _desc  Shader description
+   * @param _mods  Combination of active shader modifier ids
+   * @return Key of the program
+   */
+  static quint64 getProgramKey(const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods);
+
+  /// \brief Key of a dynamically generated program from the fingerprint of its description
+  static quint64 getProgramKey(quint64 _descFingerprint, const std::vector<unsigned int>& _mods);
+
+
+  /// Dynamically generated program requested by prewarmPrograms()
+  struct ProgramRequest
+  {
+    ShaderGenDesc desc;
+    std::vector<unsigned int> mods;
+  };
+
+  /** \brief Generate and compile dynamic programs in the background
+   *
+   * The shader sources are generated on the global QThreadPool. updateAsyncPrograms() submits
+   * them to the driver, which compiles in parallel if GL_KHR_parallel_shader_compile is supported.
+   * Finished programs are added to the cache, so that getProgram() returns them without stalling.
+   * Programs already in the cache or in flight are skipped.
+   *
+   * Has to be called with a current context. Shader modifiers have to be registered beforehand.
+   *
+   * @param _requests  Shader descriptions and modifier ids of the programs
+   */
+  void prewarmPrograms(const std::vector<ProgramRequest>& _requests);
+
+  /** \brief Query a dynamically generated program without stalling
+   *
+   * Returns the program if it is in the cache. Otherwise it is requested as in prewarmPrograms()
+   * and the caller should render with getFallbackProgram() until it is available.
+   * An outdated program is returned while its replacement is compiled, if the time check is enabled.
+   *
+   * @param _desc  Shader description
+   * @param _mods  Combination of active shader modifier ids
+   * @return The program or 0 if it is not ready yet
+   */
+  GLSL::Program* getProgramAsync(const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods);
+
+  /// \brief Same as getProgramAsync(_desc, _mods) with the fingerprint _desc->fingerprint() computed by the caller
+  GLSL::Program* getProgramAsync(const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods, quint64 _descFingerprint);
+
+  /** \brief Simple program to use while the program of _desc is compiled in the background
+   *
+   * Keeps the vertex layout, lighting and shade mode of _desc, but drops custom templates,
+   * textures, clip distances, shader modifiers and macros. Fallbacks are few and compiled synchronously.
+   * Descriptions with tessellation templates have no fallback, as their objects are drawn as patches.
+   * Their actual program is compiled synchronously and returned instead.
+   *
+   * @param _desc  Shader description of the requested program
+   * @return The fallback program
+   */
+  GLSL::Program* getFallbackProgram(const ShaderGenDesc* _desc);
+
+  /** \brief Submit generated programs to the driver and collect finished ones
+   *
+   * Has to be called regularly with a current context, e.g. once per frame.
+   *
+   * @return number of programs that are not ready yet
+   */
+  int updateAsyncPrograms();
+
+  /// Number of programs requested in the background that are not ready yet
+  int getNumPendingPrograms() const {return pending_.size();}
+
 
   /** \brief Query a static shader program from cache
    *
@@ -167,8 +255,9 @@ public:
 
   /** \brief enable or disable checking of the time step of each file
    *
+   * Also applies to the template and include files cached by ShaderProgGenerator.
    */
-  void setTimeCheck(bool _on){timeCheck_ = _on;}
+  void setTimeCheck(bool _on){timeCheck_ = _on; ShaderProgGenerator::setFileTimeCheck(_on);}
   bool getTimeCheck(){return timeCheck_;}
 
 
@@ -176,11 +265,50 @@ public:
    */
   void setDebugOutputDir(const char* _outputDir);
 
+
+  /** \brief Enable the persistent program binary cache
+   *
+   * Linked programs are stored as driver specific binaries in the given directory
+   * and loaded from there in later sessions instead of compiling them again.
+   * Binaries are keyed by the complete shader source, the driver (vendor, renderer
+   * and version) and the binary format. Programs are compiled from source if no
+   * matching binary exists or the driver rejects it.
+   *
+   * Applies to dynamically generated programs and programs loaded from files.
+   * Requires OpenGL 4.1 or GL_ARB_get_program_binary, see GLSL::Program::binarySupported().
+   *
+   * @param _dir cache directory, created if necessary. An empty string disables the cache (default).
+   */
+  void setBinaryCacheDir(const QString& _dir);
+  const QString& getBinaryCacheDir() const {return binaryCacheDir_;}
+
+  /// Statistics of the program binary cache
+  struct BinaryCacheStats
+  {
+    BinaryCacheStats() : hits(0), misses(0), rejected(0), loadTime(0.0), compileTime(0.0), savedTime(0.0) {}
+
+    int hits;           ///< programs loaded from a binary
+    int misses;         ///< programs compiled from source
+    int rejected;       ///< binaries rejected by the driver, counted as misses as well
+    double loadTime;    ///< time in ms spent loading binaries
+    double compileTime; ///< time in ms spent compiling programs synchronously on misses, background compiles are not timed
+    double savedTime;   ///< compile time in ms of the loaded binaries minus their load time, for binaries with known compile time
+  };
+
+  /// Statistics of the program binary cache since the last resetBinaryCacheStats()
+  const BinaryCacheStats& getBinaryCacheStats() const {return binaryStats_;}
+  void resetBinaryCacheStats() {binaryStats_ = BinaryCacheStats();}
+
 protected:
   ShaderCache();
 
   struct CacheEntry
   {
+    CacheEntry() : key(0) {}
+
+    /// getProgramKey() of dynamic programs
+    quint64 key;
+
     ShaderGenDesc desc;
     std::vector<unsigned int> mods;
 
@@ -201,6 +329,30 @@ protected:
     QStringList macros;
   };
 
+  /// \brief Fill entry with the templates and their timestamps of a dynamic program
+  void initDynamicEntry(CacheEntry* _entry, quint64 _key, const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods);
+
+  /// \brief Compile and link the generated shaders, without waiting for the driver if _async is set
+  GLSL::Program* compileProgram(ShaderProgGenerator& _progGen, bool _binaryHint, bool _async);
+
+  /// \brief Add a dynamic program to cache_, replacing an outdated program with the same description
+  GLSL::Program* insertProgram(const CacheEntry& _entry, GLSL::Program* _prog);
+
+  /// \brief Dynamic program with the description and modifiers in cache_, cache_.end() if there is none
+  std::list<std::pair<CacheEntry, GLSL::Program*> >::iterator findProgram(quint64 _key, const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods);
+
+  /// \brief Returns true, if the dynamic entry was created for the description and modifiers
+  static bool matchesDesc(const CacheEntry& _entry, const ShaderGenDesc* _desc, const std::vector<unsigned int>& _mods);
+
+  /// \brief Load a program from the binary cache, returns 0 if there is no usable binary
+  GLSL::Program* loadProgramBinary(quint64 _sourceKey);
+
+  /// \brief Store the binary of a compiled program in the binary cache, _compileTime is negative if unknown
+  void storeProgramBinary(quint64 _sourceKey, GLSL::Program* _prog, double _compileTime);
+
+  /// \brief Key of the current driver in the binary cache
+  quint64 getDriverKey();
+
   /// \brief Returns true, if the shaders have the timestamp
   bool compareTimeStamp(const CacheEntry* _a, const CacheEntry* _b);
 
@@ -213,16 +365,39 @@ protected:
   /// cache containing dynamic shaders from ShaderProgGenerator
   CacheList cache_;
 
+  typedef QMultiHash<quint64, CacheList::iterator> CacheIndex;
+
+  /// entries of cache_ by getProgramKey(), different descriptions with colliding keys are chained
+  CacheIndex cacheIndex_;
+
   /// cache containing static shaders loaded from files (separate from dynamic cache to reduce access time)
   CacheList cacheStatic_;
 
   /// cache for static compute shaders
   CacheList cacheComputeShaders_;
 
+  /// dynamic program generated on a worker thread and compiled in the background
+  struct AsyncProgram;
+  class GenerateTask;
+
+  typedef QHash<quint64, std::shared_ptr<AsyncProgram> > AsyncList;
+
+  /// programs requested by prewarmPrograms() and getProgramAsync() that are not in the cache yet
+  AsyncList pending_;
+
   bool timeCheck_;
 
   /// output directory for shaders in dynamic cache
   QString dbgOutputDir_;
+
+  /// directory of the program binary cache, disabled if empty
+  QString binaryCacheDir_;
+
+  /// statistics of the program binary cache
+  BinaryCacheStats binaryStats_;
+
+  /// key of the driver in the binary cache, 0 until computed
+  quint64 driverKey_;
 };
 
 
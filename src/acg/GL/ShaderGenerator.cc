@@ -51,11 +51,158 @@
 #include <QDir>
 #include <QTextStream>
 #include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
 #include <QRegularExpression>
+#include <QVector>
 
 namespace ACG
 {
 
+/** \brief Process-wide cache of shader template and include files
+ *
+ * Stores the trimmed lines of each file and the shader templates with resolved includes,
+ * so that generating many permutations reads every file from disk only once.
+ * The cache is shared by generators running on worker threads, see ShaderCache::prewarmPrograms().
+ */
+class ShaderFileCache
+{
+public:
+
+  /// append the trimmed lines of a file to _out, read from disk only if it is not cached or outdated
+  static bool readLines(const QString& _absFilename, QStringList* _out, QString* _outError = 0)
+  {
+    QMutexLocker lock(&mutex_);
+
+    QHash<QString, File>::iterator cached = files_.find(_absFilename);
+
+    if (cached != files_.end() && (!timeCheck_ || cached->lastModified == QFileInfo(_absFilename).lastModified()))
+    {
+      *_out += cached->lines;
+      return true;
+    }
+
+    // read under the lock, so that concurrent generators do not load the same file twice
+    QFile file(_absFilename);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+      if (_outError)
+        *_outError = file.errorString();
+      return false;
+    }
+
+    if (!file.isReadable())
+    {
+      if (_outError)
+        *_outError = "unreadable file";
+      return false;
+    }
+
+    File entry;
+    entry.lastModified = QFileInfo(file).lastModified();
+
+    QTextStream filestream(&file);
+
+    while (!filestream.atEnd())
+      entry.lines.push_back(filestream.readLine().trimmed());
+
+    file.close();
+
+    files_[_absFilename] = entry;
+
+    *_out += entry.lines;
+    return true;
+  }
+
+  /// get a template with resolved includes, false if it is not cached or one of its files changed
+  static bool findTemplate(const QString& _absFilename, QStringList* _out)
+  {
+    QMutexLocker lock(&mutex_);
+
+    QHash<QString, Template>::iterator cached = templates_.find(_absFilename);
+
+    if (cached == templates_.end())
+      return false;
+
+    if (timeCheck_)
+    {
+      for (int i = 0; i < cached->files.size(); ++i)
+      {
+        if (cached->files[i].second != QFileInfo(cached->files[i].first).lastModified())
+          return false;
+      }
+    }
+
+    *_out = cached->lines;
+    return true;
+  }
+
+  /// store a template with resolved includes, _files are all files it has been assembled from
+  static void storeTemplate(const QString& _absFilename, const QStringList& _lines, const QStringList& _files)
+  {
+    QMutexLocker lock(&mutex_);
+
+    Template entry;
+    entry.lines = _lines;
+
+    // timestamps of the cached files the template has been assembled from
+    for (int i = 0; i < _files.size(); ++i)
+    {
+      QHash<QString, File>::const_iterator file = files_.constFind(_files[i]);
+      entry.files.push_back(qMakePair(_files[i], file != files_.constEnd() ? file->lastModified : QDateTime()));
+    }
+
+    templates_[_absFilename] = entry;
+  }
+
+  /// drop a file, so that it is read again on the next request
+  static void remove(const QString& _absFilename)
+  {
+    QMutexLocker lock(&mutex_);
+    files_.remove(_absFilename);
+  }
+
+  static void clear()
+  {
+    QMutexLocker lock(&mutex_);
+    files_.clear();
+    templates_.clear();
+  }
+
+  static void setTimeCheck(bool _on)
+  {
+    QMutexLocker lock(&mutex_);
+    timeCheck_ = _on;
+  }
+
+private:
+
+  struct File
+  {
+    QDateTime lastModified;
+    QStringList lines;
+  };
+
+  struct Template
+  {
+    QStringList lines;
+    QVector<QPair<QString, QDateTime> > files;
+  };
+
+  static QMutex mutex_;
+  static QHash<QString, File> files_;
+  static QHash<QString, Template> templates_;
+  static bool timeCheck_;
+};
+
+QMutex ShaderFileCache::mutex_;
+QHash<QString, ShaderFileCache::File> ShaderFileCache::files_;
+QHash<QString, ShaderFileCache::Template> ShaderFileCache::templates_;
+bool ShaderFileCache::timeCheck_ = false;
+
+
 
 int ShaderProgGenerator::numRegisteredModifiers_ = 0;
 std::vector<ShaderModifier*> ShaderProgGenerator::registeredModifiers_;
@@ -154,6 +301,12 @@ void ShaderGenerator::initVertexShaderIO(const ShaderGenDesc* _desc, const Defau
   if (_iodesc->inputNormal_)
     addInput("vec3", keywords.vs_inputNormal);
 
+  if (_iodesc->inputQuantizedPos_)
+  {
+    addUniform("vec3 g_vPosQuantScale");
+    addUniform("vec3 g_vPosQuantOffset");
+  }
+
   if (_desc->textured())
   {
     std::map<size_t,ShaderGenDesc::TextureType>::const_iterator iter = _desc->textureTypes().begin();
@@ -295,7 +448,10 @@ void ShaderGenerator::defineIOAbstraction( const DefaultIODesc* _iodesc, bool _v
   {
     // input name abstraction
 
-    addIODefine(keywords.macro_inputPosOS, keywords.vs_inputPosition);
+    if (_iodesc->inputQuantizedPos_)
+      addIODefine(keywords.macro_inputPosOS, QString("vec4(%1.xyz * g_vPosQuantScale + g_vPosQuantOffset, 1.0)").arg(keywords.vs_inputPosition));
+    else
+      addIODefine(keywords.macro_inputPosOS, keywords.vs_inputPosition);
 
     if (_iodesc->inputTexCoord_)
       addIODefine(keywords.macro_inputTexcoord, keywords.vs_inputTexCoord);
@@ -627,24 +783,18 @@ void ShaderGenerator::buildShaderCode(QStringList* _pMainCode, const QStringList
 
 void ShaderGenerator::addIncludeFile(QString _fileName)
 {
-  QFile file(_fileName);
+  QStringList lines;
 
-  if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+  if (ShaderFileCache::readLines(QDir::cleanPath(_fileName), &lines))
   {
-    QTextStream fileStream(&file);
-    
     // track source of include files in shader comment
     
     imports_.push_back("// ==============================================================================");
     imports_.push_back(QString("// ShaderGenerator - begin of imported file: ") + _fileName);
     
 
-    while (!fileStream.atEnd())
-    {
-      QString tmpLine = fileStream.readLine();
-
-      imports_.push_back(tmpLine.simplified());
-    }
+    for (QStringList::const_iterator it = lines.constBegin(); it != lines.constEnd(); ++it)
+      imports_.push_back(it->simplified());
     
     
     // mark end of include file in comment
@@ -809,6 +959,7 @@ ShaderGenerator::DefaultIODesc::DefaultIODesc()
   : inputTexCoord_(false),
   inputColor_(false),
   inputNormal_(false),
+  inputQuantizedPos_(false),
   passPosVS_(false), passPosOS_(false), 
   passTexCoord_(false), 
   passColor_(false),
@@ -823,6 +974,31 @@ QString ShaderProgGenerator::shaderDir_;
 QStringList ShaderProgGenerator::lightingCode_;
 
 
+const ShaderGenCaps& ShaderGenCaps::get()
+{
+  // C++11 guarantees thread safe initialization, the first call has to be made with a current context though
+  static const ShaderGenCaps caps = []()
+  {
+    ShaderGenCaps c;
+    c.gl31 = ACG::openGLVersionTest(3,1);
+    c.gl32 = ACG::openGLVersionTest(3,2);
+    c.gl40 = ACG::openGLVersionTest(4,0);
+    c.textureBufferExt = ACG::checkExtensionSupported("EXT_texture_buffer");
+
+#ifdef GL_MAX_CLIP_DISTANCES
+    c.maxClipDistances = 0;
+    glGetIntegerv(GL_MAX_CLIP_DISTANCES, &c.maxClipDistances);
+    c.maxClipDistances = std::min(c.maxClipDistances, 32); // clamp to 32 bits
+#else
+    c.maxClipDistances = 32;
+#endif
+    return c;
+  }();
+
+  return caps;
+}
+
+
 ShaderProgGenerator::ShaderProgGenerator( const ShaderGenDesc* _desc )
   : vertex_(0), tessControl_(0), tessEval_(0), geometry_(0), fragment_(0)
 {
@@ -914,8 +1090,10 @@ void ShaderProgGenerator::init( const ShaderGenDesc* _desc, ShaderModifier* cons
   {
     desc_ = *_desc;
 
+    const ShaderGenCaps& caps = ShaderGenCaps::get();
+
     // We need at least version 3.2 or higher to support geometry shaders
-    if ( !ACG::openGLVersionTest(3,2) )
+    if ( !caps.gl32 )
     {
       if (!desc_.geometryTemplateFile.isEmpty())
         std::cerr << "Warning: removing geometry shader from ShaderDesc" << std::endl;
@@ -924,7 +1102,7 @@ void ShaderProgGenerator::init( const ShaderGenDesc* _desc, ShaderModifier* cons
     }
 
     // We need at least version 4.0 or higher to support tessellation
-    if ( !ACG::openGLVersionTest(4, 0) )
+    if ( !caps.gl40 )
     {
       if (!desc_.tessControlTemplateFile.isEmpty() || !desc_.tessEvaluationTemplateFile.isEmpty())
         std::cerr << "Warning: removing tessellation shader from ShaderDesc" << std::endl;
@@ -962,39 +1140,34 @@ ShaderProgGenerator::~ShaderProgGenerator(void)
 
 bool ShaderProgGenerator::loadStringListFromFile(QString _fileName, QStringList* _out)
 {
-  bool success = false;
-
   QString absFilename = getAbsFilePath(_fileName);
 
+  QString errorString;
+  bool success = ShaderFileCache::readLines(absFilename, _out, &errorString);
 
-  QFile file(absFilename);
+  if (!success)
+    std::cout << "error: " << errorString.toStdString() << " -> \"" << absFilename.toStdString() << "\"" << std::endl;
 
-  if (file.open(QIODevice::ReadOnly | QIODevice::Text))
-  {
-    if (!file.isReadable())
-      std::cout << "error: unreadable file -> \"" << absFilename.toStdString() << "\"" << std::endl;
-    else
-    {
-      QTextStream filestream(&file);
+  return success;
+}
 
-      while (!filestream.atEnd())
-      {
-        QString szLine = filestream.readLine();
-        _out->push_back(szLine.trimmed());
-      }
+void ShaderProgGenerator::setFileTimeCheck(bool _on)
+{
+  ShaderFileCache::setTimeCheck(_on);
+}
 
-      success = true;
-    }
+void ShaderProgGenerator::clearFileCache()
+{
+  ShaderFileCache::clear();
+}
 
-    file.close();
-  }
-  else
-    std::cout << "error: " << file.errorString().toStdString() << " -> \"" << absFilename.toStdString() << "\"" << std::endl;
 
-  return success;
+void ShaderProgGenerator::initThreadedGeneration()
+{
+  ShaderGenCaps::get();
+  loadLightingFunctions();
 }
 
-
 void ShaderProgGenerator::loadLightingFunctions()
 {
   if (lightingCode_.size()) return;
@@ -1174,7 +1347,7 @@ void ShaderProgGenerator::addVertexBeginCode(QStringList* _code)
   // size in pixel of rendered point-lists, set by user via uniform
 
   _code->push_back(QString("vec4 sg_vPosPS = g_mWVP * ") + ShaderGenerator::keywords.macro_inputPosOS + QString(";"));
-  _code->push_back("vec4 sg_vPosVS = g_mWV * inPosition;");
+  _code->push_back(QString("vec4 sg_vPosVS = g_mWV * ") + ShaderGenerator::keywords.macro_inputPosOS + QString(";"));
   _code->push_back("vec3 sg_vNormalVS = vec3(0.0, 1.0, 0.0);");
   _code->push_back("vec3 sg_vNormalOS = vec3(0.0, 1.0, 0.0);");
 
@@ -1266,7 +1439,7 @@ int ShaderProgGenerator::checkForIncludes(QString _str, ShaderGenerator* _gen, Q
   return 0;
 }
 
-int ShaderProgGenerator::checkForIncludes(QString _str, QStringList* _outImport, QString _includePath)
+int ShaderProgGenerator::checkForIncludes(QString _str, QStringList* _outImport, QString _includePath, QStringList* _outIncludeFiles)
 {
   if (_str.contains("#include "))
   {
@@ -1285,6 +1458,9 @@ int ShaderProgGenerator::checkForIncludes(QString _str, QStringList* _outImport,
       QString cleanFilepath = QDir::cleanPath(fullPathToIncludeFile);
 
       loadStringListFromFile(cleanFilepath, _outImport);
+
+      if (_outIncludeFiles)
+        _outIncludeFiles->push_back(getAbsFilePath(cleanFilepath));
     }
 
     return 1;
@@ -1617,16 +1793,7 @@ void ShaderProgGenerator::buildGeometryShader()
 
 
     // built-in gl_ClipDistance[]
-    static int maxClipDistances = -1;
-    if (maxClipDistances < 0)
-    {
-#ifdef GL_MAX_CLIP_DISTANCES
-      glGetIntegerv(GL_MAX_CLIP_DISTANCES, &maxClipDistances);
-      maxClipDistances = std::min(maxClipDistances, 32); // clamp to 32 bits
-#else
-      maxClipDistances = 32;
-#endif
-    }
+    const int maxClipDistances = ShaderGenCaps::get().maxClipDistances;
     for (int i = 0; i < maxClipDistances; ++i)
     {
       if (desc_.clipDistanceMask & (1 << i))
@@ -2108,6 +2275,8 @@ void ShaderProgGenerator::generateShaders()
   if (desc_.shadeMode != SG_SHADE_UNLIT)
     ioDesc_.inputNormal_ = true;
 
+  ioDesc_.inputQuantizedPos_ = desc_.quantizedPositions;
+
   if (desc_.textured())
   {
     ioDesc_.inputTexCoord_ = true;
@@ -2273,27 +2442,27 @@ void ShaderProgGenerator::loadShaderTemplateFromFile()
 {
   if (!desc_.vertexTemplateFile.isEmpty())
   {
-    loadStringListFromFile(desc_.vertexTemplateFile, &vertexTemplate_);
+    loadShaderTemplate(desc_.vertexTemplateFile, &vertexTemplate_);
     scanShaderTemplate(vertexTemplate_, desc_.vertexTemplateFile);
   }
   if (!desc_.fragmentTemplateFile.isEmpty())
   {
-    loadStringListFromFile(desc_.fragmentTemplateFile, &fragmentTemplate_);
+    loadShaderTemplate(desc_.fragmentTemplateFile, &fragmentTemplate_);
     scanShaderTemplate(fragmentTemplate_, desc_.fragmentTemplateFile);
   }
   if (!desc_.geometryTemplateFile.isEmpty())
   {
-    loadStringListFromFile(desc_.geometryTemplateFile, &geometryTemplate_);
+    loadShaderTemplate(desc_.geometryTemplateFile, &geometryTemplate_);
     scanShaderTemplate(geometryTemplate_, desc_.geometryTemplateFile);
   }
   if (!desc_.tessControlTemplateFile.isEmpty())
   {
-    loadStringListFromFile(desc_.tessControlTemplateFile, &tessControlTemplate_);
+    loadShaderTemplate(desc_.tessControlTemplateFile, &tessControlTemplate_);
     scanShaderTemplate(tessControlTemplate_, desc_.tessControlTemplateFile, &tessControlLayout_);
   }
   if (!desc_.tessEvaluationTemplateFile.isEmpty())
   {
-    loadStringListFromFile(desc_.tessEvaluationTemplateFile, &tessEvalTemplate_);
+    loadShaderTemplate(desc_.tessEvaluationTemplateFile, &tessEvalTemplate_);
     scanShaderTemplate(tessEvalTemplate_, desc_.tessEvaluationTemplateFile, &tessEvalLayout_);
   }
 
@@ -2305,6 +2474,45 @@ void ShaderProgGenerator::loadShaderTemplateFromFile()
   fragmentShaderFile_ = desc_.fragmentTemplateFile;
 }
 
+bool ShaderProgGenerator::loadShaderTemplate(QString _templateFilename, QStringList* _out)
+{
+  const QString absFilename = getAbsFilePath(_templateFilename);
+
+  if (ShaderFileCache::findTemplate(absFilename, _out))
+    return true;
+
+  QStringList templateSrc;
+  if (!loadStringListFromFile(absFilename, &templateSrc))
+    return false;
+
+  // resolve includes like scanShaderTemplate() and remember the included files for the time check
+  QStringList files;
+  files.push_back(absFilename);
+
+  QString filePath = getPathName(_templateFilename);
+
+  for (int i = 0; i < templateSrc.size(); )
+  {
+    QStringList import;
+
+    if (checkForIncludes(templateSrc[i], &import, filePath, &files))
+    {
+      // replace the directive with the included file, which might include something again
+      templateSrc.removeAt(i);
+
+      for (int k = 0; k < import.size(); ++k)
+        templateSrc.insert(i + k, import[k]);
+    }
+    else
+      ++i;
+  }
+
+  ShaderFileCache::storeTemplate(absFilename, templateSrc, files);
+
+  *_out = templateSrc;
+  return true;
+}
+
 void ShaderProgGenerator::scanShaderTemplate(QStringList& _templateSrc, QString _templateFilename, QStringList* _outLayoutDirectives)
 {
   // interpret loaded shader template:
@@ -2580,6 +2788,10 @@ public:
 
     if (reload)
     {
+      // the timestamp has been checked already, bypass the cached lines
+      if (!firstLoad)
+        ShaderFileCache::remove(absFilename);
+
       QStringList lines;
       if (ShaderProgGenerator::loadStringListFromFile(_filename, &lines))
       {
@@ -2762,6 +2974,7 @@ QString ShaderGenDesc::toString() const
   resStrm << "\nshaderDesc.shadeMode: " << shadeModeString[shadeMode];
   resStrm << "\nshaderDesc.twoSidedLighting: " << (twoSidedLighting ? "Yes" : "No");
   resStrm << "\nshaderDesc.vertexColors: " << vertexColors;
+  resStrm << "\nshaderDesc.quantizedPositions: " << quantizedPositions;
   resStrm << "\nshaderDesc.textured(): " << textured();
   for (std::map<size_t,TextureType>::const_iterator iter = textureTypes_.begin(); iter != textureTypes_.end();++iter)
   {
@@ -2827,6 +3040,101 @@ QString ShaderGenDesc::toString() const
 }
 
 
+//=============================================================================
+
+
+namespace {
+
+// 64 bit FNV-1a hash, used for ShaderGenDesc::fingerprint()
+class Fingerprint
+{
+public:
+  Fingerprint() : hash_(14695981039346656037ull) {}
+
+  void add(const void* _data, size_t _size)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+    for (size_t i = 0; i < _size; ++i)
+    {
+      hash_ ^= bytes[i];
+      hash_ *= 1099511628211ull;
+    }
+  }
+
+  void add(int _val) { add(&_val, sizeof(_val)); }
+
+  // the length is hashed as well, so that consecutive strings can not be confused
+  void add(const QString& _str)
+  {
+    add(_str.size());
+    add(_str.constData(), _str.size() * sizeof(QChar));
+  }
+
+  void add(const QStringList& _list)
+  {
+    add(_list.size());
+    for (int i = 0; i < _list.size(); ++i)
+      add(_list[i]);
+  }
+
+  quint64 value() const { return hash_; }
+
+private:
+  quint64 hash_;
+};
+
+} // anonymous namespace
+
+
+quint64 ShaderGenDesc::fingerprint() const
+{
+  // hash exactly the properties compared in operator ==, under the same conditions
+  Fingerprint fp;
+
+  fp.add(numLights);
+  fp.add(twoSidedLighting ? 1 : 0);
+  fp.add(int(shadeMode));
+  fp.add(vertexColors ? 1 : 0);
+  fp.add(textured() ? 1 : 0);
+
+  if (vertexColors)
+  {
+    fp.add(vertexColorsInterpolator);
+    fp.add(int(colorMaterialMode));
+  }
+
+  if (!geometryTemplateFile.isEmpty())
+    fp.add(int(clipDistanceMask));
+
+  fp.add(fragmentTemplateFile);
+  fp.add(geometryTemplateFile);
+  fp.add(vertexTemplateFile);
+  fp.add(tessControlTemplateFile);
+  fp.add(tessEvaluationTemplateFile);
+
+  fp.add(macros);
+
+  fp.add(texGenDim);
+  if (texGenDim)
+  {
+    fp.add(int(texGenMode));
+    fp.add(texGenPerFragment ? 1 : 0);
+  }
+
+  fp.add(int(shaderMods.size()));
+  if (!shaderMods.empty())
+    fp.add(&shaderMods[0], shaderMods.size() * sizeof(unsigned int));
+
+  fp.add(vertexNormalInterpolator);
+  fp.add(quantizedPositions ? 1 : 0);
+
+  for (int i = 0; i < numLights; ++i)
+    fp.add(int(lightTypes[i]));
+
+  return fp.value();
+}
+
+
 
 } // namespace ACG
 //=============================================================================
@@ -80,6 +80,23 @@ enum ShaderGenShadeMode
   SG_SHADE_FORCE_DWORD = 0xFFFFFFFF
 };
 
+/** \brief OpenGL capabilities the shader generator depends on
+ *
+ * The capabilities are queried from the current context on the first call of get()
+ * and cached afterwards, so that shaders can be generated on threads without a context.
+ */
+struct ACGDLLEXPORT ShaderGenCaps
+{
+  bool gl31;              ///< OpenGL 3.1 available
+  bool gl32;              ///< OpenGL 3.2 available, required for geometry shaders
+  bool gl40;              ///< OpenGL 4.0 available, required for tessellation shaders
+  bool textureBufferExt;  ///< EXT_texture_buffer supported
+  int maxClipDistances;   ///< GL_MAX_CLIP_DISTANCES, clamped to 32
+
+  /// capabilities of the context that is current on the first call
+  static const ShaderGenCaps& get();
+};
+
 class ShaderGenDesc
 {
 
@@ -101,16 +118,18 @@ public:
     textureTypes_(),
     texGenDim(0),
     texGenMode(GL_EYE_LINEAR),
-    texGenPerFragment(false)
+    texGenPerFragment(false),
+    quantizedPositions(false)
   {
     for ( unsigned int i = 0 ; i < SG_MAX_SHADER_LIGHTS ; ++i)
       lightTypes[i] = SG_LIGHT_DIRECTIONAL;
-    if(!ACG::openGLVersionTest(3,2))   // version 140 or less
+    const ShaderGenCaps& caps = ShaderGenCaps::get();
+    if(!caps.gl32)   // version 140 or less
     {
-      if(!ACG::openGLVersionTest(3,1)) // assume version 130
-      {                            // less is not supported
+      if(!caps.gl31) // assume version 130
+      {              // less is not supported
         version = 130;
-        if(ACG::checkExtensionSupported("EXT_texture_buffer"))
+        if(caps.textureBufferExt)
           macros.append(QString("#extension GL_EXT_texture_buffer:  enable"));
       }
       else        // version 140 texture buffer is part of spec
@@ -176,6 +195,13 @@ public:
   /// convert ShaderGenDesc to string format for debugging
   QString toString() const;
 
+  /** \brief 64 bit hash of the description
+   *
+   * Consistent with operator ==: equal descriptions have equal fingerprints.
+   * Used as key of the program cache, see ShaderCache::getProgram().
+   */
+  quint64 fingerprint() const;
+
   /// Defines if the textureVariable is normalized or not, if multiple textures are used
   bool normalizeTexColors;
 
@@ -272,6 +298,12 @@ public:
   void disableTexGen() { texGenDim = 0; }
 
 
+  // vertex positions are stored as normalized integers relative to a bounding box (see MeshCompiler::buildCompactOutput())
+  // the vertex shader dequantizes them with the uniforms g_vPosQuantScale and g_vPosQuantOffset
+  // default: false
+  bool quantizedPositions;
+
+
   // comparison operator
   bool operator == (const ShaderGenDesc& _rhs) const
   {
@@ -342,6 +374,9 @@ public:
     if (vertexNormalInterpolator != _rhs.vertexNormalInterpolator)
       return false;
 
+    if (quantizedPositions != _rhs.quantizedPositions)
+      return false;
+
     if (numLights)
       return memcmp(lightTypes, _rhs.lightTypes, numLights * sizeof(ShaderGenLightType)) == 0;
 
@@ -371,6 +406,13 @@ public:
   vec4 g_vMaterial - vec4(shininess, alpha, unused, unused)
 \endcode
 
+\subsection Quantization
+\code
+  // only if ShaderGenDesc.quantizedPositions == true
+  vec3 g_vPosQuantScale  - scale of normalized input positions
+  vec3 g_vPosQuantOffset - offset of normalized input positions
+\endcode
+
 
 \subsection Lighting
 
@@ -569,7 +611,8 @@ public:
     /// default attributes that should be imported in vertex shader
     bool inputTexCoord_, // texcoords
       inputColor_,    // vertex colors 
-      inputNormal_;   // view space normals
+      inputNormal_,   // view space normals
+      inputQuantizedPos_; // normalized positions, dequantized with g_vPosQuantScale and g_vPosQuantOffset
 
     /// default attributes that should be passed down from vertex shader
     bool passPosVS_, // view space position
@@ -1201,6 +1244,25 @@ public:
   */
   static QString getShaderDir();
 
+  /**
+  Prepare the shared state of the generator for use on threads without an OpenGL context.
+  Queries ShaderGenCaps and loads the default lighting functions, has to be called once
+  with a current context before shaders are generated on worker threads.
+  */
+  static void initThreadedGeneration();
+
+  /**
+  Template and include files are read from disk once and then served from a process-wide cache.
+  If the time check is enabled, the timestamps of cached files are compared on every use and
+  changed files are read again. ShaderCache::setTimeCheck() sets this as well.
+  */
+  static void setFileTimeCheck(bool _on);
+
+  /**
+  Remove all template and include files from the cache.
+  */
+  static void clearFileCache();
+
   /** 
   @param _desc description-set of shader properties.
   */
@@ -1306,6 +1368,9 @@ public:
   void generateShaders();
 
   /** \brief Load a text file as string list
+
+  Files are read from disk once and then served from a process-wide cache, see setFileTimeCheck().
+
   @param _fileName relative (from shader dir) or absolute file name
   @param _out lines from text file
   @return true on success, false otherwise
@@ -1323,6 +1388,10 @@ private:
   */
   void loadShaderTemplateFromFile();
 
+  /** \brief Load a shader template with resolved includes from the template cache
+  */
+  bool loadShaderTemplate(QString _templateFilename, QStringList* _out);
+
   /** \brief Scans loaded shader template for requested inputs, glsl version or includes
   */
   void scanShaderTemplate(QStringList& _templateSrc, QString _templateFilename, QStringList* _outLayoutDirectives = 0);
@@ -1371,7 +1440,8 @@ private:
 
   /// checks if _str is an include directive
   /// eventually imports the included file to the specified stringlist
-  int checkForIncludes(QString _str, QStringList* _outImport, QString _includePath);
+  /// and appends the absolute path of the included file to _outIncludeFiles
+  int checkForIncludes(QString _str, QStringList* _outImport, QString _includePath, QStringList* _outIncludeFiles = 0);
 
 
   /// provide generated defines to shader
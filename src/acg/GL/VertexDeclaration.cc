@@ -348,7 +348,14 @@ size_t VertexDeclaration::getGLTypeSize(unsigned int _type)
 
 size_t VertexDeclaration::getElementSize(const VertexElement* _pElement)
 {
-  return _pElement ? getGLTypeSize(_pElement->type_) * _pElement->numElements_ : 0;
+  if (!_pElement)
+    return 0;
+
+  // packed formats store all components in a single 32 bit value
+  if (_pElement->type_ == GL_INT_2_10_10_10_REV || _pElement->type_ == GL_UNSIGNED_INT_2_10_10_10_REV)
+    return 4;
+
+  return getGLTypeSize(_pElement->type_) * _pElement->numElements_;
 }
 
 
@@ -390,7 +397,7 @@ void VertexDeclaration::activateFixedFunction() const
 
     case VERTEX_USAGE_NORMAL:
       {
-        assert(pElem->numElements_ == 3);
+        assert(pElem->numElements_ == 3 || pElem->type_ == GL_INT_2_10_10_10_REV);
 
         ACG::GLState::normalPointer(pElem->type_, vertexStride, pElem->pointer_);
         ACG::GLState::enableClientState(GL_NORMAL_ARRAY);
@@ -0,0 +1,297 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+
+
+
+//=============================================================================
+//
+//  Batch versions of the geometric queries - IMPLEMENTATION
+//
+//=============================================================================
+
+
+//== INCLUDES =================================================================
+
+#include "AlgorithmsBatch.hh"
+#include "AlgorithmsBatchKernels.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+
+//== NAMESPACES ===============================================================
+
+namespace ACG {
+namespace Geometry {
+
+
+//== IMPLEMENTATION ===========================================================
+
+
+namespace {
+
+/// true if the CPU and the operating system support AVX2
+bool cpuSupportsAVX2() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+
+  // OSXSAVE and AVX, then the OS has to save the ymm registers
+  __cpuid(info, 1);
+  if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+    return false;
+  if ((_xgetbv(0) & 6) != 6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  // also checks the OS support of the ymm registers
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#else
+  return false;
+#endif
+}
+
+/// result of cpuSupportsAVX2(), the cpuid query runs only once
+bool hasAVX2() {
+  static const bool supported = cpuSupportsAVX2();
+  return supported;
+}
+
+/// kernels of _set, 0 if not available
+const BatchDetail::Kernels* kernelsOf(BatchInstructionSet _set) {
+  switch (_set) {
+    case BATCH_AVX2:
+      return hasAVX2() ? BatchDetail::avx2Kernels() : 0;
+#ifdef GEO_BATCH_SSE2
+    case BATCH_SSE2:
+      return BatchDetail::kernels<BatchDetail::SSE2Lane>();
+#endif
+    case BATCH_SCALAR:
+      return BatchDetail::kernels<BatchDetail::ScalarLane>();
+    default:
+      return 0;
+  }
+}
+
+/// best available instruction set not above _set
+BatchInstructionSet supportedSet(BatchInstructionSet _set) {
+  int set = _set;
+  while (set > BATCH_SCALAR && !kernelsOf(BatchInstructionSet(set)))
+    --set;
+  return BatchInstructionSet(set);
+}
+
+/// kernels used by the batch queries, 0 until the first query or setBatchInstructionSet()
+std::atomic<const BatchDetail::Kernels*> current(0);
+
+const BatchDetail::Kernels* currentKernels() {
+  const BatchDetail::Kernels* kernels = current.load(std::memory_order_acquire);
+  if (kernels)
+    return kernels;
+
+  // first query: select the best supported set, unless setBatchInstructionSet() was called concurrently
+  const BatchDetail::Kernels* best = kernelsOf(supportedSet(BATCH_AVX2));
+  if (current.compare_exchange_strong(kernels, best, std::memory_order_acq_rel))
+    return best;
+  return kernels;
+}
+
+} // anonymous namespace
+
+
+//-----------------------------------------------------------------------------
+
+
+BatchInstructionSet batchInstructionSet() {
+  const BatchDetail::Kernels* kernels = currentKernels();
+
+  int set = BATCH_AVX2;
+  while (set > BATCH_SCALAR && kernelsOf(BatchInstructionSet(set)) != kernels)
+    --set;
+  return BatchInstructionSet(set);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+BatchInstructionSet setBatchInstructionSet(BatchInstructionSet _set) {
+  const BatchInstructionSet set = supportedSet(_set);
+  current.store(kernelsOf(set), std::memory_order_release);
+  return set;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void distPointTriangleSquaredBatch( const float* const _p[3],
+                                    int                _n,
+                                    const Vec3f&       _v0,
+                                    const Vec3f&       _v1,
+                                    const Vec3f&       _v2,
+                                    float*             _sqrDist,
+                                    float* const       _nearestPoint[3] )
+{
+  if (_n <= 0)
+    return;
+
+  // per triangle constants, computed as in distPointTriangleSquared()
+  const Vec3f v0v1 = _v1 - _v0;
+  const Vec3f v0v2 = _v2 - _v0;
+  const Vec3f v1v2 = _v2 - _v1;
+  const Vec3f n = v0v1 % v0v2; // not normalized !
+  const float d = n.sqrnorm();
+
+  BatchDetail::TriangleSetup tri;
+  for (int k = 0; k < 3; ++k) {
+    tri.v0[k]   = _v0[k];
+    tri.v1[k]   = _v1[k];
+    tri.v0v1[k] = v0v1[k];
+    tri.v0v2[k] = v0v2[k];
+    tri.v1v2[k] = v1v2[k];
+    tri.n[k]    = n[k];
+  }
+
+  // degenerate triangles: the projection is skipped and the nearest edge
+  // point is used, which is the distance to the longest edge
+  tri.interior = !(d < FLT_MIN && d > -FLT_MIN);
+  tri.invD = tri.interior ? 1.0f / d : 0.0f;
+
+  // zero length edges collapse to their start point
+  const float l01 = v0v1.sqrnorm(), l02 = v0v2.sqrnorm(), l12 = v1v2.sqrnorm();
+  tri.inv_v0v1_2 = l01 > 0.0f ? 1.0f / l01 : 0.0f;
+  tri.inv_v0v2_2 = l02 > 0.0f ? 1.0f / l02 : 0.0f;
+  tri.inv_v1v2_2 = l12 > 0.0f ? 1.0f / l12 : 0.0f;
+
+  currentKernels()->distPointTriangle(_p, _n, tri, _sqrDist, _nearestPoint);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void closestPointTriBatch( const float* const _p[3],
+                           int                _n,
+                           const Vec3f&       _a,
+                           const Vec3f&       _b,
+                           const Vec3f&       _c,
+                           float* const       _closest[3] )
+{
+  // the kernels always store the distances, chunks of points avoid allocating them
+  const int chunkSize = 256;
+  float sqrDist[chunkSize];
+
+  for (int i = 0; i < _n; i += chunkSize)
+  {
+    const float* const p[3] = { _p[0] + i, _p[1] + i, _p[2] + i };
+    float* const closest[3] = { _closest[0] + i, _closest[1] + i, _closest[2] + i };
+
+    distPointTriangleSquaredBatch(p, std::min(chunkSize, _n - i), _a, _b, _c, sqrDist, closest);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int triangleIntersectionBatch( const Vec3f&       _o,
+                               const Vec3f&       _dir,
+                               const float* const _v0[3],
+                               const float* const _v1[3],
+                               const float* const _v2[3],
+                               int                _n,
+                               float*             _t,
+                               float*             _u,
+                               float*             _v,
+                               unsigned char*     _hit )
+{
+  if (_n <= 0)
+    return 0;
+
+  const float o[3]   = { _o[0], _o[1], _o[2] };
+  const float dir[3] = { _dir[0], _dir[1], _dir[2] };
+
+  return currentKernels()->triangleIntersection(o, dir, _v0, _v1, _v2, _n, _t, _u, _v, _hit);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+int axisAlignedBBIntersectionBatch( const Vec3f&       _o,
+                                    const Vec3f&       _dir,
+                                    const float* const _bbmin[3],
+                                    const float* const _bbmax[3],
+                                    int                _n,
+                                    float*             _t0,
+                                    float*             _t1,
+                                    unsigned char*     _hit )
+{
+  if (_n <= 0)
+    return 0;
+
+  BatchDetail::RaySetup ray;
+  for (int k = 0; k < 3; ++k) {
+    ray.o[k]       = _o[k];
+    ray.inv_dir[k] = 1 / _dir[k];
+  }
+
+  return currentKernels()->axisAlignedBBIntersection(ray, _bbmin, _bbmax, _n, _t0, _t1, _hit);
+}
+
+
+//=============================================================================
+} // namespace Geometry
+} // namespace ACG
+//=============================================================================
@@ -0,0 +1,215 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+
+
+
+//=============================================================================
+//
+//  Batch versions of the geometric queries in Algorithms.hh
+//
+//=============================================================================
+
+
+#ifndef GEO_ALGORITHMS_BATCH_HH
+#define GEO_ALGORITHMS_BATCH_HH
+
+
+//== INCLUDES =================================================================
+
+#include <ACG/Config/ACGDefines.hh>
+#include <ACG/Math/VectorT.hh>
+
+
+//== NAMESPACES ===============================================================
+
+namespace ACG {
+namespace Geometry {
+
+
+//== BATCH QUERIES ============================================================
+
+/** \brief Batch queries on single precision data in structure-of-arrays layout
+ *
+ * The functions below evaluate one of the queries from Algorithms.hh for many
+ * points, triangles or boxes at once. Coordinates are passed as three separate
+ * arrays (x, y and z), so that 4 (SSE2) or 8 (AVX2) elements are processed per
+ * instruction. The instruction set is chosen once at runtime from the
+ * capabilities of the CPU. All instruction sets compute bitwise identical
+ * results, the batch sources are compiled without floating point contraction
+ * (no FMA). Results agree with the functions of Algorithms.hh up to single
+ * precision rounding, as the caller may be compiled with contraction.
+ *
+ * Typical users are mesh distance tools that test many sample points against
+ * the same triangle and ray casters that test one ray against the triangles
+ * or child boxes of a BSP leaf.
+ */
+
+/// Instruction sets of the batch queries
+enum BatchInstructionSet {
+  BATCH_SCALAR = 0,
+  BATCH_SSE2   = 1,
+  BATCH_AVX2   = 2
+};
+
+/// Instruction set currently used by the batch queries
+ACGDLLEXPORT
+BatchInstructionSet batchInstructionSet();
+
+/** \brief Select the instruction set of the batch queries
+ *
+ * Mainly intended for testing and benchmarking. Requests for instruction sets
+ * that are not supported by the CPU or the build fall back to the best
+ * supported one.
+ *
+ * @param _set requested instruction set
+ * @return     instruction set that is used from now on
+ */
+ACGDLLEXPORT
+BatchInstructionSet setBatchInstructionSet(BatchInstructionSet _set);
+
+
+/** \brief squared distances from points _p to triangle (_v0, _v1, _v2)
+ *
+ * Batch version of distPointTriangleSquaredStable(): degenerate triangles
+ * return the distance to their longest edge.
+ *
+ * @param _p            x, y and z coordinates of the points
+ * @param _n            number of points
+ * @param _v0           First point of triangle
+ * @param _v1           Second point of triangle
+ * @param _v2           Third point of triangle
+ * @param _sqrDist      returned squared distances, _n values
+ * @param _nearestPoint optional x, y and z arrays for the nearest points on the triangle
+ */
+ACGDLLEXPORT
+void distPointTriangleSquaredBatch( const float* const _p[3],
+                                    int                _n,
+                                    const Vec3f&       _v0,
+                                    const Vec3f&       _v1,
+                                    const Vec3f&       _v2,
+                                    float*             _sqrDist,
+                                    float* const       _nearestPoint[3] = 0 );
+
+/** \brief closest points on triangle (_a, _b, _c) to points _p
+ *
+ * Batch version of closestPointTri(), the nearest points of
+ * distPointTriangleSquaredBatch(). Results agree with closestPointTri() up to
+ * single precision rounding.
+ *
+ * @param _p       x, y and z coordinates of the points
+ * @param _n       number of points
+ * @param _a       First point of triangle
+ * @param _b       Second point of triangle
+ * @param _c       Third point of triangle
+ * @param _closest returned x, y and z coordinates of the closest points
+ */
+ACGDLLEXPORT
+void closestPointTriBatch( const float* const _p[3],
+                           int                _n,
+                           const Vec3f&       _a,
+                           const Vec3f&       _b,
+                           const Vec3f&       _c,
+                           float* const       _closest[3] );
+
+/** \brief Intersect a ray and many triangles
+ *
+ * Batch version of triangleIntersection(). Triangle i has the corners
+ * (_v0[.][i], _v1[.][i], _v2[.][i]). _t, _u and _v are only meaningful for
+ * triangles with _hit[i] != 0.
+ *
+ * @param _o   origin of the ray
+ * @param _dir direction vector of the ray
+ * @param _v0  x, y and z coordinates of the first points of the triangles
+ * @param _v1  x, y and z coordinates of the second points of the triangles
+ * @param _v2  x, y and z coordinates of the third points of the triangles
+ * @param _n   number of triangles
+ * @param _t   returned distances from the origin to the intersections, in units of _dir
+ * @param _u   returned first barycentric coordinates of the intersections
+ * @param _v   returned second barycentric coordinates of the intersections
+ * @param _hit returned 1 for every intersected triangle, 0 otherwise
+ * @return     number of intersected triangles
+ */
+ACGDLLEXPORT
+int triangleIntersectionBatch( const Vec3f&       _o,
+                               const Vec3f&       _dir,
+                               const float* const _v0[3],
+                               const float* const _v1[3],
+                               const float* const _v2[3],
+                               int                _n,
+                               float*             _t,
+                               float*             _u,
+                               float*             _v,
+                               unsigned char*     _hit );
+
+/** \brief Intersect a ray and many axis aligned bounding boxes
+ *
+ * Batch version of axisAlignedBBIntersection(). _t0 and _t1 are only
+ * meaningful for boxes with _hit[i] != 0.
+ *
+ * @param _o     Origin of the ray
+ * @param _dir   direction vector of the ray
+ * @param _bbmin x, y and z coordinates of the lower left front corners
+ * @param _bbmax x, y and z coordinates of the upper right back corners
+ * @param _n     number of boxes
+ * @param _t0    returned entry points
+ * @param _t1    returned exit points
+ * @param _hit   returned 1 for every intersected box, 0 otherwise
+ * @return       number of intersected boxes
+ */
+ACGDLLEXPORT
+int axisAlignedBBIntersectionBatch( const Vec3f&       _o,
+                                    const Vec3f&       _dir,
+                                    const float* const _bbmin[3],
+                                    const float* const _bbmax[3],
+                                    int                _n,
+                                    float*             _t0,
+                                    float*             _t1,
+                                    unsigned char*     _hit );
+
+
+//=============================================================================
+} // namespace Geometry
+} // namespace ACG
+//=============================================================================
+#endif // GEO_ALGORITHMS_BATCH_HH defined
+//=============================================================================
@@ -0,0 +1,520 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+
+
+
+//=============================================================================
+//
+//  Kernels of the batch queries (internal, see AlgorithmsBatch.hh)
+//
+//  This header is included by AlgorithmsBatch.cc and AlgorithmsBatchAVX2.cc
+//  only. Both translation units instantiate the kernels for their own
+//  instruction set, so everything except the interface structs has internal
+//  linkage.
+//
+//=============================================================================
+
+
+#ifndef GEO_ALGORITHMS_BATCH_KERNELS_HH
+#define GEO_ALGORITHMS_BATCH_KERNELS_HH
+
+
+//== INCLUDES =================================================================
+
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GEO_BATCH_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEO_BATCH_SSE2
+#endif
+
+
+//== NAMESPACES ===============================================================
+
+namespace ACG {
+namespace Geometry {
+namespace BatchDetail {
+
+
+//== INTERFACE ================================================================
+
+
+/// Per triangle constants of the point-triangle distance
+struct TriangleSetup {
+  float v0[3], v1[3];
+  float v0v1[3], v0v2[3], v1v2[3];
+  float n[3];
+  float invD;
+  float inv_v0v1_2, inv_v0v2_2, inv_v1v2_2;
+  /// false for degenerate triangles, only the edges are considered then
+  bool interior;
+};
+
+/// Per ray constants of the ray-box intersection
+struct RaySetup {
+  float o[3];
+  float inv_dir[3];
+};
+
+/// Kernels of one instruction set
+struct Kernels {
+  void (*distPointTriangle)( const float* const _p[3], int _n, const TriangleSetup& _tri,
+                             float* _sqrDist, float* const _nearestPoint[3] );
+
+  int (*triangleIntersection)( const float _o[3], const float _dir[3],
+                               const float* const _v0[3], const float* const _v1[3], const float* const _v2[3],
+                               int _n, float* _t, float* _u, float* _v, unsigned char* _hit );
+
+  int (*axisAlignedBBIntersection)( const RaySetup& _ray,
+                                    const float* const _bbmin[3], const float* const _bbmax[3],
+                                    int _n, float* _t0, float* _t1, unsigned char* _hit );
+};
+
+/// AVX2 kernels, 0 if the library was built without AVX2 support (AlgorithmsBatchAVX2.cc)
+const Kernels* avx2Kernels();
+
+
+//== LANES ====================================================================
+
+namespace {
+
+/*
+ * A lane type bundles the arithmetic of one instruction set. V holds W floats,
+ * M holds W comparison results. min/max/select follow the SSE semantics
+ * exactly (min(a,b) = a < b ? a : b), so that all instruction sets produce
+ * the same results, including NaN and signed zero handling. Only separate
+ * multiplies and adds are used, fused multiply-add would change the rounding.
+ */
+
+struct ScalarLane {
+  typedef float V;
+  typedef bool  M;
+  enum { W = 1 };
+
+  static V load(const float* _p)          { return *_p; }
+  static void store(float* _p, V _a)      { *_p = _a; }
+  static V set1(float _a)                 { return _a; }
+  static V add(V _a, V _b)                { return _a + _b; }
+  static V sub(V _a, V _b)                { return _a - _b; }
+  static V mul(V _a, V _b)                { return _a * _b; }
+  static V div(V _a, V _b)                { return _a / _b; }
+  static V min(V _a, V _b)                { return _a < _b ? _a : _b; }
+  static V max(V _a, V _b)                { return _a > _b ? _a : _b; }
+  static M lt(V _a, V _b)                 { return _a < _b; }
+  static M gt(V _a, V _b)                 { return _a > _b; }
+  static M mand(M _a, M _b)               { return _a && _b; }
+  static M mor(M _a, M _b)                { return _a || _b; }
+  static M mandnot(M _a, M _b)            { return !_a && _b; }
+  static V select(M _m, V _a, V _b)       { return _m ? _a : _b; }
+  static int storeMask(unsigned char* _p, M _m) { *_p = _m ? 1 : 0; return _m ? 1 : 0; }
+};
+
+#ifdef GEO_BATCH_SSE2
+struct SSE2Lane {
+  typedef __m128 V;
+  typedef __m128 M;
+  enum { W = 4 };
+
+  static V load(const float* _p)          { return _mm_loadu_ps(_p); }
+  static void store(float* _p, V _a)      { _mm_storeu_ps(_p, _a); }
+  static V set1(float _a)                 { return _mm_set1_ps(_a); }
+  static V add(V _a, V _b)                { return _mm_add_ps(_a, _b); }
+  static V sub(V _a, V _b)                { return _mm_sub_ps(_a, _b); }
+  static V mul(V _a, V _b)                { return _mm_mul_ps(_a, _b); }
+  static V div(V _a, V _b)                { return _mm_div_ps(_a, _b); }
+  static V min(V _a, V _b)                { return _mm_min_ps(_a, _b); }
+  static V max(V _a, V _b)                { return _mm_max_ps(_a, _b); }
+  static M lt(V _a, V _b)                 { return _mm_cmplt_ps(_a, _b); }
+  static M gt(V _a, V _b)                 { return _mm_cmpgt_ps(_a, _b); }
+  static M mand(M _a, M _b)               { return _mm_and_ps(_a, _b); }
+  static M mor(M _a, M _b)                { return _mm_or_ps(_a, _b); }
+  static M mandnot(M _a, M _b)            { return _mm_andnot_ps(_a, _b); }
+  static V select(M _m, V _a, V _b)       { return _mm_or_ps(_mm_and_ps(_m, _a), _mm_andnot_ps(_m, _b)); }
+
+  static int storeMask(unsigned char* _p, M _m) {
+    const int bits = _mm_movemask_ps(_m);
+    int count = 0;
+    for (int i = 0; i < W; ++i) {
+      _p[i] = (unsigned char)((bits >> i) & 1);
+      count += _p[i];
+    }
+    return count;
+  }
+};
+#endif
+
+#ifdef GEO_BATCH_AVX2
+struct AVX2Lane {
+  typedef __m256 V;
+  typedef __m256 M;
+  enum { W = 8 };
+
+  static V load(const float* _p)          { return _mm256_loadu_ps(_p); }
+  static void store(float* _p, V _a)      { _mm256_storeu_ps(_p, _a); }
+  static V set1(float _a)                 { return _mm256_set1_ps(_a); }
+  static V add(V _a, V _b)                { return _mm256_add_ps(_a, _b); }
+  static V sub(V _a, V _b)                { return _mm256_sub_ps(_a, _b); }
+  static V mul(V _a, V _b)                { return _mm256_mul_ps(_a, _b); }
+  static V div(V _a, V _b)                { return _mm256_div_ps(_a, _b); }
+  static V min(V _a, V _b)                { return _mm256_min_ps(_a, _b); }
+  static V max(V _a, V _b)                { return _mm256_max_ps(_a, _b); }
+  static M lt(V _a, V _b)                 { return _mm256_cmp_ps(_a, _b, _CMP_LT_OQ); }
+  static M gt(V _a, V _b)                 { return _mm256_cmp_ps(_a, _b, _CMP_GT_OQ); }
+  static M mand(M _a, M _b)               { return _mm256_and_ps(_a, _b); }
+  static M mor(M _a, M _b)                { return _mm256_or_ps(_a, _b); }
+  static M mandnot(M _a, M _b)            { return _mm256_andnot_ps(_a, _b); }
+  static V select(M _m, V _a, V _b)       { return _mm256_blendv_ps(_b, _a, _m); }
+
+  static int storeMask(unsigned char* _p, M _m) {
+    const int bits = _mm256_movemask_ps(_m);
+    int count = 0;
+    for (int i = 0; i < W; ++i) {
+      _p[i] = (unsigned char)((bits >> i) & 1);
+      count += _p[i];
+    }
+    return count;
+  }
+};
+#endif
+
+
+//== HELPERS ==================================================================
+
+
+/// same evaluation order as VectorT::operator|
+template <class L>
+inline typename L::V dot(const typename L::V _a[3], const typename L::V _b[3]) {
+  return L::add(L::add(L::mul(_a[0], _b[0]), L::mul(_a[1], _b[1])), L::mul(_a[2], _b[2]));
+}
+
+/// same evaluation order as VectorT::operator%
+template <class L>
+inline void cross(const typename L::V _a[3], const typename L::V _b[3], typename L::V _r[3]) {
+  _r[0] = L::sub(L::mul(_a[1], _b[2]), L::mul(_a[2], _b[1]));
+  _r[1] = L::sub(L::mul(_a[2], _b[0]), L::mul(_a[0], _b[2]));
+  _r[2] = L::sub(L::mul(_a[0], _b[1]), L::mul(_a[1], _b[0]));
+}
+
+template <class L>
+inline void set1(const float _a[3], typename L::V _r[3]) {
+  _r[0] = L::set1(_a[0]);
+  _r[1] = L::set1(_a[1]);
+  _r[2] = L::set1(_a[2]);
+}
+
+template <class L>
+inline void load(const float* const _a[3], int _i, typename L::V _r[3]) {
+  _r[0] = L::load(_a[0] + _i);
+  _r[1] = L::load(_a[1] + _i);
+  _r[2] = L::load(_a[2] + _i);
+}
+
+/// nearest point _c on segment (_s, _s + _e) to _p, returns the squared distance
+template <class L>
+inline typename L::V closestOnSegment(const typename L::V _p[3],
+                                      const typename L::V _s[3],
+                                      const typename L::V _e[3],
+                                      typename L::V       _invLen2,
+                                      typename L::V       _c[3]) {
+  typedef typename L::V V;
+  V sp[3] = { L::sub(_p[0], _s[0]), L::sub(_p[1], _s[1]), L::sub(_p[2], _s[2]) };
+  V t = L::mul(dot<L>(_e, sp), _invLen2);
+  t = L::min(L::max(t, L::set1(0.0f)), L::set1(1.0f));
+
+  V d[3];
+  for (int k = 0; k < 3; ++k) {
+    _c[k] = L::add(_s[k], L::mul(_e[k], t));
+    d[k]  = L::sub(_c[k], _p[k]);
+  }
+  return dot<L>(d, d);
+}
+
+
+//== KERNELS ==================================================================
+
+
+/*
+ * Squared distance of _n points to one triangle. Instead of branching into the
+ * Voronoi regions like distPointTriangleSquared(), every lane computes the
+ * projection into the triangle plane and the nearest points on all three
+ * edges, and selects the projection if it lies inside and the closest edge
+ * point otherwise.
+ */
+template <class L>
+int distPointTriangleRange(const float* const _p[3], int _begin, int _end,
+                           const TriangleSetup& _tri,
+                           float* _sqrDist, float* const _nearestPoint[3]) {
+  typedef typename L::V V;
+  typedef typename L::M M;
+
+  V v0[3], v1[3], v0v1[3], v0v2[3], v1v2[3], n[3];
+  set1<L>(_tri.v0, v0);
+  set1<L>(_tri.v1, v1);
+  set1<L>(_tri.v0v1, v0v1);
+  set1<L>(_tri.v0v2, v0v2);
+  set1<L>(_tri.v1v2, v1v2);
+  set1<L>(_tri.n, n);
+
+  const V invD       = L::set1(_tri.invD);
+  const V negInvD    = L::set1(-_tri.invD);
+  const V inv_v0v1_2 = L::set1(_tri.inv_v0v1_2);
+  const V inv_v0v2_2 = L::set1(_tri.inv_v0v2_2);
+  const V inv_v1v2_2 = L::set1(_tri.inv_v1v2_2);
+  const V zero       = L::set1(0.0f);
+  const V one        = L::set1(1.0f);
+  const M interior   = L::lt(L::set1(_tri.interior ? 0.0f : 1.0f), one);
+
+  int i = _begin;
+  for (; i + L::W <= _end; i += L::W) {
+    V p[3];
+    load<L>(_p, i, p);
+
+    // barycentric coordinates of the projection, as in distPointTriangleSquared()
+    V v0p[3] = { L::sub(p[0], v0[0]), L::sub(p[1], v0[1]), L::sub(p[2], v0[2]) };
+    V t[3];
+    cross<L>(v0p, n, t);
+    const V a = L::mul(dot<L>(t, v0v2), negInvD);
+    const V b = L::mul(dot<L>(t, v0v1), invD);
+
+    // outside if a < 0 or b < 0 or a+b > 1
+    const M outside = L::mor(L::mor(L::lt(a, zero), L::lt(b, zero)), L::gt(L::add(a, b), one));
+    const M inside  = L::mandnot(outside, interior);
+
+    // projection into the plane
+    const V s = L::mul(dot<L>(n, v0p), invD);
+    V best[3];
+    V bestDist;
+    {
+      V d[3];
+      for (int k = 0; k < 3; ++k) {
+        best[k] = L::sub(p[k], L::mul(n[k], s));
+        d[k]    = L::sub(best[k], p[k]);
+      }
+      bestDist = dot<L>(d, d);
+    }
+
+    // nearest points on the edges
+    V c01[3], c02[3], c12[3];
+    const V d01 = closestOnSegment<L>(p, v0, v0v1, inv_v0v1_2, c01);
+    const V d02 = closestOnSegment<L>(p, v0, v0v2, inv_v0v2_2, c02);
+    const V d12 = closestOnSegment<L>(p, v1, v1v2, inv_v1v2_2, c12);
+
+    V edge[3];
+    V edgeDist = d01;
+    const M take02 = L::lt(d02, edgeDist);
+    edgeDist = L::select(take02, d02, edgeDist);
+    const M take12 = L::lt(d12, edgeDist);
+    edgeDist = L::select(take12, d12, edgeDist);
+    for (int k = 0; k < 3; ++k)
+      edge[k] = L::select(take12, c12[k], L::select(take02, c02[k], c01[k]));
+
+    L::store(_sqrDist + i, L::select(inside, bestDist, edgeDist));
+    if (_nearestPoint) {
+      for (int k = 0; k < 3; ++k)
+        L::store(_nearestPoint[k] + i, L::select(inside, best[k], edge[k]));
+    }
+  }
+  return i;
+}
+
+template <class L>
+void distPointTriangle(const float* const _p[3], int _n, const TriangleSetup& _tri,
+                       float* _sqrDist, float* const _nearestPoint[3]) {
+  const int i = distPointTriangleRange<L>(_p, 0, _n, _tri, _sqrDist, _nearestPoint);
+  distPointTriangleRange<ScalarLane>(_p, i, _n, _tri, _sqrDist, _nearestPoint);
+}
+
+
+/*
+ * Moeller-Trumbore test of one ray against _n triangles, with the same
+ * operations and rejection tests as triangleIntersection().
+ */
+template <class L>
+int triangleIntersectionRange(const float _o[3], const float _dir[3],
+                              const float* const _v0[3], const float* const _v1[3], const float* const _v2[3],
+                              int _begin, int _end, int& _hits,
+                              float* _t, float* _u, float* _v, unsigned char* _hit) {
+  typedef typename L::V V;
+  typedef typename L::M M;
+
+  V o[3], dir[3];
+  set1<L>(_o, o);
+  set1<L>(_dir, dir);
+
+  const float eps = std::numeric_limits<float>::epsilon() * 1e2f;
+  const V posEps = L::set1(eps);
+  const V negEps = L::set1(-eps);
+  const V zero   = L::set1(0.0f);
+  const V one    = L::set1(1.0f);
+
+  int i = _begin;
+  for (; i + L::W <= _end; i += L::W) {
+    V v0[3], v1[3], v2[3];
+    load<L>(_v0, i, v0);
+    load<L>(_v1, i, v1);
+    load<L>(_v2, i, v2);
+
+    V edge1[3], edge2[3], tvec[3], pvec[3], qvec[3];
+    for (int k = 0; k < 3; ++k) {
+      edge1[k] = L::sub(v1[k], v0[k]);
+      edge2[k] = L::sub(v2[k], v0[k]);
+      tvec[k]  = L::sub(o[k], v0[k]);
+    }
+
+    cross<L>(dir, edge2, pvec);
+    const V det = dot<L>(edge1, pvec);
+    M miss = L::mand(L::gt(det, negEps), L::lt(det, posEps));
+
+    const V inv_det = L::div(one, det);
+
+    const V u = L::mul(dot<L>(tvec, pvec), inv_det);
+    miss = L::mor(miss, L::mor(L::lt(u, zero), L::gt(u, one)));
+
+    cross<L>(tvec, edge1, qvec);
+    const V v = L::mul(dot<L>(dir, qvec), inv_det);
+    miss = L::mor(miss, L::mor(L::lt(v, zero), L::gt(L::add(u, v), one)));
+
+    const V t = L::mul(dot<L>(edge2, qvec), inv_det);
+
+    L::store(_t + i, t);
+    L::store(_u + i, u);
+    L::store(_v + i, v);
+    _hits += L::storeMask(_hit + i, L::mandnot(miss, L::lt(zero, one)));
+  }
+  return i;
+}
+
+template <class L>
+int triangleIntersection(const float _o[3], const float _dir[3],
+                         const float* const _v0[3], const float* const _v1[3], const float* const _v2[3],
+                         int _n, float* _t, float* _u, float* _v, unsigned char* _hit) {
+  int hits = 0;
+  const int i = triangleIntersectionRange<L>(_o, _dir, _v0, _v1, _v2, 0, _n, hits, _t, _u, _v, _hit);
+  triangleIntersectionRange<ScalarLane>(_o, _dir, _v0, _v1, _v2, i, _n, hits, _t, _u, _v, _hit);
+  return hits;
+}
+
+
+/*
+ * Slab test of one ray against _n boxes, with the same comparisons as
+ * axisAlignedBBIntersection(). The sign of the direction is the same for all
+ * boxes, so the choice of entry and exit plane does not depend on the lane.
+ */
+template <class L>
+int axisAlignedBBIntersectionRange(const RaySetup& _ray,
+                                   const float* const _bbmin[3], const float* const _bbmax[3],
+                                   int _begin, int _end, int& _hits,
+                                   float* _t0, float* _t1, unsigned char* _hit) {
+  typedef typename L::V V;
+  typedef typename L::M M;
+
+  V o[3], inv_dir[3];
+  set1<L>(_ray.o, o);
+  set1<L>(_ray.inv_dir, inv_dir);
+
+  const float* const* lo[3];
+  const float* const* hi[3];
+  for (int k = 0; k < 3; ++k) {
+    lo[k] = (_ray.inv_dir[k] >= 0) ? _bbmin : _bbmax;
+    hi[k] = (_ray.inv_dir[k] >= 0) ? _bbmax : _bbmin;
+  }
+
+  int i = _begin;
+  for (; i + L::W <= _end; i += L::W) {
+    V tmin = L::mul(L::sub(L::load(lo[0][0] + i), o[0]), inv_dir[0]);
+    V tmax = L::mul(L::sub(L::load(hi[0][0] + i), o[0]), inv_dir[0]);
+
+    M miss = L::lt(tmin, tmin); // all false
+    for (int k = 1; k < 3; ++k) {
+      const V tkmin = L::mul(L::sub(L::load(lo[k][k] + i), o[k]), inv_dir[k]);
+      const V tkmax = L::mul(L::sub(L::load(hi[k][k] + i), o[k]), inv_dir[k]);
+
+      miss = L::mor(miss, L::mor(L::gt(tmin, tkmax), L::gt(tkmin, tmax)));
+      tmin = L::select(L::gt(tkmin, tmin), tkmin, tmin);
+      tmax = L::select(L::lt(tkmax, tmax), tkmax, tmax);
+    }
+
+    L::store(_t0 + i, tmin);
+    L::store(_t1 + i, tmax);
+    _hits += L::storeMask(_hit + i, L::mandnot(miss, L::lt(L::set1(0.0f), L::set1(1.0f))));
+  }
+  return i;
+}
+
+template <class L>
+int axisAlignedBBIntersection(const RaySetup& _ray,
+                              const float* const _bbmin[3], const float* const _bbmax[3],
+                              int _n, float* _t0, float* _t1, unsigned char* _hit) {
+  int hits = 0;
+  const int i = axisAlignedBBIntersectionRange<L>(_ray, _bbmin, _bbmax, 0, _n, hits, _t0, _t1, _hit);
+  axisAlignedBBIntersectionRange<ScalarLane>(_ray, _bbmin, _bbmax, i, _n, hits, _t0, _t1, _hit);
+  return hits;
+}
+
+
+/// kernel table of one lane type
+template <class L>
+const Kernels* kernels() {
+  static const Kernels table = {
+    &distPointTriangle<L>,
+    &triangleIntersection<L>,
+    &axisAlignedBBIntersection<L>
+  };
+  return &table;
+}
+
+} // anonymous namespace
+
+
+//=============================================================================
+} // namespace BatchDetail
+} // namespace Geometry
+} // namespace ACG
+//=============================================================================
+#endif // GEO_ALGORITHMS_BATCH_KERNELS_HH defined
+//=============================================================================
@@ -45,6 +45,12 @@
 #include <cmath>
 #include <vector>
 #include <cstring>
+#include <cfloat>
+#include <algorithm>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
 
 //=============================================================================
 
@@ -473,6 +479,10 @@ GPUCacheOptimizerTipsify::GPUCacheOptimizerTipsify(unsigned int CacheSize, unsig
 
 			if (n == -1)
 			{
+				// remember hard boundary for overdraw optimization
+				if (numTrisAdded < NumTris)
+					m_DeadEnds.push_back(numTrisAdded);
+
 				// Skip-Dead-End
 				while (DeadEndVertexStack.length() && (n == -1))
 				{
@@ -508,6 +518,414 @@ GPUCacheOptimizerTipsify::GPUCacheOptimizerTipsify(unsigned int CacheSize, unsig
 
 //=============================================================================
 
+// read position of vertex i
+static inline const float* GPUCacheOptimizer_Position(const float* pVertices, unsigned int VertexStride, unsigned int i)
+{
+	return (const float*)((const char*)pVertices + (size_t)i * VertexStride);
+}
+
+GPUCacheOptimizerOverdraw::GPUCacheOptimizerOverdraw(unsigned int CacheSize, unsigned int NumTris, unsigned int NumVerts,
+                                                     unsigned int IndexSize, const void* pIndices,
+                                                     const float* pVertices, unsigned int VertexStride, float Lambda)
+: GPUCacheOptimizer(NumTris, NumVerts, IndexSize, pIndices), m_NumClusters(0)
+{
+	if (!NumTris) return;
+
+	if (!VertexStride) VertexStride = 3 * sizeof(float);
+
+	GPUCacheOptimizerTipsify tipsify(CacheSize, NumTris, NumVerts, IndexSize, pIndices);
+
+	if (NumVerts < 3)
+	{
+		memcpy(m_pTriMap, tipsify.GetTriangleMap(), NumTris * sizeof(unsigned int));
+		m_NumClusters = 1;
+		return;
+	}
+
+	const unsigned int* pTipsifyMap = tipsify.GetTriangleMap();
+	const std::vector<unsigned int>& DeadEnds = tipsify.GetDeadEnds();
+
+	const float TargetACMR = Lambda * tipsify.ComputeACMR(CacheSize);
+
+	// 1. split into clusters at dead-ends with a fifo cache simulation
+	//  a vertex is in the cache if it was inserted after the last flush and less than CacheSize misses ago
+
+	std::vector<unsigned int> InsertTime(NumVerts, 0);
+	unsigned int NumMisses = 1; // time stamp 0 marks vertices that were never inserted
+	unsigned int FlushTime = 1;
+
+	std::vector<unsigned int> ClusterStart;
+	ClusterStart.push_back(0);
+
+	size_t NextDeadEnd = 0;
+
+	for (unsigned int i = 0; i < NumTris; ++i)
+	{
+		if (NextDeadEnd < DeadEnds.size() && DeadEnds[NextDeadEnd] == i)
+		{
+			++NextDeadEnd;
+
+			const unsigned int NumClusterTris = i - ClusterStart.back();
+			const unsigned int NumClusterMisses = NumMisses - FlushTime;
+
+			if (NumClusterTris && float(NumClusterMisses) <= TargetACMR * float(NumClusterTris))
+			{
+				// close cluster, next cluster starts with an empty cache
+				ClusterStart.push_back(i);
+				FlushTime = NumMisses;
+			}
+		}
+
+		const unsigned int t = pTipsifyMap[i];
+
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned int v = GetIndex(t * 3 + k);
+
+			if (InsertTime[v] < FlushTime || NumMisses - InsertTime[v] >= CacheSize)
+				InsertTime[v] = NumMisses++;
+		}
+	}
+
+	m_NumClusters = (unsigned int)ClusterStart.size();
+	ClusterStart.push_back(NumTris);
+
+
+	// 2. occlusion potential of each cluster: dot(cluster centroid - mesh centroid, cluster normal)
+
+	std::vector<double> ClusterCentroid(m_NumClusters * 3, 0.0);
+	std::vector<double> ClusterNormal(m_NumClusters * 3, 0.0);
+	std::vector<double> ClusterArea(m_NumClusters, 0.0);
+
+	double MeshCentroid[3] = {0.0, 0.0, 0.0};
+	double MeshArea = 0.0;
+
+	for (unsigned int c = 0; c < m_NumClusters; ++c)
+	{
+		for (unsigned int i = ClusterStart[c]; i < ClusterStart[c + 1]; ++i)
+		{
+			const unsigned int t = pTipsifyMap[i];
+
+			const float* p0 = GPUCacheOptimizer_Position(pVertices, VertexStride, GetIndex(t * 3));
+			const float* p1 = GPUCacheOptimizer_Position(pVertices, VertexStride, GetIndex(t * 3 + 1));
+			const float* p2 = GPUCacheOptimizer_Position(pVertices, VertexStride, GetIndex(t * 3 + 2));
+
+			const double e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+			const double e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+
+			// area weighted normal
+			const double n[3] = {e0[1] * e1[2] - e0[2] * e1[1],
+			                     e0[2] * e1[0] - e0[0] * e1[2],
+			                     e0[0] * e1[1] - e0[1] * e1[0]};
+
+			const double Area = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int k = 0; k < 3; ++k)
+			{
+				const double Centroid = (double(p0[k]) + p1[k] + p2[k]) / 3.0;
+
+				ClusterNormal[c * 3 + k] += n[k];
+				ClusterCentroid[c * 3 + k] += Area * Centroid;
+				MeshCentroid[k] += Area * Centroid;
+			}
+
+			ClusterArea[c] += Area;
+			MeshArea += Area;
+		}
+	}
+
+	for (int k = 0; k < 3; ++k)
+		MeshCentroid[k] = MeshArea > 0.0 ? MeshCentroid[k] / MeshArea : 0.0;
+
+	std::vector< std::pair<double, unsigned int> > SortedClusters(m_NumClusters);
+
+	for (unsigned int c = 0; c < m_NumClusters; ++c)
+	{
+		const double* n = &ClusterNormal[c * 3];
+		const double Len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		double Potential = 0.0;
+
+		if (Len > 0.0 && ClusterArea[c] > 0.0)
+		{
+			for (int k = 0; k < 3; ++k)
+				Potential += (ClusterCentroid[c * 3 + k] / ClusterArea[c] - MeshCentroid[k]) * n[k] / Len;
+		}
+
+		// descending order of potential, ties keep the tipsify order
+		SortedClusters[c] = std::make_pair(-Potential, c);
+	}
+
+	std::sort(SortedClusters.begin(), SortedClusters.end());
+
+
+	// 3. write clusters in sorted order
+
+	unsigned int Dst = 0;
+
+	for (unsigned int c = 0; c < m_NumClusters; ++c)
+	{
+		const unsigned int Src = SortedClusters[c].second;
+
+		for (unsigned int i = ClusterStart[Src]; i < ClusterStart[Src + 1]; ++i)
+			m_pTriMap[Dst++] = pTipsifyMap[i];
+	}
+}
+
+//=============================================================================
+
+float GPUCacheOptimizer::ComputeOverdraw(const float* pVertices, unsigned int VertexStride,
+                                         unsigned int Resolution, bool CullBackFaces)
+{
+	if (!m_NumTris || !pVertices || !Resolution) return 0.0f;
+
+	if (!VertexStride) VertexStride = 3 * sizeof(float);
+
+	// view directions: 6 axis and 8 diagonals
+	static const float ViewDirs[14][3] = {
+		{ 1, 0, 0}, {-1, 0, 0}, {0,  1, 0}, {0, -1, 0}, {0, 0,  1}, {0, 0, -1},
+		{ 1, 1, 1}, { 1, 1,-1}, {1, -1, 1}, {1, -1,-1},
+		{-1, 1, 1}, {-1, 1,-1}, {-1,-1, 1}, {-1,-1,-1}
+	};
+
+	std::vector<float> Projected(m_NumVerts * 3);
+	std::vector<float> Depth(Resolution * Resolution);
+
+	double NumShaded = 0.0;
+	double NumCovered = 0.0;
+
+	for (int View = 0; View < 14; ++View)
+	{
+		// orthonormal view basis (u, v, d), d points from the camera into the scene
+		float d[3] = {ViewDirs[View][0], ViewDirs[View][1], ViewDirs[View][2]};
+		const float InvLen = 1.0f / std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		for (int k = 0; k < 3; ++k) d[k] *= InvLen;
+
+		const float a[3] = {std::fabs(d[0]) < 0.9f ? 1.0f : 0.0f, std::fabs(d[0]) < 0.9f ? 0.0f : 1.0f, 0.0f};
+
+		float u[3] = {a[1] * d[2] - a[2] * d[1], a[2] * d[0] - a[0] * d[2], a[0] * d[1] - a[1] * d[0]};
+		const float InvLenU = 1.0f / std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+		for (int k = 0; k < 3; ++k) u[k] *= InvLenU;
+
+		const float v[3] = {d[1] * u[2] - d[2] * u[1], d[2] * u[0] - d[0] * u[2], d[0] * u[1] - d[1] * u[0]};
+
+		// project vertices to the raster grid
+		float MinXY[2] = {FLT_MAX, FLT_MAX}, MaxXY[2] = {-FLT_MAX, -FLT_MAX};
+
+		for (unsigned int i = 0; i < m_NumVerts; ++i)
+		{
+			const float* p = GPUCacheOptimizer_Position(pVertices, VertexStride, i);
+			float* q = &Projected[i * 3];
+
+			q[0] = u[0] * p[0] + u[1] * p[1] + u[2] * p[2];
+			q[1] = v[0] * p[0] + v[1] * p[1] + v[2] * p[2];
+			q[2] = d[0] * p[0] + d[1] * p[1] + d[2] * p[2];
+
+			for (int k = 0; k < 2; ++k)
+			{
+				MinXY[k] = std::min(MinXY[k], q[k]);
+				MaxXY[k] = std::max(MaxXY[k], q[k]);
+			}
+		}
+
+		const float Extent = std::max(MaxXY[0] - MinXY[0], MaxXY[1] - MinXY[1]);
+		const float Scale = Extent > 0.0f ? float(Resolution) / Extent : 0.0f;
+
+		for (unsigned int i = 0; i < m_NumVerts; ++i)
+		{
+			Projected[i * 3]     = (Projected[i * 3]     - MinXY[0]) * Scale;
+			Projected[i * 3 + 1] = (Projected[i * 3 + 1] - MinXY[1]) * Scale;
+		}
+
+		std::fill(Depth.begin(), Depth.end(), FLT_MAX);
+
+		// rasterize triangles in order with depth test
+		for (unsigned int i = 0; i < m_NumTris; ++i)
+		{
+			const unsigned int t = m_pTriMap[i];
+
+			const float* q0 = &Projected[GetIndex(t * 3) * 3];
+			const float* q1 = &Projected[GetIndex(t * 3 + 1) * 3];
+			const float* q2 = &Projected[GetIndex(t * 3 + 2) * 3];
+
+			// signed area is dot(face normal, d), i.e. negative for counter-clockwise front faces
+			const float Area = (q1[0] - q0[0]) * (q2[1] - q0[1]) - (q2[0] - q0[0]) * (q1[1] - q0[1]);
+
+			if (Area == 0.0f || (CullBackFaces && Area > 0.0f))
+				continue;
+
+			const int x0 = std::max(0, int(std::floor(std::min(q0[0], std::min(q1[0], q2[0])))));
+			const int y0 = std::max(0, int(std::floor(std::min(q0[1], std::min(q1[1], q2[1])))));
+			const int x1 = std::min(int(Resolution) - 1, int(std::ceil(std::max(q0[0], std::max(q1[0], q2[0])))));
+			const int y1 = std::min(int(Resolution) - 1, int(std::ceil(std::max(q0[1], std::max(q1[1], q2[1])))));
+
+			const float InvArea = 1.0f / Area;
+
+			for (int y = y0; y <= y1; ++y)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					// barycentric coordinates of pixel center
+					const float px = x + 0.5f, py = y + 0.5f;
+
+					const float b0 = ((q1[0] - px) * (q2[1] - py) - (q2[0] - px) * (q1[1] - py)) * InvArea;
+					const float b1 = ((q2[0] - px) * (q0[1] - py) - (q0[0] - px) * (q2[1] - py)) * InvArea;
+					const float b2 = 1.0f - b0 - b1;
+
+					if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+						continue;
+
+					const float z = b0 * q0[2] + b1 * q1[2] + b2 * q2[2];
+					float& DstDepth = Depth[y * Resolution + x];
+
+					if (z < DstDepth)
+					{
+						if (DstDepth == FLT_MAX) NumCovered += 1.0;
+						NumShaded += 1.0;
+						DstDepth = z;
+					}
+				}
+			}
+		}
+	}
+
+	return NumCovered > 0.0 ? float(NumShaded / NumCovered) : 0.0f;
+}
+
+//=============================================================================
+
+float GPUCacheOptimizer::ComputeFetchEfficiency(unsigned int VertexStride, unsigned int VertexCacheSize,
+                                                unsigned int CacheLineSize, unsigned int NumCacheLines)
+{
+	if (!m_NumTris || !m_NumVerts || !VertexStride || !CacheLineSize || !NumCacheLines) return 0.0f;
+
+	const unsigned int NumLines = (unsigned int)(((unsigned long long)m_NumVerts * VertexStride + CacheLineSize - 1) / CacheLineSize);
+
+	// fifo caches are simulated with insertion timestamps:
+	//  an entry is in the cache if fewer than CacheSize misses happened since it was inserted
+	std::vector<unsigned int> VertexTime(m_NumVerts, 0);
+	std::vector<unsigned int> LineTime(NumLines, 0);
+	std::vector<unsigned char> Referenced(m_NumVerts, 0);
+
+	unsigned int VertexClock = 0;
+	unsigned int LineClock = 0;
+	unsigned int NumReferenced = 0;
+
+	for (unsigned int i = 0; i < m_NumTris; ++i)
+	{
+		const unsigned int t = m_pTriMap[i];
+
+		for (int k = 0; k < 3; ++k)
+		{
+			const unsigned int Idx = GetIndex(t * 3 + k);
+
+			if (!Referenced[Idx])
+			{
+				Referenced[Idx] = 1;
+				++NumReferenced;
+			}
+
+			// post-transform cache hit: no fetch
+			if (VertexTime[Idx] && VertexClock + 1 - VertexTime[Idx] <= VertexCacheSize)
+				continue;
+
+			VertexTime[Idx] = ++VertexClock;
+
+			// fetch all cache lines overlapped by the vertex
+			const unsigned long long ByteStart = (unsigned long long)Idx * VertexStride;
+			const unsigned int FirstLine = (unsigned int)(ByteStart / CacheLineSize);
+			const unsigned int LastLine = (unsigned int)((ByteStart + VertexStride - 1) / CacheLineSize);
+
+			for (unsigned int Line = FirstLine; Line <= LastLine; ++Line)
+			{
+				if (LineTime[Line] && LineClock + 1 - LineTime[Line] <= NumCacheLines)
+					continue;
+
+				LineTime[Line] = ++LineClock;
+			}
+		}
+	}
+
+	return LineClock ? float((double)NumReferenced * VertexStride / ((double)LineClock * CacheLineSize)) : 0.0f;
+}
+
+//=============================================================================
+
+GPUCacheOptimizerTipsifyParallel::GPUCacheOptimizerTipsifyParallel(unsigned int CacheSize, unsigned int NumTris, unsigned int NumVerts,
+                                                                   unsigned int IndexSize, const void* pIndices,
+                                                                   unsigned int TrisPerCluster, unsigned int NumThreads)
+: GPUCacheOptimizer(NumTris, NumVerts, IndexSize, pIndices),
+  m_NumClusters(0)
+{
+	if (!NumTris) return;
+
+	if (!TrisPerCluster) TrisPerCluster = NumTris;
+
+	m_NumClusters = (NumTris + TrisPerCluster - 1) / TrisPerCluster;
+
+	const int NumClusters = int(m_NumClusters);
+
+#ifdef USE_OPENMP
+	const int NumWorkers = NumThreads ? int(NumThreads) : omp_get_max_threads();
+#pragma omp parallel num_threads(NumWorkers) if (NumWorkers > 1 && NumClusters > 1)
+#else
+	(void)NumThreads;
+#endif
+	{
+		// compaction of the vertex ids of a cluster, so that the memory used by Tipsify
+		//  is proportional to the size of the cluster instead of the size of the complete mesh
+		//  local ids are assigned in first-use order, entries are reset after each cluster
+		std::vector<unsigned int> GlobalToLocal(NumVerts, 0xFFFFFFFF);
+		std::vector<unsigned int> LocalToGlobal;
+		std::vector<unsigned int> LocalIndices;
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+		for (int c = 0; c < NumClusters; ++c)
+		{
+			const unsigned int StartTri = unsigned(c) * TrisPerCluster;
+			const unsigned int ClusterTris = std::min(TrisPerCluster, NumTris - StartTri);
+
+			LocalToGlobal.clear();
+			LocalIndices.resize(ClusterTris * 3);
+
+			for (unsigned int i = 0; i < ClusterTris * 3; ++i)
+			{
+				const unsigned int Idx = GetIndex(StartTri * 3 + i);
+
+				if (GlobalToLocal[Idx] == 0xFFFFFFFF)
+				{
+					GlobalToLocal[Idx] = unsigned(LocalToGlobal.size());
+					LocalToGlobal.push_back(Idx);
+				}
+
+				LocalIndices[i] = GlobalToLocal[Idx];
+			}
+
+			for (size_t i = 0; i < LocalToGlobal.size(); ++i)
+				GlobalToLocal[LocalToGlobal[i]] = 0xFFFFFFFF;
+
+			// Tipsify ignores meshes with less than 3 vertices
+			if (LocalToGlobal.size() < 3)
+			{
+				for (unsigned int i = 0; i < ClusterTris; ++i)
+					m_pTriMap[StartTri + i] = StartTri + i;
+				continue;
+			}
+
+			GPUCacheOptimizerTipsify Opt(CacheSize, ClusterTris, unsigned(LocalToGlobal.size()), 4, &LocalIndices[0]);
+
+			const unsigned int* pClusterMap = Opt.GetTriangleMap();
+
+			for (unsigned int i = 0; i < ClusterTris; ++i)
+				m_pTriMap[StartTri + i] = StartTri + pClusterMap[i];
+		}
+	}
+}
+
+//=============================================================================
+
 GPUCacheEfficiencyTester::GPUCacheEfficiencyTester(unsigned int NumTris, unsigned int NumVerts,
 												   unsigned int IndexSize, const void* pIndices)
 : GPUCacheOptimizer(NumTris, NumVerts, IndexSize, pIndices)
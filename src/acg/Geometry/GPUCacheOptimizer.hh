@@ -46,6 +46,7 @@
 //== INCLUDES =================================================================
 
 #include <ACG/Config/ACGDefines.hh>
+#include <vector>
 
 //== FORWARDDECLARATIONS ======================================================
 
@@ -170,6 +171,38 @@ public:
 	*/
 	float ComputeATVR(unsigned int VertexCacheSize = 16);
 
+	/** \brief Measures the fragment overdraw of the triangle order.
+	*
+	* The triangles are rasterized in order with a depth test from 14 orthographic views
+	* (6 axis and 8 diagonal directions) onto a small grid.
+	* Overdraw is the number of fragments passing the depth test divided by the number of covered pixels,
+	* the optimal value is 1.0 (each pixel is shaded exactly once).
+	*
+	* @param pVertices vertex positions (3 floats per vertex)
+	* @param VertexStride size in bytes of one vertex in pVertices, 0 for tightly packed positions
+	* @param Resolution width and height of the raster grid
+	* @param CullBackFaces ignore triangles with clockwise orientation in a view
+	* @return ratio: # shaded fragments / # covered pixels
+	*/
+	float ComputeOverdraw(const float* pVertices, unsigned int VertexStride = 0,
+	                      unsigned int Resolution = 128, bool CullBackFaces = true);
+
+	/** \brief Measures the efficiency of vertex fetches from memory.
+	*
+	* Each post-transform cache miss fetches the vertex from the vertex buffer through a fifo cache of memory lines.
+	* Efficiency is the size of all referenced vertices divided by the number of bytes fetched from memory,
+	* the optimal value is 1.0 (each referenced byte is loaded exactly once and no unused bytes are loaded).
+	* Vertex buffers in first-use order of the index buffer (see OptimizeVertices()) perform best here.
+	*
+	* @param VertexStride size in bytes of one vertex in the vertex buffer
+	* @param VertexCacheSize size of the post-transform vertex cache
+	* @param CacheLineSize size in bytes of one memory line
+	* @param NumCacheLines number of lines in the fetch cache
+	* @return ratio: # referenced vertex bytes / # fetched bytes
+	*/
+	float ComputeFetchEfficiency(unsigned int VertexStride, unsigned int VertexCacheSize = 16,
+	                             unsigned int CacheLineSize = 64, unsigned int NumCacheLines = 64);
+
 protected:
 	// look up  m_pIndices w.r.t. index size at location 'i'
 	unsigned int GetIndex(unsigned int i) const;
@@ -269,10 +302,19 @@ public:
 	                         unsigned int IndexSize,
 	                         const void* pIndices);
 
+	/** \brief Positions in the optimized triangle order where the fanning reached a dead-end.
+	*
+	* The triangle at such a position is not adjacent to the previous triangle (hard boundary).
+	* Sorted in ascending order.
+	*/
+	const std::vector<unsigned int>& GetDeadEnds() const {return m_DeadEnds;}
+
 private:
 
 	void MakeAbstract(){}
 
+	std::vector<unsigned int> m_DeadEnds;
+
 	/// Simple and fast fixed size stack used in tipsify implementation
 	struct RingStack
 	{
@@ -337,9 +379,96 @@ private:
 	};
 };
 
+/** \class GPUCacheOptimizerOverdraw GPUCacheOptimizer.hh
+
+    Overdraw reduction on top of Tipsify as described in "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" by Sander et. al.
+	 The Tipsify order is split into clusters at its dead-ends and the clusters are sorted by their view-independent occlusion potential,
+	 such that outward facing clusters are drawn first. Runs in linear time except for sorting the clusters.
+*/
+
+class ACGDLLEXPORT GPUCacheOptimizerOverdraw : public GPUCacheOptimizer
+{
+public:
+
+	/** \brief The actual computation happens here in this constructor
+	 *
+	 * A cluster is closed at a dead-end of the Tipsify order as soon as its ACMR, starting with an empty cache,
+	 * is below Lambda times the ACMR of the complete Tipsify order.
+	 * Larger values create smaller clusters, which reduce overdraw further at the cost of vertex cache efficiency.
+	 *
+	 * @param CacheSize number of entries in the vertex cache
+	 * @param NumTris   Number of triangles
+	 * @param NumVerts  Number of vertices
+	 * @param IndexSize size in bytes of one index: 1, 2, 4 supported
+	 * @param pIndices  index buffer
+	 * @param pVertices vertex positions (3 floats per vertex)
+	 * @param VertexStride size in bytes of one vertex in pVertices, 0 for tightly packed positions
+	 * @param Lambda    cluster threshold, see above
+	*/
+	GPUCacheOptimizerOverdraw(unsigned int CacheSize,
+	                          unsigned int NumTris,
+	                          unsigned int NumVerts,
+	                          unsigned int IndexSize,
+	                          const void* pIndices,
+	                          const float* pVertices,
+	                          unsigned int VertexStride = 0,
+	                          float Lambda = 1.05f);
+
+	/// number of clusters in the optimized triangle order
+	unsigned int GetNumClusters() const {return m_NumClusters;}
+
+private:
+
+	void MakeAbstract(){}
+
+	unsigned int m_NumClusters;
+};
+
+/** \class GPUCacheOptimizerTipsifyParallel GPUCacheOptimizer.hh
+
+    Multi-threaded Tipsify for huge index buffers.
+	 The triangle list is partitioned into clusters of consecutive triangles, which are optimized
+	 independently with GPUCacheOptimizerTipsify and concatenated in their original order.
+	 Only vertices on cluster borders may be transformed more often than in the serial result,
+	 so the input order should be spatially coherent (ie. face order of a mesh or a space filling curve).
+	 The result does not depend on the number of threads.
+*/
+
+class ACGDLLEXPORT GPUCacheOptimizerTipsifyParallel : public GPUCacheOptimizer
+{
+public:
+
+	/** \brief The actual computation happens here in this constructor
+	 *
+	 * @param CacheSize number of entries in the vertex cache
+	 * @param NumTris   Number of triangles
+	 * @param NumVerts  Number of vertices
+	 * @param IndexSize size in bytes of one index: 1, 2, 4 supported
+	 * @param pIndices  index buffer
+	 * @param TrisPerCluster max number of triangles per cluster
+	 * @param NumThreads number of threads, 0 uses all available cores (requires USE_OPENMP)
+	*/
+	GPUCacheOptimizerTipsifyParallel(unsigned int CacheSize,
+	                                 unsigned int NumTris,
+	                                 unsigned int NumVerts,
+	                                 unsigned int IndexSize,
+	                                 const void* pIndices,
+	                                 unsigned int TrisPerCluster = 65536,
+	                                 unsigned int NumThreads = 0);
+
+	/// number of independently optimized clusters
+	unsigned int GetNumClusters() const {return m_NumClusters;}
+
+private:
+
+	void MakeAbstract(){}
+
+	unsigned int m_NumClusters;
+};
+
 /** \class GPUCacheEfficiencyTester GPUCacheOptimizer.hh
 
-    simple class providing ATVR and ACMR computations w/o any optimizing
+    simple class providing ATVR, ACMR, overdraw and vertex fetch efficiency computations w/o any optimizing
 */
 class ACGDLLEXPORT GPUCacheEfficiencyTester : public GPUCacheOptimizer
 {
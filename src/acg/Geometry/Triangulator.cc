@@ -101,13 +101,10 @@ Triangulator::Triangulator(const std::vector<Vec3f>& _pos)
     axis[2].normalize();
 
     // make sure first axis is linearly independent from the normal
-    while (std::abs(axis[0] | axis[2]) > 0.95f || (axis[0].sqrnorm() < 0.001f))
-    {
-      for (int i = 0; i < 3; ++i)
-        axis[0][i] = float(rand()) / float(RAND_MAX) * 2.0f - 1.0f;
-
-      axis[0].normalize();
-    }
+    //  the y-axis can not be close to the normal if the x-axis is, so this choice is always valid.
+    //  the choice is deterministic, such that the result does not depend on rand() or the calling thread
+    if (std::abs(axis[0] | axis[2]) > 0.95f)
+      axis[0] = Vec3f(0.0f, 1.0f, 0.0f);
 
     // make axis[0] orthogonal to normal
     axis[0] = axis[0] - axis[2] * (axis[0] | axis[2]);
@@ -0,0 +1,308 @@
+/*===========================================================================*\
+*                                                                           *
+*                              OpenFlipper                                  *
+*           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+*           Department of Computer Graphics and Multimedia                  *
+*                          All rights reserved.                             *
+*                            www.openflipper.org                            *
+*                                                                           *
+*---------------------------------------------------------------------------*
+* This file is part of OpenFlipper.                                         *
+*---------------------------------------------------------------------------*
+*                                                                           *
+* Redistribution and use in source and binary forms, with or without        *
+* modification, are permitted provided that the following conditions        *
+* are met:                                                                  *
+*                                                                           *
+* 1. Redistributions of source code must retain the above copyright notice, *
+*    this list of conditions and the following disclaimer.                  *
+*                                                                           *
+* 2. Redistributions in binary form must reproduce the above copyright      *
+*    notice, this list of conditions and the following disclaimer in the    *
+*    documentation and/or other materials provided with the distribution.   *
+*                                                                           *
+* 3. Neither the name of the copyright holder nor the names of its          *
+*    contributors may be used to endorse or promote products derived from   *
+*    this software without specific prior written permission.               *
+*                                                                           *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+* OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+*                                                                           *
+\*===========================================================================*/
+
+
+
+
+//=============================================================================
+//
+//  CLASS BSPCacheFile - IMPLEMENTATION
+//
+//=============================================================================
+
+
+//== INCLUDES =================================================================
+
+
+#include "BSPCacheFile.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//== NAMESPACES ===============================================================
+
+
+namespace ACG {
+
+
+//== IMPLEMENTATION ===========================================================
+
+
+namespace {
+
+const char     magic[8]  = { 'A', 'C', 'G', 'B', 'S', 'P', 0, 0 };
+const uint64_t alignment = 64;
+
+uint64_t alignOffset(uint64_t _offset)
+{
+  return (_offset + alignment - 1) & ~(alignment - 1);
+}
+
+// Name of a temporary file next to _filename, which is unique for concurrent writers
+//  in this and other processes, also on other hosts sharing the directory
+std::string tempFilename(const std::string& _filename)
+{
+  static std::atomic<unsigned int> counter(0);
+
+#ifdef _WIN32
+  const unsigned long pid = GetCurrentProcessId();
+#else
+  const unsigned long pid = (unsigned long)getpid();
+#endif
+
+  std::ostringstream name;
+  name << _filename << "." << pid << "." << counter++ << "." << std::hex << std::random_device()() << ".tmp";
+  return name.str();
+}
+
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+BSPCacheFile::BSPCacheFile()
+  : data_(0), size_(0)
+#ifdef _WIN32
+  , file_(0), mapping_(0)
+#endif
+{
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+BSPCacheFile::~BSPCacheFile()
+{
+  unmap();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+BSPCacheFile::Header BSPCacheFile::makeHeader(uint64_t _key, size_t _nodeSize, size_t _handleSize, size_t _scalarSize,
+                                              size_t _numNodes, size_t _numHandles)
+{
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, magic, sizeof(magic));
+  header.version    = Version;
+  header.nodeSize   = uint32_t(_nodeSize);
+  header.handleSize = uint32_t(_handleSize);
+  header.scalarSize = uint32_t(_scalarSize);
+  header.key        = _key;
+  header.numNodes   = _numNodes;
+  header.numHandles = _numHandles;
+  return header;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool BSPCacheFile::map(const std::string& _filename, const Header& _expected)
+{
+  unmap();
+
+#ifdef _WIN32
+
+  HANDLE file = CreateFileA(_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+  HANDLE mapping = 0;
+  const void* data = 0;
+
+  if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= LONGLONG(sizeof(Header)))
+    mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+
+  if (mapping)
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+  if (!data)
+  {
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  file_    = file;
+  mapping_ = mapping;
+  data_    = static_cast<const char*>(data);
+  size_    = size_t(fileSize.QuadPart);
+
+#else
+
+  const int fd = open(_filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  void* data = MAP_FAILED;
+
+  if (fstat(fd, &st) == 0 && st.st_size >= off_t(sizeof(Header)))
+    data = mmap(0, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // the mapping stays valid after closing the file
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  data_ = static_cast<const char*>(data);
+  size_ = size_t(st.st_size);
+
+#endif
+
+  // validate header and array bounds
+  const Header* h = header();
+
+  bool valid = memcmp(h->magic, _expected.magic, sizeof(h->magic)) == 0 &&
+               h->version    == _expected.version &&
+               h->nodeSize   == _expected.nodeSize &&
+               h->handleSize == _expected.handleSize &&
+               h->scalarSize == _expected.scalarSize &&
+               h->key        == _expected.key;
+
+  valid = valid &&
+          h->nodeOffset   % alignment == 0 && h->nodeOffset   >= sizeof(Header) &&
+          h->handleOffset % alignment == 0 && h->handleOffset >= sizeof(Header) &&
+          h->nodeOffset   <= size_ && h->numNodes   <= (size_ - h->nodeOffset)   / h->nodeSize &&
+          h->handleOffset <= size_ && h->numHandles <= (size_ - h->handleOffset) / h->handleSize;
+
+  if (!valid)
+    unmap();
+
+  return valid;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void BSPCacheFile::unmap()
+{
+  if (!data_)
+    return;
+
+#ifdef _WIN32
+  UnmapViewOfFile(data_);
+  CloseHandle(mapping_);
+  CloseHandle(file_);
+  file_    = 0;
+  mapping_ = 0;
+#else
+  munmap(const_cast<char*>(data_), size_);
+#endif
+
+  data_ = 0;
+  size_ = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+bool BSPCacheFile::write(const std::string& _filename, const Header& _header, const void* _nodes, const void* _handles)
+{
+  Header header = _header;
+  header.nodeOffset   = alignOffset(sizeof(Header));
+  header.handleOffset = alignOffset(header.nodeOffset + header.numNodes * header.nodeSize);
+
+  const std::string tmpFilename = tempFilename(_filename);
+
+  {
+    std::ofstream file(tmpFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+      return false;
+
+    const char padding[alignment] = {0};
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, std::streamsize(header.nodeOffset - sizeof(header)));
+    file.write(static_cast<const char*>(_nodes), std::streamsize(header.numNodes * header.nodeSize));
+    file.write(padding, std::streamsize(header.handleOffset - header.nodeOffset - header.numNodes * header.nodeSize));
+    file.write(static_cast<const char*>(_handles), std::streamsize(header.numHandles * header.handleSize));
+
+    if (!file)
+    {
+      file.close();
+      std::remove(tmpFilename.c_str());
+      return false;
+    }
+  }
+
+  // rename does not replace existing files on windows
+  if (std::rename(tmpFilename.c_str(), _filename.c_str()) != 0)
+  {
+    std::remove(_filename.c_str());
+    if (std::rename(tmpFilename.c_str(), _filename.c_str()) != 0)
+    {
+      std::remove(tmpFilename.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+//=============================================================================
+} // namespace ACG
+//=============================================================================
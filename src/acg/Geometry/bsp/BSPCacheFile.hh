@@ -0,0 +1,191 @@
+/*===========================================================================*\
+*                                                                           *
+*                              OpenFlipper                                  *
+*           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+*           Department of Computer Graphics and Multimedia                  *
+*                          All rights reserved.                             *
+*                            www.openflipper.org                            *
+*                                                                           *
+*---------------------------------------------------------------------------*
+* This file is part of OpenFlipper.                                         *
+*---------------------------------------------------------------------------*
+*                                                                           *
+* Redistribution and use in source and binary forms, with or without        *
+* modification, are permitted provided that the following conditions        *
+* are met:                                                                  *
+*                                                                           *
+* 1. Redistributions of source code must retain the above copyright notice, *
+*    this list of conditions and the following disclaimer.                  *
+*                                                                           *
+* 2. Redistributions in binary form must reproduce the above copyright      *
+*    notice, this list of conditions and the following disclaimer in the    *
+*    documentation and/or other materials provided with the distribution.   *
+*                                                                           *
+* 3. Neither the name of the copyright holder nor the names of its          *
+*    contributors may be used to endorse or promote products derived from   *
+*    this software without specific prior written permission.               *
+*                                                                           *
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+* PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+* OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+* EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+* PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+* LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+* NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+*                                                                           *
+\*===========================================================================*/
+
+
+
+
+//=============================================================================
+//
+//  CLASS BSPCacheFile
+//
+//=============================================================================
+
+#ifndef ACG_BSPCACHEFILE_HH
+#define ACG_BSPCACHEFILE_HH
+
+
+//== INCLUDES =================================================================
+
+
+#include <ACG/Config/ACGDefines.hh>
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+
+//== NAMESPACES ===============================================================
+
+
+namespace ACG {
+
+
+//== CLASS DEFINITION =========================================================
+
+
+/** \brief Read-only memory mapping of a BSP cache file
+ *
+ * A cache file consists of a Header followed by the node and the handle array of a built tree.
+ * Both arrays are 64 byte aligned, so they can be used directly in the mapped memory without
+ * deserialization. The files are written by TriangleBSPCoreT::buildCached().
+ *
+ * Cache files are not portable between platforms of different endianness or handle type.
+ * Such files are rejected by map(), because the header does not match.
+ */
+class ACGDLLEXPORT BSPCacheFile
+{
+public:
+
+  /// File header
+  struct Header
+  {
+    char     magic[8];      ///< "ACGBSP" padded with zeros
+    uint32_t version;       ///< file format version
+    uint32_t nodeSize;      ///< sizeof of one node in bytes
+    uint32_t handleSize;    ///< sizeof of one handle in bytes
+    uint32_t scalarSize;    ///< sizeof of the scalar type used to compute the key
+    uint64_t key;           ///< hash of the triangles and the build parameters
+    uint64_t numNodes;      ///< number of nodes
+    uint64_t numHandles;    ///< number of handles
+    uint64_t nodeOffset;    ///< byte offset of the node array
+    uint64_t handleOffset;  ///< byte offset of the handle array
+  };
+
+  /// Current file format version
+  static const uint32_t Version = 1;
+
+  BSPCacheFile();
+  ~BSPCacheFile();
+
+  /** \brief Create the header of a cache file
+   *
+   * The offsets are filled in by write().
+   */
+  static Header makeHeader(uint64_t _key, size_t _nodeSize, size_t _handleSize, size_t _scalarSize,
+                           size_t _numNodes, size_t _numHandles);
+
+  /** \brief Map a cache file into memory
+   *
+   * The file is only mapped, if its header matches _expected in everything but the array sizes
+   * and offsets, and if the arrays fit in the file. A previous mapping is released in any case.
+   *
+   * @param _filename  cache file
+   * @param _expected  header created by makeHeader()
+   * @return true if the file is mapped
+   */
+  bool map(const std::string& _filename, const Header& _expected);
+
+  /// Release the mapping
+  void unmap();
+
+  /// Is a file mapped?
+  bool isMapped() const { return data_ != 0; }
+
+  /// Header of the mapped file, 0 if no file is mapped
+  const Header* header() const { return isMapped() ? reinterpret_cast<const Header*>(data_) : 0; }
+
+  /// Node array of the mapped file
+  const void* nodes() const { return data_ + header()->nodeOffset; }
+
+  /// Handle array of the mapped file
+  const void* handles() const { return data_ + header()->handleOffset; }
+
+  /** \brief Write a cache file
+   *
+   * The file is written to a uniquely named temporary file first and renamed afterwards, such that
+   * other processes never map a partially written file and concurrent writers do not interfere.
+   *
+   * @param _filename  cache file
+   * @param _header    header created by makeHeader()
+   * @param _nodes     node array, _header.numNodes * _header.nodeSize bytes
+   * @param _handles   handle array, _header.numHandles * _header.handleSize bytes
+   * @return true on success
+   */
+  static bool write(const std::string& _filename, const Header& _header, const void* _nodes, const void* _handles);
+
+  /// FNV-1a hash of _size bytes
+  static uint64_t hash(const void* _data, size_t _size, uint64_t _seed = 14695981039346656037ULL)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(_data);
+    for (size_t i = 0; i < _size; ++i)
+      _seed = (_seed ^ bytes[i]) * 1099511628211ULL;
+    return _seed;
+  }
+
+  /// Bit mixing of a 64 bit hash (splitmix64 finalizer), used to combine hashes order independently by addition
+  static uint64_t mix(uint64_t _h)
+  {
+    _h = (_h ^ (_h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    _h = (_h ^ (_h >> 27)) * 0x94d049bb133111ebULL;
+    return _h ^ (_h >> 31);
+  }
+
+private:
+
+  // Noncopyable because of the mapping
+  BSPCacheFile(const BSPCacheFile&);
+  BSPCacheFile& operator=(const BSPCacheFile&);
+
+  const char* data_;
+  size_t      size_;
+
+#ifdef _WIN32
+  void* file_;
+  void* mapping_;
+#endif
+};
+
+
+//=============================================================================
+} // namespace ACG
+//=============================================================================
+#endif // ACG_BSPCACHEFILE_HH defined
+//=============================================================================
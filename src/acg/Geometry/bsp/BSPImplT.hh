@@ -54,6 +54,13 @@
 
 
 #include <OpenMesh/Core/Geometry/VectorT.hh>
+#include <ACG/Geometry/Algorithms.hh>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BSPIMPLT_SSE
+#include <emmintrin.h>
+#endif
 
 
 //== CLASS DEFINITION =========================================================
@@ -94,9 +101,53 @@ public: //---------------------------------------------------------------------
   /// Store nearest neighbor information
   typedef  std::vector< std::pair<Handle,Scalar> > RayCollision;
 
+  /// Closest hit of a ray in a batched query
+  struct RayHit
+  {
+    RayHit() {}
+    RayHit(Handle _h, Scalar _d) : handle(_h), dist(_d) {}
+    Handle  handle;   ///< hit face, default constructed (invalid) if the ray missed
+    Scalar  dist;     ///< ray parameter of the hit, infinity if the ray missed
+  };
+
+  /// List of faces with their distances
+  typedef  std::vector<NearestNeighbor> NearestNeighbors;
+
   /// Return handle of the nearest neighbor face
   NearestNeighbor nearest(const Point& _p) const;
 
+  /** \brief k nearest neighbor faces
+   *
+   * The search uses _neighbors as bounded max-heap and does not allocate memory.
+   * Faces with equal distance are ordered by their handle.
+   *
+   * @param _p         Query point
+   * @param _k         Number of neighbors
+   * @param _neighbors [out] Array of size _k, receives the neighbors sorted by increasing distance
+   * @return           Number of neighbors found, less than _k only if the tree has fewer faces
+   */
+  int nearest(const Point& _p, int _k, NearestNeighbor* _neighbors) const;
+
+  /** \brief All faces within a distance
+   *
+   * @param _p         Query point
+   * @param _dist      Maximum distance (inclusive)
+   * @param _neighbors [out] Faces within _dist with their exact distance, sorted by increasing distance.
+   *                   The vector is cleared first, its capacity is reused.
+   */
+  void nearest(const Point& _p, Scalar _dist, NearestNeighbors& _neighbors) const;
+
+  /** \brief Nearest neighbor faces of a point cloud
+   *
+   * Batched version of nearest(), the points are distributed on OpenMP threads (see setNumThreads()).
+   *
+   * @param _p             Query points
+   * @param _numPoints     Number of query points
+   * @param _neighbors     [out] Nearest face of each point, array of size _numPoints
+   * @param _closestPoints [out] Closest point on the nearest face, array of size _numPoints (optional)
+   */
+  void nearest(const Point* _p, int _numPoints, NearestNeighbor* _neighbors, Point* _closestPoints = 0) const;
+
   /** \brief intersect mesh with ray
    *
    * This function shots a ray through the mesh and collects all intersected triangles and
@@ -136,12 +187,53 @@ public: //---------------------------------------------------------------------
    */
   RayCollision nearestRaycollision(const Point& _p, const Point& _r) const;
 
+  /** @name Batched ray queries
+   *
+   * Consecutive rays are traced together in packets of four with SSE and the packets are
+   * distributed on OpenMP threads, so neighbouring rays in the input should be coherent.
+   * The results agree with the single ray functions up to rounding, the packet code may be
+   * compiled with and the scalar code without FMA contraction or vice versa. Rays that pass
+   * through an edge may therefore report a different one of the adjacent faces.
+   * Without SSE or for double precision meshes, each ray is traced on its own.
+   *
+   * The thread count is set by setNumThreads().
+   */
+  /** @{ */
+
+  /** \brief intersect mesh with rays, batched version of raycollision()
+   *
+   * @param _p          Start points of the rays
+   * @param _r          Ray directions
+   * @param _numRays    Number of rays
+   * @param _collisions [out] Collision information of each ray, array of size _numRays
+   */
+  void raycollision(const Point* _p, const Point* _r, int _numRays, RayCollision* _collisions) const;
+
+  /** \brief intersect mesh with rays, batched version of directionalRaycollision()
+   *
+   * @param _p          Start points of the rays
+   * @param _r          Ray directions
+   * @param _numRays    Number of rays
+   * @param _collisions [out] Collision information of each ray, array of size _numRays
+   */
+  void directionalRaycollision(const Point* _p, const Point* _r, int _numRays, RayCollision* _collisions) const;
+
+  /** \brief intersect mesh with rays, batched version of nearestRaycollision()
+   *
+   * @param _p       Start points of the rays
+   * @param _r       Ray directions
+   * @param _numRays Number of rays
+   * @param _hits    [out] First hit of each ray, array of size _numRays
+   */
+  void nearestRaycollision(const Point* _p, const Point* _r, int _numRays, RayHit* _hits) const;
+
+  /** @} */
+
   /** \brief intersect mesh with open ball
    *
    * All triangles that have at least one vertex (!) inside the ball are given to the Callback,
    * triangles which have no vertex inside the ball but intersect it MAY be returned. (TODO)
-   * Each triangle can be returned up to three times, make sure to handle this, e.g.
-   * by putting the values into an std::(unordered_)set.
+   * Each triangle is returned at most once.
    *
    * @param _c Center of the ball
    * @param _r Radius of the ball
@@ -166,6 +258,25 @@ private: //---------------------------------------------------------------------
     }
   };
 
+  /// Store k nearest neighbor information
+  struct KNearestNeighborData
+  {
+    Point            ref;
+    int              k;
+    int              size;
+    NearestNeighbor* heap;   ///< max-heap of the best candidates with squared distances
+
+    /// Squared distance that a candidate has to beat
+    Scalar bound(Scalar _infinity) const { return size < k ? _infinity : heap[0].dist; }
+  };
+
+  /// Order by distance, ties by Handle::idx() (see the traits requirements of TriangleBSPCoreT)
+  struct less_neighbor {
+    bool operator()(const NearestNeighbor &left, const NearestNeighbor &right) const {
+      return left.dist < right.dist || (left.dist == right.dist && left.handle.idx() < right.handle.idx());
+    }
+  };
+
   /// Store ray collide information
   struct RayCollisionData
   {
@@ -178,26 +289,86 @@ private: //---------------------------------------------------------------------
 
 
   // Recursive part of nearest()
-  void _nearest(Node* _node, NearestNeighborData& _data) const;
+  void _nearest(int _node, NearestNeighborData& _data) const;
+
+  // Recursive part of nearest() for k neighbors
+  void _nearest_k(int _node, KNearestNeighborData& _data) const;
+
+  // Recursive part of nearest() for all neighbors within a distance, collects squared distances
+  void _nearest_range(int _node, const Point& _p, Scalar _sqrdist, NearestNeighbors& _neighbors) const;
 
   /**  \brief recursive part of raycollision()
    *
    * @param _node The current node in the tree
    * @param _data Data pointer, used to collect the collision information
    */
-  void _raycollision_non_directional(Node* _node, RayCollisionData& _data) const;
+  void _raycollision_non_directional(int _node, RayCollisionData& _data) const;
 
   /**  \brief recursive part of directionalRaycollision()
    *
    * @param _node The current node in the tree
    * @param _data Data pointer, used to collect the collision information
    */
-  void _raycollision_directional(Node* _node, RayCollisionData& _data) const;
+  void _raycollision_directional(int _node, RayCollisionData& _data) const;
 
-  void _raycollision_nearest_directional(Node* _node, RayCollisionData& _data) const;
+  void _raycollision_nearest_directional(int _node, RayCollisionData& _data) const;
 
   template<class Callback>
-  void _intersect_ball(const Node& _node, const Point & _c, Scalar _r, Callback _callback) const;
+  void _intersect_ball(int _node, const Point & _c, Scalar _r, Callback _callback) const;
+
+  /// Query type of the batched ray functions
+  enum RayMode
+  {
+    RAY_NON_DIRECTIONAL,
+    RAY_DIRECTIONAL,
+    RAY_NEAREST
+  };
+
+  /// Packets are traced with SSE only for single precision points
+#ifdef BSPIMPLT_SSE
+  typedef std::integral_constant<bool, std::is_same<Scalar, float>::value> PacketSupport;
+#else
+  typedef std::false_type PacketSupport;
+#endif
+
+  /// Node on the traversal stack of a packet, with the active rays and their entry distances
+  struct PacketStackEntry
+  {
+    int   node;
+    int   mask;
+    float tmin[4];
+  };
+
+  typedef std::vector<PacketStackEntry> PacketStack;
+
+  /// Distribute the rays of a batched query in packets on threads
+  void _raycollision_batch(const Point* _p, const Point* _r, int _numRays, RayMode _mode,
+                           RayCollision* _collisions, RayHit* _hits) const;
+
+  /// Trace up to 4 rays one by one
+  void _raycollision_packet(const Point* _p, const Point* _r, int _numRays, RayMode _mode,
+                            RayCollision* _collisions, RayHit* _hits, PacketStack& _stack, std::false_type) const;
+
+#ifdef BSPIMPLT_SSE
+  /// Trace up to 4 rays as SSE packet, _stack is scratch space reused by the packets of a thread
+  void _raycollision_packet(const Point* _p, const Point* _r, int _numRays, RayMode _mode,
+                            RayCollision* _collisions, RayHit* _hits, PacketStack& _stack, std::true_type) const;
+
+  /// Packet version of ACG::Geometry::axisAlignedBBIntersection, returns the mask of hit rays
+  static int _intersect_bb_packet(const Node& _node, const __m128 _o[3], const __m128 _invDir[3],
+                                  const __m128 _dirPositive[3], __m128& _tmin);
+
+  /// Packet version of ACG::Geometry::triangleIntersection, returns the mask of hit rays
+  static int _intersect_triangle_packet(const __m128 _o[3], const __m128 _dir[3],
+                                        const Point& _v0, const Point& _v1, const Point& _v2, __m128& _t);
+#endif
+
+  /// Does the ray intersect the bounding box of _node?
+  bool _intersect_bb(int _node, const RayCollisionData& _data, Scalar& _tmin, Scalar& _tmax) const
+  {
+    const Node& node = this->treeData_[_node];
+    return ACG::Geometry::axisAlignedBBIntersection(_data.ref, _data.ray, node.template bb_min<Point>(), node.template bb_max<Point>(), _tmin, _tmax);
+  }
 
   template<typename T,typename U>
   struct less_pair_second {
@@ -61,6 +61,7 @@
 #include <vector>
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
 
 template <class BSPCore>
 typename BSPImplT<BSPCore>::NearestNeighbor
@@ -70,9 +71,9 @@ nearest(const Point& _p) const
   NearestNeighborData  data;
   data.ref  = _p;
   data.dist = infinity_;
-  if (this->root_ == 0)
+  if (this->treeSize_ == 0)
     throw std::runtime_error("It seems like the BSP hasn't been built, yet. Did you call build(...)?");
-  _nearest(this->root_, data);
+  _nearest(0, data);
   return NearestNeighbor(data.nearest, sqrt(data.dist));
 }
 
@@ -83,42 +84,235 @@ nearest(const Point& _p) const
 template <class BSPCore>
 void
 BSPImplT<BSPCore>::
-_nearest(Node* _node, NearestNeighborData& _data) const
+_nearest(int _node, NearestNeighborData& _data) const
 {
+  const Node& node = this->treeData_[_node];
+
   // terminal node
-  if (!_node->left_child_)
+  if (node.isLeaf())
   {
     Scalar dist(0);
-    for (HandleIter it=_node->begin(); it!=_node->end(); ++it)
+    for (unsigned int i = node.first(), end = node.first() + node.size(); i != end; ++i)
     {
-      dist = this->traits_.sqrdist(*it, _data.ref);
+      const Handle& h = this->handleData_[i];
+      dist = this->traits_.sqrdist(h, _data.ref);
       if (dist < _data.dist)
       {
         _data.dist = dist;
-        _data.nearest = *it;
+        _data.nearest = h;
       }
     }
   }
 
-  // non-terminal node
+  // non-terminal node: visit the closer child first
   else
   {
-    Scalar dist = _node->plane_.distance(_data.ref);
-    if (dist > 0.0)
+    const int left  = node.leftChild();
+    const int right = node.rightChild();
+    const Scalar dist_left  = this->treeData_[left].sqrdist(_data.ref);
+    const Scalar dist_right = this->treeData_[right].sqrdist(_data.ref);
+
+    if (dist_left <= dist_right)
     {
-      _nearest(_node->left_child_, _data);
-      if (dist*dist < _data.dist)
-        _nearest(_node->right_child_, _data);
+      if (dist_left < _data.dist)
+        _nearest(left, _data);
+      if (dist_right < _data.dist)
+        _nearest(right, _data);
     }
     else
     {
-      _nearest(_node->right_child_, _data);
-      if (dist*dist < _data.dist)
-        _nearest(_node->left_child_, _data);
+      if (dist_right < _data.dist)
+        _nearest(right, _data);
+      if (dist_left < _data.dist)
+        _nearest(left, _data);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+int
+BSPImplT<BSPCore>::
+nearest(const Point& _p, int _k, NearestNeighbor* _neighbors) const
+{
+  if (this->treeSize_ == 0)
+    throw std::runtime_error("It seems like the BSP hasn't been built, yet. Did you call build(...)?");
+
+  KNearestNeighborData data;
+  data.ref  = _p;
+  data.k    = _k;
+  data.size = 0;
+  data.heap = _neighbors;
+
+  if (_k > 0)
+    _nearest_k(0, data);
+
+  // heap to increasing distance
+  std::sort_heap(_neighbors, _neighbors + data.size, less_neighbor());
+
+  for (int i = 0; i < data.size; ++i)
+    _neighbors[i].dist = sqrt(_neighbors[i].dist);
+
+  return data.size;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+_nearest_k(int _node, KNearestNeighborData& _data) const
+{
+  const Node& node = this->treeData_[_node];
+
+  // terminal node
+  if (node.isLeaf())
+  {
+    for (unsigned int i = node.first(), end = node.first() + node.size(); i != end; ++i)
+    {
+      const NearestNeighbor candidate(this->handleData_[i], this->traits_.sqrdist(this->handleData_[i], _data.ref));
+
+      if (_data.size < _data.k)
+      {
+        if (candidate.dist < infinity_)
+        {
+          _data.heap[_data.size++] = candidate;
+          std::push_heap(_data.heap, _data.heap + _data.size, less_neighbor());
+        }
+      }
+      else if (less_neighbor()(candidate, _data.heap[0]))
+      {
+        // replace the farthest neighbor
+        std::pop_heap(_data.heap, _data.heap + _data.size, less_neighbor());
+        _data.heap[_data.size - 1] = candidate;
+        std::push_heap(_data.heap, _data.heap + _data.size, less_neighbor());
+      }
+    }
+  }
+
+  // non-terminal node: visit the closer child first
+  else
+  {
+    int first  = node.leftChild();
+    int second = node.rightChild();
+    Scalar dist_first  = this->treeData_[first].sqrdist(_data.ref);
+    Scalar dist_second = this->treeData_[second].sqrdist(_data.ref);
+
+    if (dist_second < dist_first)
+    {
+      std::swap(first, second);
+      std::swap(dist_first, dist_second);
+    }
+
+    // <= to also collect faces that tie with the current farthest neighbor
+    if (dist_first <= _data.bound(infinity_))
+      _nearest_k(first, _data);
+    if (dist_second <= _data.bound(infinity_))
+      _nearest_k(second, _data);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+nearest(const Point& _p, Scalar _dist, NearestNeighbors& _neighbors) const
+{
+  if (this->treeSize_ == 0)
+    throw std::runtime_error("It seems like the BSP hasn't been built, yet. Did you call build(...)?");
+
+  _neighbors.clear();
+
+  if (_dist >= Scalar(0))
+    _nearest_range(0, _p, _dist * _dist, _neighbors);
+
+  std::sort(_neighbors.begin(), _neighbors.end(), less_neighbor());
+
+  for (size_t i = 0; i < _neighbors.size(); ++i)
+    _neighbors[i].dist = sqrt(_neighbors[i].dist);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+_nearest_range(int _node, const Point& _p, Scalar _sqrdist, NearestNeighbors& _neighbors) const
+{
+  const Node& node = this->treeData_[_node];
+
+  // terminal node
+  if (node.isLeaf())
+  {
+    for (unsigned int i = node.first(), end = node.first() + node.size(); i != end; ++i)
+    {
+      const Scalar dist = this->traits_.sqrdist(this->handleData_[i], _p);
+      if (dist <= _sqrdist)
+        _neighbors.push_back(NearestNeighbor(this->handleData_[i], dist));
     }
   }
+
+  // non-terminal node
+  else
+  {
+    if (this->treeData_[node.leftChild()].sqrdist(_p) <= _sqrdist)
+      _nearest_range(node.leftChild(), _p, _sqrdist, _neighbors);
+    if (this->treeData_[node.rightChild()].sqrdist(_p) <= _sqrdist)
+      _nearest_range(node.rightChild(), _p, _sqrdist, _neighbors);
+  }
 }
 
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+nearest(const Point* _p, int _numPoints, NearestNeighbor* _neighbors, Point* _closestPoints) const
+{
+  if (this->treeSize_ == 0)
+    throw std::runtime_error("It seems like the BSP hasn't been built, yet. Did you call build(...)?");
+
+  const int numThreads = this->getNumWorkerThreads();
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 64) num_threads(numThreads) if (numThreads > 1 && _numPoints > 64)
+#endif
+  for (int i = 0; i < _numPoints; ++i)
+  {
+    NearestNeighborData  data;
+    data.ref  = _p[i];
+    data.dist = infinity_;
+    _nearest(0, data);
+
+    _neighbors[i] = NearestNeighbor(data.nearest, sqrt(data.dist));
+
+    if (_closestPoints)
+    {
+      // closest point on the nearest face, the query point itself if no face was found
+      _closestPoints[i] = _p[i];
+
+      if (data.dist < infinity_)
+      {
+        Point p0, p1, p2;
+        this->traits_.points(data.nearest, p0, p1, p2);
+        ACG::Geometry::distPointTriangleSquaredStable(_p[i], p0, p1, p2, _closestPoints[i]);
+      }
+    }
+  }
+}
+
+
 //-----------------------------------------------------------------------------
 
 template <class BSPCore>
@@ -132,7 +326,8 @@ raycollision(const Point& _p, const Point& _r) const
   data.ray  = _r;
   data.hit_handles.clear();
 
-  _raycollision_non_directional(this->root_, data);
+  if (this->treeSize_ != 0)
+    _raycollision_non_directional(0, data);
 
   std::sort(data.hit_handles.begin(), data.hit_handles.end(), less_pair_second<Handle,Scalar>());
   return RayCollision(data.hit_handles);
@@ -149,7 +344,8 @@ directionalRaycollision(const Point& _p, const Point& _r) const {
   data.ray  = _r;
   data.hit_handles.clear();
 
-  _raycollision_directional(this->root_, data);
+  if (this->treeSize_ != 0)
+    _raycollision_directional(0, data);
 
   std::sort(data.hit_handles.begin(), data.hit_handles.end(), less_pair_second<Handle,Scalar>());
   return RayCollision(data.hit_handles);
@@ -167,7 +363,8 @@ nearestRaycollision(const Point& _p, const Point& _r) const {
   data.ray  = _r;
   data.hit_handles.clear();
 
-  _raycollision_nearest_directional(this->root_, data);
+  if (this->treeSize_ != 0)
+    _raycollision_nearest_directional(0, data);
 
   return RayCollision(data.hit_handles);
 }
@@ -178,7 +375,8 @@ void
 BSPImplT<BSPCore>::
 intersectBall(const Point &_c, Scalar _r, Callback _callback) const
 {
-    _intersect_ball(*(this->root_), _c, _r, _callback);
+    if (this->treeSize_ != 0)
+      _intersect_ball(0, _c, _r, _callback);
 }
 
 
@@ -188,16 +386,18 @@ intersectBall(const Point &_c, Scalar _r, Callback _callback) const
 template <class BSPCore>
 void
 BSPImplT<BSPCore>::
-_raycollision_non_directional(Node* _node, RayCollisionData& _data) const
+_raycollision_non_directional(int _node, RayCollisionData& _data) const
 {
+  const Node& node = this->treeData_[_node];
+
   // terminal node
-  if (!_node->left_child_)
+  if (node.isLeaf())
   {
     Scalar dist;
     Point v0, v1, v2;
     Scalar u, v;
 
-    for (HandleIter it=_node->begin(); it!=_node->end(); ++it)
+    for (const Handle *it=this->handleData_+node.first(), *end=it+node.size(); it!=end; ++it)
     {
       this->traits_.points(*it, v0, v1, v2);
       if (ACG::Geometry::triangleIntersection(_data.ref, _data.ray, v0, v1, v2, dist, u, v)) {
@@ -211,11 +411,11 @@ _raycollision_non_directional(Node* _node, RayCollisionData& _data) const
   else
   {
     Scalar tmin, tmax;
-    if ( _node->left_child_ && ACG::Geometry::axisAlignedBBIntersection( _data.ref, _data.ray, _node->left_child_->bb_min, _node->left_child_->bb_max, tmin, tmax)) {
-      _raycollision_non_directional(_node->left_child_, _data);
+    if ( _intersect_bb(node.leftChild(), _data, tmin, tmax) ) {
+      _raycollision_non_directional(node.leftChild(), _data);
     }
-    if ( _node->right_child_ && ACG::Geometry::axisAlignedBBIntersection( _data.ref, _data.ray, _node->right_child_->bb_min, _node->right_child_->bb_max, tmin, tmax)) {
-      _raycollision_non_directional(_node->right_child_, _data);
+    if ( _intersect_bb(node.rightChild(), _data, tmin, tmax) ) {
+      _raycollision_non_directional(node.rightChild(), _data);
     }
   }
 }
@@ -226,16 +426,18 @@ _raycollision_non_directional(Node* _node, RayCollisionData& _data) const
 template <class BSPCore>
 void
 BSPImplT<BSPCore>::
-_raycollision_directional(Node* _node, RayCollisionData& _data) const
+_raycollision_directional(int _node, RayCollisionData& _data) const
 {
+  const Node& node = this->treeData_[_node];
+
   // terminal node
-  if (!_node->left_child_)
+  if (node.isLeaf())
   {
     Scalar dist;
     Point v0, v1, v2;
     Scalar u, v;
 
-    for (HandleIter it=_node->begin(); it!=_node->end(); ++it)
+    for (const Handle *it=this->handleData_+node.first(), *end=it+node.size(); it!=end; ++it)
     {
       this->traits_.points(*it, v0, v1, v2);
       if (ACG::Geometry::triangleIntersection(_data.ref, _data.ray, v0, v1, v2, dist, u, v)) {
@@ -250,11 +452,11 @@ _raycollision_directional(Node* _node, RayCollisionData& _data) const
   else
   {
     Scalar tmin, tmax;
-    if ( _node->left_child_ && ACG::Geometry::axisAlignedBBIntersection( _data.ref, _data.ray, _node->left_child_->bb_min, _node->left_child_->bb_max, tmin, tmax)) {
-      _raycollision_directional(_node->left_child_, _data);
+    if ( _intersect_bb(node.leftChild(), _data, tmin, tmax) ) {
+      _raycollision_directional(node.leftChild(), _data);
     }
-    if ( _node->right_child_ && ACG::Geometry::axisAlignedBBIntersection( _data.ref, _data.ray, _node->right_child_->bb_min, _node->right_child_->bb_max, tmin, tmax)) {
-      _raycollision_directional(_node->right_child_, _data);
+    if ( _intersect_bb(node.rightChild(), _data, tmin, tmax) ) {
+      _raycollision_directional(node.rightChild(), _data);
     }
   }
 }
@@ -265,50 +467,63 @@ _raycollision_directional(Node* _node, RayCollisionData& _data) const
 template <class BSPCore>
 void
 BSPImplT<BSPCore>::
-_raycollision_nearest_directional(Node* _node, RayCollisionData& _data) const
+_raycollision_nearest_directional(int _node, RayCollisionData& _data) const
 {
+  const Node& node = this->treeData_[_node];
+
   // terminal node
-  if (!_node->left_child_)
+  if (node.isLeaf())
   {
     Scalar dist;
     Point v0, v1, v2;
     Scalar u, v;
 
-    for (HandleIter it=_node->begin(); it!=_node->end(); ++it)
+    for (const Handle *it=this->handleData_+node.first(), *end=it+node.size(); it!=end; ++it)
     {
       this->traits_.points(*it, v0, v1, v2);
       if (ACG::Geometry::triangleIntersection(_data.ref, _data.ray, v0, v1, v2, dist, u, v)) {
         if (dist > 0.0){
-          _data.hit_handles.push_back(std::pair<Handle,Scalar>(*it, dist));
+          // only keep the closest hit, ties are resolved by the smaller Handle::idx() so that the result does not depend on the traversal order
+          if (_data.hit_handles.empty())
+            _data.hit_handles.push_back(std::pair<Handle,Scalar>(*it, dist));
+          else if (dist < _data.hit_handles.front().second ||
+                   (dist == _data.hit_handles.front().second && it->idx() < _data.hit_handles.front().first.idx()))
+            _data.hit_handles.front() = std::pair<Handle,Scalar>(*it, dist);
         }
       }
     }
-		// only return the closest hit
-		if(!_data.hit_handles.empty()) {
-			std::partial_sort(_data.hit_handles.begin(), _data.hit_handles.begin() + 1, _data.hit_handles.end(), less_pair_second<Handle, Scalar>());
-			_data.hit_handles.resize(1);
-		}
   }
 
   // non-terminal node
   else
 	{
-		// determine order of traversal
-		Node* first_node = _node->left_child_, *second_node = _node->right_child_;
-		if (!_node->plane_(_data.ref)) {
+		// determine order of traversal by the entry distance into the child boxes
+		int first_node = node.leftChild(), second_node = node.rightChild();
+		Scalar first_tmin, second_tmin, tmax;
+		const bool first_hit  = _intersect_bb(first_node,  _data, first_tmin,  tmax);
+		const bool second_hit = _intersect_bb(second_node, _data, second_tmin, tmax);
+
+		if (!first_hit && !second_hit)
+			return;
+
+		if (!first_hit || (second_hit && second_tmin < first_tmin)) {
 			std::swap(first_node, second_node);
+			std::swap(first_tmin, second_tmin);
 		}
 
-		Scalar tmin, tmax;
-		if ( first_node && ACG::Geometry::axisAlignedBBIntersection( _data.ref, _data.ray, first_node->bb_min, first_node->bb_max, tmin, tmax) ) {
-			_raycollision_nearest_directional(first_node, _data);
-		}
-		// if the second node is further away than the closeset hit skip it
+		// if a node is further away than the closeset hit skip it
 		Scalar dist = ACG::NumLimitsT<Scalar>::max();
 		if(!_data.hit_handles.empty()) {
 			dist = _data.hit_handles.front().second;
 		}
-		if ( second_node && ACG::Geometry::axisAlignedBBIntersection( _data.ref, _data.ray, second_node->bb_min, second_node->bb_max, tmin, tmax) && (tmin < dist) ) {
+		if ( first_tmin <= dist ) {
+			_raycollision_nearest_directional(first_node, _data);
+
+			if(!_data.hit_handles.empty()) {
+				dist = _data.hit_handles.front().second;
+			}
+		}
+		if ( first_hit && second_hit && (second_tmin <= dist) ) {
 			_raycollision_nearest_directional(second_node, _data);
 		}
   }
@@ -316,16 +531,19 @@ _raycollision_nearest_directional(Node* _node, RayCollisionData& _data) const
 template<class BSPCore>
 template<class Callback>
 void BSPImplT<BSPCore>::
-_intersect_ball(const Node &_node,
+_intersect_ball(int _node,
                 const Point &_c,
                 Scalar _r,
                 Callback _callback) const
 {
+    const Node &node = this->treeData_[_node];
+    const double r_sqr = _r * _r;
+
     // terminal node
-    if (!_node.left_child_)
+    if (node.isLeaf())
     {
-        const double r_sqr = _r * _r;
-        for (const auto &fh: _node) {
+        for (unsigned int i = node.first(), end = node.first() + node.size(); i != end; ++i) {
+            const Handle &fh = this->handleData_[i];
             const double dist = this->traits_.sqrdist(fh, _c);
             if (dist < r_sqr) {
                 _callback(fh);
@@ -334,19 +552,363 @@ _intersect_ball(const Node &_node,
     }
     else // non-terminal node
     {
-        const Scalar dist = _node.plane_.distance(_c);
-        const Node &left = *_node.left_child_;
-        const Node &right = *_node.right_child_;
-
-        if (dist > -_r){
-            _intersect_ball(left, _c, _r, _callback);
+        if (this->treeData_[node.leftChild()].sqrdist(_c) < r_sqr){
+            _intersect_ball(node.leftChild(), _c, _r, _callback);
         }
-        if (dist < _r) {
-            _intersect_ball(right, _c, _r, _callback);
+        if (this->treeData_[node.rightChild()].sqrdist(_c) < r_sqr) {
+            _intersect_ball(node.rightChild(), _c, _r, _callback);
+        }
+    }
+}
+
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+raycollision(const Point* _p, const Point* _r, int _numRays, RayCollision* _collisions) const
+{
+  _raycollision_batch(_p, _r, _numRays, RAY_NON_DIRECTIONAL, _collisions, 0);
+}
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+directionalRaycollision(const Point* _p, const Point* _r, int _numRays, RayCollision* _collisions) const
+{
+  _raycollision_batch(_p, _r, _numRays, RAY_DIRECTIONAL, _collisions, 0);
+}
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+nearestRaycollision(const Point* _p, const Point* _r, int _numRays, RayHit* _hits) const
+{
+  _raycollision_batch(_p, _r, _numRays, RAY_NEAREST, 0, _hits);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+_raycollision_batch(const Point* _p, const Point* _r, int _numRays, RayMode _mode,
+                    RayCollision* _collisions, RayHit* _hits) const
+{
+  const int numPackets = (_numRays + 3) / 4;
+  const int numThreads = this->getNumWorkerThreads();
+
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(numThreads) if (numThreads > 1 && numPackets > 16)
+#endif
+  {
+    // traversal stack, allocated once per thread
+    PacketStack stack;
+
+#ifdef USE_OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+    for (int i = 0; i < numPackets; ++i)
+    {
+      const int first = 4 * i;
+
+      _raycollision_packet(_p + first, _r + first, std::min(4, _numRays - first), _mode,
+                           _collisions ? _collisions + first : 0, _hits ? _hits + first : 0, stack, PacketSupport());
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+_raycollision_packet(const Point* _p, const Point* _r, int _numRays, RayMode _mode,
+                     RayCollision* _collisions, RayHit* _hits, PacketStack& /*_stack*/, std::false_type) const
+{
+  for (int i = 0; i < _numRays; ++i)
+  {
+    switch (_mode)
+    {
+      case RAY_NON_DIRECTIONAL: _collisions[i] = raycollision(_p[i], _r[i]); break;
+      case RAY_DIRECTIONAL:     _collisions[i] = directionalRaycollision(_p[i], _r[i]); break;
+      case RAY_NEAREST:
+      {
+        const RayCollision hit = nearestRaycollision(_p[i], _r[i]);
+        _hits[i] = hit.empty() ? RayHit(Handle(), infinity_) : RayHit(hit.front().first, hit.front().second);
+      } break;
+    }
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+#ifdef BSPIMPLT_SSE
+
+template <class BSPCore>
+void
+BSPImplT<BSPCore>::
+_raycollision_packet(const Point* _p, const Point* _r, int _numRays, RayMode _mode,
+                     RayCollision* _collisions, RayHit* _hits, PacketStack& _stack, std::true_type) const
+{
+  // rays in structure of arrays layout, unused lanes repeat the first ray and are masked out
+  float o[3][4], d[3][4];
+  for (int i = 0; i < 4; ++i)
+  {
+    const int k = i < _numRays ? i : 0;
+    for (int c = 0; c < 3; ++c)
+    {
+      o[c][i] = _p[k][c];
+      d[c][i] = _r[k][c];
+    }
+  }
+
+  __m128 origin[3], dir[3], invDir[3], dirPositive[3];
+  for (int c = 0; c < 3; ++c)
+  {
+    origin[c]      = _mm_loadu_ps(o[c]);
+    dir[c]         = _mm_loadu_ps(d[c]);
+    invDir[c]      = _mm_div_ps(_mm_set1_ps(1.0f), dir[c]);
+    dirPositive[c] = _mm_cmpge_ps(invDir[c], _mm_setzero_ps());
+  }
+
+  // closest hit of each ray for RAY_NEAREST, same start value as in _raycollision_nearest_directional()
+  float  bestDist[4];
+  bool   bestValid[4];
+  Handle bestHandle[4];
+  for (int i = 0; i < 4; ++i)
+  {
+    bestDist[i]  = ACG::NumLimitsT<float>::max();
+    bestValid[i] = false;
+  }
+  __m128 best = _mm_loadu_ps(bestDist);
+
+  if (_collisions)
+    for (int i = 0; i < _numRays; ++i)
+      _collisions[i].clear();
+
+  // traversal stack with the active rays and their entry distance of each node
+  _stack.clear();
+
+  PacketStackEntry root;
+  root.node = 0;
+  root.mask = (1 << _numRays) - 1;
+  _mm_storeu_ps(root.tmin, _mm_set1_ps(-std::numeric_limits<float>::infinity()));
+
+  if (this->treeSize_ != 0)
+    _stack.push_back(root);
+
+  while (!_stack.empty())
+  {
+    const PacketStackEntry entry = _stack.back();
+    _stack.pop_back();
+
+    int mask = entry.mask;
+
+    // skip rays that already have a closer hit
+    if (_mode == RAY_NEAREST)
+      mask &= _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(entry.tmin), best));
+
+    if (!mask)
+      continue;
+
+    const Node& node = this->treeData_[entry.node];
+
+    // terminal node
+    if (node.isLeaf())
+    {
+      Point v0, v1, v2;
+
+      for (unsigned int i = node.first(), end = node.first() + node.size(); i != end; ++i)
+      {
+        const Handle& h = this->handleData_[i];
+        this->traits_.points(h, v0, v1, v2);
+
+        __m128 t;
+        const int hit = _intersect_triangle_packet(origin, dir, v0, v1, v2, t) & mask;
+
+        if (!hit)
+          continue;
+
+        float dist[4];
+        _mm_storeu_ps(dist, t);
+
+        for (int k = 0; k < 4; ++k)
+        {
+          if (!(hit & (1 << k)))
+            continue;
+
+          if (_mode == RAY_NON_DIRECTIONAL)
+            _collisions[k].push_back(std::pair<Handle,Scalar>(h, dist[k]));
+          else if (dist[k] > 0.0)
+          {
+            if (_mode == RAY_DIRECTIONAL)
+              _collisions[k].push_back(std::pair<Handle,Scalar>(h, dist[k]));
+            else if (!bestValid[k] || dist[k] < bestDist[k] || (dist[k] == bestDist[k] && h.idx() < bestHandle[k].idx()))
+            {
+              bestDist[k]   = dist[k];
+              bestValid[k]  = true;
+              bestHandle[k] = h;
+            }
+          }
         }
+      }
+
+      best = _mm_loadu_ps(bestDist);
     }
+
+    // non-terminal node
+    else
+    {
+      PacketStackEntry left, right;
+      left.node  = node.leftChild();
+      right.node = node.rightChild();
+
+      __m128 tminLeft, tminRight;
+      left.mask  = mask & _intersect_bb_packet(this->treeData_[left.node],  origin, invDir, dirPositive, tminLeft);
+      right.mask = mask & _intersect_bb_packet(this->treeData_[right.node], origin, invDir, dirPositive, tminRight);
+
+      _mm_storeu_ps(left.tmin,  tminLeft);
+      _mm_storeu_ps(right.tmin, tminRight);
+
+      // the left child is visited first, as in the single ray traversal
+      bool leftFirst = true;
+
+      // closer child first, decided by the first ray that enters both
+      if (_mode == RAY_NEAREST && (left.mask & right.mask))
+      {
+        int k = 0;
+        while (!((left.mask & right.mask) & (1 << k)))
+          ++k;
+        leftFirst = !(right.tmin[k] < left.tmin[k]);
+      }
+
+      const PacketStackEntry& first  = leftFirst ? left  : right;
+      const PacketStackEntry& second = leftFirst ? right : left;
+
+      if (second.mask)
+        _stack.push_back(second);
+      if (first.mask)
+        _stack.push_back(first);
+    }
+  }
+
+  // results
+  if (_collisions)
+  {
+    for (int i = 0; i < _numRays; ++i)
+      if (_mode != RAY_NEAREST)
+        std::sort(_collisions[i].begin(), _collisions[i].end(), less_pair_second<Handle,Scalar>());
+  }
+
+  if (_hits)
+  {
+    for (int i = 0; i < _numRays; ++i)
+      _hits[i] = !bestValid[i] ? RayHit(Handle(), infinity_) : RayHit(bestHandle[i], bestDist[i]);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+int
+BSPImplT<BSPCore>::
+_intersect_bb_packet(const Node& _node, const __m128 _o[3], const __m128 _invDir[3],
+                     const __m128 _dirPositive[3], __m128& _tmin)
+{
+  // same operations as axisAlignedBBIntersection(), equal results up to FMA contraction of the scalar code
+  __m128 tmin = _mm_setzero_ps(), tmax = _mm_setzero_ps(), miss = _mm_setzero_ps();
+
+  for (int c = 0; c < 3; ++c)
+  {
+    const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bb_min_[c]), _o[c]), _invDir[c]);
+    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(_node.bb_max_[c]), _o[c]), _invDir[c]);
+
+    const __m128 cmin = _mm_or_ps(_mm_and_ps(_dirPositive[c], t0), _mm_andnot_ps(_dirPositive[c], t1));
+    const __m128 cmax = _mm_or_ps(_mm_and_ps(_dirPositive[c], t1), _mm_andnot_ps(_dirPositive[c], t0));
+
+    if (c == 0)
+    {
+      tmin = cmin;
+      tmax = cmax;
+    }
+    else
+    {
+      miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(tmin, cmax), _mm_cmpgt_ps(cmin, tmax)));
+
+      // _mm_max_ps(a, b) is (a > b ? a : b), which matches the scalar comparisons including NaNs
+      tmin = _mm_max_ps(cmin, tmin);
+      tmax = _mm_min_ps(cmax, tmax);
+    }
+  }
+
+  _tmin = tmin;
+  return ~_mm_movemask_ps(miss) & 0xF;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPCore>
+int
+BSPImplT<BSPCore>::
+_intersect_triangle_packet(const __m128 _o[3], const __m128 _dir[3],
+                           const Point& _v0, const Point& _v1, const Point& _v2, __m128& _t)
+{
+  // same operations as triangleIntersection(), equal results up to FMA contraction of either code
+  const Point edge1 = _v1 - _v0, edge2 = _v2 - _v0;
+
+  const __m128 e1[3] = { _mm_set1_ps(edge1[0]), _mm_set1_ps(edge1[1]), _mm_set1_ps(edge1[2]) };
+  const __m128 e2[3] = { _mm_set1_ps(edge2[0]), _mm_set1_ps(edge2[1]), _mm_set1_ps(edge2[2]) };
+
+  // pvec = dir % edge2
+  const __m128 pvec[3] = {
+    _mm_sub_ps(_mm_mul_ps(_dir[1], e2[2]), _mm_mul_ps(_dir[2], e2[1])),
+    _mm_sub_ps(_mm_mul_ps(_dir[2], e2[0]), _mm_mul_ps(_dir[0], e2[2])),
+    _mm_sub_ps(_mm_mul_ps(_dir[0], e2[1]), _mm_mul_ps(_dir[1], e2[0])) };
+
+  const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1[0], pvec[0]), _mm_mul_ps(e1[1], pvec[1])), _mm_mul_ps(e1[2], pvec[2]));
+
+  const float epsilon = float(std::numeric_limits<float>::epsilon() * 1e2);
+  __m128 miss = _mm_and_ps(_mm_cmpgt_ps(det, _mm_set1_ps(-epsilon)), _mm_cmplt_ps(det, _mm_set1_ps(epsilon)));
+
+  const __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+  // tvec = o - v0
+  const __m128 tvec[3] = {
+    _mm_sub_ps(_o[0], _mm_set1_ps(_v0[0])),
+    _mm_sub_ps(_o[1], _mm_set1_ps(_v0[1])),
+    _mm_sub_ps(_o[2], _mm_set1_ps(_v0[2])) };
+
+  const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tvec[0], pvec[0]), _mm_mul_ps(tvec[1], pvec[1])), _mm_mul_ps(tvec[2], pvec[2])), inv_det);
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(u, _mm_setzero_ps()), _mm_cmpgt_ps(u, _mm_set1_ps(1.0f))));
+
+  // qvec = tvec % edge1
+  const __m128 qvec[3] = {
+    _mm_sub_ps(_mm_mul_ps(tvec[1], e1[2]), _mm_mul_ps(tvec[2], e1[1])),
+    _mm_sub_ps(_mm_mul_ps(tvec[2], e1[0]), _mm_mul_ps(tvec[0], e1[2])),
+    _mm_sub_ps(_mm_mul_ps(tvec[0], e1[1]), _mm_mul_ps(tvec[1], e1[0])) };
+
+  const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_dir[0], qvec[0]), _mm_mul_ps(_dir[1], qvec[1])), _mm_mul_ps(_dir[2], qvec[2])), inv_det);
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(v, _mm_setzero_ps()), _mm_cmpgt_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f))));
+
+  _t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2[0], qvec[0]), _mm_mul_ps(e2[1], qvec[1])), _mm_mul_ps(e2[2], qvec[2])), inv_det);
+
+  return ~_mm_movemask_ps(miss) & 0xF;
 }
 
+#endif // BSPIMPLT_SSE
 
 //=============================================================================
 
@@ -41,9 +41,10 @@
 
 
 
+
 //=============================================================================
 //
-//  CLASS TreeNode
+//  CLASS BSPTreeNode
 //
 //=============================================================================
 
@@ -52,160 +53,140 @@
 
 //== INCLUDES =================================================================
 
-#include <ACG/Geometry/Types/PlaneT.hh>
-#include <ACG/Geometry/Algorithms.hh>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <ostream>
 
 //== CLASS DEFINITION =========================================================
 
-// Node of the tree: contains parent, children and splitting plane
-template <class BSPTraits>
-struct TreeNode
+/** \brief Node of the flattened tree
+ *
+ * All nodes of a tree are stored in one contiguous array with the root at index 0.
+ * Both children of an inner node are stored next to each other, so that a traversal
+ * step loads both child bounding boxes from the same cache line.
+ * Leaves reference a range of the handle array that is shared by all leaves.
+ *
+ * The bounding box is stored in single precision and rounded outwards,
+ * so it is conservative for double precision meshes as well.
+ */
+struct BSPTreeNode
 {
-    typedef typename BSPTraits::Handle       Handle;
-    typedef typename BSPTraits::Point        Point;
-    typedef typename BSPTraits::VertexHandle VertexHandle;
-    typedef std::vector<Handle>              Handles;
-    typedef typename Handles::iterator       HandleIter;
-    typedef typename Handles::const_iterator HandleConstIter;
-    typedef typename Point::value_type       Scalar;
-    typedef ACG::Geometry::PlaneT<Scalar>    Plane;
-
-    TreeNode(const Handles& _handles, TreeNode* _parent)
-            : handles_(_handles),
-            parent_(_parent), left_child_(0), right_child_(0) {}
-    ~TreeNode()
+    BSPTreeNode() : first_(0), count_(0)
     {
-        delete left_child_;
-        delete right_child_;
-
-        if (parent_)
-        {
-            if (this == parent_->left_child_)
-                parent_->left_child_ = 0;
-            else
-                parent_->right_child_ = 0;
-        }
+      bb_min_[0] = bb_min_[1] = bb_min_[2] = std::numeric_limits<float>::infinity();
+      bb_max_[0] = bb_max_[1] = bb_max_[2] = -std::numeric_limits<float>::infinity();
     }
 
-    HandleIter begin() {
-        return handles_.begin();
-    }
+    /// Is this a leaf node? (an inner node never references the root as child, so first_ == 0 marks the empty root leaf)
+    bool isLeaf() const { return count_ != 0 || first_ == 0; }
 
-    HandleIter end()   {
-        return handles_.end();
-    }
+    /// Index of the left child of an inner node, the right child is stored at leftChild()+1
+    unsigned int leftChild() const { return first_; }
+
+    /// Index of the right child of an inner node
+    unsigned int rightChild() const { return first_ + 1; }
+
+    /// Offset of the first handle of a leaf in the shared handle array
+    unsigned int first() const { return first_; }
 
-    HandleConstIter begin() const {
-        return handles_.begin();
+    /// Number of handles of a leaf
+    unsigned int size() const { return count_; }
+
+    /// Turn this node into a leaf with handles [_first, _first + _count)
+    void setLeaf(unsigned int _first, unsigned int _count) { first_ = _first; count_ = _count; }
+
+    /// Turn this node into an inner node, the children are stored at [_leftChild, _leftChild + 1]
+    void setChildren(unsigned int _leftChild) { first_ = _leftChild; count_ = 0; }
+
+    /// Store a conservative single precision bounding box
+    template <class Point>
+    void setBoundingBox(const Point& _bb_min, const Point& _bb_max)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        bb_min_[i] = roundDown(_bb_min[i]);
+        bb_max_[i] = roundUp(_bb_max[i]);
+      }
     }
 
-    HandleConstIter end() const {
-        return handles_.end();
+    /// Store the union of the bounding boxes of two nodes (already conservative, no rounding needed)
+    void mergeBoundingBoxes(const BSPTreeNode& _a, const BSPTreeNode& _b)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        bb_min_[i] = std::min(_a.bb_min_[i], _b.bb_min_[i]);
+        bb_max_[i] = std::max(_a.bb_max_[i], _b.bb_max_[i]);
+      }
     }
 
-    size_t size() const {
-        return handles_.size();
+    /// Minimum corner of the bounding box
+    template <class Point>
+    Point bb_min() const { return Point(bb_min_[0], bb_min_[1], bb_min_[2]); }
+
+    /// Maximum corner of the bounding box
+    template <class Point>
+    Point bb_max() const { return Point(bb_max_[0], bb_max_[1], bb_max_[2]); }
+
+    /// Squared distance of _p to the bounding box, 0 for points inside
+    template <class Point>
+    typename Point::value_type sqrdist(const Point& _p) const
+    {
+      typedef typename Point::value_type Scalar;
+      Scalar d(0);
+      for (int i = 0; i < 3; ++i)
+      {
+        Scalar e(0);
+        if (_p[i] < bb_min_[i])
+          e = Scalar(bb_min_[i]) - _p[i];
+        else if (_p[i] > bb_max_[i])
+          e = _p[i] - Scalar(bb_max_[i]);
+        d += e * e;
+      }
+      return d;
     }
 
-    Handles     handles_;
-    TreeNode    *parent_, *left_child_, *right_child_;
-    Plane       plane_;
-    Point	bb_min, bb_max;
-    
-    /// This visualizes the bounding boxes
-    template< typename MeshT >
-    void visualizeTree(MeshT *_object, int _max_depth)
+    /// Half of the surface area of the bounding box
+    float halfArea() const
     {
-        if (_max_depth > 0 && (left_child_ || right_child_) )
-        {
-            if (left_child_)
-                left_child_->visualizeTree(_object, _max_depth-1);
-            if (right_child_)
-                right_child_->visualizeTree(_object, _max_depth-1);
-        }
-        else
-        {
-            Point size_ = bb_max - bb_min;
-
-            std::vector<VertexHandle> vhandle(8);
-            vhandle[0] = _object->add_vertex(bb_min+Point(0.0,0.0,size_[2]));
-            vhandle[1] = _object->add_vertex(bb_min+Point(size_[0],0.0,size_[2]));
-            vhandle[2] = _object->add_vertex(bb_min+Point(size_[0],size_[1],size_[2]));
-            vhandle[3] = _object->add_vertex(bb_min+Point(0.0,size_[1],size_[2]));
-            vhandle[4] = _object->add_vertex(bb_min+Point(0.0,0.0,0.0));
-            vhandle[5] = _object->add_vertex(bb_min+Point(size_[0],0.0,0.0));
-            vhandle[6] = _object->add_vertex(bb_min+Point(size_[0],size_[1],0.0));
-            vhandle[7] = _object->add_vertex(bb_min+Point(0.0,size_[1],0.0));
-
-
-            // generate (quadrilateral) faces
-            std::vector<VertexHandle>  face_vhandles;
-
-            face_vhandles.clear();
-            face_vhandles.push_back(vhandle[0]);
-            face_vhandles.push_back(vhandle[1]);
-            face_vhandles.push_back(vhandle[2]);
-            face_vhandles.push_back(vhandle[3]);
-            _object->add_face(face_vhandles);
-
-            face_vhandles.clear();
-            face_vhandles.push_back(vhandle[7]);
-            face_vhandles.push_back(vhandle[6]);
-            face_vhandles.push_back(vhandle[5]);
-            face_vhandles.push_back(vhandle[4]);
-            _object->add_face(face_vhandles);
-
-            face_vhandles.clear();
-            face_vhandles.push_back(vhandle[1]);
-            face_vhandles.push_back(vhandle[0]);
-            face_vhandles.push_back(vhandle[4]);
-            face_vhandles.push_back(vhandle[5]);
-            _object->add_face(face_vhandles);
-
-            face_vhandles.clear();
-            face_vhandles.push_back(vhandle[2]);
-            face_vhandles.push_back(vhandle[1]);
-            face_vhandles.push_back(vhandle[5]);
-            face_vhandles.push_back(vhandle[6]);
-            _object->add_face(face_vhandles);
-
-            face_vhandles.clear();
-            face_vhandles.push_back(vhandle[3]);
-            face_vhandles.push_back(vhandle[2]);
-            face_vhandles.push_back(vhandle[6]);
-            face_vhandles.push_back(vhandle[7]);
-            _object->add_face(face_vhandles);
-
-            face_vhandles.clear();
-            face_vhandles.push_back(vhandle[0]);
-            face_vhandles.push_back(vhandle[3]);
-            face_vhandles.push_back(vhandle[7]);
-            face_vhandles.push_back(vhandle[4]);
-            _object->add_face(face_vhandles);
-        }
+      const float dx = bb_max_[0] - bb_min_[0], dy = bb_max_[1] - bb_min_[1], dz = bb_max_[2] - bb_min_[2];
+      return dx * dy + dy * dz + dz * dx;
     }
 
-    private:
-    /*
-     * Noncopyable because of root_.
-     */
-    TreeNode(const TreeNode &rhs);
-    TreeNode &operator=(const TreeNode &rhs);
+    float        bb_min_[3];
+    unsigned int first_;    // leaf: offset into the handle array, inner node: index of left child
+    float        bb_max_[3];
+    unsigned int count_;    // leaf: number of handles, inner node: 0
 
-};
+private:
+
+    template <class Scalar>
+    static float roundDown(Scalar _x)
+    {
+      float f = float(_x);
+      if (Scalar(f) > _x)
+        f = std::nextafter(f, -std::numeric_limits<float>::infinity());
+      return f;
+    }
 
-template<class BSPTraits>
-std::ostream &operator<< (std::ostream &stream, const TreeNode<BSPTraits> &node) {
-    stream << "[TreeNode instance. Handles: ";
-    for (typename TreeNode<BSPTraits>::Handles::const_iterator it = node.handles_.begin(), it_end = node.handles_.end();
-            it != it_end; ++it) {
-        stream << it->idx();
-        if (it < it_end-1) stream << ", ";
+    template <class Scalar>
+    static float roundUp(Scalar _x)
+    {
+      float f = float(_x);
+      if (Scalar(f) < _x)
+        f = std::nextafter(f, std::numeric_limits<float>::infinity());
+      return f;
     }
-    stream << ", parent: " << node.parent_ << ", left_child_: " << node.left_child_
-            << ", right_child_: " << node.right_child_ << ", plane_: <not implemented>, bb_min: "
-            << node.bb_min << ", bb_max: " << node.bb_max << ", size(): " << node.size() << "]";
+};
+
+inline std::ostream &operator<< (std::ostream &stream, const BSPTreeNode &node) {
+    stream << "[BSPTreeNode instance. ";
+    if (node.isLeaf())
+      stream << "Handles: [" << node.first() << ", " << node.first() + node.size() << ")";
+    else
+      stream << "left_child_: " << node.leftChild() << ", right_child_: " << node.rightChild();
+    stream << ", bb_min: " << node.bb_min_[0] << " " << node.bb_min_[1] << " " << node.bb_min_[2]
+           << ", bb_max: " << node.bb_max_[0] << " " << node.bb_max_[1] << " " << node.bb_max_[2] << "]";
     return stream;
 }
 
@@ -54,15 +54,37 @@
 
 
 #include <vector>
+#include <string>
 #include <ACG/Geometry/Types/PlaneT.hh>
 #include <OpenMesh/Core/Geometry/VectorT.hh>
 
+#include "BSPTreeNode.hh"
+#include "BSPCacheFile.hh"
 #include "TriangleBSPT.hh"
 
 
 //== CLASS DEFINITION =========================================================
 
 
+/** \brief Bounding volume hierarchy over triangles
+ *
+ * build() splits the triangles with a binned surface area heuristic (SAH).
+ * Each triangle is referenced by exactly one leaf. The nodes are stored in one
+ * contiguous array of 32 byte BSPTreeNode's, and the leaves reference ranges of
+ * a single shared handle array.
+ *
+ * Built trees can be stored in cache files with buildCached(). A cached tree is
+ * memory mapped and queried in place.
+ *
+ * Requirements on BSPTraits:
+ * - typedefs Point and Handle
+ * - traits_.points(Handle, Point&, Point&, Point&) returns the triangle corners
+ * - traits_.sqrdist(Handle, Point) returns the squared distance to the triangle
+ * - Handle::idx() returns an integer that is unique per triangle, like the OpenMesh
+ *   and OpenVolumeMesh handles. The queries of BSPImplT break ties between equal
+ *   distances by the smaller idx(), so that the results do not depend on the
+ *   traversal order or the number of threads.
+ */
 template <class BSPTraits>
 class TriangleBSPCoreT
 {
@@ -71,11 +93,12 @@ public: //---------------------------------------------------------------------
   typedef BSPTraits                      Traits;
   typedef typename BSPTraits::Point      Point;
   typedef typename BSPTraits::Handle     Handle;
-  typedef typename BSPTraits::Node	     Node;
+  typedef BSPTreeNode                    Node;
   typedef typename Point::value_type     Scalar;
   typedef ACG::Geometry::PlaneT<Scalar>  Plane;
   typedef std::vector<Handle>            Handles;
   typedef typename Handles::iterator     HandleIter;
+  typedef std::vector<Node>              Nodes;
 
 
 public: //---------------------------------------------------------------------
@@ -83,18 +106,17 @@ public: //---------------------------------------------------------------------
 
   /** Constructor: need traits that define the types and 
       give us the points by traits_.point(PointHandle) */
-  explicit TriangleBSPCoreT(const BSPTraits& _traits) : traits_(_traits), root_(0), nodes(0), n_triangles(0) {}
+  explicit TriangleBSPCoreT(const BSPTraits& _traits) : traits_(_traits), nodes(0), n_triangles(0), numThreads_(0), builtCost_(0),
+                                                       treeData_(0), handleData_(0), treeSize_(0) {}
 
   /// Destructor
-  ~TriangleBSPCoreT() {
-      delete root_;
-  }
+  ~TriangleBSPCoreT() {}
 
 
   /// Reserve memory for _n entries
-  void reserve(size_t _n) { handles_.reserve(_n); }
+  void reserve(size_t _n) { handles_.reserve(_n); _updateData(); }
   /// Add a handle to the BSP
-  void push_back(Handle _h)     { handles_.push_back(_h); ++n_triangles; }
+  void push_back(Handle _h)     { handles_.push_back(_h); ++n_triangles; _updateData(); }
 
   /**
    * @return size() == 0
@@ -108,11 +130,76 @@ public: //---------------------------------------------------------------------
 
   /** Build the tree.
    *
-   * @param _max_handles Maximum number of vertices per leaf.
+   * Inner nodes are split at the cheapest of 16 bins per axis according to the surface area heuristic.
+   * Nodes with more than _max_handles triangles are always split, unless _max_depth is reached.
+   *
+   * With OpenMP, the split statistics of the top levels are computed in parallel and the
+   * remaining subtrees are built concurrently. The resulting tree does not depend on the number of threads.
+   *
+   * @param _max_handles Maximum number of triangles per leaf.
    * @param _max_depth   Maximum depth.
    */
   void build(unsigned int _max_handles, unsigned int _max_depth);
 
+  /** \brief Update the bounding boxes to the current positions of the triangles
+   *
+   * Use this instead of build() if the mesh was deformed without changing its topology. The tree
+   * structure is kept, the leaf boxes are recomputed in parallel and the inner boxes bottom-up.
+   * Queries return correct results afterwards, but become slower the more the triangles moved
+   * relative to each other, see refitDegradation().
+   *
+   * A tree loaded from a cache file is copied to memory first.
+   */
+  void refit();
+
+  /** \brief Surface area heuristic cost of the tree
+   *
+   * Expected number of visited nodes and tested triangles of a random ray, that is the sum of the
+   * surface areas of the inner nodes plus the areas of the leaves times their number of triangles,
+   * relative to the area of the root.
+   */
+  Scalar sahCost() const;
+
+  /** \brief Quality of a refitted tree compared to a rebuild
+   *
+   * @return sahCost() divided by the cost right after the last build(), 1 for a freshly built tree.
+   *         A rebuild usually pays off if this exceeds about 1.5. Deformations that flatten the
+   *         mesh can also lower the value below 1.
+   */
+  Scalar refitDegradation() const { return builtCost_ > Scalar(0) ? sahCost() / builtCost_ : Scalar(1); }
+
+  /** \brief Build the tree or load it from a cache file
+   *
+   * If _filename contains a tree built from the same triangles with the same parameters, the file
+   * is memory mapped and the tree is queried in place. The mapping is released by the destructor
+   * or the next build(). Otherwise the tree is built and written to _filename. Failing to write the
+   * cache file is not an error, the built tree is used anyway.
+   *
+   * Cache files are only valid on the same platform and for the same handle and point types.
+   *
+   * @param _filename    Cache file
+   * @param _max_handles Maximum number of triangles per leaf, see build()
+   * @param _max_depth   Maximum depth, see build()
+   * @return true if the tree was loaded from the cache file
+   */
+  bool buildCached(const std::string& _filename, unsigned int _max_handles, unsigned int _max_depth);
+
+  /** \brief Key of the cache file for the current triangles and the given build parameters
+   *
+   * The key hashes the handles with the positions of their triangles, the build parameters and the
+   * memory layout. It does not depend on the order in which the handles were added.
+   */
+  uint64_t cacheKey(unsigned int _max_handles, unsigned int _max_depth) const;
+
+  /** \brief Set number of worker threads used by build() and batched queries
+   *
+   * @param _numThreads 0 uses all available OpenMP threads, 1 disables multi-threading
+   */
+  void setNumThreads(int _numThreads) { numThreads_ = _numThreads; }
+
+  /// Number of nodes of the tree
+  size_t numNodes() const { return treeSize_; }
+
     /** \brief Create a PolyMesh object that visualizes the bounding boxes of the BSP tree
      *
      * @param _object     The output mesh which the tree will be written into
@@ -121,13 +208,14 @@ public: //---------------------------------------------------------------------
   template <typename MeshT>
   void visualizeTree(MeshT *_object, int _max_depth)
   {
-    root_->visualizeTree(_object, _max_depth-1);
+    if (treeSize_ != 0)
+      _visualizeTree(_object, 0, _max_depth-1);
     _object->update_normals();
   }
 
 private:
   /*
-   * Noncopyable because of root_.
+   * Noncopyable because of the traits' mesh reference.
    */
   TriangleBSPCoreT(const TriangleBSPCoreT &rhs);
   TriangleBSPCoreT &operator=(const TriangleBSPCoreT &rhs);
@@ -135,23 +223,90 @@ private:
 
 private: //---------------------------------------------------------------------
 
+  // Per triangle data used during build()
+  struct BuildData
+  {
+    std::vector<Point> bb_min, bb_max, centroid;
+    std::vector<int>   triangles;   // permutation of the handles, leaves are ranges of it
+    unsigned int       max_handles;
+  };
+
+  // Subtree whose construction is deferred to a worker thread
+  struct BuildTask
+  {
+    int          node;
+    int          begin, end;
+    unsigned int depth;
+  };
+
+  // Recursive part of build(). Builds the subtree of triangles [_begin, _end) into _tree[_node].
+  // If _tasks is given, subtrees smaller than ParallelSubtreeSize are deferred to it.
+  void _build(BuildData&              _data,
+              Nodes&                  _tree,
+              int                     _node,
+              int                     _begin,
+              int                     _end,
+              unsigned int            _depth,
+              int                     _numThreads,
+              std::vector<BuildTask>* _tasks);
+
+  // Bounding box of triangles and their centroids in [_begin, _end)
+  void _bounds(const BuildData& _data, int _begin, int _end, int _numThreads,
+               Point& _bb_min, Point& _bb_max, Point& _c_min, Point& _c_max) const;
+
+  // Select the split by binned SAH, returns the split position in [_begin, _end)
+  int _split(BuildData& _data, int _begin, int _end, int _numThreads,
+             const Point& _c_min, const Point& _c_max) const;
+
+  // Check the tree of the mapped cache file: all nodes form one tree of at most _max_depth levels,
+  //  leaves reference valid handle ranges and the cached handles are the ones of this tree
+  bool _validCache(unsigned int _max_depth) const;
+
+  // Point treeData_ and handleData_ to tree_ and handles_, unless a cache file is mapped
+  void _updateData()
+  {
+    if (!cache_.isMapped())
+    {
+      treeData_   = tree_.empty()    ? 0 : &tree_[0];
+      handleData_ = handles_.empty() ? 0 : &handles_[0];
+      treeSize_   = tree_.size();
+    }
+  }
+
+  // Recursive part of visualizeTree()
+  template <typename MeshT>
+  void _visualizeTree(MeshT *_object, int _node, int _max_depth);
 
-  // Recursive part of build()
-  void _build(Node*        _node,
-	      unsigned int _max_handles, 
-	      unsigned int _depth);
+  // Subtrees smaller than this are built by a single thread
+  static const int ParallelSubtreeSize = 4096;
 
+  // Nodes with fewer triangles compute their statistics on a single thread
+  static const int ParallelStatsSize = 16384;
 
+  // Number of SAH bins per axis
+  static const int SAHBins = 16;
 
 
 protected: //-------------------------------------------------------------------
 
+  // Number of threads used by build() and batched queries
+  int getNumWorkerThreads() const;
+
 
   BSPTraits  traits_;
-  Handles    handles_;
-  Node*      root_;
+  Handles    handles_;   // after build(), sorted such that each leaf references a range
+  Nodes      tree_;      // root is tree_[0]
   int	       nodes, n_triangles;
-  
+  int        numThreads_;
+  Scalar     builtCost_;  // sahCost() after build()
+
+  // Arrays used by the queries, either tree_ and handles_ or the mapped cache file
+  const Node*   treeData_;
+  const Handle* handleData_;
+  size_t        treeSize_;
+
+  ACG::BSPCacheFile cache_;
+
 };
 
 
@@ -54,6 +54,14 @@
 
 #include "TriangleBSPCoreT.hh"
 
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 
 //== CLASS DEFINITION =========================================================
 
@@ -63,17 +71,86 @@ TriangleBSPCoreT<BSPTraits>::
 build(unsigned int _max_handles, unsigned int _max_depth)
 {
   // init
-  delete root_;
-  root_ = new Node(handles_, 0);
+  cache_.unmap();
+  tree_.clear();
+
+  const int numTriangles = int(handles_.size());
+  const int numThreads   = getNumWorkerThreads();
+
+  BuildData data;
+  data.bb_min.resize(numTriangles);
+  data.bb_max.resize(numTriangles);
+  data.centroid.resize(numTriangles);
+  data.triangles.resize(numTriangles);
+  data.max_handles = std::max(_max_handles, 1u);
+
+  // bounding box and centroid of each triangle
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 1024) num_threads(numThreads) if (numThreads > 1 && numTriangles > ParallelStatsSize)
+#endif
+  for (int i = 0; i < numTriangles; ++i)
+  {
+    Point p0, p1, p2;
+    traits_.points(handles_[i], p0, p1, p2);
+
+    data.bb_min[i] = p0;
+    data.bb_min[i].minimize(p1);
+    data.bb_min[i].minimize(p2);
+    data.bb_max[i] = p0;
+    data.bb_max[i].maximize(p1);
+    data.bb_max[i].maximize(p2);
+    data.centroid[i] = (data.bb_min[i] + data.bb_max[i]) * Scalar(0.5);
+    data.triangles[i] = i;
+  }
+
+  // split the top levels with parallel statistics and collect the remaining subtrees
+  std::vector<BuildTask> tasks;
 
-  // delete own handles (don't store them twice)
-  handles_ = Handles();
+  tree_.reserve(2 * (numTriangles / data.max_handles) + 1);
+  tree_.push_back(Node());
+  _build(data, tree_, 0, 0, numTriangles, _max_depth, numThreads, &tasks);
 
-  nodes=1;
-  traits_.calculateBoundingBoxRoot (root_);
-  // call recursive helper
-  _build(root_, _max_handles, _max_depth);
-  
+  // subtrees are disjoint ranges of the triangles, so they can be built concurrently
+  const int numTasks = int(tasks.size());
+  std::vector<Nodes> subtrees(numTasks);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads) if (numThreads > 1 && numTasks > 1)
+#endif
+  for (int i = 0; i < numTasks; ++i)
+  {
+    subtrees[i].push_back(Node());
+    _build(data, subtrees[i], 0, tasks[i].begin, tasks[i].end, tasks[i].depth, 1, 0);
+  }
+
+  // append the subtrees in task order, so the layout does not depend on the schedule
+  for (int i = 0; i < numTasks; ++i)
+  {
+    Nodes& subtree = subtrees[i];
+
+    // local node 1 is stored at tree_.size()
+    const unsigned int offset = (unsigned int)tree_.size() - 1;
+
+    for (size_t k = 0; k < subtree.size(); ++k)
+      if (!subtree[k].isLeaf())
+        subtree[k].setChildren(subtree[k].leftChild() + offset);
+
+    tree_[tasks[i].node] = subtree[0];
+    tree_.insert(tree_.end(), subtree.begin() + 1, subtree.end());
+
+    Nodes().swap(subtree);
+  }
+
+  // sort handles by leaves
+  Handles sorted(numTriangles);
+  for (int i = 0; i < numTriangles; ++i)
+    sorted[i] = handles_[data.triangles[i]];
+  handles_.swap(sorted);
+
+  nodes = int(tree_.size());
+  _updateData();
+
+  builtCost_ = sahCost();
 }
 
 
@@ -83,88 +160,533 @@ build(unsigned int _max_handles, unsigned int _max_depth)
 template <class BSPTraits>
 void
 TriangleBSPCoreT<BSPTraits>::
-_build(Node*         _node,
-       unsigned int  _max_handles, 
-       unsigned int  _depth)
+refit()
 {
-  // should we stop at this level ?
-  if ((_depth == 0) || ((_node->end()-_node->begin()) <= (int)_max_handles))
-    return;
-  
-  Point median;
-  int axis;
-  // compute bounding boxes for children
-  traits_.calculateBoundingBox (_node, median, axis);
-  
-  // construct splitting plane
-  const Point XYZ[3] = { Point(1,0,0), Point(0,1,0), Point(0,0,1) };
-  _node->plane_ = Plane(median, XYZ[axis]);
+  // the mapped cache file is read-only
+  if (cache_.isMapped())
+  {
+    tree_.assign(treeData_, treeData_ + treeSize_);
+    handles_.assign(handleData_, handleData_ + cache_.header()->numHandles);
+    cache_.unmap();
+    _updateData();
+  }
+
+  const int numNodes   = int(tree_.size());
+  const int numThreads = getNumWorkerThreads();
+
+  // leaf boxes from the current positions, leaves are independent
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic, 256) num_threads(numThreads) if (numThreads > 1 && n_triangles > ParallelStatsSize)
+#endif
+  for (int i = 0; i < numNodes; ++i)
+  {
+    Node& node = tree_[i];
+    if (!node.isLeaf())
+      continue;
+
+    Point bb_min, bb_max, p0, p1, p2;
+    bb_min.vectorize( std::numeric_limits<Scalar>::infinity());
+    bb_max.vectorize(-std::numeric_limits<Scalar>::infinity());
+
+    for (unsigned int k = node.first(), end = node.first() + node.size(); k < end; ++k)
+    {
+      traits_.points(handles_[k], p0, p1, p2);
+      bb_min.minimize(p0);
+      bb_min.minimize(p1);
+      bb_min.minimize(p2);
+      bb_max.maximize(p0);
+      bb_max.maximize(p1);
+      bb_max.maximize(p2);
+    }
+
+    node.setBoundingBox(bb_min, bb_max);
+  }
+
+  // children are stored behind their parent, so a backward sweep updates them first
+  for (int i = numNodes - 1; i >= 0; --i)
+  {
+    Node& node = tree_[i];
+    if (!node.isLeaf())
+      node.mergeBoundingBoxes(tree_[node.leftChild()], tree_[node.rightChild()]);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+typename TriangleBSPCoreT<BSPTraits>::Scalar
+TriangleBSPCoreT<BSPTraits>::
+sahCost() const
+{
+  if (treeSize_ == 0)
+    return Scalar(0);
+
+  const Node& root = treeData_[0];
+  if (root.isLeaf())
+    return Scalar(root.size());
+
+  const Scalar rootArea = root.halfArea();
+  if (!(rootArea > Scalar(0)))
+    return Scalar(1);
+
+  Scalar cost(0);
+  for (size_t i = 0; i < treeSize_; ++i)
+  {
+    const Node& node = treeData_[i];
+    cost += node.isLeaf() ? Scalar(node.halfArea()) * Scalar(node.size()) : Scalar(node.halfArea());
+  }
+
+  return cost / rootArea;
+}
 
-  // partition for left and right child
-  Handles lhandles, rhandles;
-  lhandles.reserve(_node->handles_.size()/2);
-  rhandles.reserve(_node->handles_.size()/2);
 
-  HandleIter it;
-  Point p0, p1, p2;
-  for (it=_node->begin(); it!=_node->end(); ++it)
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+bool
+TriangleBSPCoreT<BSPTraits>::
+buildCached(const std::string& _filename, unsigned int _max_handles, unsigned int _max_depth)
+{
+  static_assert(std::is_trivially_copyable<Handle>::value, "Cached handles are used in place, they have to be trivially copyable");
+  static_assert(sizeof(Node) == 32, "Unexpected node layout");
+
+  const ACG::BSPCacheFile::Header header =
+      ACG::BSPCacheFile::makeHeader(cacheKey(_max_handles, _max_depth), sizeof(Node), sizeof(Handle), sizeof(Scalar),
+                                    0, handles_.size());
+
+  if (cache_.map(_filename, header) && cache_.header()->numHandles == handles_.size() && _validCache(_max_depth))
   {
-    traits_.points(*it, p0, p1, p2);
+    const ACG::BSPCacheFile::Header* cached = cache_.header();
+
+    tree_.clear();
+    treeData_   = static_cast<const Node*>(cache_.nodes());
+    handleData_ = static_cast<const Handle*>(cache_.handles());
+    treeSize_   = size_t(cached->numNodes);
+    nodes       = int(treeSize_);
+    builtCost_  = sahCost();
+    return true;
+  }
+
+  // build() releases a rejected mapping
+  build(_max_handles, _max_depth);
+
+  ACG::BSPCacheFile::write(_filename,
+                           ACG::BSPCacheFile::makeHeader(header.key, sizeof(Node), sizeof(Handle), sizeof(Scalar),
+                                                         tree_.size(), handles_.size()),
+                           treeData_, handleData_);
+  return false;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+bool
+TriangleBSPCoreT<BSPTraits>::
+_validCache(unsigned int _max_depth) const
+{
+  const ACG::BSPCacheFile::Header* cached = cache_.header();
+  const Node*   cachedNodes   = static_cast<const Node*>(cache_.nodes());
+  const Handle* cachedHandles = static_cast<const Handle*>(cache_.handles());
+  const uint64_t numNodes   = cached->numNodes;
+  const uint64_t numHandles = cached->numHandles;
+
+  if (numNodes == 0 || numNodes > uint64_t(std::numeric_limits<unsigned int>::max()))
+    return false;
+
+  // children are always stored after their parent, so a single pass visits each parent before its children.
+  //  depth 0 marks nodes, which are not referenced by any parent
+  std::vector<unsigned int> depth(size_t(numNodes), 0);
+  depth[0] = 1;
+
+  for (size_t i = 0; i < depth.size(); ++i)
+  {
+    const Node& node = cachedNodes[i];
+
+    if (!depth[i])
+      return false;
+
+    if (node.isLeaf())
+    {
+      if (uint64_t(node.first()) + node.size() > numHandles)
+        return false;
+    }
+    else
+    {
+      const size_t left = node.leftChild();
+
+      if (left <= i || left + 1 >= depth.size() || depth[left] || depth[left + 1] || depth[i] > _max_depth)
+        return false;
+
+      depth[left] = depth[left + 1] = depth[i] + 1;
+    }
+  }
+
+  // the key only covers the current handles, check that the cached handle array is a permutation of them
+  uint64_t sum = 0, cachedSum = 0;
+
+  for (size_t i = 0; i < handles_.size(); ++i)
+  {
+    sum       += ACG::BSPCacheFile::mix(ACG::BSPCacheFile::hash(&handles_[i], sizeof(Handle)));
+    cachedSum += ACG::BSPCacheFile::mix(ACG::BSPCacheFile::hash(&cachedHandles[i], sizeof(Handle)));
+  }
+
+  return sum == cachedSum;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+uint64_t
+TriangleBSPCoreT<BSPTraits>::
+cacheKey(unsigned int _max_handles, unsigned int _max_depth) const
+{
+  const int numTriangles = int(handles_.size());
+  const int numThreads   = getNumWorkerThreads();
+
+  // sum of the mixed triangle hashes does not depend on the order of the handles
+  uint64_t sum = 0;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 1024) reduction(+:sum) num_threads(numThreads) if (numThreads > 1 && numTriangles > ParallelStatsSize)
+#endif
+  for (int i = 0; i < numTriangles; ++i)
+  {
+    Point p[3];
+    traits_.points(handles_[i], p[0], p[1], p[2]);
+
+    uint64_t h = ACG::BSPCacheFile::hash(&handles_[i], sizeof(Handle));
+    h = ACG::BSPCacheFile::hash(p, sizeof(p), h);
+    sum += ACG::BSPCacheFile::mix(h);
+  }
+
+  const uint64_t params[] = { uint64_t(numTriangles), _max_handles, _max_depth, SAHBins, ACG::BSPCacheFile::Version };
+
+  return ACG::BSPCacheFile::hash(params, sizeof(params), ACG::BSPCacheFile::hash(&sum, sizeof(sum)));
+}
+
 
-    /* @TODO Remove this comment block. Replaced by the clause below
+//-----------------------------------------------------------------------------
 
-    if (_node->plane_(p0))  left  = true;
-    else                    right = true;
-    if (_node->plane_(p1))  left  = true;
-    else                    right = true;
-    if (_node->plane_(p2))  left  = true;
-    else                    right = true;
 
-    if (left)  lhandles.push_back(*it);
-    if (right) rhandles.push_back(*it);
-    */
+template <class BSPTraits>
+void
+TriangleBSPCoreT<BSPTraits>::
+_build(BuildData&              _data,
+       Nodes&                  _tree,
+       int                     _node,
+       int                     _begin,
+       int                     _end,
+       unsigned int            _depth,
+       int                     _numThreads,
+       std::vector<BuildTask>* _tasks)
+{
+  Point bb_min, bb_max, c_min, c_max;
+  _bounds(_data, _begin, _end, _numThreads, bb_min, bb_max, c_min, c_max);
 
-    if ( _node->plane_(p0)  || _node->plane_(p1)  || _node->plane_(p2)  ) lhandles.push_back(*it);
-    if ( !_node->plane_(p0) || !_node->plane_(p1) || !_node->plane_(p2) ) rhandles.push_back(*it);
+  _tree[_node].setBoundingBox(bb_min, bb_max);
 
+  // should we stop at this level ?
+  if ((_depth == 0) || (_end - _begin <= int(_data.max_handles)))
+  {
+    _tree[_node].setLeaf(_begin, _end - _begin);
+    return;
   }
 
-  // check it
-  if (lhandles.size() == _node->handles_.size() ||
-      rhandles.size() == _node->handles_.size())
+  // small subtree: leave it to a worker thread
+  if (_tasks && _end - _begin < ParallelSubtreeSize)
+  {
+    BuildTask task = { _node, _begin, _end, _depth };
+    _tasks->push_back(task);
     return;
-  else
-    _node->handles_ = Handles();
-
-
-  // create children
-  _node->left_child_  = new Node(lhandles, _node);  lhandles = Handles();
-  _node->right_child_ = new Node(rhandles, _node);  rhandles = Handles();
-  nodes+=2;
-  
-  //save bounding boxes for children
-  /*
-  _node->left_child_->bb_min  = _node->bb_min;
-  _node->left_child_->bb_max  = _node->bb_max;
-  _node->left_child_->bb_max[axis] = median [axis];
-  
-  _node->right_child_->bb_min = _node->bb_min;
-  _node->right_child_->bb_min[axis] = median [axis];
-  _node->right_child_->bb_max = _node->bb_max;
-  */
-  _node->right_child_->bb_min  = _node->bb_min;
-  _node->right_child_->bb_max  = _node->bb_max;
-  _node->right_child_->bb_max[axis] = median [axis];
-  
-  _node->left_child_->bb_min = _node->bb_min;
-  _node->left_child_->bb_min[axis] = median [axis];
-  _node->left_child_->bb_max = _node->bb_max;
+  }
+
+  const int mid = _split(_data, _begin, _end, _numThreads, c_min, c_max);
+
+  // create children, stored next to each other
+  const int left = int(_tree.size());
+  _tree.push_back(Node());
+  _tree.push_back(Node());
+  _tree[_node].setChildren(left);
 
   // recurse to childen
-  _build(_node->left_child_,  _max_handles, _depth-1);
-  _build(_node->right_child_, _max_handles, _depth-1);
+  _build(_data, _tree, left,   _begin, mid,  _depth-1, _numThreads, _tasks);
+  _build(_data, _tree, left+1, mid,    _end, _depth-1, _numThreads, _tasks);
 }
 
-//=============================================================================
 
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+void
+TriangleBSPCoreT<BSPTraits>::
+_bounds(const BuildData& _data,
+        int              _begin,
+        int              _end,
+        int              _numThreads,
+        Point&           _bb_min,
+        Point&           _bb_max,
+        Point&           _c_min,
+        Point&           _c_max) const
+{
+  const int numChunks = (_end - _begin > ParallelStatsSize) ? _numThreads : 1;
+
+  // bounds of each chunk: bb_min, bb_max, c_min, c_max
+  std::vector<Point> chunkBounds(4 * numChunks);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(numChunks) if (numChunks > 1)
+#endif
+  for (int c = 0; c < numChunks; ++c)
+  {
+    Point* b = &chunkBounds[4 * c];
+    b[0].vectorize( std::numeric_limits<Scalar>::infinity());
+    b[1].vectorize(-std::numeric_limits<Scalar>::infinity());
+    b[2] = b[0];
+    b[3] = b[1];
+
+    const int chunkBegin = _begin + int((long long)(_end - _begin) * c / numChunks);
+    const int chunkEnd   = _begin + int((long long)(_end - _begin) * (c + 1) / numChunks);
+
+    for (int i = chunkBegin; i < chunkEnd; ++i)
+    {
+      const int t = _data.triangles[i];
+      b[0].minimize(_data.bb_min[t]);
+      b[1].maximize(_data.bb_max[t]);
+      b[2].minimize(_data.centroid[t]);
+      b[3].maximize(_data.centroid[t]);
+    }
+  }
+
+  // min and max do not depend on the order, so the result is independent of the number of chunks
+  _bb_min = chunkBounds[0];
+  _bb_max = chunkBounds[1];
+  _c_min  = chunkBounds[2];
+  _c_max  = chunkBounds[3];
+
+  for (int c = 1; c < numChunks; ++c)
+  {
+    _bb_min.minimize(chunkBounds[4 * c]);
+    _bb_max.maximize(chunkBounds[4 * c + 1]);
+    _c_min.minimize(chunkBounds[4 * c + 2]);
+    _c_max.maximize(chunkBounds[4 * c + 3]);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+int
+TriangleBSPCoreT<BSPTraits>::
+_split(BuildData&   _data,
+       int          _begin,
+       int          _end,
+       int          _numThreads,
+       const Point& _c_min,
+       const Point& _c_max) const
+{
+  struct Bin
+  {
+    Point bb_min, bb_max;
+    int   count;
+  };
+
+  // centroid to bin mapping
+  Scalar scale[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    const Scalar extent = _c_max[k] - _c_min[k];
+    scale[k] = extent > Scalar(0) ? Scalar(SAHBins) / extent : Scalar(0);
+  }
+
+  const int numChunks = (_end - _begin > ParallelStatsSize) ? _numThreads : 1;
+
+  // bins of each chunk, 3 axes with SAHBins each
+  std::vector<Bin> chunkBins(numChunks * 3 * SAHBins);
+
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(numChunks) if (numChunks > 1)
+#endif
+  for (int c = 0; c < numChunks; ++c)
+  {
+    Bin* bins = &chunkBins[c * 3 * SAHBins];
+
+    for (int b = 0; b < 3 * SAHBins; ++b)
+    {
+      bins[b].bb_min.vectorize( std::numeric_limits<Scalar>::infinity());
+      bins[b].bb_max.vectorize(-std::numeric_limits<Scalar>::infinity());
+      bins[b].count = 0;
+    }
+
+    const int chunkBegin = _begin + int((long long)(_end - _begin) * c / numChunks);
+    const int chunkEnd   = _begin + int((long long)(_end - _begin) * (c + 1) / numChunks);
+
+    for (int i = chunkBegin; i < chunkEnd; ++i)
+    {
+      const int t = _data.triangles[i];
+
+      for (int k = 0; k < 3; ++k)
+      {
+        const int b = std::min(int((_data.centroid[t][k] - _c_min[k]) * scale[k]), SAHBins - 1);
+        Bin& bin = bins[k * SAHBins + b];
+        bin.bb_min.minimize(_data.bb_min[t]);
+        bin.bb_max.maximize(_data.bb_max[t]);
+        ++bin.count;
+      }
+    }
+  }
+
+  // merge chunks
+  for (int c = 1; c < numChunks; ++c)
+  {
+    for (int b = 0; b < 3 * SAHBins; ++b)
+    {
+      const Bin& src = chunkBins[c * 3 * SAHBins + b];
+      chunkBins[b].bb_min.minimize(src.bb_min);
+      chunkBins[b].bb_max.maximize(src.bb_max);
+      chunkBins[b].count += src.count;
+    }
+  }
+
+  // sweep over the split positions between the bins and evaluate the SAH cost
+  int    bestAxis  = -1;
+  int    bestSplit = 0;
+  Scalar bestCost  = std::numeric_limits<Scalar>::infinity();
+
+  for (int k = 0; k < 3; ++k)
+  {
+    if (scale[k] == Scalar(0))
+      continue;
+
+    const Bin* bins = &chunkBins[k * SAHBins];
+
+    // cost of the left side for splits behind bin b
+    Scalar leftCost[SAHBins];
+    Point  bb_min = bins[0].bb_min, bb_max = bins[0].bb_max;
+    int    count  = 0;
+
+    for (int b = 0; b < SAHBins - 1; ++b)
+    {
+      bb_min.minimize(bins[b].bb_min);
+      bb_max.maximize(bins[b].bb_max);
+      count += bins[b].count;
+
+      const Point d = bb_max - bb_min;
+      leftCost[b] = count ? Scalar(count) * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]) : Scalar(-1);
+    }
+
+    bb_min = bins[SAHBins - 1].bb_min;
+    bb_max = bins[SAHBins - 1].bb_max;
+    count  = 0;
+
+    for (int b = SAHBins - 1; b > 0; --b)
+    {
+      bb_min.minimize(bins[b].bb_min);
+      bb_max.maximize(bins[b].bb_max);
+      count += bins[b].count;
+
+      if (!count || leftCost[b - 1] < Scalar(0))
+        continue;
+
+      const Point d = bb_max - bb_min;
+      const Scalar cost = leftCost[b - 1] + Scalar(count) * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
 
+      if (cost < bestCost)
+      {
+        bestCost  = cost;
+        bestAxis  = k;
+        bestSplit = b;
+      }
+    }
+  }
+
+  // all centroids coincide: split in the middle
+  if (bestAxis < 0)
+    return (_begin + _end) / 2;
+
+  // partition for left and right child
+  const Point  c_min = _c_min;
+  const Scalar s     = scale[bestAxis];
+  const BuildData& data = _data;
+
+  int* mid = std::partition(&_data.triangles[0] + _begin, &_data.triangles[0] + _end,
+                            [&](int t) { return std::min(int((data.centroid[t][bestAxis] - c_min[bestAxis]) * s), SAHBins - 1) < bestSplit; });
+
+  return int(mid - &_data.triangles[0]);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+int
+TriangleBSPCoreT<BSPTraits>::
+getNumWorkerThreads() const
+{
+#ifdef USE_OPENMP
+  return numThreads_ > 0 ? numThreads_ : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+template <class BSPTraits>
+template <typename MeshT>
+void
+TriangleBSPCoreT<BSPTraits>::
+_visualizeTree(MeshT *_object, int _node, int _max_depth)
+{
+  const Node& node = treeData_[_node];
+
+  if (_max_depth > 0 && !node.isLeaf())
+  {
+    _visualizeTree(_object, node.leftChild(),  _max_depth-1);
+    _visualizeTree(_object, node.rightChild(), _max_depth-1);
+  }
+  else
+  {
+    typedef typename MeshT::Point        MPoint;
+    typedef typename MeshT::VertexHandle VertexHandle;
+
+    const MPoint bb_min = node.template bb_min<MPoint>();
+    const MPoint size_  = node.template bb_max<MPoint>() - bb_min;
+
+    std::vector<VertexHandle> vhandle(8);
+    vhandle[0] = _object->add_vertex(bb_min+MPoint(0.0,0.0,size_[2]));
+    vhandle[1] = _object->add_vertex(bb_min+MPoint(size_[0],0.0,size_[2]));
+    vhandle[2] = _object->add_vertex(bb_min+MPoint(size_[0],size_[1],size_[2]));
+    vhandle[3] = _object->add_vertex(bb_min+MPoint(0.0,size_[1],size_[2]));
+    vhandle[4] = _object->add_vertex(bb_min+MPoint(0.0,0.0,0.0));
+    vhandle[5] = _object->add_vertex(bb_min+MPoint(size_[0],0.0,0.0));
+    vhandle[6] = _object->add_vertex(bb_min+MPoint(size_[0],size_[1],0.0));
+    vhandle[7] = _object->add_vertex(bb_min+MPoint(0.0,size_[1],0.0));
+
+    // generate (quadrilateral) faces
+    static const int faces[6][4] = { {0,1,2,3}, {7,6,5,4}, {1,0,4,5}, {2,1,5,6}, {3,2,6,7}, {0,3,7,4} };
+
+    std::vector<VertexHandle>  face_vhandles(4);
+
+    for (int i = 0; i < 6; ++i)
+    {
+      for (int k = 0; k < 4; ++k)
+        face_vhandles[k] = vhandle[faces[i][k]];
+      _object->add_face(face_vhandles);
+    }
+  }
+}
+
+//=============================================================================
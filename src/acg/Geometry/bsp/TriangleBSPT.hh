@@ -56,7 +56,6 @@
 #include "TriangleBSPCoreT.hh"
 #include "BSPImplT.hh"
 
-#include <list>
 //== CLASS DEFINITION =========================================================
 
 template <class BSPTraits>
@@ -81,7 +80,6 @@ public:
     typedef typename Point::value_type        Scalar;
     typedef std::vector<Handle>               Handles;
     typedef typename Handles::iterator        HandleIter;
-    typedef TreeNode<SpecificTraits>          Node;
 
     explicit OVMOMCommonTriangleBSPTraits(const Mesh& _mesh) : SpecificTraits(_mesh) {}
 
@@ -91,88 +89,6 @@ public:
       this->points(_h, p0, p1, p2);
       return ACG::Geometry::distPointTriangleSquaredStable(_p, p0, p1, p2, q);
     }
-
-    void calculateBoundingBox(Node* _node, Point& median, int& axis)
-    {
-      //determine splitting axis
-      HandleIter it_h;
-      Point p0, p1, p2, bb_min, bb_max;
-      bb_min.vectorize(std::numeric_limits<typename Point::value_type>::infinity());
-      bb_max.vectorize(-std::numeric_limits<typename Point::value_type>::infinity());
-      std::list<Point> vertices;
-
-      for (it_h = _node->begin(); it_h != _node->end(); ++it_h) {
-        this->points(*it_h, p0, p1, p2);
-        /*
-         bb_min.minimize(p0);
-         bb_min.minimize(p1);
-         bb_min.minimize(p2);
-         bb_max.maximize(p0);
-         bb_max.maximize(p1);
-         bb_max.maximize(p2);*/
-
-        vertices.push_back(p0);
-        vertices.push_back(p1);
-        vertices.push_back(p2);
-      }
-      bb_min = _node->bb_min;
-      bb_max = _node->bb_max;
-
-      // split longest side of bounding box
-      Point bb = bb_max - bb_min;
-      Scalar length = bb[0];
-      axis = 0;
-      if (bb[1] > length)
-        length = bb[(axis = 1)];
-      if (bb[2] > length)
-        length = bb[(axis = 2)];
-
-      //calculate the median value in axis-direction
-      switch (axis) {
-        case 0:
-          vertices.sort(x_sort());
-          break;
-        case 1:
-          vertices.sort(y_sort());
-          break;
-        case 2:
-          vertices.sort(z_sort());
-          break;
-      }
-      vertices.unique(); ///todo: does this work with Points?!
-
-      size_t size = vertices.size();
-      typename std::list<Point>::iterator it_v;
-      it_v = vertices.begin();
-      std::advance(it_v, size / 2);
-      median = *it_v;
-
-    }
-
-    void calculateBoundingBoxRoot(Node* _node)
-    {
-      HandleIter it;
-      Point p0, p1, p2, bb_min, bb_max;
-      bb_min.vectorize(FLT_MAX);
-      bb_max.vectorize(-FLT_MAX);
-      for (it = _node->begin(); it != _node->end(); ++it) {
-        this->points(*it, p0, p1, p2);
-        bb_min.minimize(p0);
-        bb_min.minimize(p1);
-        bb_min.minimize(p2);
-        bb_max.maximize(p0);
-        bb_max.maximize(p1);
-        bb_max.maximize(p2);
-      }
-      _node->bb_min = bb_min;
-      _node->bb_max = bb_max;
-    }
-
-private:
-    //functors for sorting in different directions
-    struct x_sort { bool operator()(const Point& first, const Point& second) { return (first[0] < second[0]); }  };
-    struct y_sort { bool operator()(const Point& first, const Point& second) { return (first[1] < second[1]); }  };
-    struct z_sort { bool operator()(const Point& first, const Point& second) { return (first[2] < second[2]); }  };
 };
 
 
@@ -174,6 +174,17 @@ namespace GLSL {
     return true;
   }
 
+  /** \brief Start compilation of the shader without querying the compile status
+   */
+  void Shader::compileAsync() {
+    if ( this->m_shaderId == 0 ) {
+      std::cerr << "shader not initialized" << std::endl;
+      return;
+    }
+
+    glCompileShader(m_shaderId);
+  }
+
   //--------------------------------------------------------------------------
   // Vertex shader
   //--------------------------------------------------------------------------
@@ -324,6 +335,7 @@ namespace GLSL {
   /** \brief Links the shader objects to the program.
   */
   void Program::link() {
+    resetPoolUniforms();
     glLinkProgram(this->m_programId);
     checkGLError2("link program failed");
     
@@ -340,6 +352,68 @@ namespace GLSL {
     m_linkStatus = status;
   }
 
+  /** \brief Issue the link command without querying the link status
+   */
+  void Program::linkAsync() {
+    resetPoolUniforms();
+    m_linkStatus = GL_FALSE;
+    glLinkProgram(this->m_programId);
+    checkGLError2("link program failed");
+  }
+
+  /** \brief Is a link started with linkAsync() completed?
+   *
+   * Always true without GL_KHR_parallel_shader_compile.
+   */
+  bool Program::isLinkCompleted() {
+#ifdef GL_KHR_parallel_shader_compile
+    if (parallelCompileSupported()) {
+      GLint completed = GL_TRUE;
+      glGetProgramiv(this->m_programId, GL_COMPLETION_STATUS_KHR, &completed);
+      return completed != GL_FALSE;
+    }
+#endif
+    return true;
+  }
+
+  /** \brief Query the result of linkAsync(), blocks if linking is not completed
+   *
+   * @return true if the program is linked
+   */
+  bool Program::finishLink() {
+    GLint status = GL_FALSE;
+    glGetProgramiv(this->m_programId, GL_LINK_STATUS, &status);
+    if ( !status ){
+      GLint InfoLogLength = 0;
+      glGetProgramiv(this->m_programId, GL_INFO_LOG_LENGTH, &InfoLogLength);
+      std::string errorlog(InfoLogLength,'\0');
+      glGetProgramInfoLog(this->m_programId, InfoLogLength, NULL, &errorlog[0]);
+      std::cerr << "program link error: " << errorlog << std::endl;
+    }
+
+    m_linkStatus = status;
+    return m_linkStatus != GL_FALSE;
+  }
+
+  /** \brief Is GL_KHR_parallel_shader_compile supported?
+   *
+   * Lets the driver choose the number of compiler threads on the first call.
+   */
+  bool Program::parallelCompileSupported() {
+#ifdef GL_KHR_parallel_shader_compile
+    static int supported = -1;
+
+    if (supported < 0) {
+      supported = ACG::checkExtensionSupported("KHR_parallel_shader_compile") ? 1 : 0;
+      if (supported)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    return supported != 0;
+#else
+    return false;
+#endif
+  }
+
   /** \brief Enables the program object for using.
   */
   void Program::use() {
@@ -377,6 +451,103 @@ namespace GLSL {
     return (GLuint)m_programId;
   }
 
+  /** \brief Forget locations and values of UniformPools, linking resets all uniforms
+   */
+  void Program::resetPoolUniforms() {
+    m_poolUniforms.clear();
+    m_poolNameIds.clear();
+  }
+
+  /** \brief Are program binaries supported by the driver?
+   *
+   * Requires OpenGL 4.1 or GL_ARB_get_program_binary and at least one binary format.
+   */
+  bool Program::binarySupported() {
+#ifdef GL_ARB_get_program_binary
+    static int supported = -1;
+
+    if (supported < 0) {
+      supported = 0;
+      if (ACG::openGLVersionTest(4,1) || ACG::checkExtensionSupported("ARB_get_program_binary")) {
+        GLint numFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+        supported = numFormats > 0 ? 1 : 0;
+      }
+    }
+    return supported != 0;
+#else
+    return false;
+#endif
+  }
+
+  /** \brief Hint that getBinary() will be used, has to be called before link()
+   */
+  void Program::setBinaryRetrievableHint() {
+#ifdef GL_ARB_get_program_binary
+    if (this->m_programId && binarySupported()) {
+      glProgramParameteri(this->m_programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+      checkGLError();
+    }
+#endif
+  }
+
+  /** \brief Get the binary of the linked program
+   *
+   * @param _format returned driver specific binary format
+   * @param _binary returned binary
+   * @return true on success
+   */
+  bool Program::getBinary(GLenum& _format, std::vector<char>& _binary) {
+#ifdef GL_ARB_get_program_binary
+    if (!m_linkStatus || !binarySupported())
+      return false;
+
+    GLint size = 0;
+    glGetProgramiv(this->m_programId, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+      return false;
+
+    _binary.resize(size);
+
+    GLsizei written = 0;
+    glGetProgramBinary(this->m_programId, size, &written, &_format, &_binary[0]);
+    checkGLError2("get program binary failed");
+
+    _binary.resize(written);
+    return written > 0;
+#else
+    return false;
+#endif
+  }
+
+  /** \brief Replace the program with a binary returned by getBinary()
+   *
+   * @param _format driver specific binary format
+   * @param _binary binary data
+   * @param _size   size of the binary in bytes
+   * @return true if the program is linked now
+   */
+  bool Program::loadBinary(GLenum _format, const void* _binary, int _size) {
+    resetPoolUniforms();
+    m_linkStatus = GL_FALSE;
+
+#ifdef GL_ARB_get_program_binary
+    if (!this->m_programId || !binarySupported())
+      return false;
+
+    glProgramBinary(this->m_programId, _format, _binary, _size);
+
+    // a rejected binary is not an error, it only leaves the program unlinked
+    glGetError();
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(this->m_programId, GL_LINK_STATUS, &status);
+    m_linkStatus = status;
+#endif
+
+    return m_linkStatus != GL_FALSE;
+  }
+
   /** \brief Set int uniform to specified value
    *
    * @param _name  Name of the uniform
@@ -384,7 +555,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, GLint _value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform1i(location, _value);
     checkGLError2(_name);
@@ -397,7 +568,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec2i &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform2iv(location, 1, _value.data());
     checkGLError();
@@ -410,7 +581,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec3i &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform3iv(location, 1, _value.data());
     checkGLError();
@@ -423,7 +594,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec4i &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform4iv(location, 1, _value.data());
     checkGLError();
@@ -436,7 +607,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, GLuint _value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform1ui(location, _value);
     checkGLError2(_name);
@@ -449,7 +620,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec2ui &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform2uiv(location, 1, _value.data());
     checkGLError();
@@ -462,7 +633,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec3ui &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform3uiv(location, 1, _value.data());
     checkGLError();
@@ -475,7 +646,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec4ui &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform4uiv(location, 1, _value.data());
     checkGLError();
@@ -488,7 +659,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, GLfloat _value) {
     checkGLError2("prev opengl error");
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform1f(location, _value);
     checkGLError2(_name);
@@ -501,7 +672,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec2f &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform2fv(location, 1, _value.data());
     checkGLError();
@@ -514,7 +685,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec3f &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform3fv(location, 1, _value.data());
     checkGLError();
@@ -527,7 +698,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec4f &_value) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform4fv(location, 1, _value.data());
     checkGLError();
@@ -541,7 +712,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const GLint *_values, int _count) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform1iv(location, _count, _values);
     checkGLError();
@@ -555,7 +726,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const GLfloat *_values, int _count) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform1fv(location, _count, _values);
     checkGLError();
@@ -569,7 +740,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec2f* _values, int _count) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform2fv(location, _count, (GLfloat*)_values);
     checkGLError();
@@ -583,7 +754,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec3f* _values, int _count) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform3fv(location, _count, (GLfloat*)_values);
     checkGLError();
@@ -597,7 +768,7 @@ namespace GLSL {
    */
   void Program::setUniform(const char *_name, const ACG::Vec4f* _values, int _count) {
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniform4fv(location, _count, (GLfloat*)_values);
     checkGLError();
@@ -648,7 +819,7 @@ namespace GLSL {
    */
   void Program::setUniform( const char *_name, const ACG::GLMatrixf &_value, bool _transposed){
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
     glUniformMatrix4fv(location, 1, _transposed, _value.data());
     checkGLError();
@@ -662,7 +833,7 @@ namespace GLSL {
    */
   void Program::setUniformMat3( const char *_name, const ACG::GLMatrixf &_value, bool _transposed){
     checkGLError();
-    GLint location = glGetUniformLocation(this->m_programId, _name);
+    GLint location = getUniformLocation(_name);
     checkGLError2(_name);
 
     float tmp[9];
@@ -713,6 +884,11 @@ namespace GLSL {
   int Program::getUniformLocation(const char *_name) {
     int attributeLocation = glGetUniformLocation(this->m_programId, _name);
     checkGLError2(_name);
+
+    // the location may be used to overwrite a value uploaded by a UniformPool
+    if (attributeLocation >= 0 && attributeLocation < int(m_poolNameIds.size()) && m_poolNameIds[attributeLocation] >= 0)
+      m_poolUniforms[m_poolNameIds[attributeLocation]].uploaded = false;
+
     return attributeLocation;
   }
 
@@ -53,6 +53,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 #include <QStringList>
 
 //==============================================================================
@@ -79,6 +80,9 @@ namespace GLSL {
       // FIXME implement StringList getSource();
       bool compile(bool verbose = true);
 
+      /// Start compilation without waiting for the result, errors are reported by Program::finishLink()
+      void compileAsync();
+
     protected:
       GLuint m_shaderId;
 
@@ -226,6 +230,19 @@ namespace GLSL {
       void detach(PtrConstShader _shader);
       void link();
 
+      /** \brief Link without waiting for the result
+       *
+       * With GL_KHR_parallel_shader_compile the driver compiles and links in the background,
+       * poll isLinkCompleted() and call finishLink() once it returns true. Without the extension
+       * finishLink() blocks until linking is done.
+       */
+      void linkAsync();
+      bool isLinkCompleted();
+      bool finishLink();
+
+      /// Is GL_KHR_parallel_shader_compile supported? Enables driver compiler threads on the first call.
+      static bool parallelCompileSupported();
+
       /** @} */
 
       //===========================================================================
@@ -303,6 +320,44 @@ namespace GLSL {
 
       /** @} */
 
+      //===========================================================================
+       /** @name Program binaries
+        *
+        * Linked programs can be saved as driver specific binaries and loaded again
+        * without compiling, see ShaderCache::setBinaryCacheDir().
+        * Requires OpenGL 4.1 or GL_ARB_get_program_binary.
+        *
+        * @{ */
+      //===========================================================================
+
+       /// Are program binaries supported by the driver?
+       static bool binarySupported();
+
+       /// Hint that getBinary() will be used, has to be called before link()
+       void setBinaryRetrievableHint();
+
+       /** \brief Get the binary of the linked program
+        *
+        * @param _format returned driver specific binary format
+        * @param _binary returned binary
+        * @return true on success
+        */
+       bool getBinary(GLenum& _format, std::vector<char>& _binary);
+
+       /** \brief Replace the program with a binary returned by getBinary()
+        *
+        * The driver may reject binaries, e.g. after a driver update.
+        * The program is unlinked then and has to be compiled from source.
+        *
+        * @param _format driver specific binary format
+        * @param _binary binary data
+        * @param _size   size of the binary in bytes
+        * @return true if the program is linked now
+        */
+       bool loadBinary(GLenum _format, const void* _binary, int _size);
+
+      /** @} */
+
       //===========================================================================
        /** @name Geometry shader parameters
         *
@@ -336,6 +391,25 @@ namespace GLSL {
       GLint m_programId;
 
       GLint m_linkStatus;
+
+      friend class UniformPool;
+
+      /// location and last value uploaded by a UniformPool, see UniformPool::bind()
+      struct PoolUniform {
+        PoolUniform() : location(-2), uploaded(false) {}
+
+        GLint location;                    ///< -2 if not resolved yet
+        bool uploaded;                     ///< value is valid
+        std::vector<unsigned char> value;
+      };
+
+      /// uniforms set by UniformPools, indexed by UniformPool::getNameId()
+      std::vector<PoolUniform> m_poolUniforms;
+
+      /// UniformPool name id by uniform location, -1 for locations not set by a pool
+      std::vector<int> m_poolNameIds;
+
+      void resetPoolUniforms();
   };
 
   typedef Program* PtrProgram;
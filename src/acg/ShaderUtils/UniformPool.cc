@@ -41,6 +41,11 @@
 
 
 #include <iostream>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <QHash>
+#include <QMutex>
 #include <QTextStream>
 
 #include <ACG/GL/acg_glew.hh>
@@ -57,6 +62,42 @@
 
 namespace GLSL {
 
+  //--------------------------------------------------------------------------
+  // Name interning
+  //--------------------------------------------------------------------------
+
+  namespace {
+
+    QMutex nameMutex;
+
+    /// interned names, deque keeps the strings in place
+    std::deque<std::string> names;
+    QHash<QByteArray, int> nameIds;
+  }
+
+  int UniformPool::getNameId(const char* _name) {
+    const QByteArray name = QByteArray::fromRawData(_name, int(strlen(_name)));
+
+    QMutexLocker lock(&nameMutex);
+
+    QHash<QByteArray, int>::const_iterator it = nameIds.constFind(name);
+    if (it != nameIds.constEnd())
+      return it.value();
+
+    const int id = int(names.size());
+    names.push_back(_name);
+
+    // deep copy, the key must not refer to the caller's string
+    nameIds.insert(QByteArray(_name), id);
+
+    return id;
+  }
+
+  const char* UniformPool::getName(int _nameId) {
+    QMutexLocker lock(&nameMutex);
+    return names[_nameId].c_str();
+  }
+
   //--------------------------------------------------------------------------
   // Uniform Pool
   //--------------------------------------------------------------------------
@@ -74,7 +115,6 @@ namespace GLSL {
   /** \brief Destructor
   */
   UniformPool::~UniformPool(){
-    clear();
   }
 
 
@@ -84,16 +124,13 @@ namespace GLSL {
   }
 
   void UniformPool::clear() {
-    // Delete the uniforms in that pool
-    for (UniformListIt it = pool_.begin(); it != pool_.end(); ++it)
-      delete (*it);
-
-    // Clear the pool
-    pool_.clear();
+    // keep the allocated memory, pools are typically refilled every frame
+    uniforms_.clear();
+    data_.clear();
   }
 
   bool UniformPool::empty() const {
-    return pool_.empty();
+    return uniforms_.empty();
   }
 
 
@@ -102,507 +139,280 @@ namespace GLSL {
     QString result;
     QTextStream resultStrm(&result);
 
-    for (UniformList::const_iterator it = pool_.begin(); it != pool_.end(); ++it) {
-      resultStrm << (*it)->toString() << "\n";
+    for (size_t i = 0; i < uniforms_.size(); ++i) {
+      const Uniform& u = uniforms_[i];
+      const char* name = getName(u.nameId);
+
+      const unsigned char* value = data_.data() + u.offset;
+      const GLfloat* f = reinterpret_cast<const GLfloat*>(value);
+      const GLint* n = reinterpret_cast<const GLint*>(value);
+      const GLuint* un = reinterpret_cast<const GLuint*>(value);
+
+      QString str;
+
+      switch (u.type) {
+        case UNIFORM_FLOAT:
+        case UNIFORM_INT:
+        case UNIFORM_UINT: {
+          const char* fmt = 0;
+          if (u.type == UNIFORM_FLOAT)
+            fmt = u.size > 1 ? "uniform vec%2 %1 = vec%2(" : "uniform float %1 = ";
+          else if (u.type == UNIFORM_INT)
+            fmt = u.size > 1 ? "uniform ivec%2 %1 = ivec%2(" : "uniform int %1 = ";
+          else
+            fmt = u.size > 1 ? "uniform uvec%2 %1 = uvec%2(" : "uniform uint %1 = ";
+
+          str = QString(fmt).arg(name).arg(u.size);
+          for (int k = 0; k < u.size; ++k) {
+            if (u.type == UNIFORM_FLOAT)
+              str += QString::number(f[k]);
+            else if (u.type == UNIFORM_INT)
+              str += QString::number(n[k]);
+            else
+              str += QString::number(un[k]);
+            if (k + 1 < u.size)
+              str += ", ";
+          }
+          if (u.size > 1)
+            str += ");";
+        } break;
+
+        case UNIFORM_MAT: {
+          // stored column major
+          str = QString("uniform mat%2 %1 = {").arg(name).arg(u.size);
+          for (int y = 0; y < u.size; ++y) {
+            str += "{";
+            for (int x = 0; x < u.size; ++x) {
+              str += QString::number(f[x * u.size + y]);
+              if (x + 1 < u.size)
+                str += ", ";
+            }
+            str += "}";
+            if (y + 1 < u.size)
+              str += ", ";
+          }
+          str += "};";
+        } break;
+
+        case UNIFORM_FLOAT_ARRAY:
+        case UNIFORM_INT_ARRAY: {
+          const bool integer = u.type == UNIFORM_INT_ARRAY;
+          str = QString("uniform %3 %1[%2] = {").arg(name).arg(u.size).arg(integer ? "int" : "float");
+          for (int k = 0; k < u.size; ++k) {
+            if (integer)
+              str += QString::number(n[k]);
+            else
+              str += QString::number(f[k]);
+            if (k + 1 < u.size)
+              str += ", ";
+          }
+          str += "};";
+        } break;
+      }
+
+      resultStrm << str << "\n";
     }
 
     return result;
   }
 
   /** \brief Send all stored uniforms to program
+   *
+   * Uniform locations are resolved once per program. Values the program
+   * already holds from a previous bind are not uploaded again.
+   * The program has to be active.
    *
    *  @param _prog receiving GLSL program 
    */
   void UniformPool::bind( PtrProgram _prog ) const {
-    bind(_prog->getProgramId());
-  }
-
-  /** \brief Send all stored uniforms to program
-   *
-   *  @param _prog opengl program id
-   */
-  void UniformPool::bind( GLuint _prog ) const {
-    for (UniformList::const_iterator it = pool_.begin(); it != pool_.end(); ++it) {
-      (*it)->bind(_prog);
-    }
-  }
-
-  /** \brief Search the pool for an existing value for a uniform name
-  *
-  * @param _name  Name of the uniform
-  * @return iterator of uniform entry
-  */
-  UniformPool::UniformListIt UniformPool::findEntry( std::string _name ) {
-
-    for (UniformListIt it = pool_.begin(); it != pool_.end(); ++it){
-      if ((*it)->id.compare(_name) == 0)
-        return it;
-    }
-
-    return pool_.end();
-  }
-
-  /** \brief Add all uniforms of a pool to this pool
-   *
-   *  @param _src source uniform pool
-   */
-  void UniformPool::addPool( const UniformPool& _src ){
-
-    for (UniformList::const_iterator it = _src.pool_.begin(); it != _src.pool_.end(); ++it){
-
-      // determine type
-      const UniformVecf* pVecf = dynamic_cast<const UniformVecf*>(*it);
-      const UniformVeci* pVeci = dynamic_cast<const UniformVeci*>(*it);
-      const UniformVecui* pVecui = dynamic_cast<const UniformVecui*>(*it);
-      const UniformMat* pMat = dynamic_cast<const UniformMat*>(*it);
-      const UniformBuf* pBuf = dynamic_cast<const UniformBuf*>(*it);
-
-      // add to our list
-      if (pVecf)
-        addVecf(*pVecf);
-
-      if (pVeci)
-        addVeci(*pVeci);
+    const GLuint progID = _prog->getProgramId();
 
-      if (pVecui)
-        addVecui(*pVecui);
+    for (size_t i = 0; i < uniforms_.size(); ++i) {
+      const Uniform& u = uniforms_[i];
 
-      else if (pMat)
-        addMatrix(*pMat);
-
-      else if (pBuf)
-        addBuf(pBuf->id.c_str(), pBuf->val, pBuf->size, pBuf->integer);
-    }
-  }
+      if (u.nameId >= int(_prog->m_poolUniforms.size()))
+        _prog->m_poolUniforms.resize(u.nameId + 1);
 
+      Program::PoolUniform& cached = _prog->m_poolUniforms[u.nameId];
 
-  /** \brief Bind uniform float vector to shader
-  *
-  * @param _progID  GL Program ID
-  */
-  void UniformPool::UniformVecf::bind( GLuint _progID ) const {
-    checkGLError2("prev opengl error");
-    GLint location = glGetUniformLocation(_progID, id.c_str());
-    checkGLError2(id.c_str());
-
-    switch (size){
-      case 1:
-        glUniform1fv(location, 1, val.data());
-        break;
-      case 2:
-        glUniform2fv(location, 1, val.data());
-        break;
-      case 3:
-        glUniform3fv(location, 1, val.data());
-        break;
-      case 4:
-        glUniform4fv(location, 1, val.data());
-        break;
-
-      default:
-        std::cerr << "UniformPool::UniformVecf : invalid size "  << size << std::endl;
-        break;
-    }
-
-    checkGLError2(id.c_str());
-  }
+      if (cached.location == -2) {
+        cached.location = glGetUniformLocation(progID, getName(u.nameId));
+        checkGLError2(getName(u.nameId));
+      }
 
+      // inactive uniform
+      if (cached.location < 0)
+        continue;
 
-  /** \brief print float vector to string
-  *
-  */
-  QString UniformPool::UniformVecf::toString() const {
-    const char* fmt = size > 1 ? "uniform vec%2 %1 = vec%2(" : "uniform float %1 = ";
-    QString str = QString(fmt).arg(id.c_str()).arg(size);
-    for (int i = 0; i < size; ++i) {
-      str += QString::number(val[i]);
-      if (i + 1 < size)
-        str += ", ";
-    }
-    if (size > 1)
-      str += ");";
-    return str;
-  }
+      const unsigned char* value = data_.data() + u.offset;
 
-  /** \brief Bind uniform int vector to shader
-  *
-  * @param _progID  GL Program ID
-  */
-  void UniformPool::UniformVeci::bind( GLuint _progID ) const {
-    checkGLError2("prev opengl error");
-    GLint location = glGetUniformLocation(_progID, id.c_str());
-    checkGLError2(id.c_str());
-
-    switch (size){
-        case 1:
-          glUniform1iv(location, 1, (GLint*)val.data());
-          break;
-        case 2:
-          glUniform2iv(location, 1, (GLint*)val.data());
-          break;
-        case 3:
-          glUniform3iv(location, 1, (GLint*)val.data());
-          break;
-        case 4:
-          glUniform4iv(location, 1, (GLint*)val.data());
-          break;
-
-        default:
-          std::cerr << "UniformPool::UniformVeci : invalid size "  << size << std::endl;
-          break;
-    }
+      if (cached.uploaded && cached.value.size() == u.bytes && !memcmp(cached.value.data(), value, u.bytes))
+        continue;
 
-    checkGLError2(id.c_str());
-  }
+      upload(u, value, cached.location);
 
+      cached.value.assign(value, value + u.bytes);
+      cached.uploaded = true;
 
-  /** \brief print int vector to string
-  *
-  */
-  QString UniformPool::UniformVeci::toString() const {
-    const char* fmt = size > 1 ? "uniform ivec%2 %1 = ivec%2(" : "uniform int %1 = ";
-    QString str = QString(fmt).arg(id.c_str()).arg(size);
-    for (int i = 0; i < size; ++i) {
-      str += QString::number(val[i]);
-      if (i + 1 < size)
-        str += ", ";
+      // remember the locations, so that Program::setUniform() invalidates the cached value
+      //  array elements are assumed to have consecutive locations starting at the location of the array,
+      //  which all common drivers do, although the GL spec only guarantees it for explicit layout locations
+      const int numLocations = (u.type == UNIFORM_FLOAT_ARRAY || u.type == UNIFORM_INT_ARRAY) ? u.size : 1;
+      if (cached.location + numLocations > int(_prog->m_poolNameIds.size()))
+        _prog->m_poolNameIds.resize(cached.location + numLocations, -1);
+      for (int k = 0; k < numLocations; ++k)
+        _prog->m_poolNameIds[cached.location + k] = u.nameId;
     }
-    if (size > 1)
-      str += ");";
-    return str;
   }
 
-  /** \brief Bind uniform  uint vector to shader
-  *
-  * @param _progID  GL Program ID
-  */
-  void UniformPool::UniformVecui::bind( GLuint _progID ) const {
-    checkGLError2("prev opengl error");
-    GLint location = glGetUniformLocation(_progID, id.c_str());
-    checkGLError2(id.c_str());
-
-    switch (size){
-        case 1:
-          glUniform1uiv(location, 1, (GLuint*)val.data());
-          break;
-        case 2:
-          glUniform2uiv(location, 1, (GLuint*)val.data());
-          break;
-        case 3:
-          glUniform3uiv(location, 1, (GLuint*)val.data());
-          break;
-        case 4:
-          glUniform4uiv(location, 1, (GLuint*)val.data());
-          break;
-
-        default:
-          std::cerr << "UniformPool::UniformVecui : invalid size "  << size << std::endl;
-          break;
-    }
-
-    checkGLError2(id.c_str());
-  }
+  /** \brief Send all stored uniforms to program
+   *
+   *  @param _prog opengl program id
+   */
+  void UniformPool::bind( GLuint _prog ) const {
+    for (size_t i = 0; i < uniforms_.size(); ++i) {
+      const Uniform& u = uniforms_[i];
 
+      checkGLError2("prev opengl error");
+      GLint location = glGetUniformLocation(_prog, getName(u.nameId));
+      checkGLError2(getName(u.nameId));
 
-  /** \brief print uint vector to string
-  *
-  */
-  QString UniformPool::UniformVecui::toString() const {
-    const char* fmt = size > 1 ? "uniform uvec%2 %1 = uvec%2(" : "uniform uint %1 = ";
-    QString str = QString(fmt).arg(id.c_str()).arg(size);
-    for (int i = 0; i < size; ++i) {
-      str += QString::number(val[i]);
-      if (i + 1 < size)
-        str += ", ";
+      upload(u, data_.data() + u.offset, location);
     }
-    if (size > 1)
-      str += ");";
-    return str;
   }
 
-  /** \brief Bind uniform matrix to shader
-  *
-  * @param _progID  GL Program ID
-  */
-  void UniformPool::UniformMat::bind( GLuint _progID ) const {
-    checkGLError2("prev opengl error");
-    GLint location = glGetUniformLocation(_progID, id.c_str());
-    checkGLError2(id.c_str());
-
-    switch (size){
-      case 2: {
-          float tmp[4];
-          for (int i = 0; i < 2; ++i)
-            for (int k = 0; k < 2; ++k)
-              tmp[i*2+k] = val.data()[i*4+k];
-          glUniformMatrix2fv(location, 1, transposed, tmp);
-        } break;
-
-      case 3: {
-        float tmp[9];
-        for (int i = 0; i < 3; ++i)
-          for (int k = 0; k < 3; ++k)
-            tmp[i*3+k] = val.data()[i*4+k];
-          glUniformMatrix3fv(location, 1, transposed, tmp);
-        } break;
-
-      case 4: glUniformMatrix4fv(location, 1, transposed, val.data()); break;
-
-      default:
-        std::cerr << "UniformPool::UniformMat : invalid size "  << size << std::endl;
+  /** \brief Upload a uniform value to the active program
+   *
+   * @param _uniform  uniform entry
+   * @param _value    value of the uniform
+   * @param _location location of the uniform
+   */
+  void UniformPool::upload( const Uniform& _uniform, const unsigned char* _value, GLint _location ) {
+    const GLfloat* f = reinterpret_cast<const GLfloat*>(_value);
+    const GLint* n = reinterpret_cast<const GLint*>(_value);
+    const GLuint* un = reinterpret_cast<const GLuint*>(_value);
+
+    switch (_uniform.type) {
+      case UNIFORM_FLOAT:
+        switch (_uniform.size) {
+          case 1: glUniform1fv(_location, 1, f); break;
+          case 2: glUniform2fv(_location, 1, f); break;
+          case 3: glUniform3fv(_location, 1, f); break;
+          case 4: glUniform4fv(_location, 1, f); break;
+        }
         break;
-    }
-
-    checkGLError2(id.c_str());
-  }
-
-
-  /** \brief print matrix to string
-  *
-  */
-  QString UniformPool::UniformMat::toString() const {
-    QString str = QString("uniform mat%2 %1 = {").arg(id.c_str()).arg(size);
-    for (int y = 0; y < size; ++y) {
-      str += "{";
-      for (int x = 0; x < size; ++x) {
-        str += QString::number(val(y,x));
-        if (x + 1 < size)
-          str += ", ";
-      }
-      str += "}";
-      if (y + 1 < size)
-        str += ", ";
-    }
-    str += "};";
-    return str;
-  }
-
-  /** \brief Bind uniform array to shader
-  *
-  * @param _progID  GL Program ID
-  */
-  void UniformPool::UniformBuf::bind( GLuint _progID ) const {
-    checkGLError2("prev opengl error");
-    GLint location = glGetUniformLocation(_progID, id.c_str());
-    checkGLError2(id.c_str());
-
-    if (integer){
-      glUniform1iv(location, size, (GLint*)val);
-    }
-    else{
-      glUniform1fv(location, size, val);
-    }
-
-    checkGLError2(id.c_str());
-  }
-
-
-  /** \brief print buffer id to string
-  *
-  */
-  QString UniformPool::UniformBuf::toString() const {
-    QString str = QString("uniform %3 %2[%1] = {").arg(id.c_str()).arg(size).arg(integer ? "int" : "float");
-    for (int y = 0; y < size; ++y) {
-      if (integer)
-        str += QString::number(((GLint*)val)[y]);
-      else
-        str += QString::number(val[y]);
-      if (y + 1 < size)
-        str += ", ";
-    }
-    str += "};";
-    return str;
-  }
-
-  /** \brief Creates a copy of input data
-  */
-  UniformPool::UniformBuf::UniformBuf()
-    : val(0), integer(false), size(0)
-  {
-  }
 
-  /** \brief Free data
-  */
-  UniformPool::UniformBuf::~UniformBuf() {
-    delete [] val;
-  }
-
-  
-  /** \brief Add or update a vector type uniform in pool
-  *
-  * @param _vec uniform specifier
-  */
-  void UniformPool::addVecf( const UniformVecf& _vec ) {
-    // look for existing uniform in pool
-    UniformListIt it = findEntry(_vec.id);
+      case UNIFORM_INT:
+        switch (_uniform.size) {
+          case 1: glUniform1iv(_location, 1, n); break;
+          case 2: glUniform2iv(_location, 1, n); break;
+          case 3: glUniform3iv(_location, 1, n); break;
+          case 4: glUniform4iv(_location, 1, n); break;
+        }
+        break;
 
-    // storage address of uniform
-    UniformVecf* dst = 0;
+      case UNIFORM_UINT:
+        switch (_uniform.size) {
+          case 1: glUniform1uiv(_location, 1, un); break;
+          case 2: glUniform2uiv(_location, 1, un); break;
+          case 3: glUniform3uiv(_location, 1, un); break;
+          case 4: glUniform4uiv(_location, 1, un); break;
+        }
+        break;
 
-    if ( it == pool_.end() ){
-      // create new entry
-      dst = new UniformVecf;
-      pool_.push_back(dst);
-    }
-    else{
-      // use existing entry
-      dst = dynamic_cast<UniformVecf*>( *it );
+      case UNIFORM_MAT:
+        switch (_uniform.size) {
+          case 2: glUniformMatrix2fv(_location, 1, _uniform.transposed, f); break;
+          case 3: glUniformMatrix3fv(_location, 1, _uniform.transposed, f); break;
+          case 4: glUniformMatrix4fv(_location, 1, _uniform.transposed, f); break;
+        }
+        break;
 
-      if (!dst)
-        std::cerr << "UniformPool::addVecf type of " << _vec.id << " incorrect." << std::endl;
-    }
+      case UNIFORM_FLOAT_ARRAY:
+        glUniform1fv(_location, _uniform.size, f);
+        break;
 
-    if (dst) {
-      // update data
-      dst->id = _vec.id;
-      dst->size = _vec.size;
-      dst->val = _vec.val;
+      case UNIFORM_INT_ARRAY:
+        glUniform1iv(_location, _uniform.size, n);
+        break;
     }
 
+    checkGLError2(getName(_uniform.nameId));
   }
 
-  /** \brief Add or update a vector type uniform in pool
-  *
-  * @param _vec uniform specifier
-  */
-  void UniformPool::addVeci( const UniformVeci& _vec ) {
-    // look for existing uniform in pool
-    UniformListIt it = findEntry(_vec.id);
-
-    // storage address of uniform
-    UniformVeci* dst = 0;
-
-    if ( it == pool_.end() ){
-      // create new entry
-      dst = new UniformVeci;
-      pool_.push_back(dst);
-    }
-    else{
-      // use existing entry
-      dst = dynamic_cast<UniformVeci*>( *it );
-
-      if (!dst)
-        std::cerr << "UniformPool::addVeci type of " << _vec.id << " incorrect." << std::endl;
-    }
+  /** \brief Add all uniforms of a pool to this pool
+   *
+   *  @param _src source uniform pool
+   */
+  void UniformPool::addPool( const UniformPool& _src ){
 
-    if (dst) {
-      // update data
-      dst->id = _vec.id;
-      dst->size = _vec.size;
-      dst->val = _vec.val;
+    for (size_t i = 0; i < _src.uniforms_.size(); ++i) {
+      const Uniform& u = _src.uniforms_[i];
+      setValue(u.nameId, u.type, u.size, _src.data_.data() + u.offset, u.bytes, u.transposed);
     }
-
   }
 
-  /** \brief Add or update a vector type uniform in pool
+  /** \brief Add or update a uniform in pool
   *
-  * @param _vec uniform specifier
+  * @param _nameId     interned name of the uniform
+  * @param _type       type of the uniform
+  * @param _size       number of vector components, matrix dimension or array length
+  * @param _value      new value
+  * @param _bytes      size of the value in bytes
+  * @param _transposed matrices only
   */
-  void UniformPool::addVecui( const UniformVecui& _vec ) {
+  void UniformPool::setValue( int _nameId, UniformType _type, int _size, const void* _value, size_t _bytes, bool _transposed ) {
     // look for existing uniform in pool
-    UniformListIt it = findEntry(_vec.id);
-
-    // storage address of uniform
-    UniformVecui* dst = 0;
+    size_t idx = 0;
+    while (idx < uniforms_.size() && uniforms_[idx].nameId != _nameId)
+      ++idx;
 
-    if ( it == pool_.end() ){
+    if (idx == uniforms_.size()) {
       // create new entry
-      dst = new UniformVecui;
-      pool_.push_back(dst);
+      Uniform u;
+      u.nameId = _nameId;
+      u.type = _type;
+      u.size = 0;
+      u.transposed = false;
+      u.offset = data_.size();
+      u.bytes = 0;
+      uniforms_.push_back(u);
     }
-    else{
-      // use existing entry
-      dst = dynamic_cast<UniformVecui*>( *it );
 
-      if (!dst)
-        std::cerr << "UniformPool::addVecui type of " << _vec.id << " incorrect." << std::endl;
-    }
+    Uniform& dst = uniforms_[idx];
 
-    if (dst) {
-      // update data
-      dst->id = _vec.id;
-      dst->size = _vec.size;
-      dst->val = _vec.val;
-    }
+    // int and float arrays share one entry type
+    const bool array = (dst.type == UNIFORM_FLOAT_ARRAY || dst.type == UNIFORM_INT_ARRAY) &&
+                       (_type == UNIFORM_FLOAT_ARRAY || _type == UNIFORM_INT_ARRAY);
 
-  }
-
-  /** \brief Add or update a matrix type uniform in pool
-  *
-  * @param _mat uniform specifier
-  */
-  void UniformPool::addMatrix( const UniformMat& _mat ) {
-    // look for existing uniform in pool
-    UniformListIt it = findEntry(_mat.id);
-
-    // storage address of uniform
-    UniformMat* dst = 0;
-
-    if ( it == pool_.end() ){
-      // create new entry
-      dst = new UniformMat;
-      pool_.push_back(dst);
+    if (array)
+      dst.type = _type;
+    else if (dst.type != _type) {
+      std::cerr << "UniformPool::setUniform type of " << getName(_nameId) << " incorrect." << std::endl;
+      return;
     }
-    else{
-      // use existing entry
-      dst = dynamic_cast<UniformMat*>( *it );
-
-      if (!dst)
-        std::cerr << "UniformPool::addMatrix type of " << _mat.id << " incorrect." << std::endl;
-    }
-
-    if (dst) {
-      // update data
-      dst->id = _mat.id;
-      dst->size = _mat.size;
-      dst->transposed = _mat.transposed;
-      dst->val = _mat.val;
-    }
-  }
-
-  /** \brief Add or update an array type uniform in pool
-  *
-  * @param _name Uniform name
-  * @param _values array data
-  * @param _count array size (in dwords)
-  * @param _integer integer/float array
-  */
-  void UniformPool::addBuf( const char* _name, void* _values, int _count, bool _integer ) {
-    // look for existing uniform in pool
-    UniformListIt it = findEntry(_name);
 
-    // storage address of uniform
-    UniformBuf* dst = 0;
+    if (dst.bytes != _bytes) {
+      // move the value to the end of the buffer
+      if (dst.bytes) {
+        data_.erase(data_.begin() + dst.offset, data_.begin() + dst.offset + dst.bytes);
 
-    if ( it == pool_.end() ){
-      // create new entry
-      dst = new UniformBuf();
-      pool_.push_back(dst);
-    }
-    else{
-      // use existing entry
-      dst = dynamic_cast<UniformBuf*>( *it );
+        for (size_t i = 0; i < uniforms_.size(); ++i) {
+          if (uniforms_[i].offset > dst.offset)
+            uniforms_[i].offset -= dst.bytes;
+        }
+      }
 
-      if (!dst)
-        std::cerr << "UniformPool::addBuf type of " << _name << " incorrect." << std::endl;
+      dst.offset = data_.size();
+      dst.bytes = _bytes;
+      data_.resize(data_.size() + _bytes);
     }
 
-    if (dst) {
-      // update data
-      dst->id = _name;
+    dst.size = _size;
+    dst.transposed = _transposed;
 
-      if (dst->size < _count)
-      {
-        // resize
-        delete [] dst->val;
-        dst->val = new float[_count];
-      }
-
-      dst->size = _count;
-
-      if (_values)
-        memcpy(dst->val, _values, _count * sizeof(float));
-    }
+    if (_value && _bytes)
+      memmove(data_.data() + dst.offset, _value, _bytes); // _value may point into data_ on self assignment
   }
 
 
@@ -612,14 +422,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, GLint _value ) {
-    // create uniform descriptor
-    UniformVeci tmp;
-    tmp.id = _name;
-    tmp.size = 1;
-    tmp.val[0] = _value;
-
-    // add/update in pool
-    addVeci(tmp);
+    setValue(getNameId(_name), UNIFORM_INT, 1, &_value, sizeof(GLint));
   }
 
   /** \brief Set ivec2 uniform to specified value
@@ -628,15 +431,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec2i &_value ) {
-    // create uniform descriptor
-    UniformVeci tmp;
-    tmp.id = _name;
-    tmp.size = 2;
-    tmp.val[0] = _value[0];
-    tmp.val[1] = _value[1];
-
-    // add/update in pool
-    addVeci(tmp);
+    setValue(getNameId(_name), UNIFORM_INT, 2, _value.data(), 2 * sizeof(GLint));
   }
 
   /** \brief Set ivec3 uniform to specified value
@@ -645,16 +440,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec3i &_value ) {
-    // create uniform descriptor
-    UniformVeci tmp;
-    tmp.id = _name;
-    tmp.size = 3;
-    tmp.val[0] = _value[0];
-    tmp.val[1] = _value[1];
-    tmp.val[2] = _value[2];
-
-    // add/update in pool
-    addVeci(tmp);
+    setValue(getNameId(_name), UNIFORM_INT, 3, _value.data(), 3 * sizeof(GLint));
   }
 
   /** \brief Set ivec4 uniform to specified value
@@ -663,14 +449,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec4i &_value ) {
-    // create uniform descriptor
-    UniformVeci tmp;
-    tmp.id = _name;
-    tmp.size = 4;
-    tmp.val = _value;
-
-    // add/update in pool
-    addVeci(tmp);
+    setValue(getNameId(_name), UNIFORM_INT, 4, _value.data(), 4 * sizeof(GLint));
   }
 
   /** \brief Set uint uniform to specified value
@@ -679,14 +458,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, GLuint _value ) {
-    // create uniform descriptor
-    UniformVecui tmp;
-    tmp.id = _name;
-    tmp.size = 1;
-    tmp.val[0] = _value;
-
-    // add/update in pool
-    addVecui(tmp);
+    setValue(getNameId(_name), UNIFORM_UINT, 1, &_value, sizeof(GLuint));
   }
 
   /** \brief Set uvec2 uniform to specified value
@@ -695,15 +467,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec2ui &_value ) {
-    // create uniform descriptor
-    UniformVecui tmp;
-    tmp.id = _name;
-    tmp.size = 2;
-    tmp.val[0] = _value[0];
-    tmp.val[1] = _value[1];
-
-    // add/update in pool
-    addVecui(tmp);
+    setValue(getNameId(_name), UNIFORM_UINT, 2, _value.data(), 2 * sizeof(GLuint));
   }
   
   /** \brief Set uvec3 uniform to specified value
@@ -712,16 +476,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec3ui &_value ) {
-    // create uniform descriptor
-    UniformVecui tmp;
-    tmp.id = _name;
-    tmp.size = 3;
-    tmp.val[0] = _value[0];
-    tmp.val[1] = _value[1];
-    tmp.val[2] = _value[2];
-
-    // add/update in pool
-    addVecui(tmp);
+    setValue(getNameId(_name), UNIFORM_UINT, 3, _value.data(), 3 * sizeof(GLuint));
   }  
   
   /** \brief Set uvec4 uniform to specified value
@@ -730,14 +485,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec4ui &_value ) {
-    // create uniform descriptor
-    UniformVecui tmp;
-    tmp.id = _name;
-    tmp.size = 4;
-    tmp.val = _value;
-
-    // add/update in pool
-    addVecui(tmp);
+    setValue(getNameId(_name), UNIFORM_UINT, 4, _value.data(), 4 * sizeof(GLuint));
   }
 
 
@@ -747,14 +495,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, GLfloat _value ) {
-    // create uniform descriptor
-    UniformVecf tmp;
-    tmp.id = _name;
-    tmp.size = 1;
-    tmp.val[0] = _value;
-
-    // add/update in pool
-    addVecf(tmp);
+    setValue(getNameId(_name), UNIFORM_FLOAT, 1, &_value, sizeof(GLfloat));
   }
 
   /** \brief Set vec2 uniform to specified value
@@ -763,15 +504,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec2f &_value ) {
-    // create uniform descriptor
-    UniformVecf tmp;
-    tmp.id = _name;
-    tmp.size = 2;
-    tmp.val[0] = _value[0];
-    tmp.val[1] = _value[1];
-
-    // add/update in pool
-    addVecf(tmp);
+    setValue(getNameId(_name), UNIFORM_FLOAT, 2, _value.data(), 2 * sizeof(GLfloat));
   }
 
   /** \brief Set vec3 uniform to specified value
@@ -780,16 +513,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec3f &_value ) {
-    // create uniform descriptor
-    UniformVecf tmp;
-    tmp.id = _name;
-    tmp.size = 3;
-    tmp.val[0] = _value[0];
-    tmp.val[1] = _value[1];
-    tmp.val[2] = _value[2];
-
-    // add/update in pool
-    addVecf(tmp);
+    setValue(getNameId(_name), UNIFORM_FLOAT, 3, _value.data(), 3 * sizeof(GLfloat));
   }
 
   /** \brief Set vec4 uniform to specified value
@@ -798,14 +522,7 @@ namespace GLSL {
   * @param _value New value of the uniform
   */
   void UniformPool::setUniform( const char *_name, const ACG::Vec4f &_value ) {
-    // create uniform descriptor
-    UniformVecf tmp;
-    tmp.id = _name;
-    tmp.size = 4;
-    tmp.val = _value;
-
-    // add/update in pool
-    addVecf(tmp);
+    setValue(getNameId(_name), UNIFORM_FLOAT, 4, _value.data(), 4 * sizeof(GLfloat));
   }
 
   /** \brief Set 4x4fMatrix uniform to specified value
@@ -815,15 +532,7 @@ namespace GLSL {
    * @param _transposed Is the matrix transposed?
    */
   void UniformPool::setUniform( const char *_name, const ACG::GLMatrixf &_value, bool _transposed ) {
-    // create uniform descriptor
-    UniformMat tmp;
-    tmp.id = _name;
-    tmp.transposed = _transposed;
-    tmp.size = 4;
-    tmp.val = _value;
-
-    // add/update in pool
-    addMatrix(tmp);
+    setValue(getNameId(_name), UNIFORM_MAT, 4, _value.data(), 16 * sizeof(GLfloat), _transposed);
   }
 
   /** \brief Set 3x3fMatrix uniform to specified value
@@ -833,15 +542,13 @@ namespace GLSL {
    * @param _transposed Is the matrix transposed?
    */
   void UniformPool::setUniformMat3( const char *_name, const ACG::GLMatrixf &_value, bool _transposed ) {
-    // create uniform descriptor
-    UniformMat tmp;
-    tmp.id = _name;
-    tmp.transposed = _transposed;
-    tmp.size = 3;
-    tmp.val = _value;
-
-    // add/update in pool
-    addMatrix(tmp);
+    // store the upper left 3x3 block
+    float tmp[9];
+    for (int i = 0; i < 3; ++i)
+      for (int k = 0; k < 3; ++k)
+        tmp[i*3+k] = _value.data()[i*4+k];
+
+    setValue(getNameId(_name), UNIFORM_MAT, 3, tmp, 9 * sizeof(GLfloat), _transposed);
   }
 
   /** \brief Set int array uniform to specified values
@@ -851,8 +558,7 @@ namespace GLSL {
    *  @param _count Number of values in the given array
    */
   void UniformPool::setUniform( const char *_name, GLint *_values, int _count ) {
-    // add/update in pool
-    addBuf(_name, _values, _count, true);
+    setValue(getNameId(_name), UNIFORM_INT_ARRAY, _count, _values, _count * sizeof(GLint));
   }
 
   /** \brief Set float array uniform to specified values
@@ -862,8 +568,7 @@ namespace GLSL {
    *  @param _count Number of values in the given array
    */
   void UniformPool::setUniform( const char *_name, GLfloat *_values, int _count ) {
-    // add/update in pool
-    addBuf(_name, _values, _count, false);
+    setValue(getNameId(_name), UNIFORM_FLOAT_ARRAY, _count, _values, _count * sizeof(GLfloat));
   }
 
 }
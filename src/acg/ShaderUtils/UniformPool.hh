@@ -49,8 +49,7 @@
 #include <ACG/Math/GLMatrixT.hh>
 #include <ACG/ShaderUtils/GLSLShader.hh>
 
-#include <list>
-#include <string>
+#include <vector>
 
 
 //==============================================================================
@@ -60,6 +59,10 @@ namespace GLSL {
   /** \brief GLSL uniform pool
   *
   * A uniform pool collects values for shader uniforms
+  *
+  * Values are stored in one contiguous buffer and uniforms are identified by interned
+  * name ids. Binding to a GLSL::Program resolves uniform locations once per program and
+  * skips uploads of values the program already holds from a previous bind.
   */
   class ACGDLLEXPORT UniformPool {
 
@@ -124,89 +127,51 @@ namespace GLSL {
      */
     UniformPool& operator =(const UniformPool& _other);
 
-  private:
-    struct UniformBase {
-      std::string id;
-
-
-      UniformBase() {}
-      virtual ~UniformBase() {}
-
-      virtual void bind(GLuint _progID) const {}
-
-      virtual QString toString() const { return QString(""); }
-    };
-
-    struct UniformVecf : public UniformBase {
-      ACG::Vec4f val;
-      int size;
-
-      void bind(GLuint _progID) const override;
-
-      virtual QString toString() const override;
-    };
-
-    // separate float int vector because sizeof(int) != sizeof(float) for some compilers
-    struct UniformVeci : public UniformBase {
-      ACG::Vec4i val;
-      int size;
-
-      void bind(GLuint _progID) const override;
-
-      virtual QString toString() const override;
-    };
-
-    struct UniformVecui : public UniformBase {
-      ACG::Vec4ui val;
-      int size;
-
-      void bind(GLuint _progID) const override;
-
-      virtual QString toString() const override;
-    };
-
-
-    struct UniformMat : UniformBase {
-      ACG::Matrix4x4f val;
-
-      bool transposed;
-      int size;
+    /** \brief Id of a uniform name
+     *
+     * Names are interned process-wide, equal names always map to the same id.
+     *
+     * @param _name  Name of the uniform
+     * @return id of the name
+     */
+    static int getNameId(const char* _name);
 
-      void bind(GLuint _progID) const override;
+    /** \brief Name of an id returned by getNameId()
+     */
+    static const char* getName(int _nameId);
 
-      virtual QString toString() const override;
+  private:
+    enum UniformType {
+      UNIFORM_FLOAT,
+      UNIFORM_INT,
+      UNIFORM_UINT,
+      UNIFORM_MAT,
+      UNIFORM_FLOAT_ARRAY,
+      UNIFORM_INT_ARRAY
     };
 
-    struct UniformBuf : public UniformBase {
-      float* val;
-      
-      bool integer;
-      int size;
-      
-      UniformBuf();
-      ~UniformBuf();
-
-      void bind(GLuint _progID) const override;
-
-      virtual QString toString() const override;
+    /// uniform entry, the value is stored in data_
+    struct Uniform {
+      int nameId;        ///< interned name, see getNameId()
+      UniformType type;
+      int size;          ///< number of vector components, matrix dimension or array length
+      bool transposed;   ///< matrices only
+      size_t offset;     ///< offset of the value in data_ in bytes
+      size_t bytes;      ///< size of the value in bytes
     };
 
+  protected:
+    /// uniforms in the order they were added
+    std::vector<Uniform> uniforms_;
 
-    typedef std::list<UniformBase*> UniformList;
-    typedef UniformList::iterator UniformListIt;
-    
-    /// list of uniform params
-    UniformList pool_;
+    /// values of all uniforms
+    std::vector<unsigned char> data_;
 
   private:
 
-    UniformListIt findEntry(std::string _name);
+    void setValue(int _nameId, UniformType _type, int _size, const void* _value, size_t _bytes, bool _transposed = false);
 
-    void addVecf(const UniformVecf& _vec);
-    void addVeci(const UniformVeci& _vec);
-    void addVecui(const UniformVecui& _vec);
-    void addMatrix(const UniformMat& _mat);
-    void addBuf(const char *_name, void *_values, int _count, bool _integer);
+    static void upload(const Uniform& _uniform, const unsigned char* _value, GLint _location);
   };
 
   typedef UniformPool* PtrUniformPool;
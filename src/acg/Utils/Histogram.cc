@@ -39,4 +39,173 @@
  *                                                                           *
 \*===========================================================================*/
 
-//#include "Histogram.hh"
+#include "Histogram.hh"
+
+#include <limits>
+
+namespace ACG {
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+// Arcsine scale function of the t-digest and its inverse.
+double scale(double q, double compression)
+{
+    return compression / (2. * pi) * std::asin(2. * q - 1.);
+}
+
+double inverseScale(double k, double compression)
+{
+    const double x = std::min(std::max(k * 2. * pi / compression, -pi / 2.), pi / 2.);
+    return (std::sin(x) + 1.) / 2.;
+}
+
+}
+
+QuantileDigest::QuantileDigest(double compression)
+    : compression_(std::max(compression, 10.)),
+      count_(0.),
+      min_(std::numeric_limits<double>::infinity()),
+      max_(-std::numeric_limits<double>::infinity())
+{
+}
+
+void QuantileDigest::add(double value, double weight)
+{
+    if (!(weight > 0.)) return;
+
+    Centroid c = { value, weight };
+    buffer_.push_back(c);
+    count_ += weight;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+
+    if (buffer_.size() >= static_cast<size_t>(5. * compression_))
+        compress(centroids_, buffer_, count_, compression_);
+}
+
+void QuantileDigest::merge(const QuantileDigest &other)
+{
+    if (other.count_ == 0.) return;
+
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    buffer_.insert(buffer_.end(), other.buffer_.begin(), other.buffer_.end());
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+
+    compress(centroids_, buffer_, count_, compression_);
+}
+
+void QuantileDigest::compress(std::vector<Centroid> &centroids, std::vector<Centroid> &buffer,
+                              double count, double compression)
+{
+    if (buffer.empty()) return;
+
+    // the centroids are sorted already
+    const auto less_mean = [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; };
+    std::sort(buffer.begin(), buffer.end(), less_mean);
+    const size_t n_buffered = buffer.size();
+    buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+    std::inplace_merge(buffer.begin(), buffer.begin() + n_buffered, buffer.end(), less_mean);
+
+    centroids.clear();
+
+    // Greedily merge neighbors while the merged centroid stays within one unit of the scale function.
+    double weight_so_far = 0.;
+    double weight_limit = count * inverseScale(scale(0., compression) + 1., compression);
+    Centroid current = buffer.front();
+
+    for (size_t i = 1; i < buffer.size(); ++i) {
+        const Centroid &next = buffer[i];
+        if (weight_so_far + current.weight + next.weight <= weight_limit) {
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        } else {
+            weight_so_far += current.weight;
+            centroids.push_back(current);
+            weight_limit = count * inverseScale(scale(weight_so_far / count, compression) + 1., compression);
+            current = next;
+        }
+    }
+    centroids.push_back(current);
+
+    buffer.clear();
+}
+
+std::vector<QuantileDigest::Centroid> QuantileDigest::merged() const
+{
+    std::vector<Centroid> centroids = centroids_;
+    std::vector<Centroid> buffer = buffer_;
+    compress(centroids, buffer, count_, compression_);
+    return centroids;
+}
+
+/*
+ * Ranks and quantiles interpolate linearly between the points (min, 0), (mean_i, weight below
+ * centroid i + half its weight) and (max, count).
+ */
+
+double QuantileDigest::quantile(double q) const
+{
+    if (count_ == 0.) return std::numeric_limits<double>::quiet_NaN();
+
+    const std::vector<Centroid> centroids = merged();
+    const double target = std::min(std::max(q, 0.), 1.) * count_;
+
+    double prev_value = min_, prev_rank = 0.;
+    double weight_so_far = 0.;
+
+    for (const Centroid &c: centroids) {
+        const double rank = weight_so_far + c.weight / 2.;
+        if (target <= rank) {
+            if (rank == prev_rank) return c.mean;
+            return prev_value + (c.mean - prev_value) * (target - prev_rank) / (rank - prev_rank);
+        }
+        prev_value = c.mean;
+        prev_rank = rank;
+        weight_so_far += c.weight;
+    }
+
+    if (count_ == prev_rank) return max_;
+    return prev_value + (max_ - prev_value) * (target - prev_rank) / (count_ - prev_rank);
+}
+
+std::vector<double> QuantileDigest::ranks(const std::vector<double> &values) const
+{
+    std::vector<double> result(values.size(), 0.);
+    if (count_ == 0.) return result;
+
+    const std::vector<Centroid> centroids = merged();
+
+    double prev_value = min_, prev_rank = 0.;
+    double weight_so_far = 0.;
+    size_t c = 0;
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        const double x = values[i];
+
+        if (x <= min_) { result[i] = 0.; continue; }
+        if (x >= max_) { result[i] = count_; continue; }
+
+        // advance to the segment containing x
+        while (c < centroids.size() && centroids[c].mean < x) {
+            prev_value = centroids[c].mean;
+            prev_rank = weight_so_far + centroids[c].weight / 2.;
+            weight_so_far += centroids[c].weight;
+            ++c;
+        }
+
+        const double next_value = (c < centroids.size()) ? centroids[c].mean : max_;
+        const double next_rank = (c < centroids.size()) ? weight_so_far + centroids[c].weight / 2. : count_;
+
+        result[i] = (next_value > prev_value)
+                ? prev_rank + (next_rank - prev_rank) * (x - prev_value) / (next_value - prev_value)
+                : prev_rank;
+    }
+
+    return result;
+}
+
+} // namespace ACG
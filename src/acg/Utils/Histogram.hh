@@ -45,9 +45,11 @@
 #include <cassert>
 #include <memory>
 #include <exception>
+#include <stdexcept>
 #include <algorithm>
 #include <type_traits>
 #include <map>
+#include <cmath>
 
 #include <QString>
 
@@ -171,25 +173,11 @@ std::unique_ptr<Histogram> create_histogram_unbinned(const std::map<T, size_t> &
     return ptr::make_unique<UnbinnedHistogram<T>>(std::move(histogram), std::move(values));
 }
 
-template<typename T, typename Iterable>
-std::unique_ptr<Histogram> create_histogram_autorange(const Iterable &range, size_t max_bins = 50)
+/// Bin boundaries and widths of create_histogram_autorange for n values in [min, max].
+template<typename T>
+void histogram_bin_boundaries(const T min, const T max, const size_t n, const size_t max_bins,
+                              std::vector<T> &bin_boundaries, std::vector<double> &bin_widths)
 {
-// we need to be careful with ranges, some sums (e.g. INT_MAX - INT_MIN) do not fit into a signed int,
-// so we store bin sizes as doubles. With specialization or some tricks we
-// could probably use the next-biggest integer type, but if we're using
-// the biggest integer type already, we should to fall back to double anyways.
-
-
-    std::vector<T> bin_boundaries;
-    std::vector<size_t> bins;
-    std::vector<double> bin_widths;
-
-    const size_t n = std::distance(begin(range), end(range));
-    if (n == 0) return {};
-    const auto minmax = std::minmax_element(begin(range), end(range));
-    const T min = *minmax.first;
-    const T max = *minmax.second;
-
     const double min_dbl = static_cast<double>(min);
     const double val_range = static_cast<double>(max) - min_dbl;
 
@@ -218,6 +206,29 @@ std::unique_ptr<Histogram> create_histogram_autorange(const Iterable &range, siz
     bin_widths.push_back(max - last_boundary);
 
     bin_boundaries.shrink_to_fit();
+}
+
+template<typename T, typename Iterable>
+std::unique_ptr<Histogram> create_histogram_autorange(const Iterable &range, size_t max_bins = 50)
+{
+// we need to be careful with ranges, some sums (e.g. INT_MAX - INT_MIN) do not fit into a signed int,
+// so we store bin sizes as doubles. With specialization or some tricks we
+// could probably use the next-biggest integer type, but if we're using
+// the biggest integer type already, we should to fall back to double anyways.
+
+
+    std::vector<T> bin_boundaries;
+    std::vector<size_t> bins;
+    std::vector<double> bin_widths;
+
+    const size_t n = std::distance(begin(range), end(range));
+    if (n == 0) return {};
+    const auto minmax = std::minmax_element(begin(range), end(range));
+    const T min = *minmax.first;
+    const T max = *minmax.second;
+
+    histogram_bin_boundaries(min, max, n, max_bins, bin_boundaries, bin_widths);
+
     size_t n_bins = bin_boundaries.size() - 1;
     bins.resize(n_bins);
 
@@ -264,5 +275,215 @@ std::unique_ptr<Histogram> create_histogram_auto(const Iterable &range, size_t m
     }
 }
 
-} // namespace ACG
+/**
+ * Mergeable sketch of a distribution for approximate ranks and quantiles (a merging t-digest).
+ *
+ * Values are buffered and merged into weighted centroids. The size of a centroid is bounded by
+ * the arcsine scale function, so the tails are resolved more finely than the median. Memory is
+ * O(compression) regardless of the number of values, and the rank error is roughly
+ * count / compression near the median and much smaller near the tails.
+ */
+class ACGDLLEXPORT QuantileDigest {
+public:
+    explicit QuantileDigest(double compression = 1000.);
+
+    /// Add a value with a weight.
+    void add(double value, double weight = 1.);
+
+    /// Add all values of another digest.
+    void merge(const QuantileDigest &other);
+
+    /// Total weight of all values.
+    double getCount() const { return count_; }
+    double getMin() const { return min_; }
+    double getMax() const { return max_; }
+
+    /// Approximate value below which a fraction q of the weight lies, q in [0, 1].
+    double quantile(double q) const;
+
+    /// Approximate weight of the values below each of the given ascending values.
+    std::vector<double> ranks(const std::vector<double> &values) const;
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    // Merge the buffer into the centroids.
+    static void compress(std::vector<Centroid> &centroids, std::vector<Centroid> &buffer,
+                         double count, double compression);
+
+    // Sorted centroids including the buffered values.
+    std::vector<Centroid> merged() const;
+
+    double compression_;
+    double count_;
+    double min_, max_;
+    std::vector<Centroid> centroids_;
+    std::vector<Centroid> buffer_;
+};
+
+/**
+ * Single pass, mergeable builder of the histograms of create_histogram_auto.
+ *
+ * Tracks the exact count, minimum and maximum, the exact counts of up to max_bins
+ * distinct values and a QuantileDigest. If at most max_bins distinct values were added,
+ * createHistogram() returns the exact UnbinnedHistogram. Otherwise it returns a HistogramT
+ * with the bin boundaries of create_histogram_autorange, and the bin counts are estimated
+ * from the digest.
+ *
+ * Accumulators of disjoint parts of the input can be filled independently, e.g. one per
+ * thread, and merged afterwards:
+ *
+ *     std::vector<ACG::HistogramAccumulator<double>> partial(n_threads);
+ *     #pragma omp parallel for
+ *     for (int i = 0; i < n; ++i)
+ *         partial[omp_get_thread_num()].add(quality[i]);
+ *     for (int t = 1; t < n_threads; ++t)
+ *         partial[0].merge(partial[t]);
+ *     auto hist = partial[0].createHistogram();
+ */
+template<typename T>
+class HistogramAccumulator {
+public:
+    explicit HistogramAccumulator(size_t max_bins = 50, double compression = 1000.)
+        : max_bins_(max_bins), count_(0), min_(), max_(),
+          too_many_unique_(false), digest_(compression)
+    {}
+
+    void add(const T &value)
+    {
+        if (count_ == 0) {
+            min_ = max_ = value;
+        } else {
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+        }
+        ++count_;
+
+        if (!too_many_unique_) {
+            ++unique_counts_[value];
+            checkUniqueCounts();
+        }
+
+        digest_.add(static_cast<double>(value));
+    }
+
+    template<typename Iterable>
+    void addRange(const Iterable &range)
+    {
+        for (const auto &v: range)
+            add(v);
+    }
+
+    /// Add the values of another accumulator with the same max_bins.
+    void merge(const HistogramAccumulator &other)
+    {
+        if (other.count_ == 0) return;
+
+        if (count_ == 0) {
+            min_ = other.min_;
+            max_ = other.max_;
+        } else {
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+        }
+        count_ += other.count_;
+
+        too_many_unique_ = too_many_unique_ || other.too_many_unique_;
+        if (!too_many_unique_) {
+            for (const auto &entry: other.unique_counts_)
+                unique_counts_[entry.first] += entry.second;
+            checkUniqueCounts();
+        }
+
+        digest_.merge(other.digest_);
+    }
+
+    size_t getCount() const { return count_; }
+    T getMin() const { return min_; }
+    T getMax() const { return max_; }
+
+    /// Approximate quantile, q in [0, 1].
+    double quantile(double q) const { return digest_.quantile(q); }
+
+    /**
+     * Create the histogram of all added values.
+     *
+     * @param outlier_fraction Binned histograms span the quantiles outlier_fraction and
+     *        1 - outlier_fraction instead of [min, max]. Values outside are counted in the
+     *        first and last bin.
+     * @return null if no values were added.
+     */
+    std::unique_ptr<Histogram> createHistogram(double outlier_fraction = 0.) const
+    {
+        if (count_ == 0) return {};
+
+        if (!too_many_unique_)
+            return create_histogram_unbinned(unique_counts_);
+
+        T lower = min_, upper = max_;
+        if (outlier_fraction > 0.) {
+            lower = std::max(min_, roundQuantile(digest_.quantile(outlier_fraction), false));
+            upper = std::min(max_, roundQuantile(digest_.quantile(1. - outlier_fraction), true));
+            if (!(lower < upper)) {
+                lower = min_;
+                upper = max_;
+            }
+        }
+
+        std::vector<T> bin_boundaries;
+        std::vector<double> bin_widths;
+        histogram_bin_boundaries(lower, upper, count_, max_bins_, bin_boundaries, bin_widths);
+
+        const size_t n_bins = bin_boundaries.size() - 1;
+
+        // Values equal to a boundary belong to the bin above it. Integral values
+        // below an integral boundary are at most boundary - 1.
+        std::vector<double> inner_boundaries(n_bins - 1);
+        for (size_t i = 1; i < n_bins; ++i)
+            inner_boundaries[i - 1] = static_cast<double>(bin_boundaries[i]) - (std::is_integral<T>::value ? .5 : 0.);
 
+        const std::vector<double> ranks = digest_.ranks(inner_boundaries);
+
+        std::vector<size_t> bins(n_bins);
+        size_t below = 0;
+        for (size_t i = 0; i < n_bins; ++i) {
+            const size_t rank = (i + 1 < n_bins)
+                    ? std::min(count_, std::max(below, static_cast<size_t>(std::floor(ranks[i] + .5))))
+                    : count_;
+            bins[i] = rank - below;
+            below = rank;
+        }
+
+        return ptr::make_unique<HistogramT<T>>(std::move(bins), std::move(bin_boundaries), std::move(bin_widths));
+    }
+
+private:
+    void checkUniqueCounts()
+    {
+        if (unique_counts_.size() > max_bins_) {
+            too_many_unique_ = true;
+            unique_counts_.clear();
+        }
+    }
+
+    static T roundQuantile(double value, bool up)
+    {
+        if (std::is_integral<T>::value)
+            value = up ? std::ceil(value) : std::floor(value);
+        return static_cast<T>(value);
+    }
+
+    size_t max_bins_;
+    size_t count_;
+    T min_, max_;
+
+    bool too_many_unique_;
+    std::map<T, size_t> unique_counts_;
+
+    QuantileDigest digest_;
+};
+
+} // namespace ACG
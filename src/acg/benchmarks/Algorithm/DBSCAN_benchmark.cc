@@ -0,0 +1,162 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+#include <benchmark/benchmark.h>
+
+#include "../../Algorithm/DBSCANT.hh"
+
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+struct Point {
+    Point(double x, double y) : x(x), y(y) {}
+
+    class DistanceFunc {
+        public:
+            double operator() (const Point &a, const Point &b) const {
+                return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+            }
+    };
+
+    class Position {
+        public:
+            Position(double x, double y) { v[0] = x; v[1] = y; }
+            double operator[] (int i) const { return v[i]; }
+        private:
+            double v[2];
+    };
+
+    class PositionFunc {
+        public:
+            Position operator() (const Point &a) const {
+                return Position(a.x, a.y);
+            }
+    };
+
+    double x, y;
+};
+
+typedef ACG::Algorithm::GridNeighborhoodIndex<Point::PositionFunc, 2> GridIndex;
+typedef ACG::Algorithm::KdTreeNeighborhoodIndex<Point::PositionFunc, 2> KdTreeIndex;
+typedef ACG::Algorithm::_DBSCAN_PRIVATE::constant_1<Point> ConstantWeight;
+
+/// 60 blobs of different density on background noise, same as in the DBSCAN tests
+std::vector<Point> createBlobs(const int n) {
+    std::vector<Point> points;
+    points.reserve(n);
+
+    unsigned int seed = 12345;
+    for (int i = 0; i < n; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const int blob = (seed >> 8) % 64;
+        seed = seed * 1664525u + 1013904223u;
+        const double dx = ((seed >> 8) % 2001) / 1000.0 - 1.0;
+        seed = seed * 1664525u + 1013904223u;
+        const double dy = ((seed >> 8) % 2001) / 1000.0 - 1.0;
+
+        if (blob < 4) {
+            // background noise
+            points.push_back(Point(std::floor((dx + 1.0) * 200.0), std::floor((dy + 1.0) * 200.0)));
+        } else {
+            const double radius = 2.0 + blob % 7;
+            points.push_back(Point((blob % 8) * 50.0 + dx * radius * std::fabs(dx), (blob / 8) * 50.0 + dy * radius));
+        }
+    }
+    return points;
+}
+
+} // anonymous namespace
+
+
+static void BM_DBSCANBruteForce(benchmark::State& state) {
+    const std::vector<Point> points = createBlobs(int(state.range(0)));
+    std::vector<int> clusters;
+
+    for (auto _ : state) {
+        clusters.clear();
+        benchmark::DoNotOptimize(ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                        std::back_inserter(clusters), 1.0, 4.0));
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_DBSCANBruteForce)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+static void BM_DBSCANGrid(benchmark::State& state) {
+    const std::vector<Point> points = createBlobs(int(state.range(0)));
+    std::vector<int> clusters;
+
+    for (auto _ : state) {
+        clusters.clear();
+        benchmark::DoNotOptimize(ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                        std::back_inserter(clusters), 1.0, 4.0, ConstantWeight(), GridIndex()));
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_DBSCANGrid)->Arg(5000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_DBSCANKdTree(benchmark::State& state) {
+    const std::vector<Point> points = createBlobs(int(state.range(0)));
+    std::vector<int> clusters;
+
+    for (auto _ : state) {
+        clusters.clear();
+        benchmark::DoNotOptimize(ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                        std::back_inserter(clusters), 1.0, 4.0, ConstantWeight(), KdTreeIndex()));
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_DBSCANKdTree)->Arg(5000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+static void BM_DBSCANParallelGrid(benchmark::State& state) {
+    const std::vector<Point> points = createBlobs(int(state.range(0)));
+    std::vector<int> clusters;
+
+    for (auto _ : state) {
+        clusters.clear();
+        benchmark::DoNotOptimize(ACG::Algorithm::DBSCANParallel(points.begin(), points.end(), Point::DistanceFunc(),
+                                                                std::back_inserter(clusters), 1.0, 4.0, ConstantWeight(), GridIndex()));
+    }
+    state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_DBSCANParallelGrid)->Arg(100000)->Unit(benchmark::kMillisecond);
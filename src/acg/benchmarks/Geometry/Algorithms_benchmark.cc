@@ -0,0 +1,222 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#include <benchmark/benchmark.h>
+
+#include <ACG/Math/VectorT.hh>
+#include <ACG/Geometry/Algorithms.hh>
+#include <ACG/Geometry/AlgorithmsBatch.hh>
+
+#include <vector>
+
+namespace {
+
+using ACG::Vec3f;
+
+/// Deterministic points in [-_s, _s]^3
+std::vector<Vec3f> randomPoints(int _n, float _s) {
+    std::vector<Vec3f> points(_n);
+    unsigned int seed = 12345;
+    for (int i = 0; i < _n; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            points[i][k] = _s * (float((seed >> 8) & 0xffff) / 32767.5f - 1.0f);
+        }
+    }
+    return points;
+}
+
+/// Coordinates of _points as three separate arrays
+struct SoA {
+    explicit SoA(const std::vector<Vec3f>& _points) {
+        for (int k = 0; k < 3; ++k) {
+            data[k].resize(_points.size());
+            for (size_t i = 0; i < _points.size(); ++i)
+                data[k][i] = _points[i][k];
+            ptr[k] = &data[k][0];
+        }
+    }
+
+    std::vector<float> data[3];
+    float* ptr[3];
+};
+
+const Vec3f v0(0.0f, 0.0f, 0.0f), v1(1.0f, 0.2f, 0.0f), v2(0.1f, 1.0f, 0.3f);
+
+} // anonymous namespace
+
+
+static void BM_distPointTriangleSquared(benchmark::State& state) {
+    const std::vector<Vec3f> points = randomPoints(int(state.range(0)), 2.0f);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < points.size(); ++i) {
+            Vec3f nearest;
+            benchmark::DoNotOptimize(ACG::Geometry::distPointTriangleSquaredStable(points[i], v0, v1, v2, nearest));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_distPointTriangleSquared)->Arg(1 << 16);
+
+// closestPointTri() is only implemented for double precision
+static void BM_closestPointTri(benchmark::State& state) {
+    const std::vector<Vec3f> pointsf = randomPoints(int(state.range(0)), 2.0f);
+    const std::vector<ACG::Vec3d> points(pointsf.begin(), pointsf.end());
+    const ACG::Vec3d a(v0), b(v1), c(v2);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < points.size(); ++i)
+            benchmark::DoNotOptimize(ACG::Geometry::closestPointTri(points[i], a, b, c));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_closestPointTri)->Arg(1 << 16);
+
+static void BM_triangleIntersection(benchmark::State& state) {
+    const std::vector<Vec3f> corners = randomPoints(3 * int(state.range(0)), 1.0f);
+    const Vec3f o(0.0f, 0.0f, -3.0f), dir(0.01f, -0.02f, 1.0f);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < corners.size(); i += 3) {
+            float t, u, v;
+            benchmark::DoNotOptimize(ACG::Geometry::triangleIntersection(o, dir, corners[i], corners[i+1], corners[i+2], t, u, v));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_triangleIntersection)->Arg(1 << 16);
+
+static void BM_axisAlignedBBIntersection(benchmark::State& state) {
+    const std::vector<Vec3f> corners = randomPoints(2 * int(state.range(0)), 1.0f);
+    const Vec3f o(-2.0f, 0.1f, 0.2f), dir(1.0f, 0.1f, -0.05f);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < corners.size(); i += 2) {
+            float t0, t1;
+            benchmark::DoNotOptimize(ACG::Geometry::axisAlignedBBIntersection(o, dir, corners[i].min(corners[i+1]),
+                                                                              corners[i].max(corners[i+1]), t0, t1));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_axisAlignedBBIntersection)->Arg(1 << 16);
+
+
+//== BATCH QUERIES ============================================================
+
+/*
+ * The argument of the batch benchmarks selects the instruction set
+ * (0 scalar, 1 SSE2, 2 AVX2). Unsupported instruction sets are skipped.
+ */
+
+static bool selectInstructionSet(benchmark::State& state) {
+    const ACG::Geometry::BatchInstructionSet set = ACG::Geometry::BatchInstructionSet(state.range(1));
+    if (ACG::Geometry::setBatchInstructionSet(set) != set) {
+        state.SkipWithError("instruction set not supported");
+        return false;
+    }
+    return true;
+}
+
+static void BM_distPointTriangleSquaredBatch(benchmark::State& state) {
+    const int n = int(state.range(0));
+    SoA points(randomPoints(n, 2.0f));
+    std::vector<float> sqrDist(n);
+
+    if (!selectInstructionSet(state))
+        return;
+
+    for (auto _ : state) {
+        ACG::Geometry::distPointTriangleSquaredBatch(points.ptr, n, v0, v1, v2, &sqrDist[0]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_distPointTriangleSquaredBatch)->Args({1 << 16, 0})->Args({1 << 16, 1})->Args({1 << 16, 2});
+
+static void BM_triangleIntersectionBatch(benchmark::State& state) {
+    const int n = int(state.range(0));
+    const std::vector<Vec3f> corners = randomPoints(3 * n, 1.0f);
+    std::vector<Vec3f> c0(n), c1(n), c2(n);
+    for (int i = 0; i < n; ++i) {
+        c0[i] = corners[3*i];
+        c1[i] = corners[3*i+1];
+        c2[i] = corners[3*i+2];
+    }
+    SoA a(c0), b(c1), c(c2);
+    std::vector<float> t(n), u(n), v(n);
+    std::vector<unsigned char> hit(n);
+    const Vec3f o(0.0f, 0.0f, -3.0f), dir(0.01f, -0.02f, 1.0f);
+
+    if (!selectInstructionSet(state))
+        return;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ACG::Geometry::triangleIntersectionBatch(o, dir, a.ptr, b.ptr, c.ptr, n, &t[0], &u[0], &v[0], &hit[0]));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_triangleIntersectionBatch)->Args({1 << 16, 0})->Args({1 << 16, 1})->Args({1 << 16, 2});
+
+static void BM_axisAlignedBBIntersectionBatch(benchmark::State& state) {
+    const int n = int(state.range(0));
+    const std::vector<Vec3f> corners = randomPoints(2 * n, 1.0f);
+    std::vector<Vec3f> lo(n), hi(n);
+    for (int i = 0; i < n; ++i) {
+        lo[i] = corners[2*i].min(corners[2*i+1]);
+        hi[i] = corners[2*i].max(corners[2*i+1]);
+    }
+    SoA bbmin(lo), bbmax(hi);
+    std::vector<float> t0(n), t1(n);
+    std::vector<unsigned char> hit(n);
+    const Vec3f o(-2.0f, 0.1f, 0.2f), dir(1.0f, 0.1f, -0.05f);
+
+    if (!selectInstructionSet(state))
+        return;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ACG::Geometry::axisAlignedBBIntersectionBatch(o, dir, bbmin.ptr, bbmax.ptr, n, &t0[0], &t1[0], &hit[0]));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_axisAlignedBBIntersectionBatch)->Args({1 << 16, 0})->Args({1 << 16, 1})->Args({1 << 16, 2});
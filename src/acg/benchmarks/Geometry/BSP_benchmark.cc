@@ -0,0 +1,232 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+#include <benchmark/benchmark.h>
+
+#include <OpenMesh/Core/Mesh/TriMesh_ArrayKernelT.hh>
+#include <ACG/Geometry/bsp/TriangleBSPT.hh>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+struct CustomTraits : public OpenMesh::DefaultTraits {
+};
+
+typedef OpenMesh::TriMesh_ArrayKernelT<CustomTraits> Mesh;
+
+typedef OpenMeshTriangleBSPT< Mesh > BSP;
+
+/// Wavy height field with _n x _n quads, same as in the BSP tests
+void createGrid(Mesh& _mesh, int _n) {
+
+    std::vector<Mesh::VertexHandle> vhandles;
+
+    for (int y = 0; y <= _n; ++y)
+        for (int x = 0; x <= _n; ++x)
+            vhandles.push_back(_mesh.add_vertex(Mesh::Point(x * 0.1f, y * 0.1f, std::sin(x * 0.2f) * std::cos(y * 0.1f))));
+
+    std::vector<Mesh::VertexHandle> face_vhandles;
+
+    for (int y = 0; y < _n; ++y) {
+        for (int x = 0; x < _n; ++x) {
+            const int v = y * (_n+1) + x;
+
+            face_vhandles.clear();
+            face_vhandles.push_back(vhandles[v]);
+            face_vhandles.push_back(vhandles[v + 1]);
+            face_vhandles.push_back(vhandles[v + _n + 2]);
+            _mesh.add_face(face_vhandles);
+
+            face_vhandles.clear();
+            face_vhandles.push_back(vhandles[v]);
+            face_vhandles.push_back(vhandles[v + _n + 2]);
+            face_vhandles.push_back(vhandles[v + _n + 1]);
+            _mesh.add_face(face_vhandles);
+        }
+    }
+}
+
+void fillBSP(const Mesh& _mesh, BSP& _bsp) {
+    _bsp.reserve(_mesh.n_faces());
+    for (Mesh::ConstFaceIter f_it = _mesh.faces_begin(); f_it != _mesh.faces_end(); ++f_it)
+        _bsp.push_back(*f_it);
+}
+
+/// Query points above and below the grid of size _n
+std::vector<Mesh::Point> queryPoints(int _n, int _numPoints) {
+    std::vector<Mesh::Point> points(_numPoints);
+    const float extent = _n * 0.1f;
+    for (int i = 0; i < _numPoints; ++i) {
+        const float s = float((i * 7919) % _numPoints) / float(_numPoints);
+        const float t = float(i) / float(_numPoints);
+        points[i] = Mesh::Point(s * extent, t * extent, (i & 1) ? 1.5f : -1.5f);
+    }
+    return points;
+}
+
+} // anonymous namespace
+
+
+/*
+ * Arguments: grid size, number of threads (0 uses all cores)
+ */
+static void BM_BSPBuild(benchmark::State& state) {
+    Mesh mesh;
+    createGrid(mesh, int(state.range(0)));
+
+    for (auto _ : state) {
+        BSP bsp(mesh);
+        bsp.setNumThreads(int(state.range(1)));
+        fillBSP(mesh, bsp);
+        bsp.build(10, 100);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * mesh.n_faces());
+}
+BENCHMARK(BM_BSPBuild)->Args({128, 1})->Args({512, 1})->Args({512, 0})->Unit(benchmark::kMillisecond);
+
+static void BM_BSPRefit(benchmark::State& state) {
+    Mesh mesh;
+    createGrid(mesh, int(state.range(0)));
+
+    BSP bsp(mesh);
+    fillBSP(mesh, bsp);
+    bsp.build(10, 100);
+
+    for (auto _ : state) {
+        bsp.refit();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * mesh.n_faces());
+}
+BENCHMARK(BM_BSPRefit)->Arg(512)->Unit(benchmark::kMillisecond);
+
+
+//== QUERIES ==================================================================
+
+/// Tree over a grid of size state.range(0), shared by the query benchmarks
+class BSPQuery : public benchmark::Fixture {
+public:
+    void SetUp(const benchmark::State& state) {
+        n_ = int(state.range(0));
+        mesh_.clear();
+        createGrid(mesh_, n_);
+        bsp_ = new BSP(mesh_);
+        fillBSP(mesh_, *bsp_);
+        bsp_->build(10, 100);
+        points_ = queryPoints(n_, 4096);
+
+        // fan of rays pointing at the grid from above and below
+        directions_.resize(points_.size());
+        for (size_t i = 0; i < points_.size(); ++i)
+            directions_[i] = Mesh::Point(0.05f * float(i % 5), -0.05f * float(i % 3), points_[i][2] > 0.0f ? -1.0f : 1.0f);
+    }
+
+    void TearDown(const benchmark::State&) {
+        delete bsp_;
+        bsp_ = 0;
+    }
+
+protected:
+    int n_;
+    Mesh mesh_;
+    BSP* bsp_;
+    std::vector<Mesh::Point> points_, directions_;
+};
+
+BENCHMARK_DEFINE_F(BSPQuery, Nearest)(benchmark::State& state) {
+    for (auto _ : state) {
+        for (size_t i = 0; i < points_.size(); ++i)
+            benchmark::DoNotOptimize(bsp_->nearest(points_[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * points_.size());
+}
+BENCHMARK_REGISTER_F(BSPQuery, Nearest)->Arg(512);
+
+BENCHMARK_DEFINE_F(BSPQuery, NearestBatch)(benchmark::State& state) {
+    std::vector<BSP::NearestNeighbor> neighbors(points_.size());
+    for (auto _ : state) {
+        bsp_->nearest(&points_[0], int(points_.size()), &neighbors[0]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * points_.size());
+}
+BENCHMARK_REGISTER_F(BSPQuery, NearestBatch)->Arg(512);
+
+BENCHMARK_DEFINE_F(BSPQuery, KNearest)(benchmark::State& state) {
+    BSP::NearestNeighbor neighbors[16];
+    for (auto _ : state) {
+        for (size_t i = 0; i < points_.size(); ++i)
+            benchmark::DoNotOptimize(bsp_->nearest(points_[i], 16, neighbors));
+    }
+    state.SetItemsProcessed(state.iterations() * points_.size());
+}
+BENCHMARK_REGISTER_F(BSPQuery, KNearest)->Arg(512);
+
+BENCHMARK_DEFINE_F(BSPQuery, Raycollision)(benchmark::State& state) {
+    for (auto _ : state) {
+        for (size_t i = 0; i < points_.size(); ++i)
+            benchmark::DoNotOptimize(bsp_->raycollision(points_[i], directions_[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * points_.size());
+}
+BENCHMARK_REGISTER_F(BSPQuery, Raycollision)->Arg(512);
+
+BENCHMARK_DEFINE_F(BSPQuery, NearestRaycollision)(benchmark::State& state) {
+    for (auto _ : state) {
+        for (size_t i = 0; i < points_.size(); ++i)
+            benchmark::DoNotOptimize(bsp_->nearestRaycollision(points_[i], directions_[i]));
+    }
+    state.SetItemsProcessed(state.iterations() * points_.size());
+}
+BENCHMARK_REGISTER_F(BSPQuery, NearestRaycollision)->Arg(512);
+
+BENCHMARK_DEFINE_F(BSPQuery, NearestRaycollisionBatch)(benchmark::State& state) {
+    std::vector<BSP::RayHit> hits(points_.size());
+    for (auto _ : state) {
+        bsp_->nearestRaycollision(&points_[0], &directions_[0], int(points_.size()), &hits[0]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * points_.size());
+}
+BENCHMARK_REGISTER_F(BSPQuery, NearestRaycollisionBatch)->Arg(512);
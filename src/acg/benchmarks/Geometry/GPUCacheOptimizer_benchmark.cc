@@ -0,0 +1,124 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+#include <benchmark/benchmark.h>
+
+#include <ACG/Geometry/GPUCacheOptimizer.hh>
+
+#include <vector>
+
+namespace {
+
+/*
+ * Regular grid of _n x _n quads, two triangles per quad, with the triangles
+ * shuffled so that the input order has no locality.
+ */
+std::vector<unsigned int> createShuffledGrid(unsigned int _n) {
+    std::vector<unsigned int> indices;
+    indices.reserve(_n * _n * 6);
+
+    for (unsigned int y = 0; y < _n; ++y) {
+        for (unsigned int x = 0; x < _n; ++x) {
+            const unsigned int v = y * (_n + 1) + x;
+            const unsigned int tris[6] = { v, v + 1, v + _n + 2, v, v + _n + 2, v + _n + 1 };
+            indices.insert(indices.end(), tris, tris + 6);
+        }
+    }
+
+    unsigned int seed = 12345;
+    const unsigned int numTris = unsigned(indices.size() / 3);
+    for (unsigned int i = numTris - 1; i > 0; --i) {
+        seed = seed * 1664525u + 1013904223u;
+        const unsigned int k = (seed >> 8) % (i + 1);
+        for (int c = 0; c < 3; ++c)
+            std::swap(indices[3*i + c], indices[3*k + c]);
+    }
+    return indices;
+}
+
+} // anonymous namespace
+
+
+static void BM_Tipsify(benchmark::State& state) {
+    const unsigned int n = unsigned(state.range(0));
+    const std::vector<unsigned int> indices = createShuffledGrid(n);
+    const unsigned int numTris = unsigned(indices.size() / 3);
+    const unsigned int numVerts = (n + 1) * (n + 1);
+
+    for (auto _ : state) {
+        ACG::GPUCacheOptimizerTipsify opt(16, numTris, numVerts, 4, &indices[0]);
+        benchmark::DoNotOptimize(opt.GetTriangleMap());
+    }
+    state.SetItemsProcessed(state.iterations() * numTris);
+    state.counters["ACMR"] = ACG::GPUCacheOptimizerTipsify(16, numTris, numVerts, 4, &indices[0]).ComputeACMR(16);
+}
+BENCHMARK(BM_Tipsify)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+// clusters are consecutive input triangles, so the shuffled grid is the worst case for the ACMR
+static void BM_TipsifyParallel(benchmark::State& state) {
+    const unsigned int n = unsigned(state.range(0));
+    const std::vector<unsigned int> indices = createShuffledGrid(n);
+    const unsigned int numTris = unsigned(indices.size() / 3);
+    const unsigned int numVerts = (n + 1) * (n + 1);
+
+    for (auto _ : state) {
+        ACG::GPUCacheOptimizerTipsifyParallel opt(16, numTris, numVerts, 4, &indices[0]);
+        benchmark::DoNotOptimize(opt.GetTriangleMap());
+    }
+    state.SetItemsProcessed(state.iterations() * numTris);
+    state.counters["ACMR"] = ACG::GPUCacheOptimizerTipsifyParallel(16, numTris, numVerts, 4, &indices[0]).ComputeACMR(16);
+}
+BENCHMARK(BM_TipsifyParallel)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+static void BM_OptimizeVertices(benchmark::State& state) {
+    const unsigned int n = unsigned(state.range(0));
+    std::vector<unsigned int> indices = createShuffledGrid(n);
+    const unsigned int numTris = unsigned(indices.size() / 3);
+    const unsigned int numVerts = (n + 1) * (n + 1);
+    std::vector<unsigned int> vertMap(numVerts);
+
+    for (auto _ : state) {
+        ACG::GPUCacheOptimizer::OptimizeVertices(numTris, numVerts, 4, &indices[0], &vertMap[0]);
+        benchmark::DoNotOptimize(vertMap[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * numTris);
+}
+BENCHMARK(BM_OptimizeVertices)->Arg(1024)->Unit(benchmark::kMillisecond);
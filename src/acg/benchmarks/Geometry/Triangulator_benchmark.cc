@@ -0,0 +1,95 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+#include <benchmark/benchmark.h>
+
+#include <ACG/Geometry/Triangulator.hh>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+/// Regular polygon with _n corners in the xy plane (ccw)
+std::vector<ACG::Vec3f> createConvexPolygon(int _n) {
+    std::vector<ACG::Vec3f> pos(_n);
+    for (int i = 0; i < _n; ++i) {
+        const float phi = 2.0f * float(M_PI) * float(i) / float(_n);
+        pos[i] = ACG::Vec3f(std::cos(phi), std::sin(phi), 0.0f);
+    }
+    return pos;
+}
+
+/// Star with _n corners in the xy plane (ccw), every other corner is reflex
+std::vector<ACG::Vec3f> createStarPolygon(int _n) {
+    std::vector<ACG::Vec3f> pos(_n);
+    for (int i = 0; i < _n; ++i) {
+        const float phi = 2.0f * float(M_PI) * float(i) / float(_n);
+        const float r = (i & 1) ? 0.5f : 1.0f;
+        pos[i] = ACG::Vec3f(r * std::cos(phi), r * std::sin(phi), 0.0f);
+    }
+    return pos;
+}
+
+} // anonymous namespace
+
+
+static void BM_TriangulatorConvex(benchmark::State& state) {
+    const std::vector<ACG::Vec3f> pos = createConvexPolygon(int(state.range(0)));
+
+    for (auto _ : state) {
+        ACG::Triangulator tri(pos);
+        benchmark::DoNotOptimize(tri.numTriangles());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TriangulatorConvex)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_TriangulatorStar(benchmark::State& state) {
+    const std::vector<ACG::Vec3f> pos = createStarPolygon(int(state.range(0)));
+
+    for (auto _ : state) {
+        ACG::Triangulator tri(pos);
+        benchmark::DoNotOptimize(tri.numTriangles());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TriangulatorStar)->Arg(8)->Arg(64)->Arg(512);
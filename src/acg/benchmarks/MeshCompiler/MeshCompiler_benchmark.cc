@@ -0,0 +1,194 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+#include <benchmark/benchmark.h>
+
+#include <ACG/GL/VertexDeclaration.hh>
+#include <ACG/GL/MeshCompiler.hh>
+
+#include <cmath>
+#include <vector>
+
+#include "../../tests/MeshCompiler/MeshCompiler_testData.hh"
+
+namespace {
+
+/*
+ * Synthetic quad grid with _n x _n faces. Positions and texcoords are shared
+ * by the adjacent faces, normals are per face, so that build() has to split
+ * every vertex into up to four output vertices.
+ */
+class GridData : public MeshTestData
+{
+public:
+  explicit GridData(int _n) {
+    for (int y = 0; y <= _n; ++y) {
+      for (int x = 0; x <= _n; ++x) {
+        pos_.push_back(x * 0.1f);
+        pos_.push_back(y * 0.1f);
+        pos_.push_back(std::sin(x * 0.2f) * std::cos(y * 0.1f));
+        tex_.push_back(float(x) / _n);
+        tex_.push_back(float(y) / _n);
+      }
+    }
+
+    for (int y = 0; y < _n; ++y) {
+      for (int x = 0; x < _n; ++x) {
+        const int v = y * (_n + 1) + x;
+        const int corners[4] = { v, v + 1, v + _n + 2, v + _n + 1 };
+        for (int k = 0; k < 4; ++k) {
+          fpos_.push_back(corners[k]);
+          fnorm_.push_back(y * _n + x);
+        }
+        fsizes_.push_back(4);
+
+        nrm_.push_back(0.0f);
+        nrm_.push_back(0.0f);
+        nrm_.push_back(1.0f);
+      }
+    }
+
+    numFaces_     = _n * _n;
+    numVerts_     = (_n + 1) * (_n + 1);
+    numTexcoords_ = numVerts_;
+    numNormals_   = numFaces_;
+    numIndices_   = int(fpos_.size());
+
+    fsize_    = &fsizes_[0];
+    fdata_pos = &fpos_[0];
+    fdata_t   = &fpos_[0];
+    fdata_n   = &fnorm_[0];
+    vdata_pos = &pos_[0];
+    vdata_t   = &tex_[0];
+    vdata_n   = &nrm_[0];
+  }
+
+private:
+  std::vector<unsigned char> fsizes_;
+  std::vector<int> fpos_, fnorm_;
+  std::vector<float> pos_, tex_, nrm_;
+};
+
+/// MeshCompiler with the vertex and face data of _input, as in the MeshCompiler tests
+ACG::MeshCompiler* createMesh(const MeshTestData& _input) {
+
+  ACG::VertexDeclaration decl;
+  decl.addElement(GL_FLOAT, 3, ACG::VERTEX_USAGE_POSITION);
+  if (_input.numTexcoords_)
+    decl.addElement(GL_FLOAT, 2, ACG::VERTEX_USAGE_TEXCOORD);
+  if (_input.numNormals_)
+    decl.addElement(GL_FLOAT, 3, ACG::VERTEX_USAGE_NORMAL);
+
+  ACG::MeshCompiler* mesh = new ACG::MeshCompiler(decl);
+
+  mesh->setVertices(_input.numVerts_, _input.vdata_pos);
+  mesh->setTexCoords(_input.numTexcoords_, _input.vdata_t);
+  mesh->setNormals(_input.numNormals_, _input.vdata_n);
+
+  mesh->setNumFaces(_input.numFaces_, _input.numIndices_);
+
+  int offset = 0;
+  for (int i = 0; i < _input.numFaces_; ++i)
+  {
+    int fsize = _input.fsize_[i];
+    mesh->setFaceVerts(i, fsize, ((int*)_input.fdata_pos) + offset);
+
+    if (_input.numTexcoords_ && _input.fdata_t)
+      mesh->setFaceTexCoords(i, fsize, ((int*)_input.fdata_t) + offset);
+
+    if (_input.numNormals_ && _input.fdata_n)
+      mesh->setFaceNormals(i, fsize, ((int*)_input.fdata_n) + offset);
+
+    offset += fsize;
+  }
+
+  return mesh;
+}
+
+/*
+ * Times build() with the flags weld vertices (state.range(0)), optimize
+ * vertex cache (state.range(1)) and the number of threads (state.range(2),
+ * 0 uses all cores). Setting up the input is not timed.
+ */
+void runBuild(benchmark::State& state, const MeshTestData& _input) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    ACG::MeshCompiler* mesh = createMesh(_input);
+    mesh->setNumThreads(int(state.range(2)));
+    state.ResumeTiming();
+
+    mesh->build(state.range(0) != 0, state.range(1) != 0, true);
+    benchmark::DoNotOptimize(mesh->getNumVertices());
+
+    state.PauseTiming();
+    delete mesh;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * _input.numFaces_);
+}
+
+} // anonymous namespace
+
+
+static void BM_MeshCompilerTestData0(benchmark::State& state) {
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+  runBuild(state, input);
+}
+BENCHMARK(BM_MeshCompilerTestData0)->Args({0, 0, 1})->Args({1, 1, 1})->Unit(benchmark::kMillisecond);
+
+static void BM_MeshCompilerTestData1(benchmark::State& state) {
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+  runBuild(state, input);
+}
+BENCHMARK(BM_MeshCompilerTestData1)->Args({0, 0, 1})->Args({1, 1, 1})->Unit(benchmark::kMillisecond);
+
+static void BM_MeshCompilerGrid(benchmark::State& state) {
+  const GridData input(int(state.range(3)));
+  runBuild(state, input);
+}
+BENCHMARK(BM_MeshCompilerGrid)
+    ->Args({0, 0, 1, 512})
+    ->Args({1, 1, 1, 512})
+    ->Args({1, 1, 0, 512})
+    ->Args({1, 1, 0, 1024})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,85 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+/*
+ * Benchmark suite of the ACG library.
+ *
+ * Results are written as JSON to acg_benchmark.json in the working directory,
+ * unless another file is given with --benchmark_out=<file>. All other google
+ * benchmark options work as usual, e.g. --benchmark_filter=BSP to run a subset.
+ * Compare two result files with the compare.py tool of google benchmark.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <vector>
+
+
+int main(int argc, char **argv) {
+
+    std::vector<char*> args(argv, argv + argc);
+
+    bool hasOut = false, hasOutFormat = false;
+    for (int i = 1; i < argc; ++i) {
+        hasOut       |= strncmp(argv[i], "--benchmark_out=", 16) == 0;
+        hasOutFormat |= strncmp(argv[i], "--benchmark_out_format=", 23) == 0;
+    }
+
+    char defaultOut[]       = "--benchmark_out=acg_benchmark.json";
+    char defaultOutFormat[] = "--benchmark_out_format=json";
+    if (!hasOut)
+        args.push_back(defaultOut);
+    if (!hasOutFormat)
+        args.push_back(defaultOutFormat);
+
+    int numArgs = int(args.size());
+    args.push_back(0);
+
+    ::benchmark::Initialize(&numArgs, &args[0]);
+    if (::benchmark::ReportUnrecognizedArguments(numArgs, &args[0]))
+        return 1;
+
+    ::benchmark::RunSpecifiedBenchmarks();
+    ::benchmark::Shutdown();
+    return 0;
+}
@@ -44,11 +44,14 @@
 
 #include <vector>
 #include <map>
+#include <iostream>
 
 #include <cmath>
+#include <limits>
 #include <cstring>
 
 #include "../../Algorithm/DBSCANT.hh"
+#include "../../Utils/StopWatch.hh"
 
 namespace {
 const char * const test1_map[] = {
@@ -109,6 +112,21 @@ class Point {
                 }
         };
 
+        class Position {
+            public:
+                Position(double x, double y) { v[0] = x; v[1] = y; }
+                double operator[] (int i) const { return v[i]; }
+            private:
+                double v[2];
+        };
+
+        class PositionFunc {
+            public:
+                Position operator() (const Point &a) const {
+                    return Position(a.x, a.y);
+                }
+        };
+
         double x, y, weight;
         char classifier;
 };
@@ -218,4 +236,221 @@ TEST(DBSCAN, manual_test_2_b) {
     EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), expected, expected + 10));
 }
 
+typedef ACG::Algorithm::GridNeighborhoodIndex<Point::PositionFunc, 2> GridIndex;
+typedef ACG::Algorithm::KdTreeNeighborhoodIndex<Point::PositionFunc, 2> KdTreeIndex;
+typedef ACG::Algorithm::_DBSCAN_PRIVATE::constant_1<Point> ConstantWeight;
+
+TEST(DBSCAN, neighborhood_index_manual_test_1) {
+    std::vector<Point> points;
+    parse_points(test1_map, std::back_inserter(points));
+
+    std::vector<int> clusters_grid, clusters_kd_tree;
+    EXPECT_EQ(3,
+              ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                     std::back_inserter(clusters_grid), 4.0001, 3.0, ConstantWeight(), GridIndex()));
+    EXPECT_TRUE(checkClusterConsistency(points, clusters_grid));
+
+    EXPECT_EQ(3,
+              ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                     std::back_inserter(clusters_kd_tree), 4.0001, 3.0, ConstantWeight(), KdTreeIndex()));
+    EXPECT_TRUE(checkClusterConsistency(points, clusters_kd_tree));
+}
+
+TEST(DBSCAN, neighborhood_index_manual_test_2_b) {
+    std::vector<Point> points;
+    parse_points(test2_map, std::back_inserter(points), 1.0, .5);
+
+    const int expected[] = { 0, 0, 1, 1, 1, 1, 1, 1, 0, 0 };
+
+    std::vector<int> clusters;
+    EXPECT_EQ(1,
+              ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                     std::back_inserter(clusters), 1.01, 1.2, Point::WeightFunc(), GridIndex()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), expected, expected + 10));
+
+    clusters.clear();
+    EXPECT_EQ(1,
+              ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                     std::back_inserter(clusters), 1.01, 1.2, Point::WeightFunc(), KdTreeIndex()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), expected, expected + 10));
+}
+
+/*
+ * Blobs of varying density with uniform background noise. Points on the
+ * integer lattice make many distances exactly epsilon.
+ */
+void create_blobs(const int n, std::vector<Point> &points) {
+    unsigned int seed = 12345;
+    for (int i = 0; i < n; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        const int blob = (seed >> 8) % 64;
+        seed = seed * 1664525u + 1013904223u;
+        const double dx = ((seed >> 8) % 2001) / 1000.0 - 1.0;
+        seed = seed * 1664525u + 1013904223u;
+        const double dy = ((seed >> 8) % 2001) / 1000.0 - 1.0;
+
+        if (blob < 4) {
+            // background noise
+            points.push_back(Point(std::floor((dx + 1.0) * 200.0), std::floor((dy + 1.0) * 200.0), '.'));
+        } else {
+            const double radius = 2.0 + blob % 7;
+            points.push_back(Point((blob % 8) * 50.0 + dx * radius * std::fabs(dx), (blob / 8) * 50.0 + dy * radius, 'a'));
+        }
+    }
+}
+
+TEST(DBSCAN, large_input_neighborhood_index) {
+    std::vector<Point> points;
+    create_blobs(10000, points);
+
+    std::vector<int> clusters_brute_force, clusters_grid, clusters_kd_tree;
+    ACG::StopWatch timer;
+
+    timer.start();
+    const int n_brute_force = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                     std::back_inserter(clusters_brute_force), 1.0, 4.0);
+    const double time_brute_force = timer.stop();
+
+    timer.start();
+    const int n_grid = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                              std::back_inserter(clusters_grid), 1.0, 4.0, ConstantWeight(), GridIndex());
+    const double time_grid = timer.stop();
+
+    timer.start();
+    const int n_kd_tree = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                 std::back_inserter(clusters_kd_tree), 1.0, 4.0, ConstantWeight(), KdTreeIndex());
+    const double time_kd_tree = timer.stop();
+
+    std::cout << "DBSCAN " << points.size() << " points, brute force: " << time_brute_force << " ms, grid: "
+              << time_grid << " ms, kd-tree: " << time_kd_tree << " ms" << std::endl;
+
+    EXPECT_GT(n_brute_force, 1);
+    EXPECT_EQ(n_brute_force, n_grid);
+    EXPECT_EQ(n_brute_force, n_kd_tree);
+    EXPECT_TRUE(checkCollectionEquivalence(clusters_brute_force.begin(), clusters_brute_force.end(),
+                                           clusters_grid.begin(), clusters_grid.end()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters_brute_force.begin(), clusters_brute_force.end(),
+                                           clusters_kd_tree.begin(), clusters_kd_tree.end()));
+}
+
+/*
+ * Zero epsilon, infinite and huge coordinates have no valid grid cells,
+ * the grid index has to fall back to brute force.
+ */
+TEST(DBSCAN, degenerate_input_neighborhood_index) {
+    std::vector<Point> points;
+    for (int i = 0; i < 12; ++i)
+        points.push_back(Point(i % 3, 0.0, 'a'));
+
+    std::vector<int> clusters_brute_force, clusters_grid, clusters_kd_tree;
+    const int n_brute_force = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                     std::back_inserter(clusters_brute_force), 0.0, 3.0);
+    EXPECT_EQ(3, n_brute_force);
+    EXPECT_EQ(n_brute_force, ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                    std::back_inserter(clusters_grid), 0.0, 3.0, ConstantWeight(), GridIndex()));
+    EXPECT_EQ(n_brute_force, ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                    std::back_inserter(clusters_kd_tree), 0.0, 3.0, ConstantWeight(), KdTreeIndex()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters_brute_force.begin(), clusters_brute_force.end(),
+                                           clusters_grid.begin(), clusters_grid.end()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters_brute_force.begin(), clusters_brute_force.end(),
+                                           clusters_kd_tree.begin(), clusters_kd_tree.end()));
+
+    points.push_back(Point(std::numeric_limits<double>::infinity(), 0.0, '.'));
+    points.push_back(Point(1e300, 1e300, '.'));
+
+    clusters_brute_force.clear();
+    clusters_grid.clear();
+    EXPECT_EQ(1, ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                        std::back_inserter(clusters_brute_force), 2.0, 3.0));
+    EXPECT_EQ(1, ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                        std::back_inserter(clusters_grid), 2.0, 3.0, ConstantWeight(), GridIndex()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters_brute_force.begin(), clusters_brute_force.end(),
+                                           clusters_grid.begin(), clusters_grid.end()));
+}
+
+TEST(DBSCAN, huge_input_neighborhood_index) {
+    std::vector<Point> points;
+    create_blobs(200000, points);
+
+    std::vector<int> clusters_grid, clusters_kd_tree;
+    ACG::StopWatch timer;
+
+    timer.start();
+    const int n_grid = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                              std::back_inserter(clusters_grid), 0.25, 6.0, ConstantWeight(), GridIndex());
+    const double time_grid = timer.stop();
+
+    timer.start();
+    const int n_kd_tree = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                                 std::back_inserter(clusters_kd_tree), 0.25, 6.0, ConstantWeight(), KdTreeIndex());
+    const double time_kd_tree = timer.stop();
+
+    std::cout << "DBSCAN " << points.size() << " points, grid: " << time_grid << " ms, kd-tree: "
+              << time_kd_tree << " ms" << std::endl;
+
+    EXPECT_GT(n_grid, 1);
+    EXPECT_EQ(n_grid, n_kd_tree);
+    EXPECT_TRUE(checkCollectionEquivalence(clusters_grid.begin(), clusters_grid.end(),
+                                           clusters_kd_tree.begin(), clusters_kd_tree.end()));
+}
+
+TEST(DBSCAN, parallel_manual_test_1) {
+    std::vector<Point> points;
+    parse_points(test1_map, std::back_inserter(points));
+
+    std::vector<int> clusters, clusters_parallel;
+    ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                           std::back_inserter(clusters), 4.0001, 3.0);
+
+    EXPECT_EQ(3,
+              ACG::Algorithm::DBSCANParallel(points.begin(), points.end(), Point::DistanceFunc(),
+                                             std::back_inserter(clusters_parallel), 4.0001, 3.0, ConstantWeight(),
+                                             ACG::Algorithm::BruteForceNeighborhoodIndex(), 4));
+    EXPECT_TRUE(checkClusterConsistency(points, clusters_parallel));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), clusters_parallel.begin(), clusters_parallel.end()));
+}
+
+TEST(DBSCAN, parallel_manual_test_2_b) {
+    std::vector<Point> points;
+    parse_points(test2_map, std::back_inserter(points), 1.0, .5);
+    std::vector<int> clusters;
+    EXPECT_EQ(1,
+              ACG::Algorithm::DBSCANParallel(points.begin(), points.end(), Point::DistanceFunc(),
+                                             std::back_inserter(clusters), 1.01, 1.2, Point::WeightFunc(), GridIndex(), 4));
+
+    const int expected[] = { 0, 0, 1, 1, 1, 1, 1, 1, 0, 0 };
+    EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), expected, expected + 10));
+}
+
+TEST(DBSCAN, large_input_parallel) {
+    std::vector<Point> points;
+    create_blobs(200000, points);
+
+    std::vector<int> clusters, clusters_serial, clusters_parallel;
+    ACG::StopWatch timer;
+
+    timer.start();
+    const int n = ACG::Algorithm::DBSCAN(points.begin(), points.end(), Point::DistanceFunc(),
+                                         std::back_inserter(clusters), 0.25, 6.0, ConstantWeight(), KdTreeIndex());
+    const double time = timer.stop();
+
+    timer.start();
+    const int n_serial = ACG::Algorithm::DBSCANParallel(points.begin(), points.end(), Point::DistanceFunc(),
+                                                        std::back_inserter(clusters_serial), 0.25, 6.0, ConstantWeight(), KdTreeIndex(), 1);
+    const double time_serial = timer.stop();
+
+    timer.start();
+    const int n_parallel = ACG::Algorithm::DBSCANParallel(points.begin(), points.end(), Point::DistanceFunc(),
+                                                          std::back_inserter(clusters_parallel), 0.25, 6.0, ConstantWeight(), KdTreeIndex());
+    const double time_parallel = timer.stop();
+
+    std::cout << "DBSCAN " << points.size() << " points, kd-tree: " << time << " ms, union-find 1 thread: "
+              << time_serial << " ms, union-find all threads: " << time_parallel << " ms" << std::endl;
+
+    EXPECT_EQ(n, n_serial);
+    EXPECT_EQ(n, n_parallel);
+    EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), clusters_serial.begin(), clusters_serial.end()));
+    EXPECT_TRUE(checkCollectionEquivalence(clusters.begin(), clusters.end(), clusters_parallel.begin(), clusters_parallel.end()));
+}
+
 }
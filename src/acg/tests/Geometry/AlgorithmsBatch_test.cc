@@ -0,0 +1,323 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#include <gtest/gtest.h>
+
+#include <ACG/Math/VectorT.hh>
+#include <ACG/Geometry/Algorithms.hh>
+#include <ACG/Geometry/AlgorithmsBatch.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+using ACG::Vec3f;
+using namespace ACG::Geometry;
+
+/// Points in structure-of-arrays layout
+struct PointArray {
+  std::vector<float> x, y, z;
+
+  explicit PointArray(size_t _n) : x(_n), y(_n), z(_n) {}
+
+  void set(size_t _i, const Vec3f& _p) { x[_i] = _p[0]; y[_i] = _p[1]; z[_i] = _p[2]; }
+  Vec3f get(size_t _i) const { return Vec3f(x[_i], y[_i], z[_i]); }
+  int size() const { return int(x.size()); }
+
+  const float* const* cptr() { cp[0] = &x[0]; cp[1] = &y[0]; cp[2] = &z[0]; return cp; }
+  float* const* ptr() { p[0] = &x[0]; p[1] = &y[0]; p[2] = &z[0]; return p; }
+
+private:
+  const float* cp[3];
+  float* p[3];
+};
+
+float randomFloat(float _min, float _max) {
+  return _min + (_max - _min) * float(rand()) / float(RAND_MAX);
+}
+
+Vec3f randomVec(float _min, float _max) {
+  return Vec3f(randomFloat(_min, _max), randomFloat(_min, _max), randomFloat(_min, _max));
+}
+
+/// Restores the automatically selected instruction set at the end of a test
+class ALGORITHMS_BATCH : public testing::Test {
+protected:
+  virtual void SetUp() { best_ = setBatchInstructionSet(BATCH_AVX2); }
+  virtual void TearDown() { setBatchInstructionSet(best_); }
+
+  BatchInstructionSet best_;
+};
+
+} // anonymous namespace
+
+/*
+ * Many points against one triangle, including the vertex, edge and interior
+ * regions, compared to the scalar distPointTriangleSquaredStable().
+ * 37 points leave a remainder for the 4 and 8 wide kernels.
+ */
+TEST_F(ALGORITHMS_BATCH, distPointTriangleSquaredBatch) {
+  srand(42);
+
+  for (int iter = 0; iter < 50; ++iter) {
+    const Vec3f v0 = randomVec(-1.0f, 1.0f);
+    const Vec3f v1 = randomVec(-1.0f, 1.0f);
+    const Vec3f v2 = randomVec(-1.0f, 1.0f);
+
+    PointArray p(37), nearest(37);
+    for (int i = 0; i < p.size(); ++i)
+      p.set(i, randomVec(-2.0f, 2.0f));
+
+    std::vector<float> sqrDist(p.size());
+    distPointTriangleSquaredBatch(p.cptr(), p.size(), v0, v1, v2, &sqrDist[0], nearest.ptr());
+
+    for (int i = 0; i < p.size(); ++i) {
+      Vec3f expectedNearest;
+      const float expected = distPointTriangleSquaredStable(p.get(i), v0, v1, v2, expectedNearest);
+
+      EXPECT_NEAR(expected, sqrDist[i], 1e-4f * (1.0f + expected)) << "Point " << i << " of triangle " << iter;
+      EXPECT_LT((expectedNearest - nearest.get(i)).norm(), 1e-3f) << "Point " << i << " of triangle " << iter;
+    }
+  }
+}
+
+/*
+ * Degenerate triangles use the distance to the longest edge.
+ */
+TEST_F(ALGORITHMS_BATCH, distPointTriangleSquaredBatchDegenerate) {
+  const Vec3f v0(0.0f, 0.0f, 0.0f), v1(1.0f, 0.0f, 0.0f), v2(3.0f, 0.0f, 0.0f);
+
+  PointArray p(3);
+  p.set(0, Vec3f(2.0f, 1.0f, 0.0f));
+  p.set(1, Vec3f(-1.0f, 0.0f, 0.0f));
+  p.set(2, Vec3f(4.0f, 0.0f, 2.0f));
+
+  std::vector<float> sqrDist(3);
+  distPointTriangleSquaredBatch(p.cptr(), p.size(), v0, v1, v2, &sqrDist[0]);
+
+  EXPECT_FLOAT_EQ(1.0f, sqrDist[0]);
+  EXPECT_FLOAT_EQ(1.0f, sqrDist[1]);
+  EXPECT_FLOAT_EQ(5.0f, sqrDist[2]);
+
+  // collapsed to a single point
+  distPointTriangleSquaredBatch(p.cptr(), p.size(), v1, v1, v1, &sqrDist[0]);
+
+  EXPECT_FLOAT_EQ(2.0f, sqrDist[0]);
+  EXPECT_FLOAT_EQ(4.0f, sqrDist[1]);
+  EXPECT_FLOAT_EQ(13.0f, sqrDist[2]);
+}
+
+TEST_F(ALGORITHMS_BATCH, closestPointTriBatch) {
+  const Vec3f a(0.0f, 0.0f, 0.0f), b(1.0f, 0.0f, 0.0f), c(0.0f, 1.0f, 0.0f);
+
+  PointArray p(4), closest(4);
+  p.set(0, Vec3f(0.25f, 0.25f, 1.0f));
+  p.set(1, Vec3f(-1.0f, -1.0f, 0.0f));
+  p.set(2, Vec3f(1.0f, 1.0f, -1.0f));
+  p.set(3, Vec3f(0.5f, -2.0f, 0.0f));
+
+  closestPointTriBatch(p.cptr(), p.size(), a, b, c, closest.ptr());
+
+  EXPECT_LT((closest.get(0) - Vec3f(0.25f, 0.25f, 0.0f)).norm(), 1e-6f);
+  EXPECT_LT((closest.get(1) - a).norm(), 1e-6f);
+  EXPECT_LT((closest.get(2) - Vec3f(0.5f, 0.5f, 0.0f)).norm(), 1e-6f);
+  EXPECT_LT((closest.get(3) - Vec3f(0.5f, 0.0f, 0.0f)).norm(), 1e-6f);
+}
+
+/*
+ * More points than closestPointTriBatch() processes at once.
+ */
+TEST_F(ALGORITHMS_BATCH, closestPointTriBatchChunks) {
+  srand(5);
+
+  const int n = 601;
+  PointArray p(n), closest(n), nearest(n);
+  for (int i = 0; i < n; ++i)
+    p.set(i, randomVec(-2.0f, 2.0f));
+
+  const Vec3f a(0.0f, 0.0f, 0.0f), b(1.0f, 0.0f, 0.0f), c(0.0f, 1.0f, 0.5f);
+
+  std::vector<float> sqrDist(n);
+  closestPointTriBatch(p.cptr(), n, a, b, c, closest.ptr());
+  distPointTriangleSquaredBatch(p.cptr(), n, a, b, c, &sqrDist[0], nearest.ptr());
+
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(nearest.get(i), closest.get(i)) << "Point " << i;
+  }
+}
+
+/*
+ * One ray against many triangles, hits and parameters have to match the scalar
+ * triangleIntersection(). The batch kernels use the same operations, but the
+ * test itself may be compiled with FMA contraction.
+ */
+TEST_F(ALGORITHMS_BATCH, triangleIntersectionBatch) {
+  srand(7);
+
+  const int n = 203;
+  PointArray v0(n), v1(n), v2(n);
+  for (int i = 0; i < n; ++i) {
+    v0.set(i, randomVec(-1.0f, 1.0f));
+    v1.set(i, randomVec(-1.0f, 1.0f));
+    v2.set(i, randomVec(-1.0f, 1.0f));
+  }
+  // ray in the plane of the triangle
+  v0.set(0, Vec3f(0.0f, 0.0f, 0.0f));
+  v1.set(0, Vec3f(0.0f, 1.0f, 0.0f));
+  v2.set(0, Vec3f(0.0f, 0.0f, 1.0f));
+
+  const Vec3f o(0.1f, -0.05f, -3.0f), dir(0.0f, 0.02f, 1.0f);
+
+  std::vector<float> t(n), u(n), v(n);
+  std::vector<unsigned char> hit(n);
+  const int hits = triangleIntersectionBatch(o, dir, v0.cptr(), v1.cptr(), v2.cptr(), n, &t[0], &u[0], &v[0], &hit[0]);
+
+  int expectedHits = 0;
+  for (int i = 0; i < n; ++i) {
+    float et, eu, ev;
+    const bool expected = triangleIntersection(o, dir, v0.get(i), v1.get(i), v2.get(i), et, eu, ev);
+    ASSERT_EQ(expected, hit[i] != 0) << "Triangle " << i;
+    if (expected) {
+      ++expectedHits;
+      EXPECT_NEAR(et, t[i], 1e-5f * std::max(1.0f, std::fabs(et))) << "Triangle " << i;
+      EXPECT_NEAR(eu, u[i], 1e-5f) << "Triangle " << i;
+      EXPECT_NEAR(ev, v[i], 1e-5f) << "Triangle " << i;
+    }
+  }
+
+  EXPECT_EQ(expectedHits, hits);
+  EXPECT_GT(hits, 0);
+  EXPECT_EQ(0, hit[0]);
+}
+
+/*
+ * One ray against many boxes, including axis parallel rays.
+ */
+TEST_F(ALGORITHMS_BATCH, axisAlignedBBIntersectionBatch) {
+  srand(11);
+
+  const int n = 131;
+  PointArray bbmin(n), bbmax(n);
+  for (int i = 0; i < n; ++i) {
+    const Vec3f a = randomVec(-1.0f, 1.0f), b = randomVec(-1.0f, 1.0f);
+    bbmin.set(i, a.min(b));
+    bbmax.set(i, a.max(b));
+  }
+
+  const Vec3f rays[3][2] = {
+    { Vec3f(-2.0f, 0.1f, 0.2f), Vec3f(1.0f, 0.1f, -0.05f) },
+    { Vec3f(0.0f, 0.0f, -2.0f), Vec3f(0.0f, 0.0f, 1.0f) },
+    { Vec3f(0.3f, 2.0f, 0.3f),  Vec3f(-0.2f, -1.0f, 0.0f) }
+  };
+
+  for (int r = 0; r < 3; ++r) {
+    const Vec3f& o = rays[r][0];
+    const Vec3f& dir = rays[r][1];
+
+    std::vector<float> t0(n), t1(n);
+    std::vector<unsigned char> hit(n);
+    const int hits = axisAlignedBBIntersectionBatch(o, dir, bbmin.cptr(), bbmax.cptr(), n, &t0[0], &t1[0], &hit[0]);
+
+    int expectedHits = 0;
+    for (int i = 0; i < n; ++i) {
+      float et0, et1;
+      const bool expected = axisAlignedBBIntersection(o, dir, bbmin.get(i), bbmax.get(i), et0, et1);
+      ASSERT_EQ(expected, hit[i] != 0) << "Box " << i << " ray " << r;
+      if (expected) {
+        ++expectedHits;
+        EXPECT_EQ(et0, t0[i]) << "Box " << i << " ray " << r;
+        EXPECT_EQ(et1, t1[i]) << "Box " << i << " ray " << r;
+      }
+    }
+
+    EXPECT_EQ(expectedHits, hits);
+    EXPECT_GT(hits, 0);
+  }
+}
+
+/*
+ * All instruction sets supported by this machine give bitwise identical results.
+ */
+TEST_F(ALGORITHMS_BATCH, instructionSetsAgree) {
+  srand(3);
+
+  const int n = 77;
+  PointArray p(n), v0(n), v1(n), v2(n);
+  for (int i = 0; i < n; ++i) {
+    p.set(i, randomVec(-2.0f, 2.0f));
+    v0.set(i, randomVec(-1.0f, 1.0f));
+    v1.set(i, randomVec(-1.0f, 1.0f));
+    v2.set(i, randomVec(-1.0f, 1.0f));
+  }
+  const Vec3f o(0.0f, 0.0f, -3.0f), dir(0.01f, -0.02f, 1.0f);
+
+  std::vector<float> refDist, refT;
+  std::vector<unsigned char> refHit;
+
+  for (int set = BATCH_SCALAR; set <= best_; ++set) {
+    if (setBatchInstructionSet(BatchInstructionSet(set)) != set)
+      continue;
+
+    std::vector<float> sqrDist(n), t(n), u(n), v(n);
+    std::vector<unsigned char> hit(n);
+    distPointTriangleSquaredBatch(p.cptr(), n, v0.get(0), v1.get(0), v2.get(0), &sqrDist[0]);
+    triangleIntersectionBatch(o, dir, v0.cptr(), v1.cptr(), v2.cptr(), n, &t[0], &u[0], &v[0], &hit[0]);
+
+    if (set == BATCH_SCALAR) {
+      refDist = sqrDist;
+      refT = t;
+      refHit = hit;
+      continue;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      EXPECT_EQ(refDist[i], sqrDist[i]) << "Point " << i << " instruction set " << set;
+      ASSERT_EQ(refHit[i], hit[i]) << "Triangle " << i << " instruction set " << set;
+      if (hit[i]) {
+        EXPECT_EQ(refT[i], t[i]) << "Triangle " << i << " instruction set " << set;
+      }
+    }
+  }
+}
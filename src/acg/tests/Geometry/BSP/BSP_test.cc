@@ -45,6 +45,15 @@
 #include <ACG/Geometry/bsp/TriangleBSPT.hh>
 #include <ACG/Geometry/Algorithms.hh>
 
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
 
 struct CustomTraits : public OpenMesh::DefaultTraits {
 };
@@ -550,3 +559,414 @@ TEST_F(BSP_CUBE_BASE, RayIntersectionAboveSurface_DirectionalFunction_NegativeDi
 
 }
 
+
+/* Height field grid with 2 * _n * _n triangles
+ */
+static void createGrid(Mesh& _mesh, int _n) {
+
+  std::vector<Mesh::VertexHandle> vhandles;
+
+  for (int y = 0; y <= _n; ++y)
+    for (int x = 0; x <= _n; ++x)
+      vhandles.push_back(_mesh.add_vertex(Mesh::Point(x * 0.1f, y * 0.1f, std::sin(x * 0.2f) * std::cos(y * 0.1f))));
+
+  std::vector<Mesh::VertexHandle> face_vhandles;
+
+  for (int y = 0; y < _n; ++y)
+  {
+    for (int x = 0; x < _n; ++x)
+    {
+      const int v = y * (_n+1) + x;
+
+      face_vhandles.clear();
+      face_vhandles.push_back(vhandles[v]);
+      face_vhandles.push_back(vhandles[v + 1]);
+      face_vhandles.push_back(vhandles[v + _n + 2]);
+      _mesh.add_face(face_vhandles);
+
+      face_vhandles.clear();
+      face_vhandles.push_back(vhandles[v]);
+      face_vhandles.push_back(vhandles[v + _n + 2]);
+      face_vhandles.push_back(vhandles[v + _n + 1]);
+      _mesh.add_face(face_vhandles);
+    }
+  }
+}
+
+/* Parallel construction has to produce the same tree as the serial one
+ */
+TEST(BSP_PARALLEL_BUILD, ParallelBuildMatchesSerial ) {
+
+  // large enough to split the top levels in parallel
+  Mesh mesh;
+  createGrid(mesh, 128);
+
+  BSP serialBSP(mesh), parallelBSP(mesh);
+
+  serialBSP.setNumThreads(1);
+  parallelBSP.setNumThreads(4);
+
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+  {
+    serialBSP.push_back(*f_it);
+    parallelBSP.push_back(*f_it);
+  }
+
+  serialBSP.build(10, 100);
+  parallelBSP.build(10, 100);
+
+  for (int i = 0; i < 100; ++i)
+  {
+    const Mesh::Point p(i * 0.127f, (i * 37 % 100) * 0.128f, 0.5f);
+
+    BSP::NearestNeighbor nnSerial   = serialBSP.nearest(p);
+    BSP::NearestNeighbor nnParallel = parallelBSP.nearest(p);
+
+    EXPECT_EQ(nnSerial.handle.idx(), nnParallel.handle.idx()) << "Nearest face differs for query " << i;
+    EXPECT_EQ(nnSerial.dist, nnParallel.dist) << "Nearest distance differs for query " << i;
+
+    BSP::RayCollision rcSerial   = serialBSP.raycollision(p, Mesh::Point(0.0, 0.0, -1.0));
+    BSP::RayCollision rcParallel = parallelBSP.raycollision(p, Mesh::Point(0.0, 0.0, -1.0));
+
+    ASSERT_EQ(rcSerial.size(), rcParallel.size()) << "Wrong number of hit faces for query " << i;
+
+    for (size_t k = 0; k < rcSerial.size(); ++k)
+      EXPECT_EQ(rcSerial[k].first.idx(), rcParallel[k].first.idx()) << "Hit faces differ for query " << i;
+  }
+}
+
+/* Batched ray queries have to return the same results as single rays, up to rounding
+ *
+ * The rays do not pass through edges or vertices of the grid, where rounding
+ * differences may select a different adjacent face.
+ */
+TEST(BSP_BATCHED_RAYS, BatchMatchesSingleRays ) {
+
+  Mesh mesh;
+  createGrid(mesh, 64);
+
+  BSP bsp(mesh);
+  bsp.setNumThreads(4);
+
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    bsp.push_back(*f_it);
+
+  bsp.build(10, 100);
+
+  // fan of rays from a common origin, the last packet is incomplete, some rays start below the surface
+  const int numRays = 1023;
+  std::vector<Mesh::Point> origins(numRays), directions(numRays);
+
+  for (int i = 0; i < numRays; ++i)
+  {
+    origins[i]    = Mesh::Point(3.2137f, 3.1791f, (i % 7 == 0) ? -2.0f : 2.0f);
+    directions[i] = Mesh::Point((i % 32 - 16) * 0.1f + 0.0137f, (i / 32 - 16) * 0.1f - 0.0291f, (i % 7 == 0) ? 1.0f : -1.0f);
+  }
+
+  std::vector<BSP::RayCollision> collisions(numRays), directionalCollisions(numRays);
+  std::vector<BSP::RayHit> hits(numRays);
+
+  bsp.raycollision(&origins[0], &directions[0], numRays, &collisions[0]);
+  bsp.directionalRaycollision(&origins[0], &directions[0], numRays, &directionalCollisions[0]);
+  bsp.nearestRaycollision(&origins[0], &directions[0], numRays, &hits[0]);
+
+  for (int i = 0; i < numRays; ++i)
+  {
+    BSP::RayCollision rc = bsp.raycollision(origins[i], directions[i]);
+
+    ASSERT_EQ(rc.size(), collisions[i].size()) << "Wrong number of hit faces for ray " << i;
+    for (size_t k = 0; k < rc.size(); ++k)
+    {
+      EXPECT_EQ(rc[k].first.idx(), collisions[i][k].first.idx()) << "Hit faces differ for ray " << i;
+      EXPECT_NEAR(rc[k].second, collisions[i][k].second, 1e-5f) << "Hit distances differ for ray " << i;
+    }
+
+    rc = bsp.directionalRaycollision(origins[i], directions[i]);
+
+    ASSERT_EQ(rc.size(), directionalCollisions[i].size()) << "Wrong number of directional hit faces for ray " << i;
+    for (size_t k = 0; k < rc.size(); ++k)
+      EXPECT_EQ(rc[k].first.idx(), directionalCollisions[i][k].first.idx()) << "Directional hit faces differ for ray " << i;
+
+    rc = bsp.nearestRaycollision(origins[i], directions[i]);
+
+    if (rc.empty())
+      EXPECT_FALSE(hits[i].handle.is_valid()) << "Ray " << i << " should miss";
+    else
+    {
+      EXPECT_EQ(rc[0].first.idx(), hits[i].handle.idx()) << "Nearest hit face differs for ray " << i;
+      EXPECT_NEAR(rc[0].second, hits[i].dist, 1e-5f) << "Nearest hit distance differs for ray " << i;
+    }
+  }
+}
+
+/* k nearest neighbors and range queries compared to brute force
+ */
+TEST(BSP_NEAREST_QUERIES, KNearestAndRangeMatchBruteForce ) {
+
+  Mesh mesh;
+  createGrid(mesh, 32);
+
+  BSP bsp(mesh);
+
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    bsp.push_back(*f_it);
+
+  bsp.build(10, 100);
+
+  const int k = 16;
+  BSP::NearestNeighbor neighbors[k];
+  BSP::NearestNeighbors rangeNeighbors;
+
+  for (int i = 0; i < 50; ++i)
+  {
+    const Mesh::Point p((i % 10) * 0.33f, (i / 10) * 0.65f, (i % 3) * 0.5f - 0.5f);
+
+    // squared distance and handle of all faces, sorted
+    std::vector< std::pair<float, int> > faces;
+    for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    {
+      Mesh::FaceVertexIter fv_it = Mesh::FaceVertexIter(mesh, *f_it);
+      const Mesh::Point p0 = mesh.point(*fv_it); ++fv_it;
+      const Mesh::Point p1 = mesh.point(*fv_it); ++fv_it;
+      const Mesh::Point p2 = mesh.point(*fv_it);
+      Mesh::Point q;
+      faces.push_back(std::make_pair(ACG::Geometry::distPointTriangleSquaredStable(p, p0, p1, p2, q), (*f_it).idx()));
+    }
+    std::sort(faces.begin(), faces.end());
+
+    ASSERT_EQ(k, bsp.nearest(p, k, neighbors)) << "Wrong number of neighbors for query " << i;
+
+    for (int n = 0; n < k; ++n)
+    {
+      EXPECT_EQ(faces[n].second, neighbors[n].handle.idx()) << "Wrong neighbor " << n << " for query " << i;
+      EXPECT_FLOAT_EQ(std::sqrt(faces[n].first), neighbors[n].dist) << "Wrong distance of neighbor " << n << " for query " << i;
+    }
+
+    const float radius = 0.4f;
+    bsp.nearest(p, radius, rangeNeighbors);
+
+    size_t numInRange = 0;
+    while (numInRange < faces.size() && faces[numInRange].first <= radius * radius)
+      ++numInRange;
+
+    ASSERT_EQ(numInRange, rangeNeighbors.size()) << "Wrong number of faces in range for query " << i;
+
+    for (size_t n = 0; n < numInRange; ++n)
+      EXPECT_EQ(faces[n].second, rangeNeighbors[n].handle.idx()) << "Wrong face in range for query " << i;
+  }
+}
+
+/* Batched closest point queries have to return the same results as single queries
+ */
+TEST(BSP_NEAREST_QUERIES, BatchedNearestMatchesSingle ) {
+
+  Mesh mesh;
+  createGrid(mesh, 64);
+
+  BSP bsp(mesh);
+  bsp.setNumThreads(4);
+
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    bsp.push_back(*f_it);
+
+  bsp.build(10, 100);
+
+  const int numPoints = 1000;
+  std::vector<Mesh::Point> points(numPoints), closestPoints(numPoints);
+  std::vector<BSP::NearestNeighbor> neighbors(numPoints);
+
+  for (int i = 0; i < numPoints; ++i)
+    points[i] = Mesh::Point((i % 40) * 0.16f, (i / 40) * 0.25f, (i % 5) * 0.4f - 1.0f);
+
+  bsp.nearest(&points[0], numPoints, &neighbors[0], &closestPoints[0]);
+
+  for (int i = 0; i < numPoints; ++i)
+  {
+    BSP::NearestNeighbor nn = bsp.nearest(points[i]);
+
+    EXPECT_EQ(nn.handle.idx(), neighbors[i].handle.idx()) << "Nearest face differs for point " << i;
+    EXPECT_EQ(nn.dist, neighbors[i].dist) << "Nearest distance differs for point " << i;
+    EXPECT_NEAR(nn.dist, (closestPoints[i] - points[i]).norm(), 1e-5) << "Closest point is not at the nearest distance for point " << i;
+  }
+}
+
+/* A tree loaded from a cache file has to answer queries like the built tree.
+ * Changed triangles or build parameters must not use the cache file.
+ */
+TEST(BSP_CACHE_FILE, CachedTreeMatchesBuiltTree ) {
+
+  const std::string filename = "BSP_test_cache.bsp";
+  std::remove(filename.c_str());
+
+  Mesh mesh;
+  createGrid(mesh, 64);
+
+  BSP built(mesh), cached(mesh);
+
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    built.push_back(*f_it);
+
+  // add the handles in reverse order, the key does not depend on the order
+  for (int i = int(mesh.n_faces()) - 1; i >= 0; --i)
+    cached.push_back(Mesh::FaceHandle(i));
+
+  EXPECT_FALSE(built.buildCached(filename, 10, 100)) << "Cache file should not exist yet";
+  EXPECT_TRUE(cached.buildCached(filename, 10, 100)) << "Cache file was not loaded";
+  EXPECT_EQ(built.numNodes(), cached.numNodes()) << "Wrong number of nodes in the cached tree";
+
+  for (int i = 0; i < 200; ++i)
+  {
+    const Mesh::Point p((i % 20) * 0.33f, (i / 20) * 0.65f, (i % 3) * 0.5f - 0.5f);
+    const Mesh::Point d((i % 7) * 0.1f - 0.3f, (i % 5) * 0.1f - 0.2f, -1.0f);
+
+    BSP::NearestNeighbor nnBuilt  = built.nearest(p);
+    BSP::NearestNeighbor nnCached = cached.nearest(p);
+
+    EXPECT_EQ(nnBuilt.handle.idx(), nnCached.handle.idx()) << "Nearest face differs for query " << i;
+    EXPECT_EQ(nnBuilt.dist, nnCached.dist) << "Nearest distance differs for query " << i;
+
+    BSP::RayCollision rcBuilt  = built.nearestRaycollision(p, d);
+    BSP::RayCollision rcCached = cached.nearestRaycollision(p, d);
+
+    ASSERT_EQ(rcBuilt.size(), rcCached.size()) << "Number of ray collisions differs for query " << i;
+    if (!rcBuilt.empty()) {
+      EXPECT_EQ(rcBuilt[0].first.idx(), rcCached[0].first.idx()) << "Nearest ray collision differs for query " << i;
+    }
+  }
+
+  // different build parameters
+  BSP other(mesh);
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    other.push_back(*f_it);
+
+  const uint64_t key = other.cacheKey(10, 100);
+  EXPECT_NE(key, other.cacheKey(8, 100)) << "Key does not depend on the maximum number of handles";
+  EXPECT_FALSE(other.buildCached(filename, 8, 100)) << "Cache file with different build parameters was loaded";
+
+  // changed position
+  mesh.set_point(mesh.vertex_handle(0), Mesh::Point(0.0f, 0.0f, 0.01f));
+  EXPECT_NE(key, other.cacheKey(10, 100)) << "Key does not depend on the positions";
+
+  std::remove(filename.c_str());
+}
+
+/* A cache file with a matching header but corrupt nodes or handles must be rebuilt
+ */
+TEST(BSP_CACHE_FILE, CorruptCacheFileIsRebuilt ) {
+
+  const std::string filename = "BSP_test_corrupt.bsp";
+  std::remove(filename.c_str());
+
+  Mesh mesh;
+  createGrid(mesh, 16);
+
+  BSP built(mesh);
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    built.push_back(*f_it);
+
+  ASSERT_FALSE(built.buildCached(filename, 10, 100)) << "Cache file should not exist yet";
+
+  std::vector<char> original;
+  {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    original.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  ASSERT_GT(original.size(), sizeof(ACG::BSPCacheFile::Header));
+
+  const ACG::BSPCacheFile::Header* header = reinterpret_cast<const ACG::BSPCacheFile::Header*>(&original[0]);
+  const size_t rootFirst  = size_t(header->nodeOffset) + offsetof(BSPTreeNode, first_);
+  const size_t lastHandle = size_t(header->handleOffset + (header->numHandles - 1) * header->handleSize);
+
+  // root as empty leaf leaving the other nodes unreferenced, out of range child, out of range leaf, unknown handle
+  const size_t   offsets[] = { rootFirst, rootFirst, rootFirst, lastHandle };
+  const uint32_t values[]  = { 0, uint32_t(header->numNodes), 1, uint32_t(mesh.n_faces()) };
+  const uint32_t counts[]  = { 0, 0, uint32_t(header->numHandles), 0 };
+
+  for (int i = 0; i < 4; ++i)
+  {
+    std::vector<char> corrupt = original;
+    memcpy(&corrupt[offsets[i]], &values[i], sizeof(values[i]));
+    if (offsets[i] == rootFirst)
+      memcpy(&corrupt[offsets[i] + offsetof(BSPTreeNode, count_) - offsetof(BSPTreeNode, first_)], &counts[i], sizeof(counts[i]));
+
+    {
+      std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+      file.write(&corrupt[0], std::streamsize(corrupt.size()));
+    }
+
+    BSP cached(mesh);
+    for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+      cached.push_back(*f_it);
+
+    EXPECT_FALSE(cached.buildCached(filename, 10, 100)) << "Corrupt cache file " << i << " was loaded";
+    EXPECT_EQ(built.numNodes(), cached.numNodes()) << "Tree was not rebuilt for corrupt cache file " << i;
+
+    // the rebuilt tree replaced the corrupt file
+    BSP reloaded(mesh);
+    for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+      reloaded.push_back(*f_it);
+
+    EXPECT_TRUE(reloaded.buildCached(filename, 10, 100)) << "Rewritten cache file " << i << " was not loaded";
+  }
+
+  std::remove(filename.c_str());
+}
+
+/* A refitted tree has to answer queries like a tree built for the deformed mesh
+ */
+TEST(BSP_REFIT, RefitMatchesRebuild ) {
+
+  Mesh mesh;
+  createGrid(mesh, 64);
+
+  BSP refitted(mesh);
+  refitted.setNumThreads(4);
+
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    refitted.push_back(*f_it);
+
+  refitted.build(10, 100);
+
+  // unchanged positions keep the tree
+  const float cost = refitted.sahCost();
+  refitted.refit();
+  EXPECT_EQ(cost, refitted.sahCost()) << "Refit without deformation changed the tree";
+  EXPECT_EQ(1.0f, refitted.refitDegradation()) << "Refit without deformation degraded the tree";
+
+  // deform the grid
+  for (int y = 0; y <= 64; ++y)
+  {
+    for (int x = 0; x <= 64; ++x)
+    {
+      const Mesh::VertexHandle vh = mesh.vertex_handle(y * 65 + x);
+      const Mesh::Point p = mesh.point(vh);
+      mesh.set_point(vh, Mesh::Point(p[0] + 0.3f * std::sin(p[1] * 2.0f), p[1], p[2] * 2.0f + 0.5f * std::cos(p[0])));
+    }
+  }
+
+  refitted.refit();
+  EXPECT_GT(refitted.refitDegradation(), 1.0f) << "Deformation should degrade the refitted tree";
+
+  BSP rebuilt(mesh);
+  for (Mesh::FIter f_it = mesh.faces_begin(); f_it != mesh.faces_end(); ++f_it)
+    rebuilt.push_back(*f_it);
+
+  rebuilt.build(10, 100);
+
+  for (int i = 0; i < 200; ++i)
+  {
+    const Mesh::Point p((i % 20) * 0.33f, (i / 20) * 0.65f, (i % 3) * 1.5f - 1.5f);
+    const Mesh::Point d((i % 7) * 0.1f - 0.3f, (i % 5) * 0.1f - 0.2f, (i % 3 == 0) ? 1.0f : -1.0f);
+
+    BSP::NearestNeighbor nnRefitted = refitted.nearest(p);
+    BSP::NearestNeighbor nnRebuilt  = rebuilt.nearest(p);
+
+    // the nearest face is ambiguous if the closest point is a vertex or on an edge
+    EXPECT_EQ(nnRebuilt.dist, nnRefitted.dist) << "Nearest distance differs for query " << i;
+
+    BSP::RayCollision rcRefitted = refitted.raycollision(p, d);
+    BSP::RayCollision rcRebuilt  = rebuilt.raycollision(p, d);
+
+    EXPECT_EQ(rcRebuilt.size(), rcRefitted.size()) << "Number of ray collisions differs for query " << i;
+  }
+}
@@ -0,0 +1,124 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+
+#include <gtest/gtest.h>
+
+#include <ACG/Geometry/GPUCacheOptimizer.hh>
+
+#include <vector>
+
+namespace {
+
+/*
+ * Regular grid of _n x _n quads, two triangles per quad, in row order.
+ */
+std::vector<unsigned int> createGrid(unsigned int _n) {
+    std::vector<unsigned int> indices;
+    indices.reserve(_n * _n * 6);
+
+    for (unsigned int y = 0; y < _n; ++y) {
+        for (unsigned int x = 0; x < _n; ++x) {
+            const unsigned int v0 = y * (_n + 1) + x;
+            const unsigned int v1 = v0 + 1;
+            const unsigned int v2 = v0 + _n + 1;
+            const unsigned int v3 = v2 + 1;
+
+            indices.push_back(v0); indices.push_back(v1); indices.push_back(v2);
+            indices.push_back(v1); indices.push_back(v3); indices.push_back(v2);
+        }
+    }
+
+    return indices;
+}
+
+class GPUCacheOptimizer : public testing::Test {
+
+    protected:
+
+        virtual void SetUp() {
+            gridSize_ = 512;
+            indices_ = createGrid(gridSize_);
+        }
+
+        virtual void TearDown() {
+        }
+
+        unsigned int numTris() const { return unsigned(indices_.size() / 3); }
+        unsigned int numVerts() const { return (gridSize_ + 1) * (gridSize_ + 1); }
+
+        unsigned int gridSize_;
+        std::vector<unsigned int> indices_;
+};
+
+TEST_F(GPUCacheOptimizer, tipsifyParallel_validPermutation) {
+    ACG::GPUCacheOptimizerTipsifyParallel opt(24, numTris(), numVerts(), 4, &indices_[0], 4096, 4);
+
+    EXPECT_EQ(opt.GetNumClusters(), (numTris() + 4095) / 4096);
+
+    std::vector<unsigned char> used(numTris(), 0);
+    const unsigned int* triMap = opt.GetTriangleMap();
+
+    for (unsigned int i = 0; i < numTris(); ++i) {
+        ASSERT_LT(triMap[i], numTris());
+        EXPECT_EQ(used[triMap[i]], 0) << "triangle " << triMap[i] << " used twice";
+        used[triMap[i]] = 1;
+    }
+}
+
+TEST_F(GPUCacheOptimizer, tipsifyParallel_deterministic) {
+    ACG::GPUCacheOptimizerTipsifyParallel opt1(24, numTris(), numVerts(), 4, &indices_[0], 4096, 1);
+    ACG::GPUCacheOptimizerTipsifyParallel opt4(24, numTris(), numVerts(), 4, &indices_[0], 4096, 4);
+
+    for (unsigned int i = 0; i < numTris(); ++i)
+        ASSERT_EQ(opt1.GetTriangleMap()[i], opt4.GetTriangleMap()[i]) << "result depends on the number of threads";
+}
+
+TEST_F(GPUCacheOptimizer, tipsifyParallel_acmr) {
+    ACG::GPUCacheOptimizerTipsify serial(24, numTris(), numVerts(), 4, &indices_[0]);
+    ACG::GPUCacheOptimizerTipsifyParallel parallel(24, numTris(), numVerts(), 4, &indices_[0], 65536, 0);
+
+    // only vertices on cluster borders are transformed more often
+    EXPECT_LT(parallel.ComputeACMR(24), serial.ComputeACMR(24) * 1.05f);
+}
+
+}
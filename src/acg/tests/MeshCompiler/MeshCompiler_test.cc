@@ -43,6 +43,12 @@
 
 #include <ACG/GL/VertexDeclaration.hh>
 #include <ACG/GL/MeshCompiler.hh>
+#include <ACG/Geometry/GPUCacheOptimizer.hh>
+#include <set>
+#include <map>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include "MeshCompiler_testData.hh"
 
@@ -218,6 +224,32 @@ SBFReader::SBFReader(const char* szObjFile)
 
 
 
+// collects the output of MeshCompiler::buildChunked() in combined buffers
+
+class ChunkCollector : public ACG::MeshCompilerChunkCallback
+{
+public:
+  explicit ChunkCollector(int _stride) : stride_(_stride), numChunks_(0) {}
+
+  void processChunk(const ACG::MeshCompilerChunk& _chunk) override
+  {
+    EXPECT_EQ(_chunk.id, numChunks_++);
+    EXPECT_EQ(_chunk.vertexOffset * stride_, int(vertices_.size()));
+    EXPECT_EQ(_chunk.indexOffset, int(indices_.size()));
+
+    vertices_.insert(vertices_.end(), _chunk.vertices, _chunk.vertices + _chunk.numVertices * stride_);
+    indices_.insert(indices_.end(), _chunk.indices, _chunk.indices + _chunk.numTriangles * 3);
+    faceIDs_.insert(faceIDs_.end(), _chunk.faceIDs, _chunk.faceIDs + _chunk.numTriangles);
+  }
+
+  int stride_;
+  int numChunks_;
+  std::vector<char> vertices_;
+  std::vector<int> indices_;
+  std::vector<int> faceIDs_;
+};
+
+
 class MeshCompilerTest : public testing::Test {
 
 public:
@@ -297,6 +329,620 @@ protected:
   }
 
 
+  // compare all output buffers and id mappings of two compiled meshes
+  void ExpectEqualOutput(ACG::MeshCompiler* a, ACG::MeshCompiler* b) {
+
+    ASSERT_EQ(a->getNumVertices(), b->getNumVertices()) << "vertex count differs";
+    ASSERT_EQ(a->getNumTriangles(), b->getNumTriangles()) << "triangle count differs";
+    ASSERT_EQ(a->getNumSubsets(), b->getNumSubsets()) << "subset count differs";
+
+    for (int i = 0; i < a->getNumSubsets(); ++i) {
+      EXPECT_EQ(a->getSubset(i)->id, b->getSubset(i)->id);
+      EXPECT_EQ(a->getSubset(i)->startIndex, b->getSubset(i)->startIndex);
+      EXPECT_EQ(a->getSubset(i)->numTris, b->getSubset(i)->numTris);
+    }
+
+    const int numIndices = a->getNumTriangles() * 3;
+    EXPECT_TRUE(std::equal(a->getIndexBuffer(), a->getIndexBuffer() + numIndices, b->getIndexBuffer())) << "index buffer differs";
+
+    const size_t vbSize = a->getNumVertices() * a->getVertexDeclaration()->getVertexStride();
+    std::vector<char> vbA(vbSize), vbB(vbSize);
+    a->getVertexBuffer(vbA.data());
+    b->getVertexBuffer(vbB.data());
+    EXPECT_TRUE(vbA == vbB) << "vertex buffer differs";
+
+    for (int i = 0; i < a->getNumTriangles(); ++i)
+      EXPECT_EQ(a->mapToOriginalFaceID(i), b->mapToOriginalFaceID(i)) << "triangle " << i;
+
+    for (int i = 0; i < a->getNumVertices(); ++i) {
+      int faceA, cornerA, faceB, cornerB;
+      EXPECT_EQ(a->mapToOriginalVertexID(i, faceA, cornerA), b->mapToOriginalVertexID(i, faceB, cornerB)) << "vertex " << i;
+      EXPECT_EQ(faceA, faceB) << "vertex " << i;
+      EXPECT_EQ(cornerA, cornerB) << "vertex " << i;
+    }
+
+    for (int i = 0; i < a->getNumFaces(); ++i)
+      for (int k = 0; k < a->getFaceSize(i); ++k)
+        EXPECT_EQ(a->mapToDrawVertexID(i, k), b->mapToDrawVertexID(i, k)) << "face " << i << " corner " << k;
+  }
+
+  // build with and without multithreading for all build options and compare the results
+  void TestMultithreadedBuild(const MeshTestData& input) {
+
+    for (int flags = 0; flags < 8; ++flags) {
+
+      // same random group ids for both meshes
+      srand(flags);
+      ACG::MeshCompiler* serialMesh = CreateMesh(input);
+      srand(flags);
+      ACG::MeshCompiler* parallelMesh = CreateMesh(input);
+
+      parallelMesh->setNumThreads(4);
+
+      serialMesh->build(flags & 1, flags & 2, flags & 4);
+      parallelMesh->build(flags & 1, flags & 2, flags & 4);
+
+      EXPECT_EQ(parallelMesh->dbgVerify(0), true) << "compiled mesh contains errors";
+      ExpectEqualOutput(serialMesh, parallelMesh);
+
+      delete serialMesh;
+      delete parallelMesh;
+    }
+  }
+
+  // build with hash based welding
+  void TestHashWelding(const MeshTestData& input) {
+
+    ACG::MeshCompiler* unwelded = CreateMesh(input);
+    ACG::MeshCompiler* hashWelded = CreateMesh(input);
+    ACG::MeshCompiler* quantizedWelded = CreateMesh(input);
+
+    hashWelded->setWeldMethod(ACG::MeshCompiler::WELD_HASH);
+    quantizedWelded->setWeldMethod(ACG::MeshCompiler::WELD_HASH_QUANTIZED, 1e-4);
+
+    // no per-face attributes, because the unshared provoking vertices may cause additional splits after welding
+    unwelded->build(false, true, false);
+    hashWelded->build(true, true, false);
+    quantizedWelded->build(true, true, false);
+
+    EXPECT_EQ(hashWelded->dbgVerify(0), true) << "compiled mesh contains errors";
+    EXPECT_EQ(quantizedWelded->dbgVerify(0), true) << "compiled mesh contains errors";
+
+    // bitwise equal vertices are also equal after quantization
+    EXPECT_LE(hashWelded->getNumVertices(), unwelded->getNumVertices());
+    EXPECT_LE(quantizedWelded->getNumVertices(), hashWelded->getNumVertices());
+
+    delete unwelded;
+    delete hashWelded;
+    delete quantizedWelded;
+
+    ExpectQuantizedWelding(input, 1e-4);
+    ExpectQuantizedWelding(input, 1e-2);
+  }
+
+  // float components of the input data of a face corner in the vertex layout of CreateMesh()
+  std::vector<float> GetCornerData(const MeshTestData& input, int offset) {
+
+    std::vector<float> data(input.vdata_pos + input.fdata_pos[offset] * 3, input.vdata_pos + input.fdata_pos[offset] * 3 + 3);
+    if (input.numTexcoords_)
+      data.insert(data.end(), input.vdata_t + input.fdata_t[offset] * 2, input.vdata_t + input.fdata_t[offset] * 2 + 2);
+    if (input.numNormals_)
+      data.insert(data.end(), input.vdata_n + input.fdata_n[offset] * 3, input.vdata_n + input.fdata_n[offset] * 3 + 3);
+    return data;
+  }
+
+  // welded corners must be within eps of their draw vertex, corners further apart must not be welded
+  void ExpectQuantizedWelding(const MeshTestData& input, double eps) {
+
+    ACG::MeshCompiler* mesh = CreateMesh(input);
+    mesh->setWeldMethod(ACG::MeshCompiler::WELD_HASH_QUANTIZED, eps);
+    mesh->build(true, true, false);
+
+    // dbgVerify() compares with a fixed epsilon, the distances are checked here instead
+    const int numFloats = mesh->getVertexDeclaration()->getVertexStride() / 4;
+    std::vector<float> vb(mesh->getNumVertices() * numFloats);
+    mesh->getVertexBuffer(vb.data());
+
+    // corners grouped by input position: draw vertex and input data
+    std::map<int, std::vector<std::pair<int, std::vector<float> > > > corners;
+
+    int offset = 0;
+    for (int i = 0; i < input.numFaces_; ++i) {
+      for (int k = 0; k < input.fsize_[i]; ++k, ++offset) {
+        const int v = mesh->mapToDrawVertexID(i, k);
+        const std::vector<float> data = GetCornerData(input, offset);
+
+        ASSERT_EQ(int(data.size()), numFloats);
+        for (int c = 0; c < numFloats; ++c)
+          ASSERT_LE(std::fabs(double(vb[v * numFloats + c]) - double(data[c])), eps) << "face " << i << " corner " << k << " welded to a distant vertex";
+
+        corners[input.fdata_pos[offset]].push_back(std::make_pair(v, data));
+      }
+    }
+
+    for (std::map<int, std::vector<std::pair<int, std::vector<float> > > >::const_iterator it = corners.begin(); it != corners.end(); ++it) {
+      for (size_t a = 0; a < it->second.size(); ++a) {
+        for (size_t b = a + 1; b < it->second.size(); ++b) {
+          double maxDiff = 0.0;
+          for (int c = 0; c < numFloats; ++c)
+            maxDiff = std::max(maxDiff, std::fabs(double(it->second[a].second[c]) - double(it->second[b].second[c])));
+
+          if (maxDiff > eps * 1.001) {
+            ASSERT_NE(it->second[a].first, it->second[b].first) << "distinct corners of position " << it->first << " were welded";
+          }
+        }
+      }
+    }
+
+    delete mesh;
+  }
+
+  // modify some input positions and refill the dirty ranges of a compiled vertex buffer
+  void TestIncrementalUpdate(const MeshTestData& input) {
+
+    std::vector<float> positions(input.vdata_pos, input.vdata_pos + input.numVerts_ * 3);
+
+    ACG::MeshCompiler* mesh = CreateMesh(input);
+    mesh->setVertices(input.numVerts_, positions.data());
+    mesh->build(true, true, true);
+
+    const size_t vbSize = mesh->getNumVertices() * mesh->getVertexDeclaration()->getVertexStride();
+    std::vector<char> vbRefill(vbSize), vbFull(vbSize);
+    mesh->getVertexBuffer(vbRefill.data());
+
+    for (int i = 0; i < input.numVerts_; i += 7) {
+      positions[i * 3 + 1] += 1.0f;
+      mesh->setInputVertexDirty(i);
+    }
+
+    std::vector< std::pair<int, int> > ranges;
+    const int numWritten = mesh->refillVertexBuffer(vbRefill.data(), &ranges, 4);
+    mesh->getVertexBuffer(vbFull.data());
+
+    EXPECT_TRUE(vbRefill == vbFull) << "refilled vertex buffer differs";
+    EXPECT_GT(numWritten, 0);
+    EXPECT_LE(numWritten, mesh->getNumVertices());
+    EXPECT_EQ(mesh->getNumDirtyInputVertices(), 0);
+
+    for (size_t i = 1; i < ranges.size(); ++i)
+      EXPECT_GT(ranges[i].first, ranges[i - 1].second + 4) << "ranges not merged";
+
+    delete mesh;
+  }
+
+  // compile in small chunks and compare with a regular build
+  void TestChunkedBuild(const MeshTestData& input) {
+
+    ACG::MeshCompiler* reference = CreateMesh(input);
+    ACG::MeshCompiler* chunked = CreateMesh(input);
+
+    reference->build(false, true, false);
+
+    const int stride = chunked->getVertexDeclaration()->getVertexStride();
+    ChunkCollector collector(stride);
+    const int numVerts = chunked->buildChunked(&collector, 16);
+
+    EXPECT_GT(collector.numChunks_, 1);
+    EXPECT_EQ(numVerts * stride, int(collector.vertices_.size()));
+    ASSERT_EQ(reference->getNumTriangles() * 3, int(collector.indices_.size())) << "index count differs";
+
+    std::vector<int> trisPerFace(input.numFaces_, 0);
+    std::vector<int> faceOffset(input.numFaces_ + 1, 0);
+    for (int i = 0; i < input.numFaces_; ++i)
+      faceOffset[i + 1] = faceOffset[i] + input.fsize_[i];
+
+    for (int i = 0; i < int(collector.faceIDs_.size()); ++i) {
+      const int faceID = collector.faceIDs_[i];
+      ASSERT_TRUE(faceID >= 0 && faceID < input.numFaces_);
+      ++trisPerFace[faceID];
+
+      // triangle vertices must be corners of the input face
+      for (int k = 0; k < 3; ++k) {
+        const int v = collector.indices_[i * 3 + k];
+        ASSERT_TRUE(v >= 0 && v < numVerts);
+
+        const float* pos = reinterpret_cast<const float*>(&collector.vertices_[v * stride]);
+        bool found = false;
+
+        for (int c = faceOffset[faceID]; c < faceOffset[faceID + 1]; ++c) {
+          const float* inputPos = input.vdata_pos + 3 * input.fdata_pos[c];
+          found = found || std::equal(pos, pos + 3, inputPos);
+        }
+
+        EXPECT_TRUE(found) << "triangle " << i << " vertex " << k;
+      }
+    }
+
+    for (int i = 0; i < input.numFaces_; ++i) {
+      int numTris = 0;
+      reference->mapToDrawTriID(i, 0, &numTris);
+      EXPECT_EQ(numTris, trisPerFace[i]) << "face " << i;
+    }
+
+    delete reference;
+    delete chunked;
+  }
+
+  // chunked build of a mesh with a NaN position still emits every face
+  void TestChunkedBuildNaN(const MeshTestData& input) {
+
+    std::vector<float> positions(input.vdata_pos, input.vdata_pos + input.numVerts_ * 3);
+    positions[0] = std::numeric_limits<float>::quiet_NaN();
+
+    ACG::MeshCompiler* reference = CreateMesh(input);
+    ACG::MeshCompiler* chunked = CreateMesh(input);
+    chunked->setVertices(input.numVerts_, positions.data());
+
+    reference->build(false, true, false);
+
+    ChunkCollector collector(chunked->getVertexDeclaration()->getVertexStride());
+    chunked->buildChunked(&collector, 16);
+
+    EXPECT_EQ(reference->getNumTriangles(), int(collector.faceIDs_.size()));
+
+    std::vector<int> trisPerFace(input.numFaces_, 0);
+    for (size_t i = 0; i < collector.faceIDs_.size(); ++i)
+      ++trisPerFace[collector.faceIDs_[i]];
+
+    for (int i = 0; i < input.numFaces_; ++i) {
+      int numTris = 0;
+      reference->mapToDrawTriID(i, 0, &numTris);
+      EXPECT_EQ(numTris, trisPerFace[i]) << "face " << i;
+    }
+
+    delete reference;
+    delete chunked;
+  }
+
+  // compare compact buffers with the regular draw buffers
+  void TestCompactOutput(const MeshTestData& input) {
+
+    ACG::MeshCompiler* mesh = CreateMesh(input);
+    mesh->build(true, true, false);
+    mesh->buildCompactOutput(ACG::MeshCompiler::COMPACT_ALL);
+
+    const ACG::VertexDeclaration* decl = mesh->getVertexDeclaration();
+    const ACG::VertexDeclaration* compactDecl = mesh->getCompactVertexDeclaration();
+
+    ASSERT_EQ(decl->getNumElements(), compactDecl->getNumElements());
+    EXPECT_LT(compactDecl->getVertexStride(), decl->getVertexStride());
+    EXPECT_GE(mesh->getNumCompactVertices(), mesh->getNumVertices());
+
+    std::vector<char> vb(mesh->getNumVertices() * decl->getVertexStride());
+    std::vector<char> compactVB(mesh->getNumCompactVertices() * compactDecl->getVertexStride());
+    std::vector<char> compactIB(mesh->getCompactIndexBufferSize());
+
+    mesh->getVertexBuffer(vb.data());
+    mesh->getCompactVertexBuffer(compactVB.data());
+    mesh->getCompactIndexBuffer(compactIB.data());
+
+    for (int s = 0; s < mesh->getNumSubsets(); ++s) {
+      const ACG::MeshCompiler::CompactSubset* cs = mesh->getCompactSubset(s);
+      const ACG::MeshCompiler::Subset* sub = mesh->getSubset(s);
+
+      EXPECT_EQ(cs->numIndices, sub->numTris * 3);
+      EXPECT_EQ(cs->indexType, GLenum(GL_UNSIGNED_SHORT));
+
+      const unsigned short* indices = reinterpret_cast<const unsigned short*>(&compactIB[cs->indexByteOffset]);
+
+      for (unsigned int i = 0; i < cs->numIndices; ++i) {
+        ASSERT_LT(indices[i], cs->numVertices);
+
+        const int drawID = mesh->getIndex(sub->startIndex + i);
+        const int compactID = cs->baseVertex + indices[i];
+        EXPECT_EQ(drawID, mesh->mapCompactToDrawVertexID(compactID));
+
+        // dequantize position
+        const float* pos = reinterpret_cast<const float*>(&vb[drawID * decl->getVertexStride()]);
+        const short* qpos = reinterpret_cast<const short*>(&compactVB[compactID * compactDecl->getVertexStride()]);
+
+        for (int k = 0; k < 3; ++k) {
+          const float p = float(qpos[k]) / 32767.0f * cs->posScale[k] + cs->posOffset[k];
+          EXPECT_NEAR(pos[k], p, cs->posScale[k] / 32767.0f * 1.01f + 1e-6f);
+        }
+
+        for (unsigned int e = 1; e < decl->getNumElements(); ++e) {
+          const char* a = &vb[drawID * decl->getVertexStride()] + decl->getElement(e)->getByteOffset();
+          const char* b = &compactVB[compactID * compactDecl->getVertexStride()] + compactDecl->getElement(e)->getByteOffset();
+
+          if (compactDecl->getElement(e)->type_ == GL_INT_2_10_10_10_REV) {
+            // packed normal
+            int packed;
+            memcpy(&packed, b, 4);
+            for (int k = 0; k < 3; ++k) {
+              const int c = (packed << (22 - 10 * k)) >> 22; // sign extend 10 bit component
+              EXPECT_NEAR(reinterpret_cast<const float*>(a)[k], float(c) / 511.0f, 1.01f / 511.0f);
+            }
+          }
+          else // other attributes are copied
+            EXPECT_EQ(0, memcmp(a, b, ACG::VertexDeclaration::getElementSize(decl->getElement(e))));
+        }
+      }
+    }
+
+    delete mesh;
+  }
+
+  // build with overdraw optimization
+  // overdraw estimate and ACMR of a compiled mesh with float3 positions at the beginning of each vertex
+  void ComputeOverdrawAndACMR(ACG::MeshCompiler* mesh, float* overdraw, float* acmr) {
+
+    const int stride = mesh->getVertexDeclaration()->getVertexStride();
+    std::vector<char> vb(mesh->getNumVertices() * stride);
+    mesh->getVertexBuffer(vb.data());
+
+    ACG::GPUCacheEfficiencyTester tester(mesh->getNumTriangles(), mesh->getNumVertices(), 4, mesh->getIndexBuffer());
+
+    *overdraw = tester.ComputeOverdraw(reinterpret_cast<const float*>(vb.data()), stride, 64, false);
+    *acmr = tester.ComputeACMR();
+  }
+
+  // compare overdraw optimization with plain Tipsify on the same mesh
+  void TestOverdrawOptimization(const MeshTestData& input) {
+
+    // same random group ids for both meshes
+    srand(0);
+    ACG::MeshCompiler* tipsified = CreateMesh(input);
+    srand(0);
+    ACG::MeshCompiler* optimized = CreateMesh(input);
+
+    tipsified->build(true, true, true, false, false);
+    optimized->build(true, true, true, false, true);
+
+    EXPECT_EQ(optimized->dbgVerify(0), true) << "compiled mesh contains errors";
+
+    float tipsifiedOverdraw, tipsifiedACMR, optimizedOverdraw, optimizedACMR;
+    ComputeOverdrawAndACMR(tipsified, &tipsifiedOverdraw, &tipsifiedACMR);
+    ComputeOverdrawAndACMR(optimized, &optimizedOverdraw, &optimizedACMR);
+
+    EXPECT_GE(optimizedOverdraw, 1.0f);
+    EXPECT_LE(optimizedOverdraw, tipsifiedOverdraw) << "overdraw optimization increased the overdraw";
+
+    // splitting the Tipsify order at dead-ends only adds cache misses at the cluster borders
+    EXPECT_LE(optimizedACMR, tipsifiedACMR * 1.1f) << "overdraw optimization lost too much vertex cache efficiency";
+
+    delete tipsified;
+    delete optimized;
+  }
+
+  // clustered vcache optimization of a large grid with shuffled face order
+  void TestClusteredVCacheOptimization() {
+
+    const int n = 260; // 2 * 260^2 triangles, enough for at least two clusters
+
+    std::vector<float> positions;
+    for (int y = 0; y <= n; ++y) {
+      for (int x = 0; x <= n; ++x) {
+        positions.push_back(float(x));
+        positions.push_back(float(y));
+        positions.push_back(0.0f);
+      }
+    }
+
+    std::vector<int> faces(n * n);
+    for (int i = 0; i < n * n; ++i)
+      faces[i] = i;
+
+    srand(0);
+    for (int i = n * n - 1; i > 0; --i)
+      std::swap(faces[i], faces[rand() % (i + 1)]);
+
+    float acmr[2];
+
+    for (int clustered = 0; clustered < 2; ++clustered) {
+      ACG::VertexDeclaration decl;
+      decl.addElement(GL_FLOAT, 3, ACG::VERTEX_USAGE_POSITION);
+
+      ACG::MeshCompiler mesh(decl);
+      mesh.setVertices(int(positions.size()) / 3, positions.data());
+      mesh.setNumFaces(n * n, n * n * 4);
+
+      for (int i = 0; i < n * n; ++i) {
+        const int v = (faces[i] / n) * (n + 1) + faces[i] % n;
+        int corners[4] = { v, v + 1, v + n + 2, v + n + 1 };
+        mesh.setFaceVerts(i, 4, corners);
+      }
+
+      mesh.setNumThreads(clustered ? 4 : 1);
+      mesh.setClusteredVCacheOptimization(clustered != 0);
+      mesh.build(true, true, false);
+
+      EXPECT_EQ(mesh.dbgVerify(0), true) << "compiled mesh contains errors";
+
+      ACG::GPUCacheEfficiencyTester tester(mesh.getNumTriangles(), mesh.getNumVertices(), 4, mesh.getIndexBuffer());
+      acmr[clustered] = tester.ComputeACMR();
+    }
+
+    // clusters are spatially coherent, so only the cluster borders add cache misses
+    EXPECT_LE(acmr[1], acmr[0] * 1.05f) << "clustered optimization lost too much vertex cache efficiency";
+  }
+
+  void TestVertexFetchOrder(const MeshTestData& input, bool optimizeVCache) {
+
+    ACG::MeshCompiler* mesh = CreateMesh(input);
+    mesh->build(true, optimizeVCache, true, false);
+
+    EXPECT_EQ(mesh->dbgVerify(0), true) << "compiled mesh contains errors";
+
+    // draw vertices must be numbered in first-use order of the index buffer
+    const int numIndices = mesh->getNumTriangles() * 3;
+    int numUsed = 0;
+
+    for (int i = 0; i < numIndices; ++i) {
+      const int v = mesh->getIndex(i);
+      EXPECT_LE(v, numUsed) << "draw vertex " << v << " used before its predecessors";
+      if (v == numUsed)
+        ++numUsed;
+    }
+
+    // vertex maps must stay consistent after renumbering
+    for (int v = 0; v < mesh->getNumVertices(); ++v) {
+      int face = -1, corner = -1;
+      mesh->mapToOriginalVertexID(v, face, corner);
+
+      if (face >= 0) {
+        EXPECT_EQ(mesh->mapToDrawVertexID(face, corner), v) << "vertex map mismatch for draw vertex " << v;
+      }
+    }
+
+    const int stride = mesh->getVertexDeclaration()->getVertexStride();
+    ACG::GPUCacheEfficiencyTester tester(mesh->getNumTriangles(), mesh->getNumVertices(), 4, mesh->getIndexBuffer());
+
+    const float efficiency = tester.ComputeFetchEfficiency(stride);
+    EXPECT_GT(efficiency, 0.0f);
+    EXPECT_LE(efficiency, 1.0f);
+
+    delete mesh;
+  }
+
+  void TestMeshlets(const MeshTestData& input) {
+
+    ACG::MeshCompiler* mesh = CreateMesh(input);
+    mesh->build(true, true, true, false);
+
+    EXPECT_EQ(mesh->dbgVerify(0), true) << "compiled mesh contains errors";
+
+    const int numMeshlets = mesh->buildMeshlets(16, 20);
+    EXPECT_EQ(numMeshlets, mesh->getNumMeshlets());
+    EXPECT_GT(numMeshlets, 0);
+
+    const int stride = mesh->getVertexDeclaration()->getVertexStride();
+    std::vector<char> vb(mesh->getNumVertices() * stride);
+    mesh->getVertexBuffer(vb.data());
+
+    // float3 positions are stored at the beginning of each vertex
+    const int* ib = mesh->getIndexBuffer();
+    const float* pos = reinterpret_cast<const float*>(vb.data());
+    const int posStride = stride / 4;
+
+    unsigned int numTris = 0;
+
+    for (int s = 0; s < mesh->getNumSubsets(); ++s) {
+      int first, count;
+      mesh->getSubsetMeshlets(s, first, count);
+
+      // meshlets cover the index range of their subset without gaps
+      unsigned int offset = mesh->getSubset(s)->startIndex;
+
+      for (int m = first; m < first + count; ++m) {
+        const ACG::MeshCompilerMeshlet* ml = mesh->getMeshlet(m);
+
+        EXPECT_EQ(ml->subset, s);
+        EXPECT_EQ(ml->indexOffset, offset);
+        EXPECT_LE(ml->numTriangles, 20u);
+        EXPECT_LE(ml->numVertices, 16u);
+
+        std::set<int> verts(ib + ml->indexOffset, ib + ml->indexOffset + ml->numTriangles * 3);
+        EXPECT_EQ(verts.size(), ml->numVertices);
+
+        for (std::set<int>::const_iterator it = verts.begin(); it != verts.end(); ++it) {
+          const float* p = pos + *it * posStride;
+          float d2 = 0.0f;
+          for (int k = 0; k < 3; ++k)
+            d2 += (p[k] - ml->center[k]) * (p[k] - ml->center[k]);
+          EXPECT_LE(std::sqrt(d2), ml->radius * 1.0001f + 1e-6f) << "vertex outside of meshlet bounding sphere";
+        }
+
+        // all triangles are backfacing if the meshlet is seen from behind its cone apex
+        if (ml->coneCutoff <= 1.0f) {
+          float eye[3];
+          for (int k = 0; k < 3; ++k)
+            eye[k] = ml->coneApex[k] - ml->coneAxis[k] * (ml->radius + 1.0f);
+
+          for (unsigned int t = 0; t < ml->numTriangles; ++t) {
+            const float* p0 = pos + ib[ml->indexOffset + t * 3] * posStride;
+            const float* p1 = pos + ib[ml->indexOffset + t * 3 + 1] * posStride;
+            const float* p2 = pos + ib[ml->indexOffset + t * 3 + 2] * posStride;
+
+            const float e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const float e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            const float n[3] = {e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0]};
+
+            const float facing = n[0] * (eye[0] - p0[0]) + n[1] * (eye[1] - p0[1]) + n[2] * (eye[2] - p0[2]);
+            EXPECT_LE(facing, 1e-5f) << "front facing triangle in culled meshlet " << m;
+          }
+        }
+
+        offset += ml->numTriangles * 3;
+        numTris += ml->numTriangles;
+      }
+
+      EXPECT_EQ(offset, mesh->getSubset(s)->startIndex + mesh->getSubset(s)->numTris * 3);
+    }
+
+    EXPECT_EQ(int(numTris), mesh->getNumTriangles());
+
+    // gpu table
+    std::vector<char> table(numMeshlets * ACG::MeshCompiler::MESHLET_TABLE_STRIDE);
+    mesh->getMeshletTable(table.data());
+
+    for (int m = 0; m < numMeshlets; ++m) {
+      unsigned int range[4];
+      memcpy(range, &table[m * ACG::MeshCompiler::MESHLET_TABLE_STRIDE + 48], sizeof(range));
+
+      EXPECT_EQ(range[0], mesh->getMeshlet(m)->indexOffset);
+      EXPECT_EQ(range[1], mesh->getMeshlet(m)->numTriangles);
+    }
+
+    delete mesh;
+  }
+
+  // move some input positions and refit the meshlets touching the dirty ranges
+  void TestMeshletRefit(const MeshTestData& input) {
+
+    std::vector<float> positions(input.vdata_pos, input.vdata_pos + input.numVerts_ * 3);
+
+    ACG::MeshCompiler* mesh = CreateMesh(input);
+    mesh->setVertices(input.numVerts_, positions.data());
+    mesh->build(true, true, true, false);
+
+    const int numMeshlets = mesh->buildMeshlets(16, 20);
+    ASSERT_GT(numMeshlets, 1);
+
+    const std::vector<ACG::MeshCompilerMeshlet> initial(mesh->getMeshlet(0), mesh->getMeshlet(0) + numMeshlets);
+
+    for (int i = 0; i < input.numVerts_; i += 11) {
+      positions[i * 3 + 2] += 0.5f;
+      mesh->setInputVertexDirty(i);
+    }
+
+    std::vector< std::pair<int, int> > ranges;
+    mesh->getDirtyVertexRanges(ranges);
+    mesh->clearDirtyInputVertices();
+
+    const int numRefitted = mesh->refitMeshlets(ranges);
+    EXPECT_GT(numRefitted, 0);
+    EXPECT_LE(numRefitted, numMeshlets);
+    ASSERT_EQ(numMeshlets, mesh->getNumMeshlets());
+
+    const std::vector<ACG::MeshCompilerMeshlet> refitted(mesh->getMeshlet(0), mesh->getMeshlet(0) + numMeshlets);
+
+    // refitting all meshlets must not change anything anymore
+    EXPECT_EQ(mesh->refitMeshlets(), numMeshlets);
+
+    int numChanged = 0;
+
+    for (int m = 0; m < numMeshlets; ++m) {
+      const ACG::MeshCompilerMeshlet* ml = mesh->getMeshlet(m);
+
+      // partition is kept
+      EXPECT_EQ(ml->subset, initial[m].subset);
+      EXPECT_EQ(ml->indexOffset, initial[m].indexOffset);
+      EXPECT_EQ(ml->numTriangles, initial[m].numTriangles);
+      EXPECT_EQ(ml->numVertices, initial[m].numVertices);
+
+      EXPECT_EQ(0, memcmp(ml, &refitted[m], sizeof(ACG::MeshCompilerMeshlet))) << "meshlet " << m << " missed by partial refit";
+
+      if (memcmp(ml, &initial[m], sizeof(ACG::MeshCompilerMeshlet)))
+        ++numChanged;
+    }
+
+    EXPECT_GT(numChanged, 0);
+    EXPECT_LE(numChanged, numRefitted);
+
+    delete mesh;
+  }
+
   ACG::MeshCompiler* mesh0_;
   ACG::MeshCompiler* mesh1_;
 
@@ -425,3 +1071,208 @@ TEST_F(MeshCompilerTest, tri_vpos_texc__ttt ) {
 
   EXPECT_EQ(mesh1_->dbgVerify(0), true) << "compiled mesh contains errors";
 }
+
+
+
+TEST_F(MeshCompilerTest, npoly_vpos__multithreaded ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestMultithreadedBuild(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__multithreaded ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestMultithreadedBuild(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__hashweld ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestHashWelding(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__hashweld ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestHashWelding(input);
+}
+
+TEST_F(MeshCompilerTest, quantized_weld__nonfinite ) {
+
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+
+  const float positions[] = { 0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f };
+
+  // equal non-finite and huge values are welded, different ones are not
+  const float texcoords[] = {
+    inf, nan,        1e30f, 0.0f,        -inf, 0.0f,
+    inf, nan,        -inf, 0.0f,         2e30f, 0.0f,
+    1.000001e30f, 0.0f,  -inf, 0.0f,     2e30f, 0.0f
+  };
+
+  int faceVerts[] = { 0, 1, 2,  0, 2, 3,  1, 2, 3 };
+  int faceTexCoords[] = { 0, 1, 2,  3, 4, 5,  6, 7, 8 };
+
+  ACG::VertexDeclaration decl;
+  decl.addElement(GL_FLOAT, 3, ACG::VERTEX_USAGE_POSITION);
+  decl.addElement(GL_FLOAT, 2, ACG::VERTEX_USAGE_TEXCOORD);
+
+  ACG::MeshCompiler mesh(decl);
+  mesh.setVertices(4, positions);
+  mesh.setTexCoords(9, texcoords);
+  mesh.setNumFaces(3, 9);
+
+  for (int i = 0; i < 3; ++i) {
+    mesh.setFaceVerts(i, 3, faceVerts + i * 3);
+    mesh.setFaceTexCoords(i, 3, faceTexCoords + i * 3);
+  }
+
+  mesh.setWeldMethod(ACG::MeshCompiler::WELD_HASH_QUANTIZED, 1e-4);
+  mesh.build(true, false, false);
+
+  EXPECT_EQ(mesh.dbgVerify(0), true) << "compiled mesh contains errors";
+
+  // unique: (0, inf nan), (1, 1e30), (1, 1.000001e30), (2, -inf), (3, 2e30)
+  EXPECT_EQ(mesh.getNumVertices(), 5);
+  EXPECT_EQ(mesh.mapToDrawVertexID(0, 0), mesh.mapToDrawVertexID(1, 0)) << "infinite and NaN components not welded";
+  EXPECT_EQ(mesh.mapToDrawVertexID(0, 2), mesh.mapToDrawVertexID(2, 1)) << "infinite components not welded";
+  EXPECT_EQ(mesh.mapToDrawVertexID(1, 2), mesh.mapToDrawVertexID(2, 2)) << "huge components not welded";
+  EXPECT_NE(mesh.mapToDrawVertexID(0, 1), mesh.mapToDrawVertexID(2, 0)) << "distinct huge components welded";
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__incremental ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestIncrementalUpdate(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__incremental ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestIncrementalUpdate(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__chunked ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestChunkedBuild(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__chunked ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestChunkedBuild(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__chunked_nan ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestChunkedBuildNaN(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__compact ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestCompactOutput(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__compact ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestCompactOutput(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__overdraw ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestOverdrawOptimization(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__overdraw ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestOverdrawOptimization(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__fetch ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestVertexFetchOrder(input, true);
+  TestVertexFetchOrder(input, false);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__fetch ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestVertexFetchOrder(input, true);
+  TestVertexFetchOrder(input, false);
+}
+
+TEST_F(MeshCompilerTest, grid_vpos__clustered_vcache ) {
+
+  TestClusteredVCacheOptimization();
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__meshlets ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestMeshlets(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__meshlets ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestMeshlets(input);
+}
+
+TEST_F(MeshCompilerTest, npoly_vpos__meshlet_refit ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput0(&input);
+
+  TestMeshletRefit(input);
+}
+
+TEST_F(MeshCompilerTest, tri_vpos_texc__meshlet_refit ) {
+
+  MeshTestData input;
+  MeshCompilerTest_GetInput1(&input);
+
+  TestMeshletRefit(input);
+}
@@ -0,0 +1,201 @@
+/*===========================================================================*\
+ *                                                                           *
+ *                              OpenFlipper                                  *
+ *           Copyright (c) 2001-2015, RWTH-Aachen University                 *
+ *           Department of Computer Graphics and Multimedia                  *
+ *                          All rights reserved.                             *
+ *                            www.openflipper.org                            *
+ *                                                                           *
+ *---------------------------------------------------------------------------*
+ * This file is part of OpenFlipper.                                         *
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ * Redistribution and use in source and binary forms, with or without        *
+ * modification, are permitted provided that the following conditions        *
+ * are met:                                                                  *
+ *                                                                           *
+ * 1. Redistributions of source code must retain the above copyright notice, *
+ *    this list of conditions and the following disclaimer.                  *
+ *                                                                           *
+ * 2. Redistributions in binary form must reproduce the above copyright      *
+ *    notice, this list of conditions and the following disclaimer in the    *
+ *    documentation and/or other materials provided with the distribution.   *
+ *                                                                           *
+ * 3. Neither the name of the copyright holder nor the names of its          *
+ *    contributors may be used to endorse or promote products derived from   *
+ *    this software without specific prior written permission.               *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED *
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A           *
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER *
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,  *
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,       *
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR        *
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF    *
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING      *
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS        *
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.              *
+ *                                                                           *
+\*===========================================================================*/
+
+
+
+#include <gtest/gtest.h>
+
+#include <ACG/ShaderUtils/UniformPool.hh>
+
+#include <string>
+
+namespace {
+
+/*
+ * Exposes the storage of a pool, only storage is tested here, binding requires a GL context.
+ */
+class UniformPoolInspector : public GLSL::UniformPool {
+  public:
+    UniformPoolInspector() {}
+    explicit UniformPoolInspector(const GLSL::UniformPool& _pool) : GLSL::UniformPool(_pool) {}
+
+    size_t numUniforms() const { return uniforms_.size(); }
+    size_t dataSize() const { return data_.size(); }
+    size_t uniformCapacity() const { return uniforms_.capacity(); }
+    size_t dataCapacity() const { return data_.capacity(); }
+
+    std::string str() const { return toString().toStdString(); }
+};
+
+TEST(UniformPool, setUniform_overwrite) {
+    UniformPoolInspector pool;
+    EXPECT_TRUE(pool.empty());
+
+    pool.setUniform("f", 1.5f);
+    pool.setUniform("v", ACG::Vec3f(1.0f, 2.0f, 3.0f));
+    EXPECT_FALSE(pool.empty());
+    EXPECT_EQ(pool.str(), "uniform float f = 1.5\nuniform vec3 v = vec3(1, 2, 3);\n");
+
+    // overwriting keeps the entry and its position
+    pool.setUniform("f", 2.5f);
+    EXPECT_EQ(pool.numUniforms(), 2u);
+    EXPECT_EQ(pool.dataSize(), 4 * sizeof(GLfloat));
+    EXPECT_EQ(pool.str(), "uniform float f = 2.5\nuniform vec3 v = vec3(1, 2, 3);\n");
+}
+
+TEST(UniformPool, setUniform_typeChange) {
+    UniformPoolInspector pool;
+
+    pool.setUniform("f", 1.5f);
+    pool.setUniform("v", ACG::Vec2f(1.0f, 2.0f));
+    pool.setUniform("g", 5.0f);
+
+    // different types are rejected, the old value stays
+    pool.setUniform("f", GLint(3));
+    pool.setUniform("g", ACG::Vec2ui(1, 2));
+    EXPECT_EQ(pool.str(), "uniform float f = 1.5\nuniform vec2 v = vec2(1, 2);\nuniform float g = 5\n");
+
+    // a larger vector moves the value, but not the entry
+    pool.setUniform("v", ACG::Vec4f(1.0f, 2.0f, 3.0f, 4.0f));
+    EXPECT_EQ(pool.numUniforms(), 3u);
+    EXPECT_EQ(pool.dataSize(), 6 * sizeof(GLfloat));
+    EXPECT_EQ(pool.str(), "uniform float f = 1.5\nuniform vec4 v = vec4(1, 2, 3, 4);\nuniform float g = 5\n");
+
+    // int and float arrays share one entry, the length may change
+    GLint ints[3] = { 1, 2, 3 };
+    GLfloat floats[2] = { 0.5f, 1.5f };
+    pool.setUniform("a", ints, 3);
+    EXPECT_EQ(pool.str(), "uniform float f = 1.5\nuniform vec4 v = vec4(1, 2, 3, 4);\nuniform float g = 5\nuniform int a[3] = {1, 2, 3};\n");
+
+    pool.setUniform("a", floats, 2);
+    EXPECT_EQ(pool.numUniforms(), 4u);
+    EXPECT_EQ(pool.dataSize(), 8 * sizeof(GLfloat));
+    EXPECT_EQ(pool.str(), "uniform float f = 1.5\nuniform vec4 v = vec4(1, 2, 3, 4);\nuniform float g = 5\nuniform float a[2] = {0.5, 1.5};\n");
+}
+
+TEST(UniformPool, copy) {
+    UniformPoolInspector src;
+    src.setUniform("i", GLint(-7));
+    src.setUniform("u", ACG::Vec2ui(1, 2));
+
+    UniformPoolInspector copy(src);
+    EXPECT_EQ(copy.str(), "uniform int i = -7\nuniform uvec2 u = uvec2(1, 2);\n");
+
+    // the copy has its own storage
+    src.setUniform("i", GLint(8));
+    EXPECT_EQ(copy.str(), "uniform int i = -7\nuniform uvec2 u = uvec2(1, 2);\n");
+
+    // assignment merges like addPool(): existing entries are updated, others are kept
+    UniformPoolInspector dst;
+    dst.setUniform("x", 1.0f);
+    dst.setUniform("i", GLint(0));
+    dst = src;
+    EXPECT_EQ(dst.str(), "uniform float x = 1\nuniform int i = 8\nuniform uvec2 u = uvec2(1, 2);\n");
+
+    // self assignment keeps the values
+    const UniformPoolInspector& self = dst;
+    dst = self;
+    EXPECT_EQ(dst.str(), "uniform float x = 1\nuniform int i = 8\nuniform uvec2 u = uvec2(1, 2);\n");
+}
+
+TEST(UniformPool, addPool) {
+    UniformPoolInspector dst, src;
+    dst.setUniform("a", 1.0f);
+    dst.setUniform("b", ACG::Vec2f(1.0f, 2.0f));
+
+    src.setUniform("b", ACG::Vec3f(3.0f, 4.0f, 5.0f));
+    src.setUniform("c", GLuint(6));
+    src.setUniform("a", GLint(9));
+
+    // b is updated, c is appended, a keeps its value because of the type mismatch
+    dst.addPool(src);
+    EXPECT_EQ(dst.numUniforms(), 3u);
+    EXPECT_EQ(dst.str(), "uniform float a = 1\nuniform vec3 b = vec3(3, 4, 5);\nuniform uint c = 6\n");
+
+    // the source is unchanged
+    EXPECT_EQ(src.str(), "uniform vec3 b = vec3(3, 4, 5);\nuniform uint c = 6\nuniform int a = 9\n");
+}
+
+TEST(UniformPool, clear_keepsCapacity) {
+    UniformPoolInspector pool;
+    for (int i = 0; i < 16; ++i)
+        pool.setUniform(("u" + std::to_string(i)).c_str(), ACG::Vec4f(float(i), 0.0f, 0.0f, 1.0f));
+
+    const size_t uniformCapacity = pool.uniformCapacity();
+    const size_t dataCapacity = pool.dataCapacity();
+
+    pool.clear();
+    EXPECT_TRUE(pool.empty());
+    EXPECT_EQ(pool.dataSize(), 0u);
+    EXPECT_EQ(pool.str(), "");
+    EXPECT_EQ(pool.uniformCapacity(), uniformCapacity);
+    EXPECT_EQ(pool.dataCapacity(), dataCapacity);
+
+    // refilling reuses the memory
+    pool.setUniform("u0", 1.0f);
+    EXPECT_EQ(pool.str(), "uniform float u0 = 1\n");
+    EXPECT_EQ(pool.dataCapacity(), dataCapacity);
+}
+
+TEST(UniformPool, toString_matrices) {
+    ACG::GLMatrixf m;
+    for (int row = 0; row < 4; ++row)
+        for (int col = 0; col < 4; ++col)
+            m(row, col) = float(10 * row + col);
+
+    UniformPoolInspector pool;
+    pool.setUniform("m4", m);
+    pool.setUniformMat3("m3", m);
+
+    // printed row by row, mat3 is the upper left block
+    EXPECT_EQ(pool.str(),
+              "uniform mat4 m4 = {{0, 1, 2, 3}, {10, 11, 12, 13}, {20, 21, 22, 23}, {30, 31, 32, 33}};\n"
+              "uniform mat3 m3 = {{0, 1, 2}, {10, 11, 12}, {20, 21, 22}};\n");
+}
+
+TEST(UniformPool, nameIds) {
+    const int id = GLSL::UniformPool::getNameId("UniformPool_test_name");
+    EXPECT_EQ(id, GLSL::UniformPool::getNameId(std::string("UniformPool_test_name").c_str()));
+    EXPECT_NE(id, GLSL::UniformPool::getNameId("UniformPool_test_other"));
+    EXPECT_STREQ(GLSL::UniformPool::getName(id), "UniformPool_test_name");
+}
+
+}
@@ -113,3 +113,93 @@ TEST_F(HistogramTest, simpleInt ) {
     ASSERT_EQ(boundaries, correct_boundaries);
 }
 #endif
+
+TEST_F(HistogramTest, accumulatorUnbinned ) {
+    std::vector<int> v {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5};
+
+    ACG::HistogramAccumulator<int> acc(10);
+    acc.addRange(v);
+
+    auto hist = acc.createHistogram();
+    auto reference = ACG::create_histogram_auto(v, 10);
+
+    ASSERT_TRUE(hist != nullptr);
+    EXPECT_EQ(hist->getLabelType(), Histogram::LabelType::PerBin);
+    EXPECT_EQ(hist->getBins(), reference->getBins());
+    EXPECT_EQ(acc.getCount(), v.size());
+    EXPECT_EQ(acc.getMin(), 1);
+    EXPECT_EQ(acc.getMax(), 9);
+}
+
+TEST_F(HistogramTest, accumulatorSimpleDouble ) {
+    std::vector<double> v {1.0, 1.1, 2.0};
+
+    ACG::HistogramAccumulator<double> acc(2);
+    acc.addRange(v);
+    auto hist = acc.createHistogram();
+
+    std::vector<size_t> correct_bins {2, 1};
+    EXPECT_EQ(hist->getBins(), correct_bins);
+    EXPECT_DOUBLE_EQ(hist->getTotalWidth(), 1.0);
+}
+
+TEST_F(HistogramTest, accumulatorMergedMatchesExact ) {
+    // sum of uniform values, roughly normal distribution
+    std::vector<double> v(1000000);
+    unsigned int seed = 4711;
+    for (double &x: v) {
+        x = 0.;
+        for (int k = 0; k < 4; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            x += (seed >> 8) / double(1 << 24);
+        }
+    }
+
+    // four partial accumulators, e.g. one per thread
+    std::vector<ACG::HistogramAccumulator<double>> partial(4);
+    for (size_t i = 0; i < v.size(); ++i)
+        partial[i % 4].add(v[i]);
+    for (size_t t = 1; t < partial.size(); ++t)
+        partial[0].merge(partial[t]);
+
+    const ACG::HistogramAccumulator<double> &acc = partial[0];
+    EXPECT_EQ(acc.getCount(), v.size());
+
+    auto hist = acc.createHistogram();
+    auto reference = ACG::create_histogram_auto(v);
+
+    const auto &bins = hist->getBins();
+    const auto &reference_bins = reference->getBins();
+    ASSERT_EQ(bins.size(), reference_bins.size());
+    EXPECT_EQ(std::accumulate(bins.begin(), bins.end(), size_t(0)), v.size());
+
+    for (size_t i = 0; i < bins.size(); ++i)
+        EXPECT_NEAR(double(bins[i]), double(reference_bins[i]), 0.002 * v.size()) << "Bin " << i;
+
+    EXPECT_EQ(dynamic_cast<const HistogramT<double>&>(*hist).getBinBoundaries(),
+              dynamic_cast<const HistogramT<double>&>(*reference).getBinBoundaries());
+
+    // quantiles
+    std::vector<double> sorted = v;
+    std::sort(sorted.begin(), sorted.end());
+    const double quantiles[] = { 0.001, 0.01, 0.25, 0.5, 0.75, 0.99, 0.999 };
+    for (double q: quantiles)
+        EXPECT_NEAR(acc.quantile(q), sorted[size_t(q * (v.size() - 1))], 0.01) << "Quantile " << q;
+}
+
+TEST_F(HistogramTest, accumulatorOutliers ) {
+    std::vector<int> v;
+    for (int i = 0; i < 10000; ++i)
+        v.push_back(i % 100);
+    v.push_back(1000000);
+
+    ACG::HistogramAccumulator<int> acc(10);
+    acc.addRange(v);
+
+    auto hist = acc.createHistogram(0.01);
+    const auto &boundaries = dynamic_cast<const HistogramT<int>&>(*hist).getBinBoundaries();
+    EXPECT_LT(boundaries.back(), 1000) << "Outlier was not clipped";
+
+    const auto &bins = hist->getBins();
+    EXPECT_EQ(std::accumulate(bins.begin(), bins.end(), size_t(0)), v.size());
+}